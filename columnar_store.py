@@ -0,0 +1,429 @@
+"""Append-only columnar segment store for raw telemetry, an optional storage engine for server.py.
+
+Layout under the data directory, one directory per node (hex-encoded node_id):
+
+    <root>/<node_hex>/active.wal            open segment, fixed 36-byte records (id, t_ms, 5 x int32)
+    <root>/<node_hex>/seg-000001.id         row ids, int64[rows]
+    <root>/<node_hex>/seg-000001.ts         timestamps in ms, zigzag delta varints, restarted per block
+    <root>/<node_hex>/seg-000001.<metric>   values, fixed-point int32[rows] (NULL_VALUE for missing)
+    <root>/<node_hex>/seg-000001.idx        sparse time index, one entry per block of rows
+
+Row i of every file in a segment belongs to the same reading, and rows of a node are
+appended in id order. Sealed segments are written once (tmp + rename, .idx last) and then
+only read through mmap; a range scan of one metric touches .idx, .ts and that metric's file.
+
+It implements the DBController calls server.py makes (initialize, save, fetch_recent,
+fetch_series), so it can be selected with `python server.py --storage columnar`.
+"""
+import heapq
+from bisect import bisect_right
+import mmap
+import os
+import struct
+import threading
+from array import array
+from datetime import datetime, timezone
+from pathlib import Path
+from typing import Any, Dict, Iterator, List, Optional, Tuple
+
+# (metric, fixed-point scale): stored value = round(value * scale)
+METRICS: Tuple[Tuple[str, int], ...] = (
+    ('temperature_celsius', 100),
+    ('humidity_percent', 100),
+    ('luminosity_lux', 100),
+    ('presence_detected', 1),
+    ('power_on', 1),
+)
+METRIC_SCALE = dict(METRICS)
+NULL_VALUE = -2 ** 31
+INT32_MAX = 2 ** 31 - 1
+
+WAL_RECORD = struct.Struct('<qq' + 'i' * len(METRICS))
+IDX_MAGIC = b'LCS1'
+IDX_HEADER = struct.Struct('<4sIIIq')       # magic, rows, block_rows, blocks, first_id
+IDX_ENTRY = struct.Struct('<qqqI')          # t_first, t_min, t_max, ts_offset
+
+
+def _timestamp_ms(value: Any) -> Optional[int]:
+    """ISO-8601 (naive means UTC, 'Z' allowed) or epoch seconds -> epoch milliseconds."""
+    if value is None:
+        return None
+    if isinstance(value, (int, float)):
+        return int(value * 1000)
+    text = str(value).strip()
+    try:
+        return int(float(text) * 1000)
+    except ValueError:
+        pass
+    try:
+        dt = datetime.fromisoformat(text.replace('Z', '+00:00'))
+    except ValueError:
+        return None
+    if dt.tzinfo is None:
+        dt = dt.replace(tzinfo=timezone.utc)
+    return int(dt.timestamp() * 1000)
+
+
+def _iso(t_ms: int) -> str:
+    return datetime.fromtimestamp(t_ms / 1000, timezone.utc).strftime('%Y-%m-%dT%H:%M:%S.%f')[:-3] + 'Z'
+
+
+def _fixed(value: Any, scale: int) -> int:
+    if value is None:
+        return NULL_VALUE
+    v = round(float(value) * scale)
+    return max(NULL_VALUE + 1, min(INT32_MAX, v))
+
+
+def encode_block(ts: array, start: int, end: int) -> bytes:
+    """Zigzag delta varints of ts[start:end]; the first delta is relative to ts[start] (always 0)."""
+    out = bytearray()
+    prev = ts[start]
+    for i in range(start, end):
+        d = ts[i] - prev
+        prev = ts[i]
+        n = (d << 1) ^ (d >> 63)
+        while n >= 0x80:
+            out.append((n & 0x7F) | 0x80)
+            n >>= 7
+        out.append(n)
+    return bytes(out)
+
+
+def decode_block(buf, pos: int, count: int, base: int) -> array:
+    out = array('q')
+    t = base
+    for _ in range(count):
+        n = shift = 0
+        while True:
+            b = buf[pos]
+            pos += 1
+            n |= (b & 0x7F) << shift
+            if b < 0x80:
+                break
+            shift += 7
+        t += (n >> 1) ^ -(n & 1)
+        out.append(t)
+    return out
+
+
+def _write_atomic(path: Path, data: bytes) -> None:
+    tmp = path.with_name(path.name + '.tmp')
+    with open(tmp, 'wb') as f:
+        f.write(data)
+        f.flush()
+        os.fsync(f.fileno())
+    os.replace(tmp, path)
+
+
+def _map(path: Path) -> mmap.mmap:
+    with open(path, 'rb') as f:
+        return mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+
+class Segment:
+    """Read-only view of a sealed segment. Files are mapped once and kept for the process lifetime."""
+    def __init__(self, base: Path):
+        self.base = base
+        raw = base.with_suffix('.idx').read_bytes()
+        magic, self.rows, self.block_rows, blocks, self.first_id = IDX_HEADER.unpack_from(raw, 0)
+        if magic != IDX_MAGIC:
+            raise ValueError(f'{base}: bad segment index')
+        self.blocks = [IDX_ENTRY.unpack_from(raw, IDX_HEADER.size + i * IDX_ENTRY.size) for i in range(blocks)]
+        self.t_min = min(b[1] for b in self.blocks)
+        self.t_max = max(b[2] for b in self.blocks)
+        self._ts = _map(base.with_suffix('.ts'))
+        self.ids = memoryview(_map(base.with_suffix('.id'))).cast('q')
+        self.last_id = self.ids[self.rows - 1]
+        self._cols: Dict[str, memoryview] = {}
+
+    def column(self, metric: str) -> memoryview:
+        col = self._cols.get(metric)
+        if col is None:
+            col = memoryview(_map(self.base.with_suffix('.' + metric))).cast('i')
+            self._cols[metric] = col
+        return col
+
+    def block_times(self, b: int) -> array:
+        t_first, _, _, offset = self.blocks[b]
+        start = b * self.block_rows
+        return decode_block(self._ts, offset, min(self.block_rows, self.rows - start), t_first)
+
+    @staticmethod
+    def write(base: Path, ids: array, ts: array, cols: Dict[str, array], block_rows: int) -> None:
+        rows = len(ids)
+        ts_bytes = bytearray()
+        entries = []
+        for start in range(0, rows, block_rows):
+            end = min(start + block_rows, rows)
+            block = ts[start:end]
+            entries.append((ts[start], min(block), max(block), len(ts_bytes)))
+            ts_bytes += encode_block(ts, start, end)
+        _write_atomic(base.with_suffix('.id'), ids.tobytes())
+        _write_atomic(base.with_suffix('.ts'), bytes(ts_bytes))
+        for metric, values in cols.items():
+            _write_atomic(base.with_suffix('.' + metric), values.tobytes())
+        idx = IDX_HEADER.pack(IDX_MAGIC, rows, block_rows, len(entries), ids[0])
+        idx += b''.join(IDX_ENTRY.pack(*e) for e in entries)
+        _write_atomic(base.with_suffix('.idx'), idx)   # last: its presence marks the segment complete
+
+
+class _Node:
+    def __init__(self, node_id: str, path: Path):
+        self.node_id = node_id
+        self.path = path
+        self.segments: List[Segment] = []
+        self.ids = array('q')
+        self.ts = array('q')
+        self.cols = {m: array('i') for m, _ in METRICS}
+        self.wal = None
+
+    @property
+    def last_id(self) -> int:
+        if self.ids:
+            return self.ids[-1]
+        return self.segments[-1].last_id if self.segments else 0
+
+    def open(self) -> None:
+        self.path.mkdir(parents=True, exist_ok=True)
+        for idx in sorted(self.path.glob('seg-*.idx')):
+            self.segments.append(Segment(idx.with_suffix('')))
+        for tmp in self.path.glob('*.tmp'):
+            tmp.unlink()
+        sealed_id = self.last_id
+        wal_path = self.path / 'active.wal'
+        if wal_path.exists():
+            data = wal_path.read_bytes()
+            whole = len(data) - len(data) % WAL_RECORD.size   # drop a torn trailing record
+            for rec in WAL_RECORD.iter_unpack(data[:whole]):
+                if rec[0] > sealed_id:                        # already sealed before a crash
+                    self._append_mem(rec)
+            if whole != len(data):
+                with open(wal_path, 'r+b') as f:
+                    f.truncate(whole)
+        self.wal = open(wal_path, 'ab')
+
+    def _append_mem(self, rec: Tuple[int, ...]) -> None:
+        self.ids.append(rec[0])
+        self.ts.append(rec[1])
+        for (metric, _), v in zip(METRICS, rec[2:]):
+            self.cols[metric].append(v)
+
+    def append(self, rec: Tuple[int, ...]) -> None:
+        self.wal.write(WAL_RECORD.pack(*rec))
+        self._append_mem(rec)
+
+    def sync(self, fsync: bool) -> None:
+        self.wal.flush()
+        if fsync:
+            os.fsync(self.wal.fileno())
+
+    def seal(self, block_rows: int) -> None:
+        self.wal.flush()
+        base = self.path / f'seg-{len(self.segments) + 1:06d}'
+        Segment.write(base, self.ids, self.ts, self.cols, block_rows)
+        self.segments.append(Segment(base))
+        self.wal.close()
+        self.wal = open(self.path / 'active.wal', 'wb')
+        self.ids, self.ts = array('q'), array('q')
+        self.cols = {m: array('i') for m, _ in METRICS}
+
+    def snapshot(self, start: int = 0, stop: Optional[int] = None) -> Tuple[List[Segment], array, array, Dict[str, array]]:
+        return (list(self.segments), self.ids[start:stop], self.ts[start:stop],
+                {m: c[start:stop] for m, c in self.cols.items()})
+
+    def window(self, limit: int, after_id: Optional[int]) -> Tuple[List[Segment], array, array, Dict[str, array]]:
+        """Snapshot holding only the rows fetch_recent can take from this node (at most limit)."""
+        if after_id is None:
+            start = max(0, len(self.ids) - limit)
+            segments, ids, ts, cols = self.snapshot(start)
+            # A full page from the active tail leaves nothing for the sealed segments to add
+            return ([] if start else segments), ids, ts, cols
+        start = bisect_right(self.ids, after_id)
+        return self.snapshot(start, start + limit)
+
+
+class ColumnarStore:
+    """Drop-in storage engine for server.py with columnar, append-only segments per node."""
+    def __init__(self, root: Path, segment_rows: int = 65536, block_rows: int = 1024, fsync: bool = False):
+        self.root = Path(root)
+        self.segment_rows = segment_rows
+        self.block_rows = block_rows
+        self.fsync = fsync
+        self._nodes: Dict[str, _Node] = {}
+        self._next_id = 1
+        self._lock = threading.Lock()
+
+    def initialize(self) -> None:
+        self.root.mkdir(parents=True, exist_ok=True)
+        for d in sorted(p for p in self.root.iterdir() if p.is_dir()):
+            node = _Node(bytes.fromhex(d.name).decode('utf-8'), d)
+            node.open()
+            self._nodes[node.node_id] = node
+            self._next_id = max(self._next_id, node.last_id + 1)
+
+    def close(self) -> None:
+        with self._lock:
+            for node in self._nodes.values():
+                node.wal.close()
+
+    def _node(self, node_id: str) -> _Node:
+        node = self._nodes.get(node_id)
+        if node is None:
+            node = _Node(node_id, self.root / node_id.encode('utf-8').hex())
+            node.open()
+            self._nodes[node_id] = node
+        return node
+
+    def save(self, payload: Dict[str, Any]) -> None:
+        self.save_many([payload])
+
+    def save_many(self, payloads: List[Dict[str, Any]]) -> None:
+        recs = []
+        last_stamp, last_ms = None, None
+        for payload in payloads:
+            sensors = payload.get('sensors')
+            if sensors is None:
+                continue
+            stamp = payload.get('timestamp')
+            # Readings of one gateway cycle share a timestamp; parse it once.
+            if stamp != last_stamp:
+                last_stamp, last_ms = stamp, _timestamp_ms(stamp)
+            t_ms = last_ms
+            if t_ms is None:
+                t_ms = int(datetime.now(timezone.utc).timestamp() * 1000)
+            # Flags are stored as 0/1 like the SQLite engine does, never NULL.
+            values = tuple(_fixed(sensors.get(m), scale) if scale != 1 else int(bool(sensors.get(m)))
+                           for m, scale in METRICS)
+            recs.append((str(payload.get('node_id')), t_ms, values))
+        with self._lock:
+            touched = set()
+            for node_id, t_ms, values in recs:
+                node = self._node(node_id)
+                node.append((self._next_id, t_ms) + values)
+                self._next_id += 1
+                if len(node.ids) >= self.segment_rows:
+                    node.seal(self.block_rows)
+                else:
+                    touched.add(node)
+            # One WAL write per node per call, so batched ingest amortizes the syscalls.
+            for node in touched:
+                node.sync(self.fsync)
+
+    # ---------------- Reads ----------------
+
+    @staticmethod
+    def _row(node_id: str, row_id: int, t_ms: int, values: List[int]) -> Dict[str, Any]:
+        sensors: Dict[str, Any] = {}
+        for (metric, scale), v in zip(METRICS, values):
+            if scale == 1:
+                sensors[metric] = bool(v)
+            else:
+                sensors[metric] = v / scale if v != NULL_VALUE else None
+        return {'id': row_id, 'node_id': node_id, 'timestamp': _iso(t_ms), 'sensors': sensors}
+
+    def _rows_desc(self, node_id: str, snap, after_id: int) -> Iterator[Tuple[int, Dict[str, Any]]]:
+        """Rows of one node, newest id first, stopping at after_id."""
+        segments, ids, ts, cols = snap
+        for i in range(len(ids) - 1, -1, -1):
+            if ids[i] <= after_id:
+                return
+            yield -ids[i], self._row(node_id, ids[i], ts[i], [cols[m][i] for m, _ in METRICS])
+        for seg in reversed(segments):
+            if seg.last_id <= after_id:
+                return
+            seg_cols = [seg.column(m) for m, _ in METRICS]
+            b_cached, times = -1, None
+            for i in range(seg.rows - 1, -1, -1):
+                if seg.ids[i] <= after_id:
+                    return
+                b = i // seg.block_rows
+                if b != b_cached:
+                    b_cached, times = b, seg.block_times(b)
+                yield -seg.ids[i], self._row(node_id, seg.ids[i], times[i - b * seg.block_rows],
+                                             [c[i] for c in seg_cols])
+
+    def _rows_asc(self, node_id: str, snap, after_id: int) -> Iterator[Tuple[int, Dict[str, Any]]]:
+        """Rows of one node, oldest id first, starting after after_id."""
+        segments, ids, ts, cols = snap
+        for seg in segments:
+            if seg.last_id <= after_id:
+                continue
+            seg_cols = [seg.column(m) for m, _ in METRICS]
+            b_cached, times = -1, None
+            for i in range(bisect_right(seg.ids, after_id), seg.rows):
+                b = i // seg.block_rows
+                if b != b_cached:
+                    b_cached, times = b, seg.block_times(b)
+                yield seg.ids[i], self._row(node_id, seg.ids[i], times[i - b * seg.block_rows],
+                                            [c[i] for c in seg_cols])
+        for i in range(bisect_right(ids, after_id), len(ids)):
+            yield ids[i], self._row(node_id, ids[i], ts[i], [cols[m][i] for m, _ in METRICS])
+
+    def fetch_recent(self, limit: int = 100, after_id: Optional[int] = None) -> List[Dict[str, Any]]:
+        """Newest rows first (ingest order). With after_id, the next `limit` rows after that id,
+        oldest first (same contract as DBController.fetch_recent)."""
+        with self._lock:
+            snaps = [(n.node_id, n.window(limit, after_id)) for n in self._nodes.values()]
+        if after_id is None:
+            streams = [self._rows_desc(node_id, snap, 0) for node_id, snap in snaps]
+        else:
+            streams = [self._rows_asc(node_id, snap, after_id) for node_id, snap in snaps]
+        out = []
+        for _, row in heapq.merge(*streams, key=lambda item: item[0]):
+            out.append(row)
+            if len(out) >= limit:
+                break
+        return out
+
+    def fetch_series(self, node_id: str, metric: str, t_from: Optional[float] = None,
+                     t_to: Optional[float] = None) -> Tuple[array, array]:
+        """Raw (epoch seconds, value) columns of one metric for one node, time ordered, NULLs skipped."""
+        scale = METRIC_SCALE.get(metric)
+        if scale is None:
+            raise ValueError(f'unknown metric {metric!r}')
+        lo = int(t_from * 1000) if t_from is not None else -2 ** 63
+        hi = int(t_to * 1000) if t_to is not None else 2 ** 63 - 1
+        with self._lock:
+            node = self._nodes.get(str(node_id))
+            if node is None:
+                return array('d'), array('d')
+            segments, _, ts, cols = node.snapshot()
+
+        t_ms, raw = array('q'), array('i')
+        for seg in segments:
+            if seg.t_max < lo or seg.t_min > hi:
+                continue
+            col = seg.column(metric)
+            for b, (_, b_min, b_max, _) in enumerate(seg.blocks):
+                if b_max < lo or b_min > hi:
+                    continue
+                start = b * seg.block_rows
+                times = seg.block_times(b)
+                if lo <= b_min and b_max <= hi:
+                    t_ms.extend(times)
+                    raw.extend(col[start:start + len(times)])
+                    continue
+                for i, t in enumerate(times):
+                    if lo <= t <= hi:
+                        t_ms.append(t)
+                        raw.append(col[start + i])
+        active = cols[metric]
+        for i, t in enumerate(ts):
+            if lo <= t <= hi:
+                t_ms.append(t)
+                raw.append(active[i])
+
+        pairs = [(t, v) for t, v in zip(t_ms, raw) if v != NULL_VALUE]
+        if any(pairs[i][0] > pairs[i + 1][0] for i in range(len(pairs) - 1)):
+            pairs.sort(key=lambda p: p[0])
+        return array('d', (t / 1000.0 for t, _ in pairs)), array('d', (v / scale for _, v in pairs))
+
+    def stats(self) -> Dict[str, int]:
+        with self._lock:
+            return {
+                'nodes': len(self._nodes),
+                'segments': sum(len(n.segments) for n in self._nodes.values()),
+                'active_rows': sum(len(n.ids) for n in self._nodes.values()),
+                'next_id': self._next_id,
+            }
@@ -5,13 +5,16 @@
  * Observações:
  * - Todos os valores podem ser sobrescritos por -D no platformio.ini (ex.: -DCLIENT_ID=2).
  * - Mantido o mapeamento de pinos para XIAO ESP32-S3 + Wio SX1262.
- * - Layout de payload definido em protocol.h (little-endian, 16 bytes).
+ * - Layout de payload definido em protocol.h (little-endian; v2 16 bytes, resumo 28 bytes).
+ * - CLIENT_ID é o endereço de 16 bits do nó (0..65534); USE_LEGACY_FRAME=true
+ *   volta ao quadro antigo de 8 bits (só para redes com gateways antigos).
  */
 
 #ifndef CONFIG_H
 #define CONFIG_H
 
 #include <Arduino.h>
+#include "protocol.h"
 
 // ============================================================================
 // Seção: Defaults sobrescrevíveis (permitem -DCHAVE=valor no platformio.ini)
@@ -21,6 +24,9 @@
 #ifndef CLIENT_ID
   #define CLIENT_ID 1
 #endif
+#ifndef USE_LEGACY_FRAME
+  #define USE_LEGACY_FRAME false   // true: quadro MSG_TYPE_SENSOR_DATA (endereço de 8 bits)
+#endif
 
 // ---------- Telemetria e energia ----------
 #ifndef TX_INTERVAL_MS
@@ -66,6 +72,22 @@
   #define MOISTURE_WET_VALUE 1500     // molhado (calibrar)
 #endif
 
+// Amostragem contínua: timer de hardware dispara uma tarefa que lê os sensores
+// a SAMPLE_RATE_HZ; cada TX leva mín/máx/média/desvio da janela
+// (MSG_TYPE_SENSOR_SUMMARY). Exige o MCU acordado entre transmissões.
+#ifndef ENABLE_SAMPLER
+  #define ENABLE_SAMPLER (!ENABLE_DEEP_SLEEP)
+#endif
+#ifndef SAMPLE_RATE_HZ
+  #define SAMPLE_RATE_HZ 10           // HC-SR04: no máximo ~16 Hz (eco de até 30 ms + folga)
+#endif
+#ifndef SAMPLER_TIMER
+  #define SAMPLER_TIMER 0             // timer de hardware usado (core Arduino 2.x)
+#endif
+#ifndef SAMPLER_CORE
+  #define SAMPLER_CORE 0              // loop() e rádio ficam no core 1
+#endif
+
 // Parâmetros de simulação (quando USE_REAL_SENSORS=false)
 #ifndef HUMID_BASE
   #define HUMID_BASE 60.0
@@ -95,6 +117,80 @@
   #define MAX_TX_RETRIES 3
 #endif
 
+// ---------- Modo repetidor (somente nós com alimentação contínua) ----------
+// O nó escuta entre suas transmissões e reencaminha, em lotes, os quadros dos
+// nós listados em RELAY_DOWNSTREAM (ex.: -DRELAY_DOWNSTREAM="5,6,7").
+#ifndef ENABLE_RELAY
+  #define ENABLE_RELAY false
+#endif
+#ifndef RELAY_DOWNSTREAM
+  #define RELAY_DOWNSTREAM NODE_ADDR_NONE   // lista vazia
+#endif
+#ifndef RELAY_MAX_HOPS
+  #define RELAY_MAX_HOPS 2          // saltos máximos de uma leitura até o gateway
+#endif
+#ifndef RELAY_BATCH_MAX
+  #define RELAY_BATCH_MAX 8         // registros por lote (1..14)
+#endif
+#ifndef RELAY_FLUSH_MS
+  #define RELAY_FLUSH_MS 5000       // retenção máxima antes de transmitir um lote incompleto
+#endif
+#ifndef RELAY_DEDUP_SIZE
+  #define RELAY_DEDUP_SIZE 32       // pares (origem, seq) lembrados para descartar duplicatas
+#endif
+
+// ---------- Downlink (comandos do gateway) ----------
+// Após cada uplink o nó abre uma janela curta de RX, DOWNLINK_RX_DELAY_MS depois
+// do fim do TX (mesmo valor no gateway). A janela cobre só a detecção do
+// cabeçalho (preâmbulo + header) com DOWNLINK_RX_MARGIN_MS de folga de cada lado;
+// detectado o cabeçalho, o rádio recebe o quadro até o fim.
+#ifndef ENABLE_DOWNLINK
+  #define ENABLE_DOWNLINK (!USE_LEGACY_FRAME)
+#endif
+#ifndef DOWNLINK_RX_DELAY_MS
+  #define DOWNLINK_RX_DELAY_MS 250
+#endif
+#ifndef DOWNLINK_RX_MARGIN_MS
+  #define DOWNLINK_RX_MARGIN_MS 15  // cobre a latência do gateway e o desvio dos relógios
+#endif
+// Estimativa de energia da janela (datasheets; ajuste à placa)
+#ifndef RADIO_RX_CURRENT_MA
+  #define RADIO_RX_CURRENT_MA 4.6   // SX1262 em RX, DC-DC, ganho normal
+#endif
+#ifndef MCU_ACTIVE_CURRENT_MA
+  #define MCU_ACTIVE_CURRENT_MA 40.0  // ESP32-S3 acordado (só conta com deep sleep)
+#endif
+#ifndef SUPPLY_VOLTAGE_V
+  #define SUPPLY_VOLTAGE_V 3.3
+#endif
+
+// ---------- Fila em flash (leituras não entregues) ----------
+// Uplink sem sucesso vai para a partição STORE_PARTITION (partitions.csv) e é
+// reenviado em lotes MSG_TYPE_RELAY_BATCH quando o enlace volta. O TX do LoRa
+// não confirma entrega: com STORE_REQUIRE_ACK, "entregue" é ouvir o gateway na
+// janela de downlink (DL_CMD_ACK ou comando) — exige DL_ACK_UPLINKS=true nele.
+#ifndef ENABLE_STORE
+  #define ENABLE_STORE false
+#endif
+#ifndef STORE_PARTITION
+  #define STORE_PARTITION "store"
+#endif
+#ifndef STORE_REQUIRE_ACK
+  #define STORE_REQUIRE_ACK (ENABLE_DOWNLINK)   // false: só falhas de TX vão para a fila
+#endif
+#ifndef STORE_NEWEST_FIRST
+  #define STORE_NEWEST_FIRST false   // true: reenvia as leituras mais recentes primeiro
+#endif
+#ifndef STORE_BATCH_MAX
+  #define STORE_BATCH_MAX 14         // registros por lote (1..14)
+#endif
+#ifndef STORE_AIRTIME_PCT
+  #define STORE_AIRTIME_PCT 1.0      // % do tempo que o nó pode transmitir (uplinks + reenvios)
+#endif
+#ifndef STORE_AIRTIME_BURST_MS
+  #define STORE_AIRTIME_BURST_MS 3000  // crédito máximo de tempo de ar acumulado
+#endif
+
 // ---------- Debug ----------
 #ifndef DEBUG_MODE
   #define DEBUG_MODE true
@@ -127,6 +223,14 @@
 #ifndef LORA_SCK
   #define LORA_SCK  7
 #endif
+// DMA desligado por padrão: o ganho sobre o SPIClass ainda não foi medido em
+// placa (nenhum número de tempo de transação coletado até agora)
+#ifndef LORA_SPI_DMA
+  #define LORA_SPI_DMA false        // true: SPI master do ESP-IDF com DMA (esp_dma_hal.h) | false: SPIClass
+#endif
+#ifndef LORA_SPI_CLOCK_HZ
+  #define LORA_SPI_CLOCK_HZ 8000000UL   // SX1262 aceita até 16 MHz; cai sozinho se a verificação do SPI falhar
+#endif
 
 // Controle SX1262
 #ifndef LORA_NSS
@@ -161,8 +265,11 @@
 #ifndef LORA_TX_POWER_DBM
   #define LORA_TX_POWER_DBM 20      // máx ~22
 #endif
+#ifndef GATEWAY_LOW_POWER_RX
+  #define GATEWAY_LOW_POWER_RX false  // gateway em RX duty cycle (LOW_POWER_RX): preâmbulo longo
+#endif
 #ifndef LORA_PREAMBLE_LEN
-  #define LORA_PREAMBLE_LEN 8
+  #define LORA_PREAMBLE_LEN (GATEWAY_LOW_POWER_RX ? 64 : 8)   // 64 = LP_PREAMBLE do gateway
 #endif
 
 // ============================================================================
@@ -170,7 +277,8 @@
 // ============================================================================
 
 namespace NodeCfg {
-  constexpr uint8_t  kClientId        = static_cast<uint8_t>(CLIENT_ID);
+  constexpr uint16_t kClientId        = static_cast<uint16_t>(CLIENT_ID);
+  constexpr bool     kLegacyFrame     = (USE_LEGACY_FRAME);
   constexpr uint32_t kTxIntervalMs    = static_cast<uint32_t>(TX_INTERVAL_MS);
   constexpr bool     kDeepSleep       = (ENABLE_DEEP_SLEEP);
   constexpr uint64_t kSleepTimeUs     = static_cast<uint64_t>(SLEEP_TIME_US);
@@ -195,6 +303,14 @@ namespace SensorCfg {
   constexpr float    kDistVar         = static_cast<float>(DISTANCE_VARIATION);
 }
 
+namespace SamplerCfg {
+  constexpr bool     kEnabled         = (ENABLE_SAMPLER);
+  constexpr uint32_t kRateHz          = static_cast<uint32_t>(SAMPLE_RATE_HZ);
+  constexpr uint32_t kPeriodUs        = 1000000UL / ((SAMPLE_RATE_HZ) > 0 ? static_cast<uint32_t>(SAMPLE_RATE_HZ) : 1);
+  constexpr uint8_t  kTimer           = static_cast<uint8_t>(SAMPLER_TIMER);
+  constexpr int      kCore            = SAMPLER_CORE;
+}
+
 namespace LinkCfg {
   // SPI/pinos
   constexpr uint8_t kMosi = static_cast<uint8_t>(LORA_MOSI);
@@ -204,6 +320,8 @@ namespace LinkCfg {
   constexpr uint8_t kRst  = static_cast<uint8_t>(LORA_RST);
   constexpr uint8_t kDio1 = static_cast<uint8_t>(LORA_DIO1);
   constexpr uint8_t kBusy = static_cast<uint8_t>(LORA_BUSY);
+  constexpr bool     kSpiDma     = (LORA_SPI_DMA);
+  constexpr uint32_t kSpiClockHz = static_cast<uint32_t>(LORA_SPI_CLOCK_HZ);
 
   // Rádio
   constexpr float    kFreqMHz   = static_cast<float>(LORA_FREQUENCY_MHZ);
@@ -222,6 +340,40 @@ namespace TxPolicy {
   constexpr uint8_t kMaxRetries    = static_cast<uint8_t>(MAX_TX_RETRIES);
 }
 
+namespace RelayCfg {
+  constexpr bool        kEnabled      = (ENABLE_RELAY);
+  constexpr node_addr_t kDownstream[] = { RELAY_DOWNSTREAM };
+  constexpr size_t      kNumDownstream= sizeof(kDownstream) / sizeof(kDownstream[0]);
+  constexpr uint8_t     kMaxHops      = static_cast<uint8_t>(RELAY_MAX_HOPS);
+  constexpr size_t      kBatchMax     = static_cast<size_t>(RELAY_BATCH_MAX);
+  constexpr uint32_t    kFlushMs      = static_cast<uint32_t>(RELAY_FLUSH_MS);
+  constexpr size_t      kDedupSize    = static_cast<size_t>(RELAY_DEDUP_SIZE);
+}
+
+namespace DownlinkCfg {
+  constexpr bool     kEnabled   = (ENABLE_DOWNLINK);
+  constexpr uint32_t kRxDelayMs = static_cast<uint32_t>(DOWNLINK_RX_DELAY_MS);
+  constexpr uint32_t kMarginMs  = static_cast<uint32_t>(DOWNLINK_RX_MARGIN_MS);
+  // Preâmbulo + 4,25 símbolos de sync + 8 símbolos de header, arredondado para cima
+  constexpr float    kSymbolMs  = static_cast<float>(1UL << LinkCfg::kSf) / LinkCfg::kBwKHz;
+  constexpr uint32_t kHeaderMs  = static_cast<uint32_t>((LinkCfg::kPreamble + 4.25f + 8.0f) * kSymbolMs) + 1;
+  constexpr uint32_t kWindowMs  = kHeaderMs + 2 * kMarginMs;
+  constexpr uint32_t kTimeoutRaw= kWindowMs * 64;   // unidades de 15,625 us do SX126x
+  constexpr float    kRxMa      = static_cast<float>(RADIO_RX_CURRENT_MA);
+  constexpr float    kMcuMa     = static_cast<float>(MCU_ACTIVE_CURRENT_MA);
+  constexpr float    kSupplyV   = static_cast<float>(SUPPLY_VOLTAGE_V);
+}
+
+namespace StoreCfg {
+  constexpr bool        kEnabled     = (ENABLE_STORE);
+  constexpr const char* kPartition   = STORE_PARTITION;
+  constexpr bool        kRequireAck  = (STORE_REQUIRE_ACK);
+  constexpr bool        kNewestFirst = (STORE_NEWEST_FIRST);
+  constexpr size_t      kBatchMax    = static_cast<size_t>(STORE_BATCH_MAX);
+  constexpr float       kAirtimePct  = static_cast<float>(STORE_AIRTIME_PCT);
+  constexpr float       kBurstMs     = static_cast<float>(STORE_AIRTIME_BURST_MS);
+}
+
 namespace DebugCfg {
   constexpr bool kDebug = (DEBUG_MODE);
   constexpr uint32_t kBaud = static_cast<uint32_t>(SERIAL_BAUD);
@@ -231,9 +383,24 @@ namespace DebugCfg {
 // Seção: Checks em tempo de compilação
 // ============================================================================
 
-static_assert(NodeCfg::kClientId <= 255, "CLIENT_ID deve caber em uint8_t (0..255).");
+static_assert((CLIENT_ID) >= 0 && (CLIENT_ID) < NODE_ADDR_NONE, "CLIENT_ID deve caber em 16 bits (0..65534).");
+static_assert(!NodeCfg::kLegacyFrame || NodeCfg::kClientId <= 255,
+              "USE_LEGACY_FRAME exige CLIENT_ID em uint8_t (0..255).");
 static_assert(LinkCfg::kSf >= 7 && LinkCfg::kSf <= 12, "LORA_SPREADING_FACTOR deve estar entre 7..12.");
+static_assert(LinkCfg::kSpiClockHz >= 1000000UL && LinkCfg::kSpiClockHz <= 16000000UL, "LORA_SPI_CLOCK_HZ deve estar entre 1..16 MHz (limite do SX1262).");
 static_assert(LinkCfg::kTxPowerDb >= -9 && LinkCfg::kTxPowerDb <= 22, "Potência fora do intervalo típico SX1262.");
+static_assert(!(RelayCfg::kEnabled && NodeCfg::kDeepSleep), "ENABLE_RELAY exige ENABLE_DEEP_SLEEP=false (o repetidor precisa escutar).");
+static_assert(RelayCfg::kBatchMax >= 1 && RelayCfg::kBatchMax <= RELAY_MAX_RECORDS, "RELAY_BATCH_MAX deve estar entre 1..14.");
+static_assert(RelayCfg::kMaxHops >= 1, "RELAY_MAX_HOPS deve ser >= 1.");
+static_assert(!(SamplerCfg::kEnabled && NodeCfg::kDeepSleep), "ENABLE_SAMPLER exige ENABLE_DEEP_SLEEP=false (a janela é amostrada acordado).");
+static_assert(!(SamplerCfg::kEnabled && NodeCfg::kLegacyFrame), "ENABLE_SAMPLER exige quadros v2 (USE_LEGACY_FRAME=false).");
+static_assert(!SamplerCfg::kEnabled || (SamplerCfg::kRateHz >= 1 && SamplerCfg::kRateHz <= 1000), "SAMPLE_RATE_HZ deve estar entre 1..1000.");
+static_assert(!(DownlinkCfg::kEnabled && NodeCfg::kLegacyFrame), "ENABLE_DOWNLINK exige quadros v2 (o gateway endereça por node_addr de 16 bits).");
+static_assert(!DownlinkCfg::kEnabled || DownlinkCfg::kRxDelayMs > DownlinkCfg::kMarginMs, "DOWNLINK_RX_DELAY_MS deve ser maior que DOWNLINK_RX_MARGIN_MS.");
+static_assert(!(StoreCfg::kEnabled && NodeCfg::kLegacyFrame), "ENABLE_STORE exige quadros v2 (o reenvio usa seq e lotes).");
+static_assert(!(StoreCfg::kEnabled && StoreCfg::kRequireAck && !DownlinkCfg::kEnabled), "STORE_REQUIRE_ACK exige ENABLE_DOWNLINK (a confirmação chega na janela de RX).");
+static_assert(StoreCfg::kBatchMax >= 1 && StoreCfg::kBatchMax <= RELAY_MAX_RECORDS, "STORE_BATCH_MAX deve estar entre 1..14.");
+static_assert(StoreCfg::kAirtimePct > 0.0f && StoreCfg::kAirtimePct <= 100.0f, "STORE_AIRTIME_PCT deve estar entre 0 e 100.");
 static_assert(SensorCfg::kDryRaw > SensorCfg::kWetRaw, "MOISTURE_DRY_VALUE deve ser maior que MOISTURE_WET_VALUE.");
 
 // ============================================================================
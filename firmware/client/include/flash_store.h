@@ -0,0 +1,331 @@
+/**
+ * @file flash_store.h
+ * @brief Fila circular em flash para leituras não entregues (store-and-forward do nó).
+ *
+ * @details
+ * Quando todas as tentativas de TX falham (ou o gateway não confirma o uplink),
+ * a leitura é gravada aqui como RelayRecord e reenviada depois, em lotes
+ * MSG_TYPE_RELAY_BATCH com sender == origin e hops == 0.
+ *
+ * Organização (partição de dados própria, ver partitions.csv):
+ * - Setores de 4 KB usados em anel. Cada setor começa com um cabeçalho
+ *   (StoreSectorHeader) com o número de formatação (seq) e o contador de
+ *   apagamentos; seguem registros de 32 bytes gravados em sequência.
+ * - O setor em gravação (head) só é apagado quando o anel dá a volta: todos os
+ *   setores são apagados na mesma proporção (rotação para desgaste uniforme),
+ *   e o contador de apagamentos de cada um sobrevive à formatação.
+ * - Anel cheio: o setor mais antigo é reaproveitado e os pendentes dele são
+ *   perdidos (contados em lost).
+ * - Estado de cada registro no primeiro byte; a flash NOR só leva bits de 1
+ *   para 0, então cada transição é uma gravação de 1 byte sem apagar o setor:
+ *   STORE_FREE (0xFF) -> dados gravados -> STORE_VALID (0xFE) -> STORE_SENT (0xFC).
+ *   Queda de energia no meio da gravação deixa o estado em 0xFF com dados, o
+ *   que é reconhecido e ignorado; o CRC-8 cobre o restante.
+ * - mount() varre a partição inteira (boot a frio); entre deep sleeps o estado
+ *   (State) fica em memória RTC e resume() evita a varredura.
+ *
+ * Este módulo não acessa o rádio. A flash é um parâmetro de template com
+ * read/write/erase_sector/size, para rodar também fora do ESP32.
+ */
+
+#ifndef FLASH_STORE_H
+#define FLASH_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "protocol.h"
+
+#define STORE_SECTOR_SIZE 4096
+#define STORE_RECORD_SIZE 32
+
+#define STORE_FREE  0xFF  ///< Slot apagado
+#define STORE_VALID 0xFE  ///< Leitura pendente de envio
+#define STORE_SENT  0xFC  ///< Enviada (e confirmada, se exigido) ou descartada
+
+/**
+ * @struct StoreSectorHeader
+ * @brief Cabeçalho de setor (ocupa o primeiro slot de 32 bytes).
+ */
+struct __attribute__((packed)) StoreSectorHeader {
+    uint32_t magic;        ///< STORE_MAGIC em setor formatado
+    uint32_t seq;          ///< Ordem de formatação (maior = mais recente)
+    uint32_t erase_count;  ///< Apagamentos deste setor desde o primeiro uso
+    uint8_t  reserved[STORE_RECORD_SIZE - 12];
+};
+
+/**
+ * @struct StoredRecord
+ * @brief Leitura guardada (32 bytes).
+ */
+struct __attribute__((packed)) StoredRecord {
+    uint8_t     state;     ///< STORE_*
+    uint8_t     crc;       ///< CRC-8 dos bytes após este campo
+    uint16_t    session;   ///< Energização em que foi gravada (uptime só vale na mesma)
+    uint32_t    stored_s;  ///< uptime (s) ao gravar
+    RelayRecord rec;       ///< Leitura como vai no lote (hops = 0)
+    uint8_t     pad[STORE_RECORD_SIZE - 8 - sizeof(RelayRecord)];
+};
+
+static_assert(sizeof(StoreSectorHeader) == STORE_RECORD_SIZE, "StoreSectorHeader deve ocupar um slot.");
+static_assert(sizeof(StoredRecord) == STORE_RECORD_SIZE, "StoredRecord deve ter 32 bytes.");
+
+/// CRC-8 (polinômio 0x07), suficiente para detectar gravações incompletas.
+inline uint8_t store_crc8(const uint8_t* data, size_t len) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) crc = (crc & 0x80) ? (uint8_t)(crc << 1 ^ 0x07) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+/**
+ * @class FlashStore
+ * @brief Anel de setores com leituras pendentes, sem heap.
+ *
+ * @tparam Flash Backend com `bool read(uint32_t off, void* dst, size_t n)`,
+ *         `bool write(uint32_t off, const void* src, size_t n)`,
+ *         `bool erase_sector(uint32_t off)` e `uint32_t size()`.
+ */
+template <class Flash>
+class FlashStore {
+public:
+    static constexpr uint32_t kMagic = 0x31524653;   // "SFR1"
+    static constexpr uint16_t kSlots = STORE_SECTOR_SIZE / STORE_RECORD_SIZE - 1;   // 127 por setor
+
+    /// Posição no anel e contadores; cabe em RTC_DATA_ATTR entre deep sleeps.
+    struct State {
+        uint32_t magic;
+        uint16_t sectors;
+        uint16_t head;       ///< Setor em gravação
+        uint16_t tail;       ///< Setor mais antigo que ainda pode ter pendentes
+        uint16_t next;       ///< Próximo slot livre no head
+        uint16_t session;
+        uint32_t head_seq;
+        uint32_t pending;
+        uint32_t stored;     ///< Leituras gravadas
+        uint32_t sent;       ///< Marcadas como enviadas
+        uint32_t lost;       ///< Pendentes sobrescritas com o anel cheio
+        uint32_t corrupt;    ///< Registros com CRC inválido (descartados)
+    };
+
+    /// Registro pendente devolvido por peek(); addr identifica-o em mark_sent().
+    struct Item {
+        uint32_t     addr;
+        StoredRecord r;
+    };
+
+    explicit FlashStore(Flash& flash) : flash_(flash) {}
+
+    /**
+     * @brief Varre a partição: acha o setor mais recente, o próximo slot livre e
+     *        conta os pendentes. Partição sem setor formatado começa do zero.
+     */
+    bool mount() {
+        ready_ = false;
+        st_ = State{};
+        st_.magic = kMagic;
+        st_.sectors = (uint16_t)(flash_.size() / STORE_SECTOR_SIZE);
+        if (st_.sectors < 2) return false;
+
+        bool any = false;
+        for (uint16_t s = 0; s < st_.sectors; s++) {
+            StoreSectorHeader h;
+            if (!read_header(s, h)) continue;
+            if (!any || (int32_t)(h.seq - st_.head_seq) > 0) { st_.head = s; st_.head_seq = h.seq; }
+            any = true;
+        }
+        if (!any) {
+            if (!format(0, 1, 0)) return false;
+            st_.head = st_.tail = 0;
+            st_.head_seq = 1;
+            st_.session = 1;
+            ready_ = true;
+            return true;
+        }
+
+        // Do mais antigo (head + 1) ao head: pendentes, sessão e slot livre
+        uint16_t max_session = 0;
+        bool tail_found = false;
+        st_.tail = st_.head;
+        for (uint16_t i = 1; i <= st_.sectors; i++) {
+            uint16_t s = (uint16_t)((st_.head + i) % st_.sectors);
+            StoreSectorHeader h;
+            if (!read_header(s, h)) continue;
+            for (uint16_t k = 0; k < kSlots; k++) {
+                StoredRecord r;
+                if (!flash_.read(slot_addr(s, k), &r, sizeof(r))) continue;
+                if (blank(r)) continue;
+                if (s == st_.head) st_.next = k + 1;
+                if (r.state == STORE_VALID) {
+                    if (!crc_ok(r)) { retire(slot_addr(s, k)); st_.corrupt++; continue; }
+                    st_.pending++;
+                    if (!tail_found) { st_.tail = s; tail_found = true; }
+                }
+                if (r.session > max_session) max_session = r.session;
+            }
+        }
+        st_.session = max_session == 0xFFFF ? 1 : (uint16_t)(max_session + 1);
+        ready_ = true;
+        return true;
+    }
+
+    /// Retoma o estado guardado em RTC (false: estado inválido, use mount()).
+    bool resume(const State& s) {
+        if (s.magic != kMagic || s.sectors != flash_.size() / STORE_SECTOR_SIZE || s.sectors < 2) return false;
+        st_ = s;
+        ready_ = true;
+        return true;
+    }
+
+    const State& state() const { return st_; }
+    bool ready() const { return ready_; }
+    uint32_t pending() const { return st_.pending; }
+    uint32_t capacity() const { return (uint32_t)st_.sectors * kSlots; }
+
+    /**
+     * @brief Grava uma leitura pendente.
+     * @param now_s uptime (s) — a idade no reenvio é calculada a partir dele.
+     */
+    bool append(const RelayRecord& rec, uint32_t now_s) {
+        if (!ready_) return false;
+        if (st_.next >= kSlots && !advance()) return false;
+
+        StoredRecord r;
+        memset(&r, 0xFF, sizeof(r));
+        r.session  = st_.session;
+        r.stored_s = now_s;
+        r.rec      = rec;
+        r.crc      = crc_of(r);
+        uint32_t addr = slot_addr(st_.head, st_.next++);   // consumido mesmo se falhar
+
+        uint8_t valid = STORE_VALID;
+        if (!flash_.write(addr, &r, sizeof(r)) || !flash_.write(addr, &valid, 1)) return false;
+        st_.pending++;
+        st_.stored++;
+        return true;
+    }
+
+    /**
+     * @brief Copia até max pendentes, do mais novo ou do mais antigo.
+     *        Registros com CRC inválido encontrados no caminho são descartados.
+     */
+    size_t peek(bool newest_first, Item* out, size_t max) {
+        if (!ready_ || st_.pending == 0) return 0;
+        size_t n = 0;
+        const uint16_t tail = st_.tail;
+        uint16_t span = (uint16_t)((st_.head + st_.sectors - tail) % st_.sectors + 1);
+        for (uint16_t i = 0; i < span && n < max; i++) {
+            uint16_t s = newest_first ? (uint16_t)((st_.head + st_.sectors - i) % st_.sectors)
+                                      : (uint16_t)((tail + i) % st_.sectors);
+            uint16_t used = s == st_.head ? st_.next : kSlots;
+            StoreSectorHeader h;
+            if (read_header(s, h)) {
+                for (uint16_t j = 0; j < used && n < max; j++) {
+                    uint16_t k = newest_first ? (uint16_t)(used - 1 - j) : j;
+                    Item& it = out[n];
+                    it.addr = slot_addr(s, k);
+                    if (!flash_.read(it.addr, &it.r, sizeof(it.r)) || it.r.state != STORE_VALID) continue;
+                    if (!crc_ok(it.r)) { retire(it.addr); st_.corrupt++; drop_pending(); continue; }
+                    n++;
+                }
+            }
+            // Setor mais antigo sem pendentes: o próximo passa a ser a cauda
+            if (!newest_first && n == 0 && s == st_.tail && s != st_.head)
+                st_.tail = (uint16_t)((s + 1) % st_.sectors);
+        }
+        return n;
+    }
+
+    /// Marca como enviado um registro devolvido por peek().
+    bool mark_sent(uint32_t addr) {
+        if (!retire(addr)) return false;
+        st_.sent++;
+        drop_pending();
+        return true;
+    }
+
+    /// Menor e maior contador de apagamentos entre os setores formatados.
+    void wear(uint32_t& min_erases, uint32_t& max_erases) const {
+        min_erases = UINT32_MAX;
+        max_erases = 0;
+        for (uint16_t s = 0; s < st_.sectors; s++) {
+            StoreSectorHeader h;
+            if (!read_header(s, h)) continue;
+            if (h.erase_count < min_erases) min_erases = h.erase_count;
+            if (h.erase_count > max_erases) max_erases = h.erase_count;
+        }
+        if (min_erases == UINT32_MAX) min_erases = 0;
+    }
+
+private:
+    static uint32_t sector_addr(uint16_t s) { return (uint32_t)s * STORE_SECTOR_SIZE; }
+    static uint32_t slot_addr(uint16_t s, uint16_t k) {
+        return sector_addr(s) + (uint32_t)(k + 1) * STORE_RECORD_SIZE;
+    }
+
+    static uint8_t crc_of(const StoredRecord& r) {
+        return store_crc8(reinterpret_cast<const uint8_t*>(&r) + 2, sizeof(r) - 2);
+    }
+    static bool crc_ok(const StoredRecord& r) { return r.crc == crc_of(r); }
+
+    static bool blank(const StoredRecord& r) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(&r);
+        for (size_t i = 0; i < sizeof(r); i++) if (p[i] != 0xFF) return false;
+        return true;
+    }
+
+    bool read_header(uint16_t s, StoreSectorHeader& h) const {
+        return flash_.read(sector_addr(s), &h, sizeof(h)) && h.magic == kMagic;
+    }
+
+    bool retire(uint32_t addr) {
+        uint8_t sent = STORE_SENT;
+        return flash_.write(addr, &sent, 1);
+    }
+
+    void drop_pending() {
+        if (st_.pending > 0) st_.pending--;
+        if (st_.pending == 0) st_.tail = st_.head;
+    }
+
+    bool format(uint16_t s, uint32_t seq, uint32_t erases) {
+        if (!flash_.erase_sector(sector_addr(s))) return false;
+        StoreSectorHeader h;
+        memset(&h, 0xFF, sizeof(h));
+        h.magic = kMagic;
+        h.seq = seq;
+        h.erase_count = erases + 1;
+        return flash_.write(sector_addr(s), &h, sizeof(h));
+    }
+
+    /// Passa a gravar no próximo setor do anel (o mais antigo), apagando-o.
+    bool advance() {
+        uint16_t s = (uint16_t)((st_.head + 1) % st_.sectors);
+        uint32_t erases = 0;
+        StoreSectorHeader h;
+        if (read_header(s, h)) {
+            erases = h.erase_count;
+            for (uint16_t k = 0; k < kSlots; k++) {
+                uint8_t state;
+                if (flash_.read(slot_addr(s, k), &state, 1) && state == STORE_VALID) {
+                    st_.lost++;
+                    if (st_.pending > 0) st_.pending--;
+                }
+            }
+        }
+        if (!format(s, st_.head_seq + 1, erases)) return false;
+        st_.head = s;
+        st_.head_seq++;
+        st_.next = 0;
+        if (st_.pending == 0 || st_.tail == s) st_.tail = st_.pending ? (uint16_t)((s + 1) % st_.sectors) : s;
+        return true;
+    }
+
+    Flash& flash_;
+    State  st_ = {};
+    bool   ready_ = false;
+};
+
+#endif // FLASH_STORE_H
@@ -6,37 +6,88 @@
  * @details
  * Este protocolo define diferentes tipos de mensagens, todas transmitidas
  * no formato LITTLE-ENDIAN, otimizadas para redes LoRa de baixa taxa de dados.
- * O principal pacote (SensorDataMessage) contém medições de temperatura,
+ * O principal pacote (SensorDataMessageV2) contém medições de temperatura,
  * umidade e distância, sendo o formato padrão utilizado no projeto.
  *
- * Layout (LITTLE-ENDIAN on ESP32)
+ * Layout v2 — MSG_TYPE_SENSOR_DATA_V2 (LITTLE-ENDIAN on ESP32)
  *  Offset  Size  Field
- *  0       1     msg_type
- *  1       1     client_id
- *  2       4     timestamp (millis)
- *  6       2     temperature (°C x100)
- *  8       2     humidity (% x100)
- *  10      2     distance_cm (uint16)
- *  12      1     battery (%)
- *  13      1     checksum (XOR of bytes [0..12])
- *  14      2     reserved
+ *  0       1     msg_type (0x04)
+ *  1       2     node_addr (endereço de 16 bits)
+ *  3       4     timestamp (millis)
+ *  7       2     temperature (°C x100)
+ *  9       2     humidity (% x100)
+ *  11      2     distance_cm (uint16)
+ *  13      1     battery (%)
+ *  14      1     seq (contador de quadros, mod 256)
+ *  15      1     checksum (XOR of bytes [0..14])
  *
- *  Total = 16 bytes
+ *  Total = 16 bytes. O endereço de 16 bits e o seq ocupam os 2 bytes que
+ *  eram "reserved" no layout legado, então o tamanho do quadro não muda.
+ *
+ * Layout legado — MSG_TYPE_SENSOR_DATA (ainda decodificado pelo gateway)
+ *  0 msg_type | 1 client_id (8 bits) | 2 timestamp | 6 temperature |
+ *  8 humidity | 10 distance_cm | 12 battery | 13 checksum | 14 reserved
+ *
+ *  No legado o checksum é o XOR dos bytes [0..12] e "reserved" é zero, logo
+ *  o XOR de todos os 16 bytes é zero — é isso que o decodificador verifica.
+ *
+ * Lote de repetidor — MSG_TYPE_RELAY_BATCH (tamanho variável)
+ *  0       1     msg_type (0x05)
+ *  1       2     sender (endereço do repetidor que transmitiu o lote)
+ *  3       1     count (número de registros, 1..RELAY_MAX_RECORDS)
+ *  4       17×n  RelayRecord[count]
+ *  4+17n   1     checksum (XOR de todos os bytes anteriores)
+ *
+ *  O mesmo quadro leva a fila em flash do próprio nó (flash_store.h): registros
+ *  com origin == sender e hops == 0, age_s = tempo guardado até o envio.
+ *
+ * Resumo de janela — MSG_TYPE_SENSOR_SUMMARY (28 bytes)
+ *  0       1     msg_type (0x06)
+ *  1       2     node_addr
+ *  3       4     timestamp (millis no fim da janela)
+ *  7       1     battery (%)
+ *  8       1     seq (mesmo contador do v2)
+ *  9       2     samples (amostras por canal na janela)
+ *  11      8     humidity: min, max, mean, stddev (% × 100, uint16 cada)
+ *  19      8     distance: min, max, mean, stddev (cm × 10, uint16 cada)
+ *  27      1     checksum (XOR dos bytes [0..26])
+ *
+ * Downlink — MSG_TYPE_DOWNLINK (gateway → nó, tamanho variável)
+ *  0       1     msg_type (0x07)
+ *  1       2     node_addr (destino)
+ *  3       1     seq (contador do gateway por nó; o nó descarta repetidos)
+ *  4       1     cmd (DL_CMD_*)
+ *  5       1     len (bytes de payload, 0..DL_MAX_PAYLOAD)
+ *  6       len   payload (formato definido pelo comando)
+ *  6+len   1     checksum (XOR de todos os bytes anteriores)
+ *
+ *  Transmitido DOWNLINK_RX_DELAY_MS após o fim de um uplink do nó, na janela
+ *  curta de recepção que o nó abre depois de cada transmissão.
  */
 
 #ifndef PROTOCOL_H
 #define PROTOCOL_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 // =====================================================
 // Tipos de mensagem
 // =====================================================
 
-#define MSG_TYPE_SENSOR_DATA 0x01  ///< Dados de sensores (mensagem principal)
-#define MSG_TYPE_HEARTBEAT   0x02  ///< Sinal periódico de vida do dispositivo
-#define MSG_TYPE_ALERT       0x03  ///< Alerta de evento crítico
-#define MSG_TYPE_ACK         0xAA  ///< Confirmação de recebimento (ACK)
+#define MSG_TYPE_SENSOR_DATA    0x01  ///< Dados de sensores, layout legado (endereço de 8 bits)
+#define MSG_TYPE_HEARTBEAT      0x02  ///< Sinal periódico de vida do dispositivo
+#define MSG_TYPE_ALERT          0x03  ///< Alerta de evento crítico
+#define MSG_TYPE_SENSOR_DATA_V2 0x04  ///< Dados de sensores (mensagem principal, endereço de 16 bits)
+#define MSG_TYPE_RELAY_BATCH    0x05  ///< Lote de leituras repetidas por um nó repetidor
+#define MSG_TYPE_SENSOR_SUMMARY 0x06  ///< Estatísticas (mín/máx/média/desvio) da janela entre TX
+#define MSG_TYPE_DOWNLINK       0x07  ///< Comando do gateway para um nó (janela pós-uplink)
+#define MSG_TYPE_ACK            0xAA  ///< Confirmação de recebimento (ACK)
+
+/// Endereço de nó na rede (16 bits: até 65535 nós por rede).
+typedef uint16_t node_addr_t;
+
+#define NODE_ADDR_NONE 0xFFFF  ///< Reservado: nenhum nó / broadcast (não usar como CLIENT_ID)
 
 // =====================================================
 // Estruturas de mensagens
@@ -44,11 +95,11 @@
 
 /**
  * @struct SensorDataMessage
- * @brief Estrutura base de 16 bytes para envio de medições ambientais.
+ * @brief Layout legado de 16 bytes (endereço de 8 bits).
  *
  * @details
- * Usada pelo nó sensor para transmitir temperatura, umidade, distância e
- * nível de bateria. O checksum é calculado com XOR sobre os 13 primeiros bytes.
+ * Mantido apenas para que o gateway continue decodificando nós antigos.
+ * Firmwares novos transmitem SensorDataMessageV2.
  */
 struct __attribute__((packed)) SensorDataMessage {
     uint8_t  msg_type;     ///< Tipo de mensagem (MSG_TYPE_SENSOR_DATA)
@@ -62,6 +113,131 @@ struct __attribute__((packed)) SensorDataMessage {
     uint16_t reserved;     ///< Reservado para uso futuro (alinhamento)
 };
 
+/**
+ * @struct SensorDataMessageV2
+ * @brief Estrutura base de 16 bytes para envio de medições ambientais.
+ *
+ * @details
+ * Usada pelo nó sensor para transmitir temperatura, umidade, distância e
+ * nível de bateria. O checksum (último byte) é o XOR dos 15 bytes anteriores.
+ */
+struct __attribute__((packed)) SensorDataMessageV2 {
+    uint8_t     msg_type;     ///< Tipo de mensagem (MSG_TYPE_SENSOR_DATA_V2)
+    node_addr_t node_addr;    ///< Endereço do nó (0–65535)
+    uint32_t    timestamp;    ///< Tempo em milissegundos desde o boot (millis)
+    int16_t     temperature;  ///< Temperatura em °C × 100
+    uint16_t    humidity;     ///< Umidade relativa em % × 100
+    uint16_t    distance_cm;  ///< Distância em centímetros
+    uint8_t     battery;      ///< Percentual de bateria (0–100)
+    uint8_t     seq;          ///< Contador de quadros (detecção de perda/duplicata)
+    uint8_t     checksum;     ///< XOR dos bytes [0..14]
+};
+
+/**
+ * @struct RelayBatchHeader
+ * @brief Cabeçalho de um lote de leituras repetidas (4 bytes).
+ */
+struct __attribute__((packed)) RelayBatchHeader {
+    uint8_t     msg_type;     ///< Tipo de mensagem (MSG_TYPE_RELAY_BATCH)
+    node_addr_t sender;       ///< Repetidor que transmitiu este lote
+    uint8_t     count;        ///< Quantidade de RelayRecord que seguem
+};
+
+/**
+ * @struct RelayRecord
+ * @brief Uma leitura encaminhada por repetidor (17 bytes).
+ *
+ * @details
+ * Preserva endereço e seq do nó de origem (usados para descartar duplicatas
+ * no repetidor e no gateway) e conta quantos saltos a leitura já percorreu.
+ */
+struct __attribute__((packed)) RelayRecord {
+    node_addr_t origin;       ///< Nó que gerou a leitura
+    uint8_t     seq;          ///< seq do quadro original
+    uint8_t     hops;         ///< Saltos de repetidor já percorridos (>= 1)
+    uint32_t    timestamp;    ///< millis() do nó de origem
+    int16_t     temperature;  ///< Temperatura em °C × 100
+    uint16_t    humidity;     ///< Umidade relativa em % × 100
+    uint16_t    distance_cm;  ///< Distância em centímetros
+    uint8_t     battery;      ///< Percentual de bateria (0–100)
+    uint16_t    age_s;        ///< Tempo retido em repetidores até a transmissão (s, satura)
+};
+
+#define RELAY_MAX_RECORDS 14  ///< 4 + 14×17 + 1 = 243 bytes (cabe no FIFO de 255 do SX1262)
+
+/// Tamanho do lote com n registros (cabeçalho + registros + checksum).
+constexpr size_t relay_batch_size(size_t n) {
+    return sizeof(RelayBatchHeader) + n * sizeof(RelayRecord) + 1;
+}
+
+/**
+ * @struct ChannelSummary
+ * @brief Estatísticas de um canal de sensor ao longo da janela (8 bytes).
+ *
+ * @details
+ * Valores em ponto fixo na escala do canal (umidade: % × 100; distância: cm × 10),
+ * saturados em 0..65535. O desvio padrão é o amostral (n - 1).
+ */
+struct __attribute__((packed)) ChannelSummary {
+    uint16_t min;     ///< Menor amostra
+    uint16_t max;     ///< Maior amostra
+    uint16_t mean;    ///< Média
+    uint16_t stddev;  ///< Desvio padrão
+};
+
+/**
+ * @struct SensorSummaryMessage
+ * @brief Resumo estatístico das amostras coletadas entre duas transmissões (28 bytes).
+ *
+ * @details
+ * Enviado no lugar do SensorDataMessageV2 quando o nó amostra continuamente
+ * (ENABLE_SAMPLER): uma única transmissão carrega a janela inteira em vez de
+ * um valor instantâneo. Repetidores encaminham apenas as médias (RelayRecord).
+ */
+struct __attribute__((packed)) SensorSummaryMessage {
+    uint8_t        msg_type;   ///< Tipo de mensagem (MSG_TYPE_SENSOR_SUMMARY)
+    node_addr_t    node_addr;  ///< Endereço do nó (0–65535)
+    uint32_t       timestamp;  ///< millis() no fim da janela
+    uint8_t        battery;    ///< Percentual de bateria (0–100)
+    uint8_t        seq;        ///< Contador de quadros (compartilhado com o v2)
+    uint16_t       samples;    ///< Amostras por canal na janela
+    ChannelSummary humidity;   ///< Umidade relativa (% × 100)
+    ChannelSummary distance;   ///< Distância (cm × 10)
+    uint8_t        checksum;   ///< XOR dos bytes [0..26]
+};
+
+/**
+ * @struct DownlinkHeader
+ * @brief Cabeçalho de um comando do gateway para um nó (6 bytes).
+ */
+struct __attribute__((packed)) DownlinkHeader {
+    uint8_t     msg_type;     ///< Tipo de mensagem (MSG_TYPE_DOWNLINK)
+    node_addr_t node_addr;    ///< Nó de destino
+    uint8_t     seq;          ///< Contador do gateway para este nó (mod 256)
+    uint8_t     cmd;          ///< Comando (DL_CMD_*)
+    uint8_t     len;          ///< Bytes de payload que seguem
+};
+
+#define DL_MAX_PAYLOAD 8      ///< Maior payload de comando (quadro de até 15 bytes)
+
+// Comandos de downlink (payload little-endian)
+#define DL_CMD_SET_INTERVAL 0x01  ///< uint32 intervalo entre uplinks (ms)
+#define DL_CMD_TIME_SYNC    0x02  ///< uint32 época Unix (s) + uint16 ms, válidos ao fim do quadro
+#define DL_CMD_TX_POWER     0x03  ///< int8 potência de TX sugerida (dBm) — dica de ADR
+#define DL_CMD_ACK          0x04  ///< uint8 checksum do uplink confirmado (fila em flash, flash_store.h)
+
+/// Tamanho do downlink com n bytes de payload (cabeçalho + payload + checksum).
+constexpr size_t downlink_size(size_t n) {
+    return sizeof(DownlinkHeader) + n + 1;
+}
+
+static_assert(sizeof(SensorDataMessage) == 16, "SensorDataMessage deve ter 16 bytes.");
+static_assert(sizeof(RelayRecord) == 17, "RelayRecord deve ter 17 bytes.");
+static_assert(relay_batch_size(RELAY_MAX_RECORDS) <= 255, "Lote não cabe em um pacote LoRa.");
+static_assert(sizeof(SensorDataMessageV2) == 16, "SensorDataMessageV2 deve ter 16 bytes.");
+static_assert(sizeof(SensorSummaryMessage) == 28, "SensorSummaryMessage deve ter 28 bytes.");
+static_assert(sizeof(DownlinkHeader) == 6, "DownlinkHeader deve ter 6 bytes.");
+
 /**
  * @struct HeartbeatMessage
  * @brief Mensagem curta de status geral do nó (8 bytes).
@@ -142,6 +318,154 @@ inline bool verify_checksum(const uint8_t* data, size_t length) {
     return calculate_checksum(data, length) == data[length - 1];
 }
 
+/**
+ * @brief Resultado da decodificação de um quadro de sensores.
+ */
+enum DecodeStatus : uint8_t {
+    DECODE_OK = 0,        ///< Quadro válido
+    DECODE_BAD_LENGTH,    ///< Tamanho incompatível com o tipo
+    DECODE_BAD_CHECKSUM,  ///< Checksum inválido
+    DECODE_UNKNOWN_TYPE   ///< msg_type não suportado
+};
+
+/**
+ * @struct SensorReading
+ * @brief Leitura normalizada, independente da versão do quadro recebido.
+ */
+struct SensorReading {
+    node_addr_t node_addr;    ///< Endereço do nó (legado: 0–255)
+    uint32_t    timestamp;    ///< millis() do nó
+    int16_t     temperature;  ///< °C × 100
+    uint16_t    humidity;     ///< % × 100
+    uint16_t    distance_cm;  ///< cm
+    uint8_t     battery;      ///< 0–100
+    uint8_t     seq;          ///< Contador de quadros (só v2)
+    bool        has_seq;      ///< false para quadros legados
+    uint8_t     hops;         ///< 0 = recebido direto do nó de origem
+    uint16_t    age_s;        ///< Tempo retido em repetidores (s)
+    const SensorSummaryMessage* summary;  ///< Estatísticas da janela (só MSG_TYPE_SENSOR_SUMMARY; aponta para o quadro)
+};
+
+/**
+ * @brief Preenche SensorReading a partir de um RelayRecord.
+ */
+inline void relay_record_to_reading(const RelayRecord& rec, SensorReading& out) {
+    out.node_addr   = rec.origin;
+    out.timestamp   = rec.timestamp;
+    out.temperature = rec.temperature;
+    out.humidity    = rec.humidity;
+    out.distance_cm = rec.distance_cm;
+    out.battery     = rec.battery;
+    out.seq         = rec.seq;
+    out.has_seq     = true;
+    out.hops        = rec.hops;
+    out.age_s       = rec.age_s;
+    out.summary     = nullptr;
+}
+
+/**
+ * @brief Valida um lote de repetidor e devolve ponteiros para cabeçalho e registros.
+ * @return DECODE_OK se tipo, tamanho e checksum conferem.
+ */
+inline DecodeStatus decode_relay_batch(const uint8_t* data, size_t length,
+                                       const RelayBatchHeader*& header,
+                                       const RelayRecord*& records) {
+    if (length < relay_batch_size(1) || data[0] != MSG_TYPE_RELAY_BATCH) return DECODE_BAD_LENGTH;
+    header = reinterpret_cast<const RelayBatchHeader*>(data);
+    if (header->count == 0 || header->count > RELAY_MAX_RECORDS ||
+        length != relay_batch_size(header->count)) return DECODE_BAD_LENGTH;
+    if (!verify_checksum(data, length)) return DECODE_BAD_CHECKSUM;
+    records = reinterpret_cast<const RelayRecord*>(data + sizeof(RelayBatchHeader));
+    return DECODE_OK;
+}
+
+/**
+ * @brief Decodifica um quadro de sensores (v2, resumo ou legado) para SensorReading.
+ * @param data Ponteiro para o quadro recebido.
+ * @param length Tamanho recebido em bytes.
+ * @param out Leitura decodificada (válida apenas se DECODE_OK).
+ * @return Status da decodificação.
+ */
+inline DecodeStatus decode_sensor_frame(const uint8_t* data, size_t length, SensorReading& out) {
+    if (length < 1) return DECODE_BAD_LENGTH;
+
+    if (data[0] == MSG_TYPE_SENSOR_DATA_V2) {
+        if (length != sizeof(SensorDataMessageV2)) return DECODE_BAD_LENGTH;
+        if (!verify_checksum(data, length)) return DECODE_BAD_CHECKSUM;
+        const SensorDataMessageV2* m = reinterpret_cast<const SensorDataMessageV2*>(data);
+        out.node_addr   = m->node_addr;
+        out.timestamp   = m->timestamp;
+        out.temperature = m->temperature;
+        out.humidity    = m->humidity;
+        out.distance_cm = m->distance_cm;
+        out.battery     = m->battery;
+        out.seq         = m->seq;
+        out.has_seq     = true;
+        out.hops        = 0;
+        out.age_s       = 0;
+        out.summary     = nullptr;
+        return DECODE_OK;
+    }
+
+    if (data[0] == MSG_TYPE_SENSOR_SUMMARY) {
+        if (length != sizeof(SensorSummaryMessage)) return DECODE_BAD_LENGTH;
+        if (!verify_checksum(data, length)) return DECODE_BAD_CHECKSUM;
+        const SensorSummaryMessage* m = reinterpret_cast<const SensorSummaryMessage*>(data);
+        out.node_addr   = m->node_addr;
+        out.timestamp   = m->timestamp;
+        out.temperature = 0;
+        out.humidity    = m->humidity.mean;
+        out.distance_cm = (uint16_t)((m->distance.mean + 5) / 10);
+        out.battery     = m->battery;
+        out.seq         = m->seq;
+        out.has_seq     = true;
+        out.hops        = 0;
+        out.age_s       = 0;
+        out.summary     = m;
+        return DECODE_OK;
+    }
+
+    if (data[0] == MSG_TYPE_SENSOR_DATA) {
+        if (length != sizeof(SensorDataMessage)) return DECODE_BAD_LENGTH;
+        uint8_t x = 0;
+        for (size_t i = 0; i < length; i++) x ^= data[i];
+        if (x != 0) return DECODE_BAD_CHECKSUM;
+        const SensorDataMessage* m = reinterpret_cast<const SensorDataMessage*>(data);
+        out.node_addr   = m->client_id;
+        out.timestamp   = m->timestamp;
+        out.temperature = m->temperature;
+        out.humidity    = m->humidity;
+        out.distance_cm = m->distance_cm;
+        out.battery     = m->battery;
+        out.seq         = 0;
+        out.has_seq     = false;
+        out.hops        = 0;
+        out.age_s       = 0;
+        out.summary     = nullptr;
+        return DECODE_OK;
+    }
+
+    return DECODE_UNKNOWN_TYPE;
+}
+
+/**
+ * @brief Valida um downlink endereçado a um nó e devolve cabeçalho e payload.
+ * @param data Ponteiro para o quadro recebido.
+ * @param length Tamanho recebido em bytes.
+ * @param self Endereço deste nó (quadros para outros nós dão DECODE_UNKNOWN_TYPE).
+ * @return DECODE_OK se tipo, destino, tamanho e checksum conferem.
+ */
+inline DecodeStatus decode_downlink(const uint8_t* data, size_t length, node_addr_t self,
+                                    const DownlinkHeader*& header, const uint8_t*& payload) {
+    if (length < downlink_size(0)) return DECODE_BAD_LENGTH;
+    header = reinterpret_cast<const DownlinkHeader*>(data);
+    if (header->msg_type != MSG_TYPE_DOWNLINK || header->node_addr != self) return DECODE_UNKNOWN_TYPE;
+    if (header->len > DL_MAX_PAYLOAD || length != downlink_size(header->len)) return DECODE_BAD_LENGTH;
+    if (!verify_checksum(data, length)) return DECODE_BAD_CHECKSUM;
+    payload = data + sizeof(DownlinkHeader);
+    return DECODE_OK;
+}
+
 /**
  * @brief Converte temperatura em °C para o formato codificado (×100).
  */
@@ -0,0 +1,149 @@
+/**
+ * @file relay.h
+ * @brief Buffer de repetição (store-and-forward) para nós em modo repetidor.
+ *
+ * @details
+ * Um nó repetidor (alimentado pela rede elétrica) escuta entre suas próprias
+ * transmissões, aceita quadros dos nós downstream configurados e os agrupa em
+ * um único MSG_TYPE_RELAY_BATCH. Este módulo não acessa o rádio: apenas filtra
+ * (lista de downstream, limite de saltos, duplicatas) e monta o lote.
+ */
+
+#ifndef RELAY_H
+#define RELAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "protocol.h"
+
+/**
+ * @brief Resultado de RelayBuffer::offer().
+ */
+enum RelayVerdict : uint8_t {
+    RELAY_ACCEPTED = 0,    ///< Enfileirado para o próximo lote
+    RELAY_NOT_DOWNSTREAM,  ///< Origem/remetente fora da lista configurada
+    RELAY_DUPLICATE,       ///< (origem, seq) já visto recentemente
+    RELAY_HOP_LIMIT,       ///< Excederia o número máximo de saltos
+    RELAY_FULL             ///< Lote cheio (deve ser transmitido antes)
+};
+
+/**
+ * @class RelayBuffer
+ * @brief Fila de leituras a repetir + janela de deduplicação, sem heap.
+ *
+ * @tparam kBatchMax  Registros por lote (<= RELAY_MAX_RECORDS).
+ * @tparam kDedupSize Entradas (origem, seq) lembradas para descartar duplicatas.
+ */
+template <size_t kBatchMax, size_t kDedupSize>
+class RelayBuffer {
+public:
+    static_assert(kBatchMax >= 1 && kBatchMax <= RELAY_MAX_RECORDS, "RELAY_BATCH_MAX fora do intervalo.");
+    static_assert(kDedupSize >= 1, "RELAY_DEDUP_SIZE deve ser >= 1.");
+
+    RelayBuffer(const node_addr_t* downstream, size_t n_downstream, uint8_t max_hops)
+        : downstream_(downstream), n_downstream_(n_downstream), max_hops_(max_hops) {}
+
+    /**
+     * @brief Oferece uma leitura recebida de outro nó.
+     * @param r Leitura decodificada (hops/age_s do caminho já percorrido).
+     * @param from Endereço de quem transmitiu o quadro (origem ou repetidor anterior).
+     * @param now_ms millis() no momento da recepção.
+     */
+    RelayVerdict offer(const SensorReading& r, node_addr_t from, uint32_t now_ms) {
+        if (!is_downstream(from)) return RELAY_NOT_DOWNSTREAM;
+        if ((uint16_t)r.hops + 1 > max_hops_) return RELAY_HOP_LIMIT;
+        if (seen(r.node_addr, r.seq)) return RELAY_DUPLICATE;
+        if (count_ >= kBatchMax) return RELAY_FULL;
+
+        remember(r.node_addr, r.seq);
+        Pending& p = pending_[count_++];
+        p.rec.origin      = r.node_addr;
+        p.rec.seq         = r.seq;
+        p.rec.hops        = r.hops + 1;
+        p.rec.timestamp   = r.timestamp;
+        p.rec.temperature = r.temperature;
+        p.rec.humidity    = r.humidity;
+        p.rec.distance_cm = r.distance_cm;
+        p.rec.battery     = r.battery;
+        p.rec.age_s       = r.age_s;
+        p.rx_ms           = now_ms;
+        if (count_ == 1) oldest_ms_ = now_ms;
+        return RELAY_ACCEPTED;
+    }
+
+    /// true quando o lote deve sair: cheio ou o registro mais antigo excedeu max_hold_ms.
+    bool should_flush(uint32_t now_ms, uint32_t max_hold_ms) const {
+        if (count_ == 0) return false;
+        return count_ >= kBatchMax || (now_ms - oldest_ms_) >= max_hold_ms;
+    }
+
+    /**
+     * @brief Monta o MSG_TYPE_RELAY_BATCH em out (>= relay_batch_size(kBatchMax) bytes).
+     * @return Tamanho do quadro, ou 0 se não há nada pendente.
+     */
+    size_t build_frame(node_addr_t self, uint32_t now_ms, uint8_t* out) const {
+        if (count_ == 0) return 0;
+        RelayBatchHeader* h = reinterpret_cast<RelayBatchHeader*>(out);
+        h->msg_type = MSG_TYPE_RELAY_BATCH;
+        h->sender   = self;
+        h->count    = (uint8_t)count_;
+
+        RelayRecord* recs = reinterpret_cast<RelayRecord*>(out + sizeof(RelayBatchHeader));
+        for (size_t i = 0; i < count_; i++) {
+            recs[i] = pending_[i].rec;
+            uint32_t held = recs[i].age_s + (now_ms - pending_[i].rx_ms) / 1000;
+            recs[i].age_s = held > 0xFFFF ? 0xFFFF : (uint16_t)held;
+        }
+        size_t len = relay_batch_size(count_);
+        out[len - 1] = calculate_checksum(out, len);
+        return len;
+    }
+
+    /// Descarta o lote após transmissão bem-sucedida.
+    void clear() { count_ = 0; }
+
+    size_t pending() const { return count_; }
+
+private:
+    struct Pending {
+        RelayRecord rec;
+        uint32_t    rx_ms;
+    };
+
+    bool is_downstream(node_addr_t addr) const {
+        for (size_t i = 0; i < n_downstream_; i++)
+            if (downstream_[i] == addr) return true;
+        return false;
+    }
+
+    bool seen(node_addr_t origin, uint8_t seq) const {
+        for (size_t i = 0; i < dedup_used_; i++)
+            if (dedup_[i].origin == origin && dedup_[i].seq == seq) return true;
+        return false;
+    }
+
+    void remember(node_addr_t origin, uint8_t seq) {
+        dedup_[dedup_next_] = DedupEntry{origin, seq};
+        dedup_next_ = (dedup_next_ + 1) % kDedupSize;
+        if (dedup_used_ < kDedupSize) dedup_used_++;
+    }
+
+    struct DedupEntry {
+        node_addr_t origin;
+        uint8_t     seq;
+    };
+
+    const node_addr_t* downstream_;
+    size_t             n_downstream_;
+    uint8_t            max_hops_;
+
+    Pending    pending_[kBatchMax] = {};
+    size_t     count_ = 0;
+    uint32_t   oldest_ms_ = 0;
+
+    DedupEntry dedup_[kDedupSize] = {};
+    size_t     dedup_next_ = 0;
+    size_t     dedup_used_ = 0;
+};
+
+#endif // RELAY_H
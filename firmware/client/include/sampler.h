@@ -0,0 +1,72 @@
+/**
+ * @file sampler.h
+ * @brief Estatística incremental por canal para a amostragem contínua do nó.
+ *
+ * @details
+ * A tarefa de amostragem (disparada por timer de hardware) alimenta um
+ * RunningStats por canal; a cada transmissão o loop tira um instantâneo,
+ * zera os acumuladores e envia o resumo (SensorSummaryMessage). A memória é
+ * constante, qualquer que seja a taxa de amostragem ou o intervalo de TX.
+ * Este módulo não acessa sensores nem rádio.
+ */
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdint.h>
+#include <math.h>
+#include "protocol.h"
+
+/**
+ * @struct RunningStats
+ * @brief Mínimo, máximo, média e variância pelo método de Welford.
+ *
+ * @details
+ * Estável numericamente mesmo em float (a FPU do ESP32-S3 é de precisão
+ * simples; double seria emulado em software dentro da tarefa de amostragem).
+ */
+struct RunningStats {
+    uint32_t n    = 0;
+    float    mean = 0.0f;
+    float    m2   = 0.0f;   ///< Soma dos quadrados dos desvios
+    float    lo   = 0.0f;
+    float    hi   = 0.0f;
+
+    void reset() { *this = RunningStats(); }
+
+    void add(float x) {
+        if (n == 0) { lo = hi = x; }
+        else if (x < lo) lo = x;
+        else if (x > hi) hi = x;
+        n++;
+        float d = x - mean;
+        mean += d / n;
+        m2   += d * (x - mean);
+    }
+
+    /// Desvio padrão amostral (0 com menos de duas amostras).
+    float stddev() const { return n > 1 ? sqrtf(m2 / (n - 1)) : 0.0f; }
+};
+
+/**
+ * @brief Converte um valor para o ponto fixo do quadro, saturando em 0..65535.
+ */
+inline uint16_t summary_fixed(float v, float scale) {
+    float f = v * scale + 0.5f;
+    if (f <= 0.0f) return 0;
+    if (f >= 65535.0f) return 65535;
+    return (uint16_t)f;
+}
+
+/**
+ * @brief Preenche um ChannelSummary a partir do acumulador do canal.
+ * @param scale Fator do ponto fixo (umidade: 100; distância: 10).
+ */
+inline void summarize_channel(const RunningStats& s, float scale, ChannelSummary& out) {
+    out.min    = summary_fixed(s.lo, scale);
+    out.max    = summary_fixed(s.hi, scale);
+    out.mean   = summary_fixed(s.mean, scale);
+    out.stddev = summary_fixed(s.stddev(), scale);
+}
+
+#endif // SAMPLER_H
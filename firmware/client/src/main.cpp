@@ -6,19 +6,38 @@
  * - Lê sensores ambientais (umidade e distância)
  * - Transmite dados via LoRa em formato binário compacto (protocol.h)
  * - Transmissão adaptativa e modo de baixo consumo
+ * - Modo repetidor opcional (ENABLE_RELAY): encaminha quadros de nós fora do alcance
+ * - Amostragem contínua opcional (ENABLE_SAMPLER): timer de hardware + tarefa dedicada;
+ *   cada transmissão leva mín/máx/média/desvio da janela (MSG_TYPE_SENSOR_SUMMARY)
+ * - SPI do SX1262 opcionalmente pelo SPI master do ESP-IDF com DMA (LORA_SPI_DMA, esp_dma_hal.h)
+ * - Downlink opcional (ENABLE_DOWNLINK): janela curta de RX após cada uplink para
+ *   comandos do gateway (intervalo de TX, sincronismo de relógio, potência)
+ * - Fila em flash opcional (ENABLE_STORE): leituras não entregues ficam em uma
+ *   partição própria e são reenviadas em lotes, dentro do orçamento de tempo de ar
  * - Suporte para ESP32-S3 XIAO + SX1262
  */
 
 #include "config.h"
 #include "protocol.h"
+#include "relay.h"
+#include "sampler.h"
+#include "esp_dma_hal.h"
+#include "flash_store.h"
 #include <Arduino.h>
 #include <RadioLib.h>
+#if ENABLE_STORE
+#include <esp_partition.h>
+#endif
 
 // =====================================================
 // Instâncias globais
 // =====================================================
 
+EspDmaHal radio_hal(SPI, LinkCfg::kSck, LinkCfg::kMiso, LinkCfg::kMosi,
+                    LinkCfg::kSpiClockHz, LinkCfg::kSpiDma);
+
 SX1262 radio = new Module(
+    &radio_hal,
     LinkCfg::kNss,
     LinkCfg::kDio1,
     LinkCfg::kRst,
@@ -33,9 +52,97 @@ uint32_t tx_success = 0;
 uint32_t tx_failed = 0;
 uint32_t tx_skipped = 0;
 
+uint32_t tx_timed     = 0;  ///< Transmissões medidas (bench de radio.transmit)
+uint32_t tx_wall_us   = 0;  ///< Tempo de parede acumulado (preparo + tempo de ar)
+uint32_t tx_spi_us    = 0;  ///< Tempo acumulado com o SPI reservado (preparo/limpeza)
+uint32_t tx_spi_xfers = 0;  ///< Transações SPI acumuladas
+uint32_t last_tx_end_us = 0; ///< micros() ao fim do último uplink (referência da janela de downlink)
+uint8_t  last_tx_check  = 0; ///< Checksum do último uplink (conferido no DL_CMD_ACK)
+bool     uplink_acked   = false; ///< Gateway respondeu na janela após o último uplink
+
 bool lora_initialized = false;
 
+#if ENABLE_RELAY
+RelayBuffer<RelayCfg::kBatchMax, RelayCfg::kDedupSize> relay(
+    RelayCfg::kDownstream, RelayCfg::kNumDownstream, RelayCfg::kMaxHops);
+
+volatile bool relay_rx_flag = false;
+
+uint32_t relay_rx        = 0;   // quadros válidos ouvidos
+uint32_t relay_forwarded = 0;   // leituras enviadas em lotes
+uint32_t relay_batches   = 0;   // lotes transmitidos
+uint32_t relay_dropped   = 0;   // duplicatas, fora da lista, limite de saltos, falha de TX
+#endif
+
+#if ENABLE_STORE
+/**
+ * @struct PartitionFlash
+ * @brief Backend do FlashStore sobre a partição de dados (offsets relativos a ela).
+ */
+struct PartitionFlash {
+    const esp_partition_t* part = nullptr;
+
+    bool read(uint32_t off, void* dst, size_t n) {
+        return part && esp_partition_read(part, off, dst, n) == ESP_OK;
+    }
+    bool write(uint32_t off, const void* src, size_t n) {
+        return part && esp_partition_write(part, off, src, n) == ESP_OK;
+    }
+    bool erase_sector(uint32_t off) {
+        return part && esp_partition_erase_range(part, off, STORE_SECTOR_SIZE) == ESP_OK;
+    }
+    uint32_t size() { return part ? part->size : 0; }
+};
+
+PartitionFlash             store_flash;
+FlashStore<PartitionFlash> store(store_flash);
+
+RelayRecord uplink_rec;               ///< Leitura do uplink corrente, no formato da fila
+bool        uplink_rec_valid = false;
+
+uint32_t store_batches  = 0;   ///< Lotes da fila transmitidos (e confirmados, se exigido)
+uint32_t store_resent   = 0;   ///< Leituras reenviadas
+uint32_t store_deferred = 0;   ///< Reenvios adiados por falta de crédito de tempo de ar
+uint32_t store_unacked  = 0;   ///< Lotes sem confirmação (ficam na fila)
+uint32_t store_errors   = 0;   ///< Falhas de gravação
+#endif
+
+#if ENABLE_SAMPLER
+hw_timer_t*  sample_timer = nullptr;
+TaskHandle_t sampler_task = nullptr;
+portMUX_TYPE sample_mux   = portMUX_INITIALIZER_UNLOCKED;
+
+RunningStats hum_acc;                   // janela corrente (protegida por sample_mux)
+RunningStats dist_acc;
+volatile uint32_t sample_ticks    = 0;  // disparos do timer atendidos
+volatile uint32_t sample_overruns = 0;  // disparos perdidos (leitura mais lenta que o período)
+#endif
+
 RTC_DATA_ATTR uint32_t boot_count = 0;
+RTC_DATA_ATTR uint8_t  tx_seq = 0;   // contador de quadros (sobrevive ao deep sleep)
+RTC_DATA_ATTR uint32_t tx_interval_ms = NodeCfg::kTxIntervalMs;  // DL_CMD_SET_INTERVAL
+RTC_DATA_ATTR int8_t   tx_power_dbm   = LinkCfg::kTxPowerDb;     // DL_CMD_TX_POWER
+RTC_DATA_ATTR uint64_t clock_base_ms  = 0;   ///< Tempo de ciclos anteriores (acordado + dormindo)
+
+#if ENABLE_STORE
+RTC_DATA_ATTR FlashStore<PartitionFlash>::State store_state = {};   ///< Posição do anel entre deep sleeps
+RTC_DATA_ATTR float    airtime_credit_ms = StoreCfg::kBurstMs;       ///< Crédito de tempo de ar (balde de fichas)
+RTC_DATA_ATTR uint64_t airtime_at_ms     = 0;                        ///< uptime_ms() da última atualização do crédito
+#endif
+
+#if ENABLE_DOWNLINK
+RTC_DATA_ATTR int64_t  clock_offset_ms = 0;      ///< Época Unix (ms) menos uptime_ms(), após DL_CMD_TIME_SYNC
+RTC_DATA_ATTR bool     clock_synced    = false;
+RTC_DATA_ATTR uint8_t  dl_last_seq     = 0;      ///< seq do último downlink aplicado (descarta repetidos)
+RTC_DATA_ATTR bool     dl_seen         = false;
+
+uint32_t dl_windows  = 0;   ///< Janelas abertas
+uint32_t dl_received = 0;   ///< Downlinks válidos para este nó
+uint32_t dl_applied  = 0;   ///< Comandos aplicados
+uint32_t dl_acks     = 0;   ///< DL_CMD_ACK do uplink recebidos
+uint64_t dl_rx_us    = 0;   ///< Tempo acumulado com o rádio em RX nas janelas
+uint64_t dl_awake_us = 0;   ///< Tempo acumulado do fim do uplink ao fim da janela
+#endif
 
 // =====================================================
 // Declarações
@@ -43,12 +150,31 @@ RTC_DATA_ATTR uint32_t boot_count = 0;
 
 void setup_lora();
 void setup_sensors();
+#if ENABLE_SAMPLER
+void setup_sampler();
+bool transmit_summary(const RunningStats& humid, const RunningStats& dist);
+static bool take_window(RunningStats& humid, RunningStats& dist, bool reset = true);
+#endif
 bool should_transmit(float humid, float distance);
 bool transmit_sensor_data(float humid, float distance);
 void enter_deep_sleep();
 void print_stats();
 float simulate_sensor_reading(float base, float variation);
+#if ENABLE_RELAY
+void relay_listen(uint32_t duration_ms);
+#endif
 static inline void read_sensors(float& humid, float& distance);
+static bool transmit_frame(uint8_t* frame, size_t len);
+static uint64_t uptime_ms();
+#if ENABLE_DOWNLINK
+static void downlink_window();
+#endif
+#if ENABLE_STORE
+void setup_store();
+static void store_note_uplink(const uint8_t* frame, size_t len);
+static void store_after_uplink(bool delivered);
+static void airtime_charge(uint32_t toa_us);
+#endif
 
 // =====================================================
 // Setup
@@ -69,9 +195,21 @@ void setup() {
 
     setup_lora();
     setup_sensors();
+#if ENABLE_STORE
+    setup_store();
+#endif
+
+#if ENABLE_RELAY
+    DEBUG_PRINTF("Relay mode: %u downstream node(s), batch %u, max hops %u\n",
+        (unsigned)RelayCfg::kNumDownstream, (unsigned)RelayCfg::kBatchMax, RelayCfg::kMaxHops);
+#endif
 
     if (boot_count == 1)
         read_sensors(prev_humidity, prev_distance);
+
+#if ENABLE_SAMPLER
+    setup_sampler();   // a partir daqui só a tarefa de amostragem lê os sensores
+#endif
 }
 
 // =====================================================
@@ -82,11 +220,37 @@ void loop() {
     DEBUG_PRINTLN("\n--- Measurement Cycle ---");
 
     float humidity, distance;
+#if ENABLE_SAMPLER
+    RunningStats hum_win, dist_win;
+    // Com TX adaptativo a janela só é zerada quando o resumo sai: um uplink pulado
+    // não perde as amostras, elas entram na janela do próximo
+    constexpr bool kKeepWindow = ENABLE_ADAPTIVE_TX;
+    // Primeira janela após o boot: espera algumas amostras em vez de disputar os sensores
+    bool have_window = take_window(hum_win, dist_win, !kKeepWindow);
+    for (int i = 0; i < 10 && !have_window; i++) {
+        delay(SamplerCfg::kPeriodUs / 1000 + 1);
+        have_window = take_window(hum_win, dist_win, !kKeepWindow);
+    }
+    if (have_window) {
+        humidity = hum_win.mean;
+        distance = dist_win.mean;
+        DEBUG_PRINTF("Window: %u samples\n", hum_win.n);
+        DEBUG_PRINTF("Humidity: %.2f %% (sd %.2f, %.2f..%.2f)\n",
+            humidity, hum_win.stddev(), hum_win.lo, hum_win.hi);
+        DEBUG_PRINTF("Distance: %.2f cm (sd %.2f, %.1f..%.1f)\n",
+            distance, dist_win.stddev(), dist_win.lo, dist_win.hi);
+        DEBUG_PRINTF("Presence: %s\n", (dist_win.lo < SensorCfg::kPresenceThresh) ? "DETECTED" : "No");
+    } else {
+        DEBUG_PRINTLN("Sampler produced no samples - falling back to a direct reading");
+        read_sensors(humidity, distance);
+    }
+#else
     read_sensors(humidity, distance);
 
     DEBUG_PRINTF("Humidity: %.2f %%\n", humidity);
     DEBUG_PRINTF("Distance: %.2f cm\n", distance);
     DEBUG_PRINTF("Presence: %s\n", (distance < SensorCfg::kPresenceThresh) ? "DETECTED" : "No");
+#endif
 
     bool should_send = true;
 
@@ -99,14 +263,30 @@ void loop() {
 #endif
 
     if (should_send) {
+#if ENABLE_SAMPLER
+        if (kKeepWindow && have_window) {
+            take_window(hum_win, dist_win);   // inclui o que chegou desde a decisão
+            humidity = hum_win.mean;
+            distance = dist_win.mean;
+        }
+        bool success = have_window ? transmit_summary(hum_win, dist_win)
+                                   : transmit_sensor_data(humidity, distance);
+#else
         bool success = transmit_sensor_data(humidity, distance);
+#endif
         if (success) {
             tx_success++;
             prev_humidity = humidity;
             prev_distance = distance;
+#if ENABLE_DOWNLINK
+            downlink_window();
+#endif
         } else {
             tx_failed++;
         }
+#if ENABLE_STORE
+        store_after_uplink(success && (uplink_acked || !StoreCfg::kRequireAck));
+#endif
     }
 
     tx_count++;
@@ -116,9 +296,12 @@ void loop() {
     DEBUG_PRINTLN("\nEntering deep sleep...");
     delay(100);
     enter_deep_sleep();
+#elif ENABLE_RELAY
+    DEBUG_PRINTF("\nListening for %d seconds...\n", tx_interval_ms / 1000);
+    relay_listen(tx_interval_ms);
 #else
-    DEBUG_PRINTF("\nWaiting %d seconds...\n", NodeCfg::kTxIntervalMs / 1000);
-    delay(NodeCfg::kTxIntervalMs);
+    DEBUG_PRINTF("\nWaiting %d seconds...\n", tx_interval_ms / 1000);
+    delay(tx_interval_ms);
 #endif
 }
 
@@ -143,6 +326,12 @@ static inline void read_sensors(float& humid, float& distance) {
   distance= constrain(distance, 5.0f, 400.0f);
 }
 
+static inline float moisture_from_raw(uint16_t raw) {
+  float humid = 100.0f - ((float)(raw - SensorCfg::kWetRaw) /
+                          (SensorCfg::kDryRaw - SensorCfg::kWetRaw) * 100.0f);
+  return constrain(humid, 0.0f, 100.0f);
+}
+
 static inline float read_moisture_sensor() {
 #if USE_REAL_SENSORS
   uint32_t sum = 0;
@@ -150,10 +339,7 @@ static inline float read_moisture_sensor() {
     sum += analogRead(SensorCfg::kMoistPin);
     delay(10);
   }
-  uint16_t avg = sum / SensorCfg::kMoistSamples;
-  float humid = 100.0f - ((float)(avg - SensorCfg::kWetRaw) /
-                          (SensorCfg::kDryRaw - SensorCfg::kWetRaw) * 100.0f);
-  return constrain(humid, 0.0f, 100.0f);
+  return moisture_from_raw(sum / SensorCfg::kMoistSamples);
 #else
   return simulate_sensor_reading(SensorCfg::kHumBase, SensorCfg::kHumVar);
 #endif
@@ -175,10 +361,95 @@ static inline float read_ultrasonic_distance() {
 }
 
 
+// =====================================================
+// Amostragem contínua (timer de hardware + tarefa)
+// =====================================================
+
+#if ENABLE_SAMPLER
+/**
+ * @brief ISR do timer: só acorda a tarefa de amostragem.
+ *
+ * ADC e pulseIn() não podem rodar em ISR; a notificação acumula disparos,
+ * então um ping lento do HC-SR04 aparece como overrun em vez de travar o timer.
+ */
+void IRAM_ATTR on_sample_timer() {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(sampler_task, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
+
+/**
+ * @brief Uma amostra de cada canal (uma conversão ADC e um ping, sem média).
+ */
+static void sample_once(float& humid, float& distance) {
+#if USE_REAL_SENSORS
+    humid    = moisture_from_raw(analogRead(SensorCfg::kMoistPin));
+    distance = read_ultrasonic_distance();
+#else
+    humid    = constrain(simulate_sensor_reading(SensorCfg::kHumBase, SensorCfg::kHumVar), 0.0f, 100.0f);
+    distance = constrain(simulate_sensor_reading(SensorCfg::kDistBase, SensorCfg::kDistVar), 5.0f, 400.0f);
+#endif
+}
+
+static void sampler_run(void*) {
+    for (;;) {
+        uint32_t ticks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (ticks > 1) sample_overruns += ticks - 1;
+        sample_ticks += ticks;
+
+        float h, d;
+        sample_once(h, d);
+        portENTER_CRITICAL(&sample_mux);
+        hum_acc.add(h);
+        dist_acc.add(d);
+        portEXIT_CRITICAL(&sample_mux);
+    }
+}
+
+/**
+ * @brief Cria a tarefa de amostragem e programa o timer para SAMPLE_RATE_HZ.
+ */
+void setup_sampler() {
+    xTaskCreatePinnedToCore(sampler_run, "sampler", 4096, nullptr, 2, &sampler_task, SamplerCfg::kCore);
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    sample_timer = timerBegin(1000000);                          // 1 MHz
+    timerAttachInterrupt(sample_timer, on_sample_timer);
+    timerAlarm(sample_timer, SamplerCfg::kPeriodUs, true, 0);
+#else
+    sample_timer = timerBegin(SamplerCfg::kTimer, 80, true);     // APB 80 MHz / 80 = 1 MHz
+    timerAttachInterrupt(sample_timer, on_sample_timer, true);
+    timerAlarmWrite(sample_timer, SamplerCfg::kPeriodUs, true);
+    timerAlarmEnable(sample_timer);
+#endif
+    DEBUG_PRINTF("✓ Sampler: %u Hz on core %d\n", (unsigned)SamplerCfg::kRateHz, SamplerCfg::kCore);
+}
+
+/**
+ * @brief Copia a janela acumulada e zera os acumuladores (atômico frente à tarefa).
+ * @param reset false só copia: a janela segue acumulando (uplink ainda não decidido).
+ * @return true se a janela tem pelo menos uma amostra.
+ */
+static bool take_window(RunningStats& humid, RunningStats& dist, bool reset) {
+    portENTER_CRITICAL(&sample_mux);
+    humid = hum_acc;
+    dist  = dist_acc;
+    if (reset) {
+        hum_acc.reset();
+        dist_acc.reset();
+    }
+    portEXIT_CRITICAL(&sample_mux);
+    return humid.n > 0;
+}
+#endif
+
 // =====================================================
 // LoRa Setup
 // =====================================================
 
+#if ENABLE_RELAY
+void IRAM_ATTR on_relay_dio1() { relay_rx_flag = true; }
+#endif
+
 void setup_lora() {
     DEBUG_PRINTLN("\n========================================");
     DEBUG_PRINTLN("LoRa Radio Initialization");
@@ -196,24 +467,37 @@ void setup_lora() {
     delay(10);
     DEBUG_PRINTLN("✓ Reset pulse sent");
 
-    SPI.begin(LinkCfg::kSck, LinkCfg::kMiso, LinkCfg::kMosi, LinkCfg::kNss);
-    SPI.setFrequency(2000000UL);
+    // O clock vem do HAL (LORA_SPI_CLOCK_HZ): o ArduinoHal aplica as próprias
+    // SPISettings a cada transação, então SPI.setFrequency() não tinha efeito.
+    DEBUG_PRINTF("   SPI: %s @ %u Hz\n",
+        radio_hal.dma() ? "DMA (SPI3)" : "SPIClass", radio_hal.clock_hz());
+    if (!radio_hal.dma())   // no modo DMA o HAL inicializa o próprio barramento
+        SPI.begin(LinkCfg::kSck, LinkCfg::kMiso, LinkCfg::kMosi, LinkCfg::kNss);
     delay(100);
 
-    int state = radio.begin(
-        LinkCfg::kFreqMHz,
-        LinkCfg::kBwKHz,
-        LinkCfg::kSf,
-        LinkCfg::kCr,
-        LinkCfg::kSyncWord,
-        LinkCfg::kTxPowerDb,
-        LinkCfg::kPreamble
-    );
+    int state;
+    for (;;) {
+        state = radio.begin(
+            LinkCfg::kFreqMHz,
+            LinkCfg::kBwKHz,
+            LinkCfg::kSf,
+            LinkCfg::kCr,
+            LinkCfg::kSyncWord,
+            tx_power_dbm,
+            LinkCfg::kPreamble
+        );
+        // Erro de SPI pode ser clock alto demais para a fiação: tenta de novo mais devagar
+        if (state == RADIOLIB_ERR_NONE || !EspDmaHal::spi_fault(state) || !radio_hal.step_down()) break;
+        DEBUG_PRINTF("   init failed (code %d), SPI -> %u Hz\n", state, radio_hal.clock_hz());
+    }
 
     if (state == RADIOLIB_ERR_NONE) {
         DEBUG_PRINTLN("✓✓✓ LoRa initialization SUCCESS ✓✓✓");
         lora_initialized = true;
         radio.setCurrentLimit(140);
+#if ENABLE_RELAY
+        radio.setDio1Action(on_relay_dio1);
+#endif
     } else {
         DEBUG_PRINTF("✗✗✗ LoRa init failed (code %d)\n", state);
         lora_initialized = false;
@@ -267,40 +551,475 @@ bool should_transmit(float humid, float dist) {
 bool transmit_sensor_data(float humid, float dist) {
     if (!lora_initialized) return false;
 
-    SensorDataMessage msg{};
+    uint8_t frame[16];
+    static_assert(sizeof(frame) == sizeof(SensorDataMessageV2), "quadro v2 tem 16 bytes");
+    static_assert(sizeof(frame) == sizeof(SensorDataMessage), "quadro legado tem 16 bytes");
+
+#if USE_LEGACY_FRAME
+    SensorDataMessage& msg = *reinterpret_cast<SensorDataMessage*>(frame);
+    msg = SensorDataMessage{};
     msg.msg_type   = MSG_TYPE_SENSOR_DATA;
-    msg.client_id  = NodeCfg::kClientId;
+    msg.client_id  = static_cast<uint8_t>(NodeCfg::kClientId);
+#else
+    SensorDataMessageV2& msg = *reinterpret_cast<SensorDataMessageV2*>(frame);
+    msg = SensorDataMessageV2{};
+    msg.msg_type   = MSG_TYPE_SENSOR_DATA_V2;
+    msg.node_addr  = NodeCfg::kClientId;
+    msg.seq        = tx_seq++;
+#endif
     msg.timestamp  = millis();
     msg.temperature= 0;
     msg.humidity   = encode_humidity(humid);
     msg.distance_cm= (uint16_t)dist;
     msg.battery    = 100;
-    msg.reserved   = 0;
-    msg.checksum   = calculate_checksum((uint8_t*)&msg, sizeof(msg));
+    msg.checksum   = calculate_checksum(frame, sizeof(frame));
 
     DEBUG_PRINTF("TX attempt (%d bytes): humid=%.2f dist=%.1f\n",
         sizeof(msg), humid, dist);
+#if ENABLE_STORE
+    store_note_uplink(frame, sizeof(frame));
+#endif
 
+    return transmit_frame(frame, sizeof(frame));
+}
+
+#if ENABLE_SAMPLER
+/**
+ * @brief Transmite o resumo da janela (MSG_TYPE_SENSOR_SUMMARY, 28 bytes).
+ */
+bool transmit_summary(const RunningStats& humid, const RunningStats& dist) {
+    if (!lora_initialized) return false;
+
+    SensorSummaryMessage msg{};
+    msg.msg_type  = MSG_TYPE_SENSOR_SUMMARY;
+    msg.node_addr = NodeCfg::kClientId;
+    msg.timestamp = millis();
+    msg.battery   = 100;
+    msg.seq       = tx_seq++;
+    msg.samples   = humid.n > 65535 ? 65535 : (uint16_t)humid.n;
+    summarize_channel(humid, 100.0f, msg.humidity);
+    summarize_channel(dist, 10.0f, msg.distance);
+    msg.checksum  = calculate_checksum((uint8_t*)&msg, sizeof(msg));
+
+    DEBUG_PRINTF("TX summary (%d bytes): %u samples\n", sizeof(msg), msg.samples);
+#if ENABLE_STORE
+    store_note_uplink((const uint8_t*)&msg, sizeof(msg));
+#endif
+    return transmit_frame((uint8_t*)&msg, sizeof(msg));
+}
+#endif
+
+static bool transmit_frame(uint8_t* frame, size_t len) {
+    last_tx_check = frame[len - 1];
+    uplink_acked = false;
     for (int i = 0; i < TxPolicy::kMaxRetries; i++) {
-        int state = radio.transmit((uint8_t*)&msg, sizeof(msg));
+        uint32_t t0 = micros();
+        uint32_t spi0 = radio_hal.busy_us();
+        uint32_t xfers0 = radio_hal.transactions();
+        int state = radio.transmit(frame, len);
+        last_tx_end_us = micros();
+#if ENABLE_STORE
+        airtime_charge(radio.getTimeOnAir(len));
+#endif
+        tx_timed++;
+        tx_wall_us   += micros() - t0;
+        tx_spi_us    += radio_hal.busy_us() - spi0;
+        tx_spi_xfers += radio_hal.transactions() - xfers0;
         if (state == RADIOLIB_ERR_NONE) return true;
         delay(100);
     }
     return false;
 }
 
+// =====================================================
+// Downlink
+// =====================================================
+
+/// Milissegundos desde o primeiro boot (inclui ciclos de deep sleep).
+static uint64_t uptime_ms() {
+    return clock_base_ms + millis();
+}
+
+#if ENABLE_DOWNLINK
+
+/**
+ * @brief Aplica um comando do gateway, validando tamanho e faixa do payload.
+ */
+static void downlink_apply(const DownlinkHeader& h, const uint8_t* p) {
+    switch (h.cmd) {
+    case DL_CMD_SET_INTERVAL: {
+        uint32_t ms;
+        if (h.len != sizeof(ms)) break;
+        memcpy(&ms, p, sizeof(ms));
+        if (ms < 1000 || ms > 86400000UL) break;
+        tx_interval_ms = ms;
+        dl_applied++;
+        DEBUG_PRINTF("Downlink: TX interval -> %u ms\n", ms);
+        return;
+    }
+    case DL_CMD_TIME_SYNC: {
+        uint32_t sec;
+        uint16_t ms;
+        if (h.len != sizeof(sec) + sizeof(ms)) break;
+        memcpy(&sec, p, sizeof(sec));
+        memcpy(&ms, p + sizeof(sec), sizeof(ms));
+        clock_offset_ms = (int64_t)sec * 1000 + ms - (int64_t)uptime_ms();
+        clock_synced = true;
+        dl_applied++;
+        DEBUG_PRINTF("Downlink: clock synced to %u.%03u\n", sec, ms);
+        return;
+    }
+    case DL_CMD_TX_POWER: {
+        if (h.len != 1) break;
+        int8_t dbm = (int8_t)p[0];
+        if (dbm < -9 || dbm > 22 || radio.setOutputPower(dbm) != RADIOLIB_ERR_NONE) break;
+        tx_power_dbm = dbm;
+        dl_applied++;
+        DEBUG_PRINTF("Downlink: TX power -> %d dBm\n", dbm);
+        return;
+    }
+    }
+    DEBUG_PRINTF("Downlink: command 0x%02X (%u bytes) ignored\n", h.cmd, h.len);
+}
+
+/**
+ * @brief Janela de recepção após um uplink bem sucedido.
+ *
+ * @details
+ * O gateway transmite DOWNLINK_RX_DELAY_MS após o fim do uplink. O rádio fica em
+ * standby até DOWNLINK_RX_DELAY_MS - margem e então escuta com timeout de
+ * hardware de DownlinkCfg::kWindowMs (margem + preâmbulo + header + margem).
+ * Sem cabeçalho detectado, o rádio encerra sozinho; com cabeçalho, recebe o
+ * quadro até o fim. DIO1 sinaliza RX_DONE ou TIMEOUT; no timeout o FIFO ainda
+ * guarda o próprio uplink, que decode_downlink() recusa.
+ *
+ * Qualquer downlink válido para este nó confirma o uplink (uplink_acked): o
+ * gateway só transmite na janela de um uplink que ouviu. DL_CMD_ACK não é
+ * comando — só confirma, se o checksum for o do uplink.
+ */
+static void downlink_window() {
+    if (!lora_initialized) return;
+
+    uint32_t open_at = last_tx_end_us + (DownlinkCfg::kRxDelayMs - DownlinkCfg::kMarginMs) * 1000UL;
+    int32_t wait_us = (int32_t)(open_at - micros());
+    if (wait_us > 2000) delay((wait_us - 1000) / 1000);
+    while ((int32_t)(open_at - micros()) > 0) {}
+
+    // Salvaguarda caso o DIO1 não suba: cabeçalho no fim da janela + maior downlink
+    uint32_t limit_us = DownlinkCfg::kWindowMs * 1000UL +
+                        radio.getTimeOnAir(downlink_size(DL_MAX_PAYLOAD)) + 5000;
+    uint32_t t_open = micros();
+    dl_windows++;
+    int state = radio.startReceive(DownlinkCfg::kTimeoutRaw, RADIOLIB_SX126X_IRQ_RX_DEFAULT,
+                                   RADIOLIB_SX126X_IRQ_RX_DONE | RADIOLIB_SX126X_IRQ_TIMEOUT);
+    while (state == RADIOLIB_ERR_NONE && !digitalRead(LinkCfg::kDio1) && micros() - t_open < limit_us)
+        delay(1);
+    uint32_t rx_us = micros() - t_open;
+
+    uint8_t buf[downlink_size(DL_MAX_PAYLOAD)];
+    size_t len = digitalRead(LinkCfg::kDio1) ? radio.getPacketLength() : 0;
+    if (len >= downlink_size(0) && len <= sizeof(buf) && radio.readData(buf, len) == RADIOLIB_ERR_NONE) {
+        const DownlinkHeader* h = nullptr;
+        const uint8_t* payload = nullptr;
+        if (decode_downlink(buf, len, NodeCfg::kClientId, h, payload) == DECODE_OK) {
+            dl_received++;
+            if (h->cmd == DL_CMD_ACK) {
+                if (h->len == 1 && payload[0] == last_tx_check) { uplink_acked = true; dl_acks++; }
+            } else {
+                uplink_acked = true;
+                if (!dl_seen || h->seq != dl_last_seq) {
+                    dl_seen = true;
+                    dl_last_seq = h->seq;
+                    downlink_apply(*h, payload);
+                }
+            }
+        }
+    }
+    radio.standby();
+#if ENABLE_RELAY
+    relay_rx_flag = false;   // o DIO1 da janela não é quadro de repetidor
+#endif
+
+    dl_rx_us    += rx_us;
+    dl_awake_us += micros() - last_tx_end_us;
+}
+#endif
+
+// =====================================================
+// Modo repetidor
+// =====================================================
+
+#if ENABLE_RELAY
+static void relay_flush() {
+    static uint8_t frame[relay_batch_size(RelayCfg::kBatchMax)];
+    size_t len = relay.build_frame(NodeCfg::kClientId, millis(), frame);
+    if (len == 0) return;
+
+    size_t n = relay.pending();
+    bool ok = false;
+    for (int i = 0; i < TxPolicy::kMaxRetries && !ok; i++) {
+        ok = radio.transmit(frame, len) == RADIOLIB_ERR_NONE;
+        if (!ok) delay(100);
+    }
+    if (ok) { relay_forwarded += n; relay_batches++; }
+    else    { relay_dropped += n; }
+    DEBUG_PRINTF("Relay batch: %u record(s), %u bytes -> %s\n",
+        (unsigned)n, (unsigned)len, ok ? "OK" : "FAIL");
+    relay.clear();
+}
+
+static void relay_offer(const SensorReading& r, node_addr_t from) {
+    RelayVerdict v = relay.offer(r, from, millis());
+    if (v == RELAY_FULL) {
+        relay_flush();
+        v = relay.offer(r, from, millis());
+    }
+    if (v != RELAY_ACCEPTED) relay_dropped++;
+}
+
+static void relay_handle_frame(const uint8_t* buf, size_t len) {
+    SensorReading r;
+    if (decode_sensor_frame(buf, len, r) == DECODE_OK) {
+        if (!r.has_seq) { relay_dropped++; return; }   // legado: sem seq não há dedupe
+        relay_rx++;
+        relay_offer(r, r.node_addr);
+        return;
+    }
+
+    const RelayBatchHeader* h;
+    const RelayRecord* recs;
+    if (decode_relay_batch(buf, len, h, recs) == DECODE_OK) {
+        relay_rx++;
+        for (uint8_t i = 0; i < h->count; i++) {
+            relay_record_to_reading(recs[i], r);
+            relay_offer(r, h->sender);
+        }
+    }
+}
+
+/**
+ * @brief Escuta o canal por duration_ms, repetindo quadros de nós downstream.
+ *
+ * O rádio fica em RX contínuo; cada pacote gera DIO1 e é lido com o tamanho
+ * exato. Lotes saem quando enchem ou quando a leitura mais antiga atinge
+ * RELAY_FLUSH_MS, e a escuta é retomada logo em seguida.
+ */
+void relay_listen(uint32_t duration_ms) {
+    if (!lora_initialized) { delay(duration_ms); return; }
+
+    static uint8_t buf[256];
+    uint32_t start = millis();
+    relay_rx_flag = false;
+    radio.startReceive();
+
+    while (millis() - start < duration_ms) {
+        if (relay_rx_flag) {
+            relay_rx_flag = false;
+            size_t len = radio.getPacketLength();
+            if (len > 0 && len <= sizeof(buf) && radio.readData(buf, len) == RADIOLIB_ERR_NONE)
+                relay_handle_frame(buf, len);
+            radio.startReceive();
+        }
+        if (relay.should_flush(millis(), RelayCfg::kFlushMs)) {
+            relay_flush();
+            relay_rx_flag = false;
+            radio.startReceive();
+        }
+        delay(5);
+    }
+
+    radio.standby();
+    relay_rx_flag = false;
+}
+#endif
+
+// =====================================================
+// Fila em flash (store-and-forward do próprio nó)
+// =====================================================
+
+#if ENABLE_STORE
+/**
+ * @brief Localiza a partição e retoma o anel: do RTC ao acordar do deep sleep,
+ *        por varredura completa nos demais boots (o RTC pode estar desatualizado).
+ */
+void setup_store() {
+    store_flash.part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                StoreCfg::kPartition);
+    if (!store_flash.part) {
+        DEBUG_PRINTF("Store: partition '%s' not found - disabled\n", StoreCfg::kPartition);
+        return;
+    }
+    bool warm = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER && store.resume(store_state);
+    if (!warm && !store.mount()) {
+        DEBUG_PRINTLN("Store: mount failed - disabled");
+        return;
+    }
+    DEBUG_PRINTF("Store: %u/%u pending (%s, session %u)\n", store.pending(), store.capacity(),
+        warm ? "resumed" : "mounted", store.state().session);
+}
+
+/// Crédito de tempo de ar (ms), reposto a STORE_AIRTIME_PCT do tempo decorrido.
+static float airtime_credit() {
+    uint64_t now = uptime_ms();
+    if (now > airtime_at_ms)
+        airtime_credit_ms += (float)(now - airtime_at_ms) * StoreCfg::kAirtimePct / 100.0f;
+    if (airtime_credit_ms > StoreCfg::kBurstMs) airtime_credit_ms = StoreCfg::kBurstMs;
+    airtime_at_ms = now;
+    return airtime_credit_ms;
+}
+
+/// Debita cada transmissão do nó; uplinks normais nunca esperam, só os reenvios.
+static void airtime_charge(uint32_t toa_us) {
+    airtime_credit();
+    airtime_credit_ms -= toa_us / 1000.0f;
+    if (airtime_credit_ms < -StoreCfg::kBurstMs) airtime_credit_ms = -StoreCfg::kBurstMs;
+}
+
+/// Guarda a leitura do quadro (v2 ou resumo, só as médias) caso não seja entregue.
+static void store_note_uplink(const uint8_t* frame, size_t len) {
+    SensorReading r;
+    uplink_rec_valid = decode_sensor_frame(frame, len, r) == DECODE_OK && r.has_seq;
+    if (!uplink_rec_valid) return;
+    uplink_rec.origin      = r.node_addr;
+    uplink_rec.seq         = r.seq;
+    uplink_rec.hops        = 0;
+    uplink_rec.timestamp   = r.timestamp;
+    uplink_rec.temperature = r.temperature;
+    uplink_rec.humidity    = r.humidity;
+    uplink_rec.distance_cm = r.distance_cm;
+    uplink_rec.battery     = r.battery;
+    uplink_rec.age_s       = 0;
+}
+
+/// Tempo guardado (s, satura). Gravado em outra energização: uptime não compara, 0xFFFF.
+static uint16_t stored_age_s(const StoredRecord& r, uint32_t now_s) {
+    if (r.session != store.state().session || now_s < r.stored_s) return 0xFFFF;
+    uint32_t age = now_s - r.stored_s;
+    return age > 0xFFFF ? 0xFFFF : (uint16_t)age;
+}
+
+/**
+ * @brief Reenvia a fila em lotes enquanto houver crédito de tempo de ar.
+ *
+ * @details
+ * Um lote só é marcado como enviado após o TX e, com STORE_REQUIRE_ACK, após a
+ * resposta do gateway na janela de downlink. Lote sem resposta encerra o ciclo
+ * (o enlace caiu de novo) e continua na fila; o gateway descarta as cópias
+ * repetidas pelo seq de origem.
+ */
+static void store_drain() {
+    static FlashStore<PartitionFlash>::Item items[StoreCfg::kBatchMax];
+    static uint8_t frame[relay_batch_size(StoreCfg::kBatchMax)];
+
+    while (store.pending() > 0) {
+        size_t n = store.peek(StoreCfg::kNewestFirst, items, StoreCfg::kBatchMax);
+        if (n == 0) break;
+        size_t len = relay_batch_size(n);
+        if (airtime_credit() < radio.getTimeOnAir(len) / 1000.0f) { store_deferred++; break; }
+
+        RelayBatchHeader* h = reinterpret_cast<RelayBatchHeader*>(frame);
+        h->msg_type = MSG_TYPE_RELAY_BATCH;
+        h->sender   = NodeCfg::kClientId;
+        h->count    = (uint8_t)n;
+        RelayRecord* recs = reinterpret_cast<RelayRecord*>(frame + sizeof(RelayBatchHeader));
+        uint32_t now_s = (uint32_t)(uptime_ms() / 1000);
+        for (size_t i = 0; i < n; i++) {
+            recs[i] = items[i].r.rec;
+            recs[i].age_s = stored_age_s(items[i].r, now_s);
+        }
+        frame[len - 1] = calculate_checksum(frame, len);
+
+        bool ok = transmit_frame(frame, len);
+#if ENABLE_DOWNLINK
+        if (ok) downlink_window();
+#endif
+        DEBUG_PRINTF("Store batch: %u record(s), %u bytes -> %s\n", (unsigned)n, (unsigned)len,
+            !ok ? "FAIL" : (StoreCfg::kRequireAck && !uplink_acked) ? "NO ACK" : "OK");
+        if (!ok || (StoreCfg::kRequireAck && !uplink_acked)) { store_unacked++; break; }
+        for (size_t i = 0; i < n; i++) store.mark_sent(items[i].addr);
+        store_batches++;
+        store_resent += n;
+    }
+}
+
+/**
+ * @brief Após o uplink da leitura: guarda-a se não foi entregue; se foi, o
+ *        enlace está de pé e a fila é reenviada.
+ */
+static void store_after_uplink(bool delivered) {
+    if (!store.ready()) return;
+    if (delivered) {
+        store_drain();
+    } else if (uplink_rec_valid) {   // quadro sem seq (legado) não vira registro
+        if (store.append(uplink_rec, (uint32_t)(uptime_ms() / 1000)))
+            DEBUG_PRINTF("Reading stored (%u pending)\n", store.pending());
+        else
+            store_errors++;
+    }
+    uplink_rec_valid = false;
+}
+#endif
+
 // =====================================================
 // Energia e estatísticas
 // =====================================================
 
 void enter_deep_sleep() {
-    esp_sleep_enable_timer_wakeup(NodeCfg::kSleepTimeUs);
+    // Intervalo alterado por downlink substitui SLEEP_TIME_US
+    uint64_t sleep_us = (tx_interval_ms == NodeCfg::kTxIntervalMs)
+        ? NodeCfg::kSleepTimeUs : (uint64_t)tx_interval_ms * 1000ULL;
+    clock_base_ms += millis() + sleep_us / 1000;
+#if ENABLE_STORE
+    store_state = store.state();
+#endif
+    esp_sleep_enable_timer_wakeup(sleep_us);
     esp_deep_sleep_start();
 }
 
 void print_stats() {
     DEBUG_PRINTF("\nCycles:%u  Success:%u  Fail:%u  Skip:%u\n",
         tx_count, tx_success, tx_failed, tx_skipped);
+#if ENABLE_RELAY
+    DEBUG_PRINTF("Relay RX:%u  Fwd:%u  Batches:%u  Dropped:%u  Pending:%u\n",
+        relay_rx, relay_forwarded, relay_batches, relay_dropped, (unsigned)relay.pending());
+#endif
+#if ENABLE_SAMPLER
+    DEBUG_PRINTF("Sampler ticks:%u  Overruns:%u\n", sample_ticks, sample_overruns);
+#endif
+#if ENABLE_STORE
+    if (store.ready()) {
+        const auto& st = store.state();
+        uint32_t wear_min, wear_max;
+        store.wear(wear_min, wear_max);
+        DEBUG_PRINTF("Store: pending %u/%u  stored:%u  resent:%u (%u batches)  lost:%u  corrupt:%u  "
+            "deferred:%u  unacked:%u  errors:%u  airtime credit %.0f ms  erases %u..%u\n",
+            st.pending, store.capacity(), st.stored, store_resent, store_batches, st.lost, st.corrupt,
+            store_deferred, store_unacked, store_errors, airtime_credit(), wear_min, wear_max);
+    }
+#endif
+#if ENABLE_DOWNLINK
+    if (dl_windows > 0) {
+        // Carga extra por ciclo: RX do rádio na janela; com deep sleep, também o MCU
+        // acordado do fim do uplink ao fim da janela (sem a janela ele já dormiria).
+        float rx_ms    = (float)dl_rx_us / dl_windows / 1000.0f;
+        float awake_ms = (float)dl_awake_us / dl_windows / 1000.0f;
+        float uc = DownlinkCfg::kRxMa * rx_ms + (NodeCfg::kDeepSleep ? DownlinkCfg::kMcuMa * awake_ms : 0.0f);
+        float cycles_day = 86400000.0f / (tx_interval_ms + awake_ms);
+        DEBUG_PRINTF("Downlink: windows:%u  rx:%u  acks:%u  applied:%u  RX %.1f ms  awake %.1f ms  +%.3f mJ/cycle  +%.2f mAh/day\n",
+            dl_windows, dl_received, dl_acks, dl_applied, rx_ms, awake_ms,
+            uc * DownlinkCfg::kSupplyV / 1000.0f, uc * cycles_day / 3.6e6f);
+    }
+    if (clock_synced) {
+        uint64_t epoch_ms = (uint64_t)((int64_t)uptime_ms() + clock_offset_ms);
+        DEBUG_PRINTF("Clock: %lu.%03u (synced)\n",
+            (unsigned long)(epoch_ms / 1000), (unsigned)(epoch_ms % 1000));
+    }
+#endif
+    if (tx_timed > 0) {
+        DEBUG_PRINTF("TX bench: %u ms/tx (SPI %u us, %u xfers)  SPI %s %u Hz, errors %u\n",
+            tx_wall_us / tx_timed / 1000, tx_spi_us / tx_timed, tx_spi_xfers / tx_timed,
+            radio_hal.dma() ? "DMA" : "SPIClass", radio_hal.clock_hz(), radio_hal.errors());
+    }
     if (tx_count > 0) {
         float eff = (float)tx_success / tx_count * 100.0f;
         DEBUG_PRINTF("Efficiency: %.1f%%\n", eff);
@@ -1,16 +1,206 @@
-import time, json, random
-
-while True:
-    data = {
-        "node_id": "1",
-        "timestamp": time.strftime("%Y-%m-%dT%H:%M:%S"),
-        "sensors": {
-            "temperature_celsius": round(random.uniform(24, 28), 2),
-            "humidity_percent": round(random.uniform(55, 65), 2),
-            "luminosity_lux": None,
-            "presence_detected": random.choice([True, False]),
-            "power_on": True
+import argparse
+import json
+import os
+import random
+import struct
+import sys
+import time
+
+# =====================================================
+# GATEWAY SINTÉTICO PARA TESTE DE CARGA DO BRIDGE
+# =====================================================
+# Emula a saída serial do firmware do gateway: N nós com seq de 8 bits, RSSI/SNR,
+# linhas de debug intercaladas ("[LoRa] Pacote recebido!", HEX, ✓ ...) e linhas
+# corrompidas (JSON truncado, lixo de baud errado, quadro binário com checksum ruim).
+#
+# Formatos de saída:
+#   json    uma linha JSON por leitura, igual a packet_to_json()
+#   binary  quadros enquadrados: A5 5A | len | quadro v2 de 16 bytes | XOR(len+payload)
+#           (ver StreamParser em gateway/lora_serial_bridge.py)
+#
+# Como uma UART sem controle de fluxo, a saída nunca bloqueia: se o pipe estiver cheio
+# a linha é descartada e contada (relatório final em stderr).
+#
+# Uso:
+#   python fake_gateway.py                                   # 1 nó a cada 10 s (antigo)
+#   python fake_gateway.py --nodes 200 --rate 500 --format binary \
+#       | python ../../gateway/lora_serial_bridge.py --stdin --dry-run --stats 5
+#   python fake_gateway.py --nodes 50 --rate 100 --burst-every 30 --burst-len 5 --burst-factor 10
+
+SYNC = b"\xA5\x5A"
+FRAME_V2 = struct.Struct("<BHIhHHBB")     # SensorDataMessageV2 sem o checksum
+MSG_TYPE_SENSOR_DATA_V2 = 0x04
+
+
+class Node:
+    def __init__(self, addr: int, rnd: random.Random):
+        self.addr = addr
+        self.seq = rnd.randrange(256)
+        self.temp = rnd.uniform(22.0, 28.0)
+        self.hum = rnd.uniform(50.0, 65.0)
+        self.rssi = rnd.uniform(-120.0, -60.0)
+        self.rnd = rnd
+
+    def step(self):
+        self.seq = (self.seq + 1) & 0xFF
+        self.temp += self.rnd.gauss(0, 0.05)
+        self.hum = min(max(self.hum + self.rnd.gauss(0, 0.1), 0.0), 100.0)
+
+    def signal(self):
+        return self.rssi + self.rnd.gauss(0, 2.0), self.rnd.uniform(-5.0, 10.0)
+
+    def frame(self, uptime_ms: int) -> bytes:
+        body = FRAME_V2.pack(MSG_TYPE_SENSOR_DATA_V2, self.addr, uptime_ms & 0xFFFFFFFF,
+                             int(self.temp * 100), int(self.hum * 100),
+                             self.rnd.randrange(20, 300), self.rnd.randrange(60, 101), self.seq)
+        c = 0
+        for b in body:
+            c ^= b
+        return body + bytes([c])
+
+    def json_line(self, uptime_ms: int, rssi: float, snr: float) -> bytes:
+        data = {
+            "node_id": str(self.addr),
+            "timestamp": time.strftime("%Y-%m-%dT%H:%M:%S", time.gmtime()),
+            "seq": self.seq,
+            "rssi": round(rssi, 1),
+            "snr": round(snr, 1),
+            "sensors": {
+                "temperature_celsius": round(self.temp, 2),
+                "humidity_percent": round(self.hum, 2),
+                "luminosity_lux": None,
+                "presence_detected": self.rnd.random() < 0.3,
+                "power_on": True,
+            },
         }
-    }
-    print(json.dumps(data))
-    time.sleep(10)
+        return json.dumps(data, separators=(",", ":")).encode() + b"\n"
+
+
+def enclose(payload: bytes, corrupt: bool = False) -> bytes:
+    c = len(payload)
+    for b in payload:
+        c ^= b
+    if corrupt:
+        c ^= 0xFF
+    return SYNC + bytes([len(payload)]) + payload + bytes([c])
+
+
+def debug_lines(node: Node, frame: bytes, rssi: float, snr: float) -> bytes:
+    return (
+        "\n[LoRa] Pacote recebido!\n"
+        f"  RSSI: {rssi:.1f} dBm | SNR: {snr:.1f} dB | Len: {len(frame)} bytes\n"
+        f"  Data HEX: {' '.join(f'{b:02X}' for b in frame)}\n"
+        f"  ✓ Node: {node.addr}\n"
+        f"  ✓ Seq: {node.seq}\n"
+        f"  ✓ Temp: {node.temp:.2f} °C\n"
+        f"  ✓ Humid: {node.hum:.2f} %\n"
+    ).encode()
+
+
+def malformed(rnd: random.Random, node: Node, uptime_ms: int, fmt: str) -> bytes:
+    kind = rnd.randrange(3)
+    if kind == 0:                      # JSON cortado no meio (reset / buffer cheio)
+        line = node.json_line(uptime_ms, -90.0, 5.0)
+        return line[:rnd.randrange(5, len(line) - 2)] + b"\n"
+    if kind == 1:                      # lixo de taxa serial errada
+        return bytes(rnd.randrange(0x80, 0x100) for _ in range(rnd.randrange(8, 40))) + b"\n"
+    if fmt == "binary":                # quadro com checksum do enquadramento errado
+        return enclose(node.frame(uptime_ms), corrupt=True)
+    return b'{"node_id":"' + str(node.addr).encode() + b'","sensors":{"temperature_celsius":}\n'
+
+
+class Writer:
+    """Saída sem bloqueio: o que não couber no pipe é descartado, como numa UART."""
+    def __init__(self):
+        self.fd = sys.stdout.fileno()
+        os.set_blocking(self.fd, False)
+        self.bytes = 0
+        self.dropped = 0
+
+    def write(self, data: bytes) -> bool:
+        try:
+            n = os.write(self.fd, data)
+        except BlockingIOError:
+            self.dropped += 1
+            return False
+        if n < len(data):
+            # Escrita parcial: completa bloqueando para não cortar o registro no meio.
+            os.set_blocking(self.fd, True)
+            os.write(self.fd, data[n:])
+            os.set_blocking(self.fd, False)
+        self.bytes += len(data)
+        return True
+
+
+def main():
+    p = argparse.ArgumentParser(description="Gateway LoRa sintético (saída serial em stdout).")
+    p.add_argument("--nodes", type=int, default=1)
+    p.add_argument("--rate", type=float, default=0.1, help="leituras/s somando todos os nós")
+    p.add_argument("--format", choices=("json", "binary"), default="json")
+    p.add_argument("--duration", type=float, default=0.0, help="segundos (0 = sem fim)")
+    p.add_argument("--burst-every", type=float, default=0.0, help="período entre rajadas (s)")
+    p.add_argument("--burst-len", type=float, default=0.0, help="duração de cada rajada (s)")
+    p.add_argument("--burst-factor", type=float, default=10.0, help="multiplicador da taxa na rajada")
+    p.add_argument("--debug", type=float, default=1.0, help="fração das leituras com bloco de debug")
+    p.add_argument("--malformed", type=float, default=0.0, help="fração de linhas corrompidas injetadas")
+    p.add_argument("--loss", type=float, default=0.0, help="fração de quadros perdidos no rádio (gera buracos de seq)")
+    p.add_argument("--seed", type=int, default=1)
+    args = p.parse_args()
+
+    rnd = random.Random(args.seed)
+    nodes = [Node(i + 1, rnd) for i in range(args.nodes)]
+    out = Writer()
+    emitted = lost = injected = 0
+    t0 = time.monotonic()
+    next_t = t0
+    next_report = t0 + 5.0
+
+    try:
+        while True:
+            now = time.monotonic()
+            elapsed = now - t0
+            if args.duration and elapsed >= args.duration:
+                break
+            in_burst = (args.burst_every > 0 and args.burst_len > 0
+                        and elapsed % args.burst_every < args.burst_len)
+            rate = args.rate * (args.burst_factor if in_burst else 1.0)
+            if next_t > now:
+                time.sleep(min(next_t - now, 0.05))
+                continue
+            next_t += 1.0 / rate
+
+            node = nodes[rnd.randrange(len(nodes))]
+            node.step()
+            if rnd.random() < args.loss:
+                lost += 1
+                continue
+            uptime_ms = int(elapsed * 1000)
+            rssi, snr = node.signal()
+            frame = node.frame(uptime_ms)
+            chunk = debug_lines(node, frame, rssi, snr) if rnd.random() < args.debug else b""
+            if args.format == "binary":
+                chunk += enclose(frame)
+            else:
+                chunk += node.json_line(uptime_ms, rssi, snr)
+            bad = rnd.random() < args.malformed
+            if bad:
+                chunk += malformed(rnd, node, uptime_ms, args.format)
+            if out.write(chunk):
+                emitted += 1
+                injected += bad
+
+            if now >= next_report:
+                sys.stderr.write(f"[fake_gw] {emitted} leituras, {out.dropped} descartadas (pipe cheio), "
+                                 f"{injected} corrompidas, {lost} perdidas no rádio\n")
+                next_report += 5.0
+    except (KeyboardInterrupt, BrokenPipeError):
+        pass
+
+    secs = max(time.monotonic() - t0, 1e-9)
+    sys.stderr.write(f"[fake_gw] fim: {emitted} leituras em {secs:.1f}s ({emitted / secs:.0f}/s, "
+                     f"{out.bytes / secs / 1024:.1f} KB/s), {out.dropped} descartadas, "
+                     f"{injected} corrompidas, {lost} perdidas no rádio\n")
+
+
+if __name__ == "__main__":
+    main()
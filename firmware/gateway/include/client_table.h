@@ -0,0 +1,157 @@
+/**
+ * @file client_table.h
+ * @brief Tabela de clientes (nós) do gateway, com capacidade fixa definida em config.h.
+ *
+ * - Indexada pelo endereço de 16 bits (hash com sondagem linear, sem heap).
+ * - Guarda último contato, contadores e o último seq para estimar perdas.
+ * - Uma máscara dos últimos 32 seq descarta cópias repetidas (ex.: quadro ouvido
+ *   direto e também via repetidor); outra marca os seq contados em lost, e só
+ *   esses são descontados quando chegam atrasados.
+ * - Leituras da fila em flash do nó (reenviadas depois) têm seq antigo: contadas
+ *   à parte, sem mexer no last_seq do enlace direto.
+ * - Quando cheia, reaproveita a entrada menos recente (contabiliza em evictions).
+ */
+
+#ifndef CLIENT_TABLE_H
+#define CLIENT_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "protocol.h"
+
+struct ClientEntry {
+  node_addr_t addr;
+  bool        used;
+  uint8_t     last_seq;
+  bool        has_seq;
+  uint32_t    seen_mask;     // bit i: seq (last_seq - i) já recebido
+  uint32_t    lost_mask;     // bit i: seq (last_seq - i) contado em lost
+  uint32_t    first_seen_ms;
+  uint32_t    last_seen_ms;
+  uint32_t    packets;
+  uint32_t    lost;          // lacunas de seq observadas
+  uint32_t    duplicates;    // seq já recebido (descartado)
+  uint32_t    relayed;       // leituras que chegaram via repetidor
+  uint32_t    backlog;       // leituras reenviadas da fila em flash do nó
+  float       last_rssi;
+  float       last_snr;
+};
+
+template <size_t N>
+class ClientTable {
+ public:
+  static_assert(N > 0, "MAX_CLIENTS deve ser > 0");
+
+  // Retorna a entrada do nó, criando-a se necessário (nunca nulo).
+  ClientEntry& touch(node_addr_t addr, uint32_t now_ms) {
+    size_t victim = N;
+    size_t idx = slot_for(addr);
+    for (size_t probe = 0; probe < N; ++probe, idx = (idx + 1) % N) {
+      ClientEntry& e = entries_[idx];
+      if (e.used && e.addr == addr) { e.last_seen_ms = now_ms; return e; }
+      if (!e.used) { victim = idx; break; }
+    }
+
+    if (victim == N) {
+      // Tabela cheia: reaproveita o nó há mais tempo sem contato
+      victim = 0;
+      for (size_t i = 1; i < N; ++i)
+        if (entries_[i].last_seen_ms < entries_[victim].last_seen_ms) victim = i;
+      evictions_++;
+    } else {
+      count_++;
+    }
+
+    ClientEntry& e = entries_[victim];
+    e = ClientEntry{};
+    e.addr = addr;
+    e.used = true;
+    e.first_seen_ms = now_ms;
+    e.last_seen_ms = now_ms;
+    return e;
+  }
+
+  // Atualiza contadores de perda/duplicata a partir do seq do quadro.
+  // Retorna false se o seq já foi visto (o chamador deve descartar a leitura).
+  static bool account_seq(ClientEntry& e, uint8_t seq) {
+    if (!e.has_seq) {
+      e.last_seq = seq;
+      e.seen_mask = 1;
+      e.lost_mask = 0;
+      e.has_seq = true;
+      return true;
+    }
+
+    uint8_t ahead = (uint8_t)(seq - e.last_seq);
+    if (ahead == 0) { e.duplicates++; return false; }
+
+    if (ahead < 128) {
+      e.lost += ahead - 1;
+      e.seen_mask = (ahead >= 32 ? 0 : e.seen_mask << ahead) | 1u;
+      // Pulados: bits 1..ahead-1 em relação ao novo last_seq (até onde a máscara alcança)
+      uint32_t skipped = ahead - 1 >= 31 ? 0xFFFFFFFEu : ((1u << (ahead - 1)) - 1) << 1;
+      e.lost_mask = (ahead >= 32 ? 0 : e.lost_mask << ahead) | skipped;
+      e.last_seq = seq;
+      return true;
+    }
+
+    uint8_t behind = (uint8_t)(e.last_seq - seq);
+    if (behind < 32) {
+      if (e.seen_mask & (1u << behind)) { e.duplicates++; return false; }
+      e.seen_mask |= 1u << behind;
+      if (e.lost_mask & (1u << behind)) {   // chegou atrasado: não era perda
+        e.lost_mask &= ~(1u << behind);
+        e.lost--;
+      }
+      return true;
+    }
+
+    // Salto grande para trás: provável reboot do nó
+    e.last_seq = seq;
+    e.seen_mask = 1;
+    e.lost_mask = 0;
+    return true;
+  }
+
+  // Leitura da fila em flash: dentro da máscara descarta cópia e desconta a
+  // perda só se o seq foi contado em lost; mais antiga que isso não há como
+  // saber se é repetida (aceita).
+  static bool account_backlog(ClientEntry& e, uint8_t seq) {
+    if (!e.has_seq) return true;
+    uint8_t behind = (uint8_t)(e.last_seq - seq);
+    if (behind >= 32) return true;
+    if (e.seen_mask & (1u << behind)) { e.duplicates++; return false; }
+    e.seen_mask |= 1u << behind;
+    if (e.lost_mask & (1u << behind)) {
+      e.lost_mask &= ~(1u << behind);
+      e.lost--;
+    }
+    return true;
+  }
+
+  const ClientEntry* find(node_addr_t addr) const {
+    size_t idx = slot_for(addr);
+    for (size_t probe = 0; probe < N; ++probe, idx = (idx + 1) % N) {
+      const ClientEntry& e = entries_[idx];
+      if (!e.used) return nullptr;
+      if (e.addr == addr) return &e;
+    }
+    return nullptr;
+  }
+
+  size_t size() const { return count_; }
+  static constexpr size_t capacity() { return N; }
+  uint32_t evictions() const { return evictions_; }
+  const ClientEntry& at(size_t i) const { return entries_[i]; }
+
+ private:
+  static size_t slot_for(node_addr_t addr) {
+    return (size_t)((addr * 40503u) >> 4) % N;   // espalha endereços sequenciais
+  }
+
+  ClientEntry entries_[N] = {};
+  size_t      count_ = 0;
+  uint32_t    evictions_ = 0;
+};
+
+#endif // CLIENT_TABLE_H
@@ -5,6 +5,7 @@
  * Observações:
  * - Todos os valores podem ser sobrescritos via -D no platformio.ini (ex.: -DUSE_HTTP=false).
  * - Fluxo recomendado neste projeto: LoRa -> Serial -> (bridge Python) -> HTTP /data.
+ * - Para implantações maiores: LoRa -> Wi-Fi -> MQTT (USE_MQTT=true, ENABLE_WIFI=true).
  */
 
 #ifndef CONFIG_H
@@ -28,8 +29,52 @@
   #define USE_SERIAL true    // Imprime JSON puro em uma linha para o bridge ler
 #endif
 
+#ifndef USE_MQTT
+  #define USE_MQTT false     // Publica direto em um broker MQTT (exige ENABLE_WIFI)
+#endif
+
+// Tamanho máximo de um registro JSON (buffer fixo, sem String no caminho de saída).
+// Resumos de janela (MSG_TYPE_SENSOR_SUMMARY) acrescentam ~190 bytes de "stats".
+#ifndef JSON_MAX_LEN
+  #define JSON_MAX_LEN 512
+#endif
+
 #ifndef SERIAL_BAUD
-  #define SERIAL_BAUD 115200
+  #define SERIAL_BAUD 115200  // taxa base: sempre usada no início do enlace e no fallback
+#endif
+
+// Negociação de taxa com o bridge (@HELLO / @BAUD / @PING). O bridge escolhe a
+// maior taxa da lista (<= SERIAL_BAUD_MAX) que passar no teste de eco.
+// Com ARDUINO_USB_CDC_ON_BOOT=1 a Serial é USB CDC e a taxa é ignorada.
+#ifndef SERIAL_BAUD_MAX
+  #define SERIAL_BAUD_MAX 2000000
+#endif
+#ifndef SERIAL_BAUD_RATES
+  #define SERIAL_BAUD_RATES 115200, 230400, 460800, 921600, 1500000, 2000000, 3000000
+#endif
+#ifndef LINK_CONFIRM_MS
+  #define LINK_CONFIRM_MS 2000     // prazo para o primeiro @PING na nova taxa
+#endif
+#ifndef LINK_KEEPALIVE_MS
+  #define LINK_KEEPALIVE_MS 15000  // sem @PING nesse prazo => volta à taxa base
+#endif
+#ifndef LINK_GARBAGE_MAX
+  #define LINK_GARBAGE_MAX 8       // linhas de controle corrompidas antes do fallback
+#endif
+
+// Controle de fluxo por créditos com o bridge (@FC / @ACK / @CREDIT). Só vale
+// depois que o bridge envia @FC; até lá (ou com bridge antigo) o JSON sai direto.
+#ifndef FC_QUEUE_SLOTS
+  #define FC_QUEUE_SLOTS 16          // registros retidos no gateway (em voo + pendentes)
+#endif
+#ifndef FC_POLICY
+  #define FC_POLICY 0                // fila cheia: 0 = descarta o mais antigo, 1 = agrega por nó, 2 = descarta menor prioridade
+#endif
+#ifndef FC_ACK_TIMEOUT_MS
+  #define FC_ACK_TIMEOUT_MS 5000     // sem @ACK/@CREDIT com registros em voo => reenvia desde o primeiro não confirmado
+#endif
+#ifndef FC_TIMEOUT_MAX
+  #define FC_TIMEOUT_MAX 3           // timeouts seguidos sem @ACK/@CREDIT => desliga o FC e volta ao JSON puro (0 = nunca)
 #endif
 
 // Se quiser prefixar a linha serial (eu recomendo string vazia para JSON puro):
@@ -48,10 +93,46 @@
   #define MAX_PACKET_SIZE 256
 #endif
 
+// Descritores de pacote entre RX e decodificação/saída (~MAX_PACKET_SIZE + 16 bytes cada).
+// O SX1262 guarda um pacote só e o loop() lê e processa um por iteração, então
+// nunca há mais de um descritor em uso: mais slots só servem a um consumidor em
+// outra tarefa. Rajadas durante uma saída lenta (HTTP) se perdem no rádio.
+#ifndef PACKET_POOL_SLOTS
+  #define PACKET_POOL_SLOTS 1
+#endif
+
+// Capacidade da tabela de clientes (nós distintos acompanhados pelo gateway).
+// Endereços são de 16 bits; dimensione conforme o tamanho do site (~48 bytes/nó).
+#ifndef MAX_CLIENTS
+  #define MAX_CLIENTS 64
+#endif
+
+// Quantos nós listar no bloco de estatísticas periódicas
+#ifndef STATS_MAX_CLIENTS
+  #define STATS_MAX_CLIENTS 16
+#endif
+
 #ifndef STATS_INTERVAL_MS
   #define STATS_INTERVAL_MS 60000
 #endif
 
+// Sem heap após o boot (heap_guard.h): compile com o env *_noheap do
+// platformio.ini, que liga NO_HEAP_AFTER_BOOT e intercepta malloc/new no link.
+// Alocações da tarefa do loop() são contadas por ponto de chamada (@HEAP nas
+// estatísticas; tools/heap_report.py resolve os endereços).
+#ifndef NO_HEAP_AFTER_BOOT
+  #define NO_HEAP_AFTER_BOOT false
+#endif
+#ifndef HEAP_GUARD_TRAP
+  #define HEAP_GUARD_TRAP false      // true: abort() (com backtrace) na primeira alocação contada
+#endif
+#ifndef HEAP_GUARD_SITES
+  #define HEAP_GUARD_SITES 24        // pontos de chamada distintos guardados
+#endif
+#ifndef HEAP_GUARD_WARMUP_LOOPS
+  #define HEAP_GUARD_WARMUP_LOOPS 16 // iterações iniciais de loop() tratadas como aquecimento
+#endif
+
 // Modo de teste (injeta pacotes fake)
 #ifndef TEST_MODE
   #define TEST_MODE true
@@ -85,6 +166,14 @@
 #ifndef LORA_BUSY
   #define LORA_BUSY 40
 #endif
+// DMA desligado por padrão: o ganho sobre o SPIClass ainda não foi medido em
+// placa (compare com os contadores "SPI:"/"Leitura pós-RX" das estatísticas)
+#ifndef LORA_SPI_DMA
+  #define LORA_SPI_DMA false        // SPI master do ESP-IDF com DMA (esp_dma_hal.h); false = SPIClass
+#endif
+#ifndef LORA_SPI_CLOCK_HZ
+  #define LORA_SPI_CLOCK_HZ 8000000UL   // até 16 MHz no SX1262; radio_start reduz se a verificação do SPI falhar
+#endif
 
 #ifndef LORA_FREQUENCY_MHZ
   #define LORA_FREQUENCY_MHZ 915.0   // 915 Américas | 868 EU | 433 Ásia
@@ -102,7 +191,99 @@
   #define LORA_SYNC_WORD 0x12
 #endif
 #ifndef LORA_PREAMBLE
-  #define LORA_PREAMBLE 8
+  #define LORA_PREAMBLE (LOW_POWER_RX ? LP_PREAMBLE : 8)
+#endif
+
+// Monitor de saúde do rádio: sonda SPI periódica, detecção de silêncio e
+// reinicialização com backoff exponencial (sem reiniciar o MCU).
+#ifndef RADIO_SILENCE_MS
+  #define RADIO_SILENCE_MS 600000    // sem IRQ de RX => sonda + reinicia RX (~3x o maior intervalo de TX; 0 = desliga)
+#endif
+#ifndef RADIO_PROBE_MS
+  #define RADIO_PROBE_MS 30000       // período da sonda de registrador via SPI
+#endif
+#ifndef RADIO_ERR_MAX
+  #define RADIO_ERR_MAX 5            // erros seguidos antes de derrubar e reinicializar
+#endif
+#ifndef RADIO_BACKOFF_MIN_MS
+  #define RADIO_BACKOFF_MIN_MS 1000
+#endif
+#ifndef RADIO_BACKOFF_MAX_MS
+  #define RADIO_BACKOFF_MAX_MS 60000
+#endif
+
+// Piso de ruído / ocupação do canal: RSSI instantâneo amostrado entre pacotes
+// (não tira o rádio de RX). Relatado e zerado a cada STATS_INTERVAL_MS.
+#ifndef NOISE_SAMPLE_MS
+  #define NOISE_SAMPLE_MS (LOW_POWER_RX ? 0 : 100)   // período médio entre amostras (0 = desliga)
+#endif
+#ifndef NOISE_FLOOR_PCT
+  #define NOISE_FLOOR_PCT 10         // percentil da janela usado como piso
+#endif
+#ifndef NOISE_BUSY_MARGIN_DB
+  #define NOISE_BUSY_MARGIN_DB 6     // amostra acima de piso + margem => canal ocupado
+#endif
+
+// Downlink: comandos enfileirados pelo bridge (@DL) por nó e transmitidos
+// DOWNLINK_RX_DELAY_MS após o fim do próximo uplink do nó (janela de RX do client).
+#ifndef ENABLE_DOWNLINK
+  #define ENABLE_DOWNLINK true
+#endif
+#ifndef DOWNLINK_RX_DELAY_MS
+  #define DOWNLINK_RX_DELAY_MS 250   // igual ao do client
+#endif
+#ifndef DL_NODES
+  #define DL_NODES 16                // nós com comandos pendentes ao mesmo tempo
+#endif
+#ifndef DL_DEPTH
+  #define DL_DEPTH 4                 // comandos pendentes por nó
+#endif
+#ifndef DL_TTL_MS
+  #define DL_TTL_MS 3600000          // validade padrão de um comando (ttl 0 no @DL)
+#endif
+#ifndef DL_TX_POWER_DBM
+  #define DL_TX_POWER_DBM 14
+#endif
+// Confirma com DL_CMD_ACK todo uplink sem comando pendente (nós com fila em
+// flash e STORE_REQUIRE_ACK). Custa um TX curto por uplink, com o gateway surdo.
+#ifndef DL_ACK_UPLINKS
+  #define DL_ACK_UPLINKS false
+#endif
+
+// Gateway a bateria/solar: o SX1262 alterna sono e escutas curtas à procura de
+// preâmbulo (RX duty cycle) e o ESP32 fica em light sleep até o DIO1. Os clients
+// precisam de preâmbulo longo: compile-os com GATEWAY_LOW_POWER_RX=true.
+// Desliga a amostragem de ruído (cada acesso SPI acorda o rádio).
+#ifndef LOW_POWER_RX
+  #define LOW_POWER_RX false
+#endif
+#ifndef LP_PREAMBLE
+  #define LP_PREAMBLE 64             // preâmbulo dos clients (símbolos); mesmo valor no client
+#endif
+#ifndef LP_MIN_SYMBOLS
+  #define LP_MIN_SYMBOLS 8           // símbolos de preâmbulo para detecção em cada escuta
+#endif
+#ifndef LP_LIGHT_SLEEP
+  #define LP_LIGHT_SLEEP true        // ESP32 em light sleep entre pacotes (exige UART, não USB CDC)
+#endif
+#ifndef LP_MAX_SLEEP_MS
+  #define LP_MAX_SLEEP_MS 1000       // acorda ao menos nesse período (sonda, estatísticas, downlink)
+#endif
+// Correntes típicas para a estimativa de consumo nas estatísticas (mA)
+#ifndef LP_RADIO_RX_MA
+  #define LP_RADIO_RX_MA 4.6f
+#endif
+#ifndef LP_RADIO_SLEEP_MA
+  #define LP_RADIO_SLEEP_MA 0.0012f  // sono com retenção (warm start)
+#endif
+#ifndef LP_MCU_ACTIVE_MA
+  #define LP_MCU_ACTIVE_MA 40.0f
+#endif
+#ifndef LP_MCU_SLEEP_MA
+  #define LP_MCU_SLEEP_MA 0.24f      // light sleep do ESP32-S3
+#endif
+#ifndef LP_SUPPLY_V
+  #define LP_SUPPLY_V 3.3f
 #endif
 
 // ============================================================================
@@ -132,6 +313,61 @@
   #define WIFI_TIMEOUT_MS 10000
 #endif
 
+// ============================================================================
+// (Opcional) MQTT: só usado se USE_MQTT=true
+// ============================================================================
+#ifndef MQTT_HOST
+  #define MQTT_HOST "127.0.0.1"
+#endif
+#ifndef MQTT_PORT
+  #define MQTT_PORT 1883
+#endif
+#ifndef MQTT_USER
+  #define MQTT_USER ""
+#endif
+#ifndef MQTT_PASSWORD
+  #define MQTT_PASSWORD ""
+#endif
+#ifndef MQTT_TOPIC_PREFIX
+  #define MQTT_TOPIC_PREFIX "lora"   // tópicos: <prefixo>/<gateway>/node/<id> e .../batch
+#endif
+#ifndef MQTT_QOS
+  #define MQTT_QOS 1                 // 0 ou 1
+#endif
+#ifndef MQTT_BATCH_MAX
+  #define MQTT_BATCH_MAX 1           // 1 = uma publicação por leitura no tópico do nó
+#endif
+#ifndef MQTT_BATCH_FLUSH_MS
+  #define MQTT_BATCH_FLUSH_MS 2000   // idade máxima de um lote incompleto
+#endif
+#ifndef MQTT_QUEUE_SLOTS
+  #define MQTT_QUEUE_SLOTS 32        // fila entre RX e broker; cheia => descarta o mais antigo
+#endif
+#ifndef MQTT_KEEPALIVE_S
+  #define MQTT_KEEPALIVE_S 30
+#endif
+#ifndef MQTT_TIMEOUT_MS
+  #define MQTT_TIMEOUT_MS 500        // espera máxima por CONNACK/PUBACK
+#endif
+#ifndef MQTT_RECONNECT_MS
+  #define MQTT_RECONNECT_MS 5000
+#endif
+#ifndef MQTT_PUBLISH_BUDGET
+  #define MQTT_PUBLISH_BUDGET 4      // publicações por ciclo da tarefa MQTT
+#endif
+#ifndef MQTT_TASK_CORE
+  #define MQTT_TASK_CORE 0           // junto da pilha WiFi; loop() e rádio ficam no core 1
+#endif
+#ifndef MQTT_TASK_PERIOD_MS
+  #define MQTT_TASK_PERIOD_MS 20     // pausa entre ciclos da tarefa MQTT
+#endif
+#ifndef MQTT_TASK_STACK
+  #define MQTT_TASK_STACK 6144
+#endif
+#ifndef MQTT_BUFFER_SIZE
+  #define MQTT_BUFFER_SIZE 4096      // buffer do cliente MQTT (limita o tamanho do lote)
+#endif
+
 // ============================================================================
 // Namespaces (apenas leitura) — evitam macros no código-fonte
 // ============================================================================
@@ -143,6 +379,8 @@ namespace LinkCfg {
   constexpr uint8_t  kRst  = LORA_RST;
   constexpr uint8_t  kDio1 = LORA_DIO1;
   constexpr uint8_t  kBusy = LORA_BUSY;
+  constexpr bool     kSpiDma     = LORA_SPI_DMA;
+  constexpr uint32_t kSpiClockHz = LORA_SPI_CLOCK_HZ;
   constexpr float    kFreqMHz  = LORA_FREQUENCY_MHZ;
   constexpr float    kBwKHz    = LORA_BW_KHZ;
   constexpr uint8_t  kSf       = LORA_SF;
@@ -151,10 +389,57 @@ namespace LinkCfg {
   constexpr uint16_t kPreamble = LORA_PREAMBLE;
 }
 
+namespace HealthCfg {
+  constexpr uint32_t kSilenceMs    = RADIO_SILENCE_MS;
+  constexpr uint32_t kProbeMs      = RADIO_PROBE_MS;
+  constexpr uint8_t  kErrMax       = RADIO_ERR_MAX;
+  constexpr uint32_t kBackoffMinMs = RADIO_BACKOFF_MIN_MS;
+  constexpr uint32_t kBackoffMaxMs = RADIO_BACKOFF_MAX_MS;
+}
+
+namespace NoiseCfg {
+  constexpr uint32_t kSampleMs     = NOISE_SAMPLE_MS;
+  constexpr uint8_t  kFloorPct     = NOISE_FLOOR_PCT;
+  constexpr int      kBusyMarginDb = NOISE_BUSY_MARGIN_DB;
+}
+
+namespace DownlinkCfg {
+  constexpr bool     kEnabled    = ENABLE_DOWNLINK;
+  constexpr uint32_t kRxDelayMs  = DOWNLINK_RX_DELAY_MS;
+  constexpr size_t   kNodes      = DL_NODES;
+  constexpr size_t   kDepth      = DL_DEPTH;
+  constexpr uint32_t kTtlMs      = DL_TTL_MS;
+  constexpr int8_t   kTxPowerDbm = DL_TX_POWER_DBM;
+  constexpr bool     kAckUplinks = DL_ACK_UPLINKS;
+}
+
+namespace LowPowerCfg {
+  constexpr bool     kEnabled    = LOW_POWER_RX;
+  constexpr uint16_t kPreamble   = LP_PREAMBLE;
+  constexpr uint16_t kMinSymbols = LP_MIN_SYMBOLS;
+  constexpr bool     kLightSleep = LP_LIGHT_SLEEP;
+  constexpr uint32_t kMaxSleepMs = LP_MAX_SLEEP_MS;
+  // Períodos de escuta/sono como em SX126x::startReceiveDutyCycleAuto (RadioLib 6.x), em us
+  constexpr uint32_t kSymbolUs = static_cast<uint32_t>(1000.0f * (1UL << LinkCfg::kSf) / LinkCfg::kBwKHz);
+  constexpr uint32_t kSleepUs  = kSymbolUs * (kPreamble > 2 * kMinSymbols ? kPreamble - 2 * kMinSymbols : 0);
+  constexpr uint32_t kWakeA    = (kSymbolUs * (kPreamble + 1) - (kSleepUs - 1000)) / 2;
+  constexpr uint32_t kWakeB    = kSymbolUs * (kMinSymbols + 1);
+  constexpr uint32_t kWakeUs   = kWakeA > kWakeB ? kWakeA : kWakeB;
+  constexpr float    kRadioDuty= static_cast<float>(kWakeUs) / (kWakeUs + kSleepUs);
+  constexpr float    kRadioRxMa    = LP_RADIO_RX_MA;
+  constexpr float    kRadioSleepMa = LP_RADIO_SLEEP_MA;
+  constexpr float    kMcuActiveMa  = LP_MCU_ACTIVE_MA;
+  constexpr float    kMcuSleepMa   = LP_MCU_SLEEP_MA;
+  constexpr float    kSupplyV      = LP_SUPPLY_V;
+}
+
 namespace GwCfg {
   constexpr uint8_t   kGatewayId   = GATEWAY_ID;
   constexpr uint32_t  kStatsEveryMs= STATS_INTERVAL_MS;
   constexpr uint16_t  kMaxPkt      = MAX_PACKET_SIZE;
+  constexpr size_t    kPoolSlots   = PACKET_POOL_SLOTS;
+  constexpr size_t    kMaxClients  = MAX_CLIENTS;
+  constexpr size_t    kStatsClients= STATS_MAX_CLIENTS;
   constexpr bool      kTestMode    = TEST_MODE;
   constexpr uint32_t  kTestEveryMs = TEST_INTERVAL_MS;
 }
@@ -162,10 +447,35 @@ namespace GwCfg {
 namespace IoCfg {
   constexpr bool     kUseSerial = USE_SERIAL;
   constexpr uint32_t kSerialBaud= SERIAL_BAUD;
+  constexpr uint32_t kBaudMax   = SERIAL_BAUD_MAX;
+  constexpr uint32_t kBaudRates[] = { SERIAL_BAUD_RATES };
+  constexpr uint32_t kLinkConfirmMs  = LINK_CONFIRM_MS;
+  constexpr uint32_t kLinkKeepaliveMs= LINK_KEEPALIVE_MS;
+  constexpr uint8_t  kLinkGarbageMax = LINK_GARBAGE_MAX;
+  constexpr size_t   kJsonMax   = JSON_MAX_LEN;
+#if ARDUINO_USB_CDC_ON_BOOT
+  constexpr bool     kUsbCdc    = true;
+#else
+  constexpr bool     kUsbCdc    = false;
+#endif
   // prefixo para a linha — mantenha "" para o bridge ler JSON puro
   inline const char*  Prefix() { return SERIAL_PREFIX; }
 }
 
+namespace FlowCfg {
+  constexpr size_t   kSlots        = FC_QUEUE_SLOTS;
+  constexpr uint8_t  kPolicy       = FC_POLICY;
+  constexpr uint32_t kAckTimeoutMs = FC_ACK_TIMEOUT_MS;
+  constexpr uint8_t  kTimeoutMax   = FC_TIMEOUT_MAX;
+}
+
+namespace HeapCfg {
+  constexpr bool     kGuard        = NO_HEAP_AFTER_BOOT;
+  constexpr bool     kTrap         = HEAP_GUARD_TRAP;
+  constexpr size_t   kSites        = HEAP_GUARD_SITES;
+  constexpr uint32_t kWarmupLoops  = HEAP_GUARD_WARMUP_LOOPS;
+}
+
 namespace NetCfg {
   constexpr bool      kUseHttp     = USE_HTTP;
   constexpr bool      kWifiEnabled = ENABLE_WIFI;
@@ -177,9 +487,60 @@ namespace NetCfg {
   constexpr uint32_t  WifiTimeoutMs = WIFI_TIMEOUT_MS;
 }
 
+namespace MqttCfg {
+  constexpr bool      kEnabled      = USE_MQTT;
+  inline const char*  Host() { return MQTT_HOST; }
+  constexpr uint16_t  kPort         = MQTT_PORT;
+  inline const char*  User() { return MQTT_USER; }
+  inline const char*  Pass() { return MQTT_PASSWORD; }
+  inline const char*  Prefix() { return MQTT_TOPIC_PREFIX; }
+  constexpr uint8_t   kQos          = MQTT_QOS;
+  constexpr size_t    kBatchMax     = MQTT_BATCH_MAX;
+  constexpr uint32_t  kBatchFlushMs = MQTT_BATCH_FLUSH_MS;
+  constexpr size_t    kQueueSlots   = MQTT_QUEUE_SLOTS;
+  constexpr uint16_t  kKeepAliveS   = MQTT_KEEPALIVE_S;
+  constexpr uint32_t  kTimeoutMs    = MQTT_TIMEOUT_MS;
+  constexpr uint32_t  kReconnectMs  = MQTT_RECONNECT_MS;
+  constexpr uint8_t   kBudget       = MQTT_PUBLISH_BUDGET;
+  constexpr size_t    kBufferSize   = MQTT_BUFFER_SIZE;
+  constexpr int       kTaskCore     = MQTT_TASK_CORE;
+  constexpr uint32_t  kTaskPeriodMs = MQTT_TASK_PERIOD_MS;
+  constexpr uint32_t  kTaskStack    = MQTT_TASK_STACK;
+}
+
 namespace DebugCfg {
   constexpr bool     kDebug = true;
   constexpr uint32_t kBaud  = SERIAL_BAUD;
 }
 
+static_assert(IoCfg::kBaudMax >= IoCfg::kSerialBaud, "SERIAL_BAUD_MAX deve ser >= SERIAL_BAUD.");
+static_assert(HeapCfg::kSites >= 1, "HEAP_GUARD_SITES deve ser >= 1.");
+static_assert(!(HeapCfg::kGuard && HeapCfg::kTrap && NetCfg::kUseHttp),
+              "HEAP_GUARD_TRAP com USE_HTTP: HTTPClient/String alocam a cada leitura (use MQTT ou serial).");
+static_assert(FlowCfg::kSlots >= 2 && FlowCfg::kSlots <= 255, "FC_QUEUE_SLOTS deve estar entre 2 e 255.");
+static_assert(FlowCfg::kPolicy <= 2, "FC_POLICY deve ser 0, 1 ou 2.");
+static_assert(FC_TIMEOUT_MAX >= 0 && FC_TIMEOUT_MAX <= 255, "FC_TIMEOUT_MAX deve estar entre 0 e 255.");
+static_assert(!MqttCfg::kEnabled || NetCfg::kWifiEnabled, "USE_MQTT exige ENABLE_WIFI=true.");
+static_assert(MqttCfg::kQos <= 1, "MQTT_QOS deve ser 0 ou 1.");
+static_assert(MqttCfg::kBatchMax >= 1, "MQTT_BATCH_MAX deve ser >= 1.");
+static_assert(MqttCfg::kBatchMax * IoCfg::kJsonMax + 64 <= MqttCfg::kBufferSize,
+              "MQTT_BUFFER_SIZE pequeno demais para MQTT_BATCH_MAX registros.");
+static_assert(GwCfg::kMaxClients >= 1 && GwCfg::kMaxClients <= 65536,
+              "MAX_CLIENTS deve estar entre 1 e 65536 (endereços de 16 bits).");
+static_assert(LinkCfg::kSpiClockHz >= 1000000UL && LinkCfg::kSpiClockHz <= 16000000UL,
+              "LORA_SPI_CLOCK_HZ deve estar entre 1 e 16 MHz.");
+static_assert(HealthCfg::kErrMax >= 1, "RADIO_ERR_MAX deve ser >= 1.");
+static_assert(HealthCfg::kBackoffMinMs >= 1 && HealthCfg::kBackoffMinMs <= HealthCfg::kBackoffMaxMs,
+              "RADIO_BACKOFF_MIN_MS deve estar entre 1 e RADIO_BACKOFF_MAX_MS.");
+static_assert(DownlinkCfg::kRxDelayMs >= 50, "DOWNLINK_RX_DELAY_MS deve ser >= 50 (tempo de virada do rádio).");
+static_assert(DownlinkCfg::kNodes >= 1 && DownlinkCfg::kDepth >= 1 && DownlinkCfg::kDepth <= 255,
+              "DL_NODES >= 1 e DL_DEPTH entre 1 e 255.");
+static_assert(!LowPowerCfg::kEnabled || LowPowerCfg::kSleepUs > 1000,
+              "LOW_POWER_RX: LP_PREAMBLE curto demais para dormir (precisa > 2 * LP_MIN_SYMBOLS).");
+static_assert(!LowPowerCfg::kEnabled || LinkCfg::kPreamble >= LowPowerCfg::kPreamble,
+              "LOW_POWER_RX: LORA_PREAMBLE deve ser >= LP_PREAMBLE.");
+static_assert(!LowPowerCfg::kEnabled || NoiseCfg::kSampleMs == 0,
+              "LOW_POWER_RX: amostragem de ruído acorda o rádio; use NOISE_SAMPLE_MS=0.");
+static_assert(NoiseCfg::kFloorPct >= 1 && NoiseCfg::kFloorPct <= 99, "NOISE_FLOOR_PCT deve estar entre 1 e 99.");
+
 #endif // CONFIG_H
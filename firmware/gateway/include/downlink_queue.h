@@ -0,0 +1,200 @@
+/**
+ * @file downlink_queue.h
+ * @brief Fila fixa de comandos de downlink por nó (sem heap).
+ *
+ * - Até kNodes nós com comandos pendentes, kDepth comandos cada; o slot do nó
+ *   é liberado quando a fila dele esvazia.
+ * - head(): comando de maior prioridade (o mais antigo entre iguais), entregue
+ *   na janela que o nó abre após o próximo uplink; pop() o remove depois do TX.
+ * - Mesmo comando já na fila: substitui (a configuração mais nova vence).
+ * - Fila do nó cheia: o novo comando toma o lugar do de menor prioridade, se
+ *   for mais prioritário; senão é recusado.
+ * - Cada comando expira após ttl_ms (nó que some não prende a fila).
+ */
+
+#ifndef DOWNLINK_QUEUE_H
+#define DOWNLINK_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "protocol.h"
+
+enum DlResult : uint8_t {
+  DL_QUEUED = 0,
+  DL_REPLACED,     // substituiu o mesmo comando já na fila
+  DL_EVICTED,      // tomou o lugar de um comando menos prioritário
+  DL_FULL,         // fila do nó cheia de comandos com prioridade >= a nova
+  DL_NO_SLOT,      // nós demais com comandos pendentes
+  DL_TOO_LONG,     // payload maior que kPayload
+};
+
+template <size_t kNodes, size_t kDepth, size_t kPayload>
+class DownlinkQueue {
+ public:
+  static_assert(kNodes >= 1 && kDepth >= 1 && kDepth <= 255, "dimensões inválidas");
+
+  struct Entry {
+    uint8_t  cmd;
+    uint8_t  prio;          // maior = sai antes
+    uint8_t  len;
+    uint8_t  payload[kPayload];
+    uint32_t queued_ms;
+    uint32_t ttl_ms;
+  };
+
+  DlResult push(node_addr_t node, uint8_t cmd, uint8_t prio, uint32_t ttl_ms,
+                const uint8_t* data, uint8_t len, uint32_t now_ms) {
+    if (len > kPayload) { rejected_++; return DL_TOO_LONG; }
+    Slot* s = find(node);
+    if (!s) {
+      s = find(NODE_ADDR_NONE);
+      if (!s) { rejected_++; return DL_NO_SLOT; }
+      s->addr  = node;
+      s->count = 0;
+      s->seq   = (uint8_t)now_ms;   // evita repetir o seq de um slot anterior do mesmo nó
+    }
+
+    DlResult res = DL_QUEUED;
+    Entry* e = nullptr;
+    for (uint8_t i = 0; i < s->count && !e; ++i)
+      if (s->q[i].cmd == cmd) { e = &s->q[i]; res = DL_REPLACED; }
+    if (!e && s->count < kDepth) e = &s->q[s->count++];
+    if (!e) {
+      Entry* low = &s->q[lowest(*s)];
+      if (low->prio >= prio) { rejected_++; return DL_FULL; }
+      e = low;
+      res = DL_EVICTED;
+      evicted_++;
+    }
+
+    e->cmd = cmd;
+    e->prio = prio;
+    e->len = len;
+    for (uint8_t i = 0; i < len; ++i) e->payload[i] = data[i];
+    e->queued_ms = now_ms;
+    e->ttl_ms = ttl_ms;
+    queued_++;
+    return res;
+  }
+
+  // Próximo comando do nó (nullptr se não houver). Descarta os expirados antes.
+  const Entry* head(node_addr_t node, uint32_t now_ms) {
+    Slot* s = find(node);
+    if (!s) return nullptr;
+    drop_expired(*s, now_ms, [](node_addr_t, const Entry&) {});
+    if (s->count == 0) { s->addr = NODE_ADDR_NONE; return nullptr; }
+    return &s->q[best(*s)];
+  }
+
+  // Remove o comando devolvido por head() (já transmitido) e avança o seq do nó.
+  void pop(node_addr_t node) {
+    Slot* s = find(node);
+    if (!s || s->count == 0) return;
+    remove(*s, best(*s));
+    s->seq++;
+    sent_++;
+    if (s->count == 0) s->addr = NODE_ADDR_NONE;
+  }
+
+  uint8_t seq(node_addr_t node) const {
+    for (const Slot& s : slots_)
+      if (s.addr == node) return s.seq;
+    return 0;
+  }
+
+  // Varre todos os nós; on_expired(node, entry) é chamado para cada comando vencido.
+  template <typename F>
+  size_t expire(uint32_t now_ms, F on_expired) {
+    size_t n = 0;
+    for (Slot& s : slots_) {
+      if (s.addr == NODE_ADDR_NONE) continue;
+      n += drop_expired(s, now_ms, on_expired);
+      if (s.count == 0) s.addr = NODE_ADDR_NONE;
+    }
+    return n;
+  }
+
+  size_t pending(node_addr_t node) const {
+    for (const Slot& s : slots_)
+      if (s.addr == node) return s.count;
+    return 0;
+  }
+
+  size_t size() const {
+    size_t n = 0;
+    for (const Slot& s : slots_) if (s.addr != NODE_ADDR_NONE) n += s.count;
+    return n;
+  }
+
+  size_t nodes() const {
+    size_t n = 0;
+    for (const Slot& s : slots_) if (s.addr != NODE_ADDR_NONE) n++;
+    return n;
+  }
+
+  static constexpr size_t capacity() { return kNodes * kDepth; }
+  uint32_t queued() const   { return queued_; }
+  uint32_t sent() const     { return sent_; }
+  uint32_t expired() const  { return expired_; }
+  uint32_t evicted() const  { return evicted_; }
+  uint32_t rejected() const { return rejected_; }
+
+ private:
+  struct Slot {
+    node_addr_t addr = NODE_ADDR_NONE;
+    uint8_t     count = 0;
+    uint8_t     seq = 0;
+    Entry       q[kDepth];
+  };
+
+  Slot* find(node_addr_t node) {
+    for (Slot& s : slots_)
+      if (s.addr == node) return &s;
+    return nullptr;
+  }
+
+  static uint8_t best(const Slot& s) {
+    uint8_t b = 0;
+    for (uint8_t i = 1; i < s.count; ++i)
+      if (s.q[i].prio > s.q[b].prio ||
+          (s.q[i].prio == s.q[b].prio && (int32_t)(s.q[i].queued_ms - s.q[b].queued_ms) < 0)) b = i;
+    return b;
+  }
+
+  static uint8_t lowest(const Slot& s) {
+    uint8_t l = 0;
+    for (uint8_t i = 1; i < s.count; ++i)
+      if (s.q[i].prio < s.q[l].prio ||
+          (s.q[i].prio == s.q[l].prio && (int32_t)(s.q[i].queued_ms - s.q[l].queued_ms) < 0)) l = i;
+    return l;
+  }
+
+  static void remove(Slot& s, uint8_t i) {
+    s.q[i] = s.q[--s.count];
+  }
+
+  template <typename F>
+  size_t drop_expired(Slot& s, uint32_t now_ms, F on_expired) {
+    size_t n = 0;
+    for (uint8_t i = 0; i < s.count;) {
+      if (now_ms - s.q[i].queued_ms >= s.q[i].ttl_ms) {
+        on_expired(s.addr, s.q[i]);
+        remove(s, i);
+        expired_++;
+        n++;
+      } else {
+        ++i;
+      }
+    }
+    return n;
+  }
+
+  Slot     slots_[kNodes];
+  uint32_t queued_   = 0;
+  uint32_t sent_     = 0;
+  uint32_t expired_  = 0;
+  uint32_t evicted_  = 0;
+  uint32_t rejected_ = 0;
+};
+
+#endif // DOWNLINK_QUEUE_H
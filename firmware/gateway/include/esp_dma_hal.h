@@ -0,0 +1,160 @@
+/**
+ * @file esp_dma_hal.h
+ * @brief HAL do RadioLib com SPI master do ESP-IDF (DMA) para o SX1262.
+ *
+ * - Mesmo arquivo no client e no gateway.
+ * - O RadioLib monta cada comando (opcode + endereço + dados) em um único buffer
+ *   e chama spiTransfer() uma vez: aqui isso vira UMA transação do spi_master
+ *   (polling, DMA), em vez do laço byte a byte do SPIClass do Arduino. Leituras
+ *   de FIFO e de vários registradores saem em rajada na mesma transação.
+ * - O barramento fica reservado (acquire) entre begin/endTransaction, o que
+ *   elimina a arbitragem por transação. O NSS continua por GPIO (RadioLib).
+ * - Usa um host SPI próprio (SPI3 por padrão) para não disputar com o `SPI`
+ *   global do Arduino (FSPI/SPI2 no ESP32-S3).
+ * - dma=false: cai no ArduinoHal (SPIClass), com o mesmo clock configurável;
+ *   serve de referência para comparar tempos (contadores valem nos dois modos).
+ *   O SPISettings de cada transação é montado aqui com o clock atual.
+ * - step_down(): reduz o clock pela metade (mín. 1 MHz) quando o init falha com
+ *   erro de SPI (spi_fault()), nos dois modos; parâmetros inválidos ou BUSY
+ *   preso não contam.
+ * - Cada transação passa por buffers do próprio HAL, alinhados a 4 bytes: com
+ *   os buffers do RadioLib (pilha, desalinhados) o spi_master alocaria um
+ *   bounce buffer por transação com heap_caps_malloc(MALLOC_CAP_DMA). O objeto
+ *   precisa ficar em RAM interna (global/estático, nunca em PSRAM).
+ */
+
+#ifndef ESP_DMA_HAL_H
+#define ESP_DMA_HAL_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <RadioLib.h>
+#include <driver/spi_master.h>
+
+class EspDmaHal : public ArduinoHal {
+ public:
+  static constexpr uint32_t kMinClockHz = 1000000;
+  static constexpr size_t   kBounceBytes = 260;   // FIFO de 255 bytes + cabeçalho, múltiplo de 4
+
+  EspDmaHal(SPIClass& spi, int8_t sck, int8_t miso, int8_t mosi, uint32_t clock_hz, bool dma,
+            spi_host_device_t host = SPI3_HOST)
+      : ArduinoHal(spi, SPISettings(clock_hz, MSBFIRST, SPI_MODE0)),
+        spi_(spi), sck_(sck), miso_(miso), mosi_(mosi), clock_hz_(clock_hz), dma_(dma), host_(host) {}
+
+  void init() override {
+    if (dma_) spiBegin();
+    else ArduinoHal::init();
+  }
+
+  void term() override {
+    if (dma_) spiEnd();
+    else ArduinoHal::term();
+  }
+
+  void spiBegin() override {
+    if (!dma_) { ArduinoHal::spiBegin(); return; }
+    if (dev_) return;
+    if (!bus_ready_) {
+      spi_bus_config_t bus = {};
+      bus.mosi_io_num     = mosi_;
+      bus.miso_io_num     = miso_;
+      bus.sclk_io_num     = sck_;
+      bus.quadwp_io_num   = -1;
+      bus.quadhd_io_num   = -1;
+      bus.max_transfer_sz = 512;           // FIFO de 255 bytes + cabeçalho do comando
+      esp_err_t err = spi_bus_initialize(host_, &bus, SPI_DMA_CH_AUTO);
+      bus_ready_ = (err == ESP_OK || err == ESP_ERR_INVALID_STATE);   // já iniciado
+      if (!bus_ready_) { errors_++; return; }
+    }
+    add_device();
+  }
+
+  void spiBeginTransaction() override {
+    t0_ = micros();
+    if (!dma_) { spi_.beginTransaction(SPISettings(clock_hz_, MSBFIRST, SPI_MODE0)); return; }
+    if (!dev_) spiBegin();
+    if (dev_) spi_device_acquire_bus(dev_, portMAX_DELAY);
+  }
+
+  void spiTransfer(uint8_t* out, size_t len, uint8_t* in) override {
+    transactions_++;
+    bytes_ += len;
+    if (!dma_) { ArduinoHal::spiTransfer(out, len, in); return; }
+    if (!dev_ || len == 0) { errors_++; return; }
+    // Acima de kBounceBytes (não acontece com o SX1262) o driver volta a alocar
+    bool own = len <= kBounceBytes;
+    if (own && out) memcpy(tx_dma_, out, len);
+    spi_transaction_t t = {};
+    t.length    = len * 8;
+    t.tx_buffer = own && out ? tx_dma_ : out;
+    t.rx_buffer = own && in ? rx_dma_ : in;
+    if (spi_device_polling_transmit(dev_, &t) != ESP_OK) errors_++;
+    else if (own && in) memcpy(in, rx_dma_, len);
+  }
+
+  void spiEndTransaction() override {
+    if (!dma_) ArduinoHal::spiEndTransaction();
+    else if (dev_) spi_device_release_bus(dev_);
+    busy_us_ += micros() - t0_;
+  }
+
+  void spiEnd() override {
+    if (!dma_) { ArduinoHal::spiEnd(); return; }
+    if (dev_) { spi_bus_remove_device(dev_); dev_ = nullptr; }
+    if (bus_ready_) { spi_bus_free(host_); bus_ready_ = false; }
+  }
+
+  // Erros do RadioLib que indicam bytes corrompidos no SPI (versão/registrador de
+  // verificação ilegível, comando recusado): só esses justificam step_down().
+  static bool spi_fault(int state) {
+    return state == RADIOLIB_ERR_CHIP_NOT_FOUND || state == RADIOLIB_ERR_SPI_WRITE_FAILED ||
+           state == RADIOLIB_ERR_SPI_CMD_INVALID || state == RADIOLIB_ERR_SPI_CMD_FAILED;
+  }
+
+  // Reduz o clock pela metade. false se já está no mínimo. No SPIClass vale a
+  // partir da próxima transação; no DMA o device é recriado com o novo clock.
+  bool step_down() {
+    if (clock_hz_ <= kMinClockHz) return false;
+    clock_hz_ = clock_hz_ / 2 < kMinClockHz ? kMinClockHz : clock_hz_ / 2;
+    if (dev_) { spi_bus_remove_device(dev_); dev_ = nullptr; add_device(); }
+    return true;
+  }
+
+  bool     dma() const          { return dma_; }
+  uint32_t clock_hz() const     { return clock_hz_; }
+  uint32_t transactions() const { return transactions_; }
+  uint32_t bytes() const        { return bytes_; }
+  uint32_t busy_us() const      { return busy_us_; }   // tempo com o barramento reservado
+  uint32_t errors() const       { return errors_; }
+
+ private:
+  void add_device() {
+    spi_device_interface_config_t cfg = {};
+    cfg.mode           = 0;
+    cfg.clock_speed_hz = (int)clock_hz_;
+    cfg.spics_io_num   = -1;                 // NSS controlado pelo RadioLib
+    cfg.queue_size     = 1;
+    // Acima de ~10 MHz a amostragem do MISO precisa compensar o atraso dos pinos
+    cfg.input_delay_ns = clock_hz_ > 10000000 ? 20 : 0;
+    if (spi_bus_add_device(host_, &cfg, &dev_) != ESP_OK) { dev_ = nullptr; errors_++; }
+  }
+
+  SPIClass& spi_;
+  int8_t   sck_, miso_, mosi_;
+  uint32_t clock_hz_;
+  bool     dma_;
+  spi_host_device_t host_;
+  spi_device_handle_t dev_ = nullptr;
+  bool     bus_ready_ = false;
+
+  uint32_t t0_ = 0;
+  uint32_t transactions_ = 0;
+  uint32_t bytes_ = 0;
+  uint32_t busy_us_ = 0;
+  uint32_t errors_ = 0;
+
+  alignas(4) uint8_t tx_dma_[kBounceBytes] = {};
+  alignas(4) uint8_t rx_dma_[kBounceBytes] = {};
+};
+
+#endif // ESP_DMA_HAL_H
@@ -0,0 +1,181 @@
+/**
+ * @file flow_control.h
+ * @brief Fila de saída com controle de fluxo por créditos (gateway -> bridge, sem heap).
+ *
+ * - O bridge concede uma janela (créditos): no máximo `window` registros em voo,
+ *   isto é, enviados e ainda não confirmados por @ACK.
+ * - Os registros ficam na fila até o ACK cumulativo: em voo no início (seq
+ *   atribuído no envio, consecutivo), pendentes depois. rewind() volta a enviar
+ *   desde o primeiro não confirmado (go-back-N após timeout ou nova sessão).
+ * - Fila cheia (bridge parado): a política decide o que sai, sempre entre os
+ *   pendentes — registros em voo só saem por ACK.
+ *     FC_BUFFER:    descarta o pendente mais antigo;
+ *     FC_AGGREGATE: um pendente por nó (o novo substitui o anterior do mesmo nó);
+ *                   sem par do mesmo nó, descarta o mais antigo;
+ *     FC_DROP_LOW:  descarta o pendente de menor prioridade (o mais antigo entre
+ *                   iguais), se não for mais prioritário que o novo.
+ */
+
+#ifndef FLOW_CONTROL_H
+#define FLOW_CONTROL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "protocol.h"
+
+enum FcPolicy : uint8_t { FC_BUFFER = 0, FC_AGGREGATE = 1, FC_DROP_LOW = 2 };
+
+inline const char* fc_policy_name(FcPolicy p) {
+  return p == FC_AGGREGATE ? "aggregate" : p == FC_DROP_LOW ? "drop" : "buffer";
+}
+
+inline bool fc_policy_parse(const char* s, FcPolicy& out) {
+  if (strcmp(s, "buffer") == 0)    { out = FC_BUFFER;    return true; }
+  if (strcmp(s, "aggregate") == 0) { out = FC_AGGREGATE; return true; }
+  if (strcmp(s, "drop") == 0)      { out = FC_DROP_LOW;  return true; }
+  return false;
+}
+
+// Prioridade de descarte: alerta de bateria > resumo de janela > leitura > legado.
+inline uint8_t reading_priority(const SensorReading& r) {
+  if (r.battery < 15) return 3;
+  if (r.summary) return 2;
+  return r.has_seq ? 1 : 0;
+}
+
+template <size_t kSlots, size_t kBytes>
+class CreditQueue {
+ public:
+  static_assert(kSlots >= 2 && kSlots <= 255, "kSlots entre 2 e 255");
+
+  struct Entry {
+    uint32_t    seq;
+    uint32_t    enqueued_ms;
+    node_addr_t node;
+    uint8_t     prio;
+    uint8_t     tries;          // envios (> 1 = retransmitido)
+    uint16_t    len;
+    char        json[kBytes];
+  };
+
+  CreditQueue() {
+    for (size_t i = 0; i < kSlots; ++i) order_[i] = (uint8_t)i;
+  }
+
+  // false se o registro foi descartado (não cabe ou a política o recusou).
+  bool push(const char* json, size_t len, node_addr_t node, uint8_t prio, FcPolicy policy,
+            uint32_t now_ms) {
+    if (len >= kBytes) { oversize_++; return false; }
+
+    int victim = -1;
+    if (policy == FC_AGGREGATE) victim = find_pending(node);
+    if (victim >= 0) {
+      merged_++;
+    } else if (count_ == kSlots) {
+      if (inflight_ == count_) { dropped_++; return false; }   // só há registros em voo
+      victim = policy == FC_DROP_LOW ? lowest_pending() : (int)inflight_;
+      if (policy == FC_DROP_LOW && entry(victim).prio > prio) { dropped_++; return false; }
+      dropped_++;
+    }
+
+    Entry* e;
+    if (victim >= 0) {
+      // Reaproveita o slot no fim da fila: o registro novo é o mais recente
+      uint8_t slot = order_[victim];
+      for (size_t i = victim; i + 1 < count_; ++i) order_[i] = order_[i + 1];
+      order_[count_ - 1] = slot;
+      e = &slots_[slot];
+    } else {
+      e = &slots_[order_[count_++]];
+    }
+    memcpy(e->json, json, len);
+    e->json[len] = '\0';
+    e->len = (uint16_t)len;
+    e->node = node;
+    e->prio = prio;
+    e->tries = 0;
+    e->enqueued_ms = now_ms;
+    if (count_ > high_water_) high_water_ = count_;
+    return true;
+  }
+
+  // Próximo registro a enviar, se houver crédito (nullptr caso contrário).
+  const Entry* next(uint8_t window) {
+    if (inflight_ >= count_ || inflight_ >= window) return nullptr;
+    Entry& e = entry(inflight_);
+    e.seq = inflight_ == 0 ? base_seq_ : entry(inflight_ - 1).seq + 1;
+    inflight_++;
+    if (e.tries++ == 0) sent_++;
+    else retransmits_++;
+    return &e;
+  }
+
+  // ACK cumulativo: confirma todos os registros em voo com seq <= `seq`.
+  size_t ack(uint32_t seq) {
+    size_t n = 0;
+    while (n < inflight_ && (int32_t)(entry(n).seq - seq) <= 0) n++;
+    if (n == 0) return 0;
+    base_seq_ = entry(n - 1).seq + 1;
+    uint8_t freed[kSlots];
+    memcpy(freed, order_, n);
+    memmove(order_, order_ + n, count_ - n);
+    memcpy(order_ + count_ - n, freed, n);
+    count_ -= n;
+    inflight_ -= n;
+    acked_ += n;
+    return n;
+  }
+
+  // Reenvia a partir do primeiro não confirmado.
+  size_t rewind() {
+    size_t n = inflight_;
+    inflight_ = 0;
+    return n;
+  }
+
+  size_t   size() const      { return count_; }
+  size_t   inflight() const  { return inflight_; }
+  size_t   pending() const   { return count_ - inflight_; }
+  size_t   high_water() const{ return high_water_; }
+  static constexpr size_t capacity() { return kSlots; }
+  uint32_t next_seq() const  { return inflight_ ? entry(inflight_ - 1).seq + 1 : base_seq_; }
+  uint32_t sent() const      { return sent_; }
+  uint32_t acked() const     { return acked_; }
+  uint32_t retransmits() const { return retransmits_; }
+  uint32_t dropped() const   { return dropped_; }
+  uint32_t merged() const    { return merged_; }
+  uint32_t oversize() const  { return oversize_; }
+
+ private:
+  Entry& entry(size_t i) { return slots_[order_[i]]; }
+  const Entry& entry(size_t i) const { return slots_[order_[i]]; }
+
+  int find_pending(node_addr_t node) const {
+    for (size_t i = count_; i-- > inflight_;)
+      if (entry(i).node == node) return (int)i;
+    return -1;
+  }
+
+  int lowest_pending() const {
+    size_t l = inflight_;
+    for (size_t i = inflight_ + 1; i < count_; ++i)
+      if (entry(i).prio < entry(l).prio) l = i;   // estrito: o mais antigo entre iguais
+    return (int)l;
+  }
+
+  Entry    slots_[kSlots] = {};
+  uint8_t  order_[kSlots];      // índices dos slots em ordem de fila; os livres no fim
+  size_t   count_ = 0;
+  size_t   inflight_ = 0;
+  size_t   high_water_ = 0;
+  uint32_t base_seq_ = 1;       // seq do primeiro registro não confirmado
+  uint32_t sent_ = 0;
+  uint32_t acked_ = 0;
+  uint32_t retransmits_ = 0;
+  uint32_t dropped_ = 0;
+  uint32_t merged_ = 0;
+  uint32_t oversize_ = 0;
+};
+
+#endif // FLOW_CONTROL_H
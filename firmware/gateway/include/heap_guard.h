@@ -0,0 +1,123 @@
+/**
+ * @file heap_guard.h
+ * @brief Contagem de alocações por ponto de chamada após o boot (sem heap).
+ *
+ * - Alimentado pelos wrappers de malloc/calloc/realloc, heap_caps_* e new do modo
+ *   NO_HEAP_AFTER_BOOT (main.cpp, -Wl,--wrap=... no env *_noheap).
+ * - arm() no fim do setup(): só alocações da tarefa armada (a do loop())
+ *   contam; WiFi/lwIP alocam nas próprias tarefas e ficam de fora.
+ * - tick() no início de cada loop(): as primeiras `warmup` iterações são
+ *   aquecimento (inicializações preguiçosas), contadas à parte.
+ * - exempt: trechos fora do caminho de pacotes (estatísticas periódicas),
+ *   contados à parte e nunca interrompidos.
+ * - Cada alocação contada soma no ponto de chamada (endereço da instrução de
+ *   call); tools/heap_report.py resolve os endereços com addr2line.
+ * - note() devolve HEAP_TRAP quando a alocação deve interromper (modo trap).
+ */
+
+#ifndef HEAP_GUARD_H
+#define HEAP_GUARD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum HeapVerdict : uint8_t { HEAP_IGNORED = 0, HEAP_COUNTED, HEAP_TRAP };
+
+template <size_t kSites>
+class HeapGuard {
+ public:
+  static_assert(kSites >= 1, "kSites deve ser >= 1");
+
+  struct Site {
+    uintptr_t pc;
+    uint32_t  count;
+    uint32_t  bytes;
+    uint32_t  max;        // maior pedido
+  };
+
+  void arm(const void* task, uint32_t warmup_loops, bool trap) {
+    task_ = task;
+    warmup_loops_ = warmup_loops;
+    trap_ = trap;
+    armed_ = true;
+  }
+
+  void tick() { loops_++; }
+  void exempt_enter() { exempt_depth_++; }
+  void exempt_leave() { exempt_depth_--; }
+
+  // operator new chama malloc por dentro: o malloc aninhado não conta de novo.
+  // nest()/unnest() só na tarefa armada (mine()): o contador não é atômico.
+  bool mine(const void* task) const { return armed_ && task == task_; }
+  void nest()   { nested_++; }
+  void unnest() { nested_--; }
+
+  HeapVerdict note(const void* task, const void* ra, size_t n) {
+    if (!mine(task) || nested_) return HEAP_IGNORED;
+    if (loops_ <= warmup_loops_) { warmup_++; return HEAP_IGNORED; }
+    if (exempt_depth_) { exempt_++; return HEAP_IGNORED; }
+    allocs_++;
+    bytes_ += n;
+    Site* s = find(pc_of(ra));
+    if (s) {
+      s->count++;
+      s->bytes += n;
+      if (n > s->max) s->max = n;
+    } else {
+      overflow_++;
+    }
+    return trap_ ? HEAP_TRAP : HEAP_COUNTED;
+  }
+
+  // Endereço de retorno -> instrução de chamada. No Xtensa (ABI com janelas) os
+  // 2 bits altos guardam o incremento da janela e call ocupa 3 bytes.
+  static uintptr_t pc_of(const void* ra) {
+    uintptr_t pc = (uintptr_t)ra;
+#if defined(__XTENSA__)
+    if (pc & 0x80000000) pc = (pc & 0x3fffffff) | 0x40000000;
+    return pc - 3;
+#else
+    return pc ? pc - 1 : 0;
+#endif
+  }
+
+  bool     armed() const    { return armed_; }
+  bool     trap() const     { return trap_; }
+  uint32_t loops() const    { return loops_; }
+  uint32_t allocs() const   { return allocs_; }
+  uint32_t bytes() const    { return bytes_; }
+  uint32_t warmup() const   { return warmup_; }
+  uint32_t exempt() const   { return exempt_; }
+  uint32_t overflow() const { return overflow_; }   // pontos além de kSites (estão em allocs)
+  size_t   sites() const    { return used_; }
+  const Site& site(size_t i) const { return sites_[i]; }
+  static constexpr size_t capacity() { return kSites; }
+
+ private:
+  Site* find(uintptr_t pc) {
+    for (size_t i = 0; i < used_; i++)
+      if (sites_[i].pc == pc) return &sites_[i];
+    if (used_ == kSites) return nullptr;
+    Site* s = &sites_[used_++];
+    s->pc = pc;
+    return s;
+  }
+
+  volatile bool armed_ = false;
+  bool        trap_ = false;
+  const void* task_ = nullptr;
+  uint32_t    warmup_loops_ = 0;
+  uint32_t    loops_ = 0;
+  uint8_t     exempt_depth_ = 0;
+  uint8_t     nested_ = 0;
+
+  uint32_t allocs_ = 0;
+  uint32_t bytes_ = 0;
+  uint32_t warmup_ = 0;
+  uint32_t exempt_ = 0;
+  uint32_t overflow_ = 0;
+  size_t   used_ = 0;
+  Site     sites_[kSites] = {};
+};
+
+#endif // HEAP_GUARD_H
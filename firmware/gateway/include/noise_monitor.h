@@ -0,0 +1,89 @@
+/**
+ * @file noise_monitor.h
+ * @brief Histograma do piso de ruído e estimativa de ocupação do canal (sem heap).
+ *
+ * - Amostras de RSSI instantâneo (dBm) tomadas com o rádio ocioso em RX, em
+ *   bins de 1 dB entre kMinDbm e kMinDbm + kBins - 1 (valores fora são saturados).
+ * - Piso de ruído = percentil baixo da janela (p10 por padrão): ignora rajadas.
+ * - Ocupação = fração das amostras acima de piso + margem. Inclui o tráfego da
+ *   própria rede; o tempo de ar dos pacotes recebidos é somado à parte
+ *   (add_airtime) para separar ocupação própria de interferência externa.
+ * - LoRa demodula abaixo do ruído: sinais fracos não aparecem na ocupação.
+ */
+
+#ifndef NOISE_MONITOR_H
+#define NOISE_MONITOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+template <size_t kBins = 100, int kMinDbm = -140>
+class NoiseMonitor {
+ public:
+  static_assert(kBins >= 2, "histograma precisa de pelo menos 2 bins");
+
+  void add(float dbm) {
+    int bin = (int)(dbm >= 0 ? dbm + 0.5f : dbm - 0.5f) - kMinDbm;
+    if (bin < 0) bin = 0;
+    if (bin >= (int)kBins) bin = kBins - 1;
+    counts_[bin]++;
+    samples_++;
+  }
+
+  // Tempo de ar de um pacote recebido nesta janela (microssegundos).
+  void add_airtime(uint32_t us) { airtime_us_ += us; }
+
+  // Percentil p (0..100) da janela, em dBm (kMinDbm - 1 se não houver amostras).
+  int percentile(float p) const {
+    if (samples_ == 0) return kMinDbm - 1;
+    uint32_t target = (uint32_t)(p / 100.0f * samples_);
+    if (target == 0) target = 1;
+    uint32_t seen = 0;
+    for (size_t i = 0; i < kBins; ++i) {
+      seen += counts_[i];
+      if (seen >= target) return kMinDbm + (int)i;
+    }
+    return kMinDbm + (int)kBins - 1;
+  }
+
+  // Fração (0..1) das amostras acima de floor_dbm + margin_db.
+  float occupancy(int floor_dbm, int margin_db) const {
+    if (samples_ == 0) return 0.0f;
+    int first = floor_dbm + margin_db + 1 - kMinDbm;
+    if (first < 0) first = 0;
+    uint32_t busy = 0;
+    for (size_t i = (size_t)first; i < kBins; ++i) busy += counts_[i];
+    return (float)busy / samples_;
+  }
+
+  // Fração (0..1) de window_ms ocupada por pacotes recebidos.
+  float own_airtime(uint32_t window_ms) const {
+    if (window_ms == 0) return 0.0f;
+    float f = (float)airtime_us_ / (window_ms * 1000.0f);
+    return f > 1.0f ? 1.0f : f;
+  }
+
+  int max_dbm() const {
+    for (size_t i = kBins; i-- > 0;)
+      if (counts_[i]) return kMinDbm + (int)i;
+    return kMinDbm - 1;
+  }
+
+  void reset() {
+    for (size_t i = 0; i < kBins; ++i) counts_[i] = 0;
+    samples_ = 0;
+    airtime_us_ = 0;
+  }
+
+  uint32_t count(size_t bin) const { return counts_[bin]; }
+  uint32_t samples() const { return samples_; }
+  static constexpr size_t bins() { return kBins; }
+  static constexpr int    min_dbm() { return kMinDbm; }
+
+ private:
+  uint32_t counts_[kBins] = {};
+  uint32_t samples_ = 0;
+  uint64_t airtime_us_ = 0;
+};
+
+#endif // NOISE_MONITOR_H
@@ -0,0 +1,90 @@
+/**
+ * @file output_queue.h
+ * @brief Fila circular de registros JSON prontos para saída (sem heap).
+ *
+ * - Slots de tamanho fixo; push() nunca bloqueia o caminho de RX.
+ * - Cheia: descarta o registro mais antigo e contabiliza em dropped().
+ * - O consumidor lê com peek(i) e confirma com pop(n) só após publicar.
+ * - Consumidor em outra tarefa: copia com head_seq() anotado e confirma com
+ *   pop_through(seq); descartes feitos pelo push() nesse meio não são contados
+ *   duas vezes. A sincronização fica com quem chama.
+ */
+
+#ifndef OUTPUT_QUEUE_H
+#define OUTPUT_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "protocol.h"
+
+template <size_t kBytes>
+struct OutputSlot {
+  uint32_t    enqueued_ms;
+  node_addr_t node;
+  uint16_t    len;
+  char        json[kBytes];
+};
+
+template <size_t kSlots, size_t kBytes>
+class OutputQueue {
+ public:
+  static_assert(kSlots >= 1, "fila precisa de pelo menos 1 slot");
+  using Slot = OutputSlot<kBytes>;
+
+  // Copia o registro para a fila. Retorna false se não cabe no slot.
+  bool push(const char* json, size_t len, node_addr_t node, uint32_t now_ms) {
+    if (len >= kBytes) { oversize_++; return false; }
+    if (count_ == kSlots) {           // descarta o mais antigo
+      head_ = (head_ + 1) % kSlots;
+      count_--;
+      head_seq_++;
+      dropped_++;
+    }
+    Slot& s = slots_[(head_ + count_) % kSlots];
+    memcpy(s.json, json, len);
+    s.json[len] = '\0';
+    s.len = (uint16_t)len;
+    s.node = node;
+    s.enqueued_ms = now_ms;
+    count_++;
+    if (count_ > high_water_) high_water_ = count_;
+    return true;
+  }
+
+  const Slot& peek(size_t i = 0) const { return slots_[(head_ + i) % kSlots]; }
+
+  void pop(size_t n = 1) {
+    if (n > count_) n = count_;
+    head_ = (head_ + n) % kSlots;
+    count_ -= n;
+    head_seq_ += n;
+  }
+
+  // Sequência do registro na frente (total já removido: pop + descartes).
+  uint32_t head_seq() const { return head_seq_; }
+
+  // Remove até a sequência seq (exclusiva); o que já saiu por descarte é ignorado.
+  void pop_through(uint32_t seq) {
+    int32_t n = (int32_t)(seq - head_seq_);
+    if (n > 0) pop((size_t)n);
+  }
+
+  size_t   size() const { return count_; }
+  bool     empty() const { return count_ == 0; }
+  static constexpr size_t capacity() { return kSlots; }
+  uint32_t dropped() const { return dropped_; }
+  uint32_t oversize() const { return oversize_; }
+  size_t   high_water() const { return high_water_; }
+
+ private:
+  Slot     slots_[kSlots] = {};
+  size_t   head_ = 0;
+  size_t   count_ = 0;
+  size_t   high_water_ = 0;
+  uint32_t head_seq_ = 0;
+  uint32_t dropped_ = 0;
+  uint32_t oversize_ = 0;
+};
+
+#endif // OUTPUT_QUEUE_H
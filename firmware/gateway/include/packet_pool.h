@@ -0,0 +1,87 @@
+/**
+ * @file packet_pool.h
+ * @brief Pool fixo de descritores de pacote (payload + metadados de RX), sem heap.
+ *
+ * - O RX pega um descritor livre (acquire), lê o pacote direto em data[] com o
+ *   tamanho exato e o publica na fila de prontos (commit) — só o índice anda.
+ * - Decodificação e saída trabalham sobre o mesmo descritor (next) e o devolvem
+ *   ao pool (release) ao terminar. Nada é zerado nem copiado entre estágios.
+ * - Pool vazio: acquire() devolve kNone e contabiliza em exhausted().
+ * - Com RX e decodificação no mesmo loop() basta um descritor; kSlots > 1 só
+ *   tem efeito com um consumidor em outra tarefa.
+ */
+
+#ifndef PACKET_POOL_H
+#define PACKET_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+template <size_t kBytes>
+struct PacketDesc {
+  uint32_t rx_ms;
+  float    rssi;
+  float    snr;
+  uint16_t len;
+  uint8_t  data[kBytes];
+};
+
+template <size_t kSlots, size_t kBytes>
+class PacketPool {
+ public:
+  static_assert(kSlots >= 1 && kSlots < 255, "pool precisa de 1..254 descritores");
+  using Desc = PacketDesc<kBytes>;
+  static constexpr uint8_t kNone = 0xFF;
+
+  PacketPool() {
+    for (size_t i = 0; i < kSlots; ++i) free_[i] = (uint8_t)(kSlots - 1 - i);
+    nfree_ = kSlots;
+  }
+
+  // Reserva um descritor livre (kNone se o pool estiver esgotado).
+  uint8_t acquire() {
+    if (nfree_ == 0) { exhausted_++; return kNone; }
+    uint8_t idx = free_[--nfree_];
+    size_t used = kSlots - nfree_;
+    if (used > high_water_) high_water_ = used;
+    return idx;
+  }
+
+  // Entrega o descritor preenchido ao próximo estágio (ordem de chegada).
+  void commit(uint8_t idx) {
+    ready_[(head_ + count_) % kSlots] = idx;
+    count_++;
+  }
+
+  // Próximo descritor pronto para decodificar (kNone se não houver).
+  uint8_t next() {
+    if (count_ == 0) return kNone;
+    uint8_t idx = ready_[head_];
+    head_ = (head_ + 1) % kSlots;
+    count_--;
+    return idx;
+  }
+
+  void release(uint8_t idx) { free_[nfree_++] = idx; }
+
+  Desc&       at(uint8_t idx)       { return slots_[idx]; }
+  const Desc& at(uint8_t idx) const { return slots_[idx]; }
+
+  size_t   pending() const { return count_; }
+  size_t   in_use() const { return kSlots - nfree_; }
+  static constexpr size_t capacity() { return kSlots; }
+  size_t   high_water() const { return high_water_; }
+  uint32_t exhausted() const { return exhausted_; }
+
+ private:
+  Desc     slots_[kSlots];
+  uint8_t  free_[kSlots];
+  uint8_t  ready_[kSlots];
+  size_t   nfree_ = 0;
+  size_t   head_ = 0;
+  size_t   count_ = 0;
+  size_t   high_water_ = 0;
+  uint32_t exhausted_ = 0;
+};
+
+#endif // PACKET_POOL_H
@@ -2,19 +2,40 @@
  * @file protocol.h
  * @brief Protocolo binário compacto compartilhado (client <-> gateway).
  *
- * Layout (LITTLE-ENDIAN no ESP32)
+ * Layout v2 — MSG_TYPE_SENSOR_DATA_V2 (LITTLE-ENDIAN no ESP32)
  *  Offset  Size  Field
- *  0       1     msg_type
- *  1       1     client_id
- *  2       4     timestamp (millis)
- *  6       2     temperature (°C x100)
- *  8       2     humidity (% x100)
- *  10      2     distance_cm (uint16)
- *  12      1     battery (%)
- *  13      2     reserved
+ *  0       1     msg_type (0x04)
+ *  1       2     node_addr (16 bits)
+ *  3       4     timestamp (millis)
+ *  7       2     temperature (°C x100)
+ *  9       2     humidity (% x100)
+ *  11      2     distance_cm (uint16)
+ *  13      1     battery (%)
+ *  14      1     seq (mod 256)
  *  15      1     checksum (XOR de bytes [0..14])  ← ÚLTIMO BYTE
  *
- * Total = 16 bytes
+ * Total = 16 bytes (node_addr/seq reaproveitam o antigo "reserved").
+ *
+ * Layout legado — MSG_TYPE_SENSOR_DATA (client_id de 8 bits)
+ *  0 msg_type | 1 client_id | 2 timestamp | 6 temperature | 8 humidity |
+ *  10 distance_cm | 12 battery | 13..15 checksum/reserved
+ *  Firmwares antigos gravam o checksum no byte 13 e zeram o restante, então
+ *  o quadro legado é válido quando o XOR dos 16 bytes é zero.
+ *
+ * Lote de repetidor — MSG_TYPE_RELAY_BATCH
+ *  0 msg_type (0x05) | 1 sender (16 bits) | 3 count | 4 RelayRecord[count] (17 B cada)
+ *  | último byte: checksum (XOR de todos os anteriores)
+ *  Registros com origin == sender e hops == 0 são a fila em flash do próprio nó
+ *  (leituras não entregues, reenviadas depois; age_s = tempo guardado).
+ *
+ * Resumo de janela — MSG_TYPE_SENSOR_SUMMARY (28 bytes)
+ *  0 msg_type (0x06) | 1 node_addr | 3 timestamp | 7 battery | 8 seq | 9 samples (u16)
+ *  | 11 humidity min/max/mean/stddev (% x100) | 19 distance min/max/mean/stddev (cm x10)
+ *  | 27 checksum (XOR de [0..26])
+ *
+ * Downlink — MSG_TYPE_DOWNLINK (gateway → nó)
+ *  0 msg_type (0x07) | 1 node_addr (destino) | 3 seq (por nó) | 4 cmd | 5 len
+ *  | 6 payload[len] | último byte: checksum (XOR de todos os anteriores)
  */
 
 #ifndef PROTOCOL_H
@@ -26,20 +47,24 @@
 // =====================================================
 // Tipos de mensagem
 // =====================================================
-#define MSG_TYPE_SENSOR_DATA 0x01
-#define MSG_TYPE_HEARTBEAT   0x02
-#define MSG_TYPE_ALERT       0x03
-#define MSG_TYPE_ACK         0xAA
+#define MSG_TYPE_SENSOR_DATA    0x01   // legado (8 bits)
+#define MSG_TYPE_HEARTBEAT      0x02
+#define MSG_TYPE_ALERT          0x03
+#define MSG_TYPE_SENSOR_DATA_V2 0x04   // atual (16 bits)
+#define MSG_TYPE_RELAY_BATCH    0x05   // lote encaminhado por repetidor
+#define MSG_TYPE_SENSOR_SUMMARY 0x06   // estatísticas da janela entre TX
+#define MSG_TYPE_DOWNLINK       0x07   // comando gateway -> nó (janela pós-uplink)
+#define MSG_TYPE_ACK            0xAA
+
+typedef uint16_t node_addr_t;   // endereço de nó (0..65534)
+#define NODE_ADDR_NONE 0xFFFF          // reservado: nenhum nó / broadcast
 
 // =====================================================
 // Estruturas
 // =====================================================
 
 /**
- * @brief Pacote de dados de sensores (16 bytes).
- *
- * Checksum é XOR de todos os bytes exceto o próprio checksum
- * (ou seja, XOR de bytes [0..14]).
+ * @brief Pacote de dados de sensores, layout legado (16 bytes).
  */
 struct __attribute__((packed)) SensorDataMessage {
     uint8_t  msg_type;
@@ -53,6 +78,108 @@ struct __attribute__((packed)) SensorDataMessage {
     uint8_t  checksum;      // ÚLTIMO BYTE
 };
 
+/**
+ * @brief Pacote de dados de sensores v2 (16 bytes).
+ *
+ * Checksum é XOR de todos os bytes exceto o próprio checksum
+ * (ou seja, XOR de bytes [0..14]).
+ */
+struct __attribute__((packed)) SensorDataMessageV2 {
+    uint8_t     msg_type;
+    node_addr_t node_addr;
+    uint32_t    timestamp;     // millis()
+    int16_t     temperature;   // °C ×100
+    uint16_t    humidity;      // % ×100
+    uint16_t    distance_cm;   // cm
+    uint8_t     battery;       // 0..100
+    uint8_t     seq;           // contador de quadros
+    uint8_t     checksum;      // ÚLTIMO BYTE
+};
+
+/**
+ * @brief Cabeçalho de lote de repetidor (4 bytes).
+ */
+struct __attribute__((packed)) RelayBatchHeader {
+    uint8_t     msg_type;
+    node_addr_t sender;        // repetidor que transmitiu
+    uint8_t     count;
+};
+
+/**
+ * @brief Leitura encaminhada por repetidor (17 bytes).
+ */
+struct __attribute__((packed)) RelayRecord {
+    node_addr_t origin;        // nó de origem
+    uint8_t     seq;           // seq original (dedupe)
+    uint8_t     hops;          // saltos percorridos (>= 1)
+    uint32_t    timestamp;     // millis() da origem
+    int16_t     temperature;
+    uint16_t    humidity;
+    uint16_t    distance_cm;
+    uint8_t     battery;
+    uint16_t    age_s;         // tempo retido em repetidores
+};
+
+#define RELAY_MAX_RECORDS 14
+
+constexpr size_t relay_batch_size(size_t n) {
+    return sizeof(RelayBatchHeader) + n * sizeof(RelayRecord) + 1;
+}
+
+/**
+ * @brief Estatísticas de um canal na janela (ponto fixo, saturado em uint16).
+ */
+struct __attribute__((packed)) ChannelSummary {
+    uint16_t min;
+    uint16_t max;
+    uint16_t mean;
+    uint16_t stddev;        // amostral (n - 1)
+};
+
+/**
+ * @brief Resumo das amostras entre duas transmissões (28 bytes).
+ */
+struct __attribute__((packed)) SensorSummaryMessage {
+    uint8_t        msg_type;
+    node_addr_t    node_addr;
+    uint32_t       timestamp;   // millis() no fim da janela
+    uint8_t        battery;
+    uint8_t        seq;         // mesmo contador do v2
+    uint16_t       samples;     // amostras por canal
+    ChannelSummary humidity;    // % ×100
+    ChannelSummary distance;    // cm ×10
+    uint8_t        checksum;    // ÚLTIMO BYTE
+};
+
+/**
+ * @brief Cabeçalho de downlink (6 bytes) + payload[len] + checksum.
+ */
+struct __attribute__((packed)) DownlinkHeader {
+    uint8_t     msg_type;
+    node_addr_t node_addr;     // destino
+    uint8_t     seq;           // contador do gateway por nó
+    uint8_t     cmd;           // DL_CMD_*
+    uint8_t     len;           // bytes de payload
+};
+
+#define DL_MAX_PAYLOAD 8
+
+#define DL_CMD_SET_INTERVAL 0x01   // uint32 ms
+#define DL_CMD_TIME_SYNC    0x02   // uint32 época (s) + uint16 ms
+#define DL_CMD_TX_POWER     0x03   // int8 dBm (dica de ADR)
+#define DL_CMD_ACK          0x04   // uint8 checksum do uplink confirmado (fila em flash do nó)
+
+constexpr size_t downlink_size(size_t n) {
+    return sizeof(DownlinkHeader) + n + 1;
+}
+
+static_assert(sizeof(SensorDataMessage) == 16, "layout legado deve ter 16 bytes");
+static_assert(sizeof(RelayRecord) == 17, "RelayRecord deve ter 17 bytes");
+static_assert(relay_batch_size(RELAY_MAX_RECORDS) <= 255, "lote não cabe em um pacote");
+static_assert(sizeof(SensorDataMessageV2) == 16, "layout v2 deve ter 16 bytes");
+static_assert(sizeof(SensorSummaryMessage) == 28, "resumo deve ter 28 bytes");
+static_assert(sizeof(DownlinkHeader) == 6, "cabeçalho de downlink deve ter 6 bytes");
+
 /**
  * @brief Heartbeat (8 bytes).
  */
@@ -99,4 +226,133 @@ inline float    decode_temperature(int16_t t){ return t / 100.0f; }
 inline uint16_t encode_humidity(float h)    { return (uint16_t)(h * 100); }
 inline float    decode_humidity(uint16_t h) { return h / 100.0f; }
 
+// =====================================================
+// Decodificação (v2 + resumo + legado)
+// =====================================================
+
+enum DecodeStatus : uint8_t {
+    DECODE_OK = 0,
+    DECODE_BAD_LENGTH,
+    DECODE_BAD_CHECKSUM,
+    DECODE_UNKNOWN_TYPE
+};
+
+// Leitura normalizada, independente da versão do quadro.
+struct SensorReading {
+    node_addr_t node_addr;
+    uint32_t    timestamp;
+    int16_t     temperature;
+    uint16_t    humidity;
+    uint16_t    distance_cm;
+    uint8_t     battery;
+    uint8_t     seq;
+    bool        has_seq;       // false para quadros legados
+    uint8_t     hops;          // 0 = direto da origem
+    uint16_t    age_s;         // tempo retido em repetidores
+    const SensorSummaryMessage* summary;   // só resumos (aponta para o quadro recebido)
+};
+
+inline void relay_record_to_reading(const RelayRecord& rec, SensorReading& out) {
+    out.node_addr   = rec.origin;
+    out.timestamp   = rec.timestamp;
+    out.temperature = rec.temperature;
+    out.humidity    = rec.humidity;
+    out.distance_cm = rec.distance_cm;
+    out.battery     = rec.battery;
+    out.seq         = rec.seq;
+    out.has_seq     = true;
+    out.hops        = rec.hops;
+    out.age_s       = rec.age_s;
+    out.summary     = nullptr;
+}
+
+inline DecodeStatus decode_relay_batch(const uint8_t* data, size_t length,
+                                       const RelayBatchHeader*& header,
+                                       const RelayRecord*& records) {
+    if (length < relay_batch_size(1) || data[0] != MSG_TYPE_RELAY_BATCH) return DECODE_BAD_LENGTH;
+    header = reinterpret_cast<const RelayBatchHeader*>(data);
+    if (header->count == 0 || header->count > RELAY_MAX_RECORDS ||
+        length != relay_batch_size(header->count)) return DECODE_BAD_LENGTH;
+    if (!verify_checksum(data, length)) return DECODE_BAD_CHECKSUM;
+    records = reinterpret_cast<const RelayRecord*>(data + sizeof(RelayBatchHeader));
+    return DECODE_OK;
+}
+
+inline DecodeStatus decode_sensor_frame(const uint8_t* data, size_t length, SensorReading& out) {
+    if (length < 1) return DECODE_BAD_LENGTH;
+
+    if (data[0] == MSG_TYPE_SENSOR_DATA_V2) {
+        if (length != sizeof(SensorDataMessageV2)) return DECODE_BAD_LENGTH;
+        if (!verify_checksum(data, length)) return DECODE_BAD_CHECKSUM;
+        const SensorDataMessageV2* m = reinterpret_cast<const SensorDataMessageV2*>(data);
+        out.node_addr   = m->node_addr;
+        out.timestamp   = m->timestamp;
+        out.temperature = m->temperature;
+        out.humidity    = m->humidity;
+        out.distance_cm = m->distance_cm;
+        out.battery     = m->battery;
+        out.seq         = m->seq;
+        out.has_seq     = true;
+        out.hops        = 0;
+        out.age_s       = 0;
+        out.summary     = nullptr;
+        return DECODE_OK;
+    }
+
+    if (data[0] == MSG_TYPE_SENSOR_SUMMARY) {
+        if (length != sizeof(SensorSummaryMessage)) return DECODE_BAD_LENGTH;
+        if (!verify_checksum(data, length)) return DECODE_BAD_CHECKSUM;
+        const SensorSummaryMessage* m = reinterpret_cast<const SensorSummaryMessage*>(data);
+        out.node_addr   = m->node_addr;
+        out.timestamp   = m->timestamp;
+        out.temperature = 0;
+        out.humidity    = m->humidity.mean;
+        out.distance_cm = (uint16_t)((m->distance.mean + 5) / 10);
+        out.battery     = m->battery;
+        out.seq         = m->seq;
+        out.has_seq     = true;
+        out.hops        = 0;
+        out.age_s       = 0;
+        out.summary     = m;
+        return DECODE_OK;
+    }
+
+    if (data[0] == MSG_TYPE_SENSOR_DATA) {
+        if (length != sizeof(SensorDataMessage)) return DECODE_BAD_LENGTH;
+        uint8_t x = 0;
+        for (size_t i = 0; i < length; ++i) x ^= data[i];
+        if (x != 0) return DECODE_BAD_CHECKSUM;
+        const SensorDataMessage* m = reinterpret_cast<const SensorDataMessage*>(data);
+        out.node_addr   = m->client_id;
+        out.timestamp   = m->timestamp;
+        out.temperature = m->temperature;
+        out.humidity    = m->humidity;
+        out.distance_cm = m->distance_cm;
+        out.battery     = m->battery;
+        out.seq         = 0;
+        out.has_seq     = false;
+        out.hops        = 0;
+        out.age_s       = 0;
+        out.summary     = nullptr;
+        return DECODE_OK;
+    }
+
+    return DECODE_UNKNOWN_TYPE;
+}
+
+// Monta um downlink em out (>= downlink_size(len) bytes); devolve o tamanho.
+inline size_t encode_downlink(node_addr_t node, uint8_t seq, uint8_t cmd,
+                              const uint8_t* payload, uint8_t len, uint8_t* out) {
+    DownlinkHeader* h = reinterpret_cast<DownlinkHeader*>(out);
+    h->msg_type  = MSG_TYPE_DOWNLINK;
+    h->node_addr = node;
+    h->seq       = seq;
+    h->cmd       = cmd;
+    h->len       = len;
+    for (uint8_t i = 0; i < len; ++i) out[sizeof(DownlinkHeader) + i] = payload[i];
+    size_t n = downlink_size(len);
+    out[n - 1] = calculate_checksum(out, n);
+    return n;
+}
+
 #endif // PROTOCOL_H
@@ -0,0 +1,121 @@
+/**
+ * @file radio_health.h
+ * @brief Monitor de saúde do rádio do gateway (lógica pura, sem RadioLib).
+ *
+ * - Estado UP/DOWN; o main.cpp informa inicializações, pacotes, erros e sondas.
+ * - Erros consecutivos (SPI, readData, startReceive, sonda) >= limite => DOWN.
+ * - Silêncio: nenhuma IRQ de RX por RADIO_SILENCE_MS => o main sonda o chip e
+ *   reinicia o RX; repete a cada período enquanto durar (contado em silences()).
+ * - DOWN: reinicialização com backoff exponencial (min..max), sem reiniciar o MCU.
+ * - Métricas: quedas, tempo fora do ar acumulado, maior queda, tentativas falhas.
+ */
+
+#ifndef RADIO_HEALTH_H
+#define RADIO_HEALTH_H
+
+#include <stdint.h>
+
+class RadioHealth {
+ public:
+  RadioHealth(uint32_t silence_ms, uint8_t err_max, uint32_t backoff_min_ms, uint32_t backoff_max_ms)
+      : silence_ms_(silence_ms), err_max_(err_max),
+        backoff_min_(backoff_min_ms), backoff_max_(backoff_max_ms), backoff_(backoff_min_ms) {}
+
+  // Rádio configurado e em RX (boot ou recuperação). Fecha a queda em aberto.
+  void up(uint32_t now_ms) {
+    if (!up_ && down_since_ms_ != 0) {
+      uint32_t lost = now_ms - down_since_ms_;
+      downtime_ms_ += lost;
+      if (lost > longest_ms_) longest_ms_ = lost;
+      recoveries_++;
+    }
+    up_ = true;
+    errors_ = 0;
+    backoff_ = backoff_min_;
+    last_rx_ms_ = now_ms;
+    last_check_ms_ = now_ms;
+  }
+
+  // Derruba o rádio; a primeira tentativa de reinício sai após o backoff mínimo.
+  void down(int16_t code, uint32_t now_ms) {
+    last_error_ = code;
+    if (up_ || down_since_ms_ == 0) {
+      outages_++;
+      down_since_ms_ = now_ms ? now_ms : 1;   // 0 = "nunca caiu"
+    }
+    up_ = false;
+    backoff_ = backoff_min_;
+    next_try_ms_ = now_ms + backoff_;
+  }
+
+  // Tentativa de reinício falhou: dobra a espera até o teto.
+  void retry_failed(int16_t code, uint32_t now_ms) {
+    last_error_ = code;
+    failed_inits_++;
+    backoff_ = backoff_ > backoff_max_ / 2 ? backoff_max_ : backoff_ * 2;
+    next_try_ms_ = now_ms + backoff_;
+  }
+
+  bool retry_due(uint32_t now_ms) const {
+    return !up_ && (int32_t)(now_ms - next_try_ms_) >= 0;
+  }
+
+  // Houve IRQ de RX (pacote bom ou com CRC ruim): o rádio está vivo.
+  void rx_activity(uint32_t now_ms) { last_rx_ms_ = now_ms; last_check_ms_ = now_ms; errors_ = 0; }
+
+  // Operação bem sucedida fora do RX (ex.: sonda): zera a sequência de erros.
+  void ok() { errors_ = 0; }
+
+  // Erro de operação no rádio. Retorna true quando o limite de erros seguidos estoura.
+  bool fault(int16_t code) {
+    last_error_ = code;
+    faults_++;
+    if (errors_ < 255) errors_++;
+    return errors_ >= err_max_;
+  }
+
+  // Sem IRQ de RX há RADIO_SILENCE_MS (verificado uma vez por período).
+  bool silent(uint32_t now_ms) const {
+    return up_ && silence_ms_ > 0 && now_ms - last_check_ms_ >= silence_ms_;
+  }
+
+  void silence_handled(uint32_t now_ms) { silences_++; last_check_ms_ = now_ms; }
+
+  bool     is_up() const             { return up_; }
+  uint32_t outages() const           { return outages_; }
+  uint32_t recoveries() const        { return recoveries_; }
+  uint32_t failed_inits() const      { return failed_inits_; }
+  uint32_t faults() const            { return faults_; }
+  uint32_t silences() const          { return silences_; }
+  uint32_t longest_ms() const        { return longest_ms_; }
+  uint32_t backoff_ms() const        { return backoff_; }
+  int16_t  last_error() const        { return last_error_; }
+  uint32_t since_rx_ms(uint32_t now_ms) const { return now_ms - last_rx_ms_; }
+  uint32_t current_outage_ms(uint32_t now_ms) const { return up_ ? 0 : now_ms - down_since_ms_; }
+  uint32_t downtime_ms(uint32_t now_ms) const { return downtime_ms_ + current_outage_ms(now_ms); }
+
+ private:
+  uint32_t silence_ms_;
+  uint8_t  err_max_;
+  uint32_t backoff_min_;
+  uint32_t backoff_max_;
+  uint32_t backoff_;
+
+  bool     up_            = false;
+  uint8_t  errors_        = 0;     // erros seguidos
+  int16_t  last_error_    = 0;
+  uint32_t last_rx_ms_    = 0;
+  uint32_t last_check_ms_ = 0;
+  uint32_t next_try_ms_   = 0;
+  uint32_t down_since_ms_ = 0;
+
+  uint32_t outages_      = 0;
+  uint32_t recoveries_   = 0;
+  uint32_t failed_inits_ = 0;
+  uint32_t faults_       = 0;
+  uint32_t silences_     = 0;
+  uint32_t downtime_ms_  = 0;
+  uint32_t longest_ms_   = 0;
+};
+
+#endif // RADIO_HEALTH_H
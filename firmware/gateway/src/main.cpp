@@ -4,29 +4,68 @@
  *
  * @details
  * - Recebe pacotes binários LoRa de múltiplos nós sensores (clients)
+ * - Aceita lotes de repetidores (MSG_TYPE_RELAY_BATCH) e descarta duplicatas
  * - Valida e converte para JSON
  * - Envia pela porta serial (para o script Python lora_serial_bridge.py)
- * - Opcionalmente envia por HTTP direto (desativado por padrão)
+ * - Negocia a taxa da serial com o bridge (linhas de controle iniciadas por '@')
+ * - Controle de fluxo por créditos com o bridge (@FC/@ACK/@CREDIT): registros
+ *   retidos até a confirmação e política de descarte quando o bridge para
+ * - Opcionalmente envia por HTTP direto ou publica em MQTT (desativados por padrão)
  * - Modo debug detalhado exibe bytes, checksum, RSSI e SNR
+ * - Pool de descritores de pacote: RX → decodificação → saída sem cópias
+ * - RX por interrupção (DIO1) com monitor de saúde: sonda SPI, detecção de
+ *   silêncio e reinicialização do SX1262 com backoff, sem reiniciar o MCU
+ * - Piso de ruído e ocupação do canal a partir de RSSI amostrado entre pacotes
+ * - SPI do SX1262 opcionalmente pelo SPI master do ESP-IDF com DMA (LORA_SPI_DMA, esp_dma_hal.h)
+ * - Downlink: fila fixa de comandos por nó (@DL do bridge), transmitidos na
+ *   janela curta que o nó abre após cada uplink; DL_ACK_UPLINKS confirma os
+ *   demais uplinks (fila em flash dos nós)
+ * - Modo de baixo consumo opcional (LOW_POWER_RX): RX duty cycle no SX1262 e
+ *   light sleep do ESP32 até o DIO1, com estimativa de consumo nas estatísticas
+ * - Modo sem heap após o boot (NO_HEAP_AFTER_BOOT, env *_noheap): conta (ou
+ *   interrompe) alocações feitas pelo loop() e relata os pontos de chamada
  */
 
 #include "config.h"
 #include "protocol.h"
+#include "client_table.h"
+#include "radio_health.h"
+#include "packet_pool.h"
+#include "noise_monitor.h"
+#include "esp_dma_hal.h"
+#include "downlink_queue.h"
+#include "flow_control.h"
+#if NO_HEAP_AFTER_BOOT
+  #include "heap_guard.h"
+#endif
 
 #include <Arduino.h>
 #include <RadioLib.h>
+#if LOW_POWER_RX
+  #include <esp_sleep.h>
+  #include <driver/gpio.h>
+  #include <driver/uart.h>
+#endif
 #if ENABLE_WIFI
   #include <WiFi.h>
 #endif
 #if USE_HTTP
   #include <HTTPClient.h>
 #endif
+#if USE_MQTT
+  #include <MQTT.h>
+  #include "output_queue.h"
+#endif
 
 // =====================================================
 // Instâncias globais e estado
 // =====================================================
 
+EspDmaHal radio_hal(SPI, LinkCfg::kSck, LinkCfg::kMiso, LinkCfg::kMosi,
+                    LinkCfg::kSpiClockHz, LinkCfg::kSpiDma);
+
 SX1262 radio = new Module(
+    &radio_hal,
     LinkCfg::kNss,
     LinkCfg::kDio1,
     LinkCfg::kRst,
@@ -36,21 +75,242 @@ SX1262 radio = new Module(
 uint32_t packets_ok       = 0;
 uint32_t packets_invalid  = 0;
 uint32_t packets_checksum = 0;
+uint32_t packets_unknown  = 0;
+uint32_t packets_legacy   = 0;
+uint32_t relay_batches    = 0;
+uint32_t readings_dup     = 0;
+uint32_t packets_crc      = 0;
+uint32_t rx_readouts      = 0;   // leituras pós-RX medidas (tamanho + FIFO + RSSI/SNR)
+uint32_t rx_readout_us    = 0;   // tempo de parede acumulado
+uint32_t rx_readout_spi   = 0;   // tempo acumulado com o SPI reservado
+uint32_t rx_readout_xfers = 0;   // transações SPI acumuladas
 uint32_t last_stat_time   = 0;
 
-bool lora_ready = false;
+ClientTable<GwCfg::kMaxClients> clients;
+
+using RxPool   = PacketPool<GwCfg::kPoolSlots, GwCfg::kMaxPkt>;
+using RxPacket = RxPool::Desc;
+RxPool rx_pool;
+
+#if USE_MQTT
+WiFiClient mqtt_net;
+MQTTClient mqtt(MqttCfg::kBufferSize);
+OutputQueue<MqttCfg::kQueueSlots, IoCfg::kJsonMax> mqtt_queue;
+
+uint32_t mqtt_published  = 0;   // registros confirmados pelo broker (QoS1) ou enviados (QoS0)
+uint32_t mqtt_batches    = 0;   // publicações de lote
+uint32_t mqtt_failures   = 0;   // publicações que falharam (registro continua na fila)
+uint32_t mqtt_reconnects = 0;
+uint32_t mqtt_last_try   = 0;
+
+// Fila compartilhada: send_json() (loop, core 1) produz, mqtt_task (core 0) consome.
+// Mutex e não seção crítica: copiar um lote inteiro não pode desligar interrupções
+StaticSemaphore_t mqtt_lock_buf;
+SemaphoreHandle_t mqtt_lock = nullptr;
+TaskHandle_t  mqtt_task_handle = nullptr;
+volatile bool mqtt_up = false;
+#endif
+
+// Rádio: RX por interrupção + monitor de saúde
+RadioHealth radio_health(HealthCfg::kSilenceMs, HealthCfg::kErrMax,
+                         HealthCfg::kBackoffMinMs, HealthCfg::kBackoffMaxMs);
+volatile bool rx_flag     = false;
+volatile uint32_t rx_done_us = 0;    // micros() da IRQ de RX = fim do uplink
+uint8_t  radio_probe_ref  = 0;       // registrador de sonda lido logo após a inicialização
+uint32_t radio_last_probe = 0;
+
+#if LOW_POWER_RX
+// Light sleep (janela = intervalo de estatísticas)
+uint32_t lp_sleeps   = 0;   // entradas em light sleep
+uint32_t lp_wake_rx  = 0;   // acordadas pelo DIO1
+uint64_t lp_sleep_us = 0;   // tempo dormindo
+uint32_t lp_window_start = 0;
+#endif
+
+// Ruído do canal (janela = intervalo de estatísticas)
+NoiseMonitor<> noise;
+uint32_t noise_next_ms      = 0;
+uint32_t noise_window_start = 0;
+
+#if ENABLE_DOWNLINK
+// Downlink: comandos por nó aguardando o próximo uplink
+DownlinkQueue<DownlinkCfg::kNodes, DownlinkCfg::kDepth, DL_MAX_PAYLOAD> dl_queue;
+uint32_t dl_late     = 0;   // uplink atendido tarde demais para a janela do nó
+uint32_t dl_failed   = 0;   // transmissão do downlink falhou
+uint32_t dl_lag_max  = 0;   // maior atraso do TX em relação ao instante alvo (us)
+uint32_t dl_acks     = 0;   // DL_CMD_ACK transmitidos
+uint32_t dl_acks_late= 0;   // ACK não enviado: uplink atendido tarde demais
+uint32_t dl_last_expire = 0;
+#endif
+
+// Enlace serial com o bridge
+uint32_t link_baud        = IoCfg::kSerialBaud;
+bool     link_pending     = false;   // nova taxa aguardando o primeiro @PING
+uint32_t link_deadline    = 0;
+uint32_t link_last_ping   = 0;
+uint32_t link_fallbacks   = 0;
+uint8_t  link_garbage     = 0;
+
+// Controle de fluxo com o bridge (ativo após @FC)
+CreditQueue<FlowCfg::kSlots, IoCfg::kJsonMax> fc_queue;
+bool     fc_enabled     = false;
+uint8_t  fc_window      = 0;
+FcPolicy fc_policy      = (FcPolicy)FlowCfg::kPolicy;
+uint32_t fc_last_ack    = 0;   // último @ACK/@CREDIT (ou início do prazo do ACK)
+uint32_t fc_timeouts    = 0;
+uint8_t  fc_timeout_run = 0;   // timeouts seguidos sem nenhum @ACK/@CREDIT
+uint32_t fc_disables    = 0;   // FC desligado pelo gateway (fallback ou bridge mudo)
+uint32_t fc_stalls      = 0;   // créditos esgotados com registros pendentes
+uint32_t fc_stall_ms    = 0;
+uint32_t fc_stall_max   = 0;
+uint32_t fc_stall_start = 0;
+bool     fc_stalled     = false;
+uint64_t fc_util_acc    = 0;   // soma de (em voo x ms): utilização da janela
+uint64_t fc_window_acc  = 0;   // soma de (janela x ms)
+uint32_t fc_last_tick   = 0;
+
+#if NO_HEAP_AFTER_BOOT
+// Sem heap após o boot: malloc/calloc/realloc/heap_caps_*/new interceptados no link
+// (-Wl,--wrap=..., env *_noheap); só a tarefa do loop() é vigiada.
+HeapGuard<HeapCfg::kSites> heap_guard;
+
+static inline const void* heap_task() { return xTaskGetCurrentTaskHandle(); }
+
+static void heap_note(const void* ra, size_t n) {
+  if (heap_guard.note(heap_task(), ra, n) == HEAP_TRAP) {
+    heap_guard.exempt_enter();
+    Serial.printf("@HEAP TRAP 0x%08lx n=%u\n",
+                  (unsigned long)HeapGuard<HeapCfg::kSites>::pc_of(ra), (unsigned)n);
+    Serial.flush();
+    abort();
+  }
+}
+
+extern "C" {
+void* __real_malloc(size_t n);
+void* __real_calloc(size_t c, size_t n);
+void* __real_realloc(void* p, size_t n);
+
+void* __wrap_malloc(size_t n) {
+  heap_note(__builtin_return_address(0), n);
+  return __real_malloc(n);
+}
+
+void* __wrap_calloc(size_t c, size_t n) {
+  heap_note(__builtin_return_address(0), c * n);
+  return __real_calloc(c, n);
+}
+
+void* __wrap_realloc(void* p, size_t n) {
+  heap_note(__builtin_return_address(0), n);
+  return __real_realloc(p, n);
+}
+
+#if defined(ESP_PLATFORM)
+// newlib (printf, strdup, String...) entra pelas variantes reentrantes
+void* __real__malloc_r(struct _reent* r, size_t n);
+void* __real__calloc_r(struct _reent* r, size_t c, size_t n);
+void* __real__realloc_r(struct _reent* r, void* p, size_t n);
+
+void* __wrap__malloc_r(struct _reent* r, size_t n) {
+  heap_note(__builtin_return_address(0), n);
+  return __real__malloc_r(r, n);
+}
+
+void* __wrap__calloc_r(struct _reent* r, size_t c, size_t n) {
+  heap_note(__builtin_return_address(0), c * n);
+  return __real__calloc_r(r, c, n);
+}
+
+void* __wrap__realloc_r(struct _reent* r, void* p, size_t n) {
+  heap_note(__builtin_return_address(0), n);
+  return __real__realloc_r(r, p, n);
+}
+
+// heap_caps_*: alocações com capacidade (DMA, PSRAM) dos drivers do IDF, p.ex.
+// o bounce buffer do spi_master. O malloc do IDF chama heap_caps_malloc dentro
+// do próprio heap_caps.c, fora do alcance do --wrap: não conta duas vezes.
+void* __real_heap_caps_malloc(size_t n, uint32_t caps);
+void* __real_heap_caps_calloc(size_t c, size_t n, uint32_t caps);
+void* __real_heap_caps_realloc(void* p, size_t n, uint32_t caps);
+void* __real_heap_caps_aligned_alloc(size_t align, size_t n, uint32_t caps);
+
+void* __wrap_heap_caps_malloc(size_t n, uint32_t caps) {
+  heap_note(__builtin_return_address(0), n);
+  return __real_heap_caps_malloc(n, caps);
+}
+
+void* __wrap_heap_caps_calloc(size_t c, size_t n, uint32_t caps) {
+  heap_note(__builtin_return_address(0), c * n);
+  return __real_heap_caps_calloc(c, n, caps);
+}
+
+void* __wrap_heap_caps_realloc(void* p, size_t n, uint32_t caps) {
+  heap_note(__builtin_return_address(0), n);
+  return __real_heap_caps_realloc(p, n, caps);
+}
+
+void* __wrap_heap_caps_aligned_alloc(size_t align, size_t n, uint32_t caps) {
+  heap_note(__builtin_return_address(0), n);
+  return __real_heap_caps_aligned_alloc(align, n, caps);
+}
+#endif
+
+#if __SIZEOF_SIZE_T__ == 4
+// operator new / new[]: conta no chamador, não no malloc interno
+void* __real__Znwj(size_t n);
+void* __real__Znaj(size_t n);
+
+void* __wrap__Znwj(size_t n) {
+  heap_note(__builtin_return_address(0), n);
+  bool own = heap_guard.mine(heap_task());   // outras tarefas não mexem no contador
+  if (own) heap_guard.nest();
+  void* p = __real__Znwj(n);
+  if (own) heap_guard.unnest();
+  return p;
+}
+
+void* __wrap__Znaj(size_t n) {
+  heap_note(__builtin_return_address(0), n);
+  bool own = heap_guard.mine(heap_task());   // outras tarefas não mexem no contador
+  if (own) heap_guard.nest();
+  void* p = __real__Znaj(n);
+  if (own) heap_guard.unnest();
+  return p;
+}
+#endif
+}
+#endif
 
 // =====================================================
 // Funções auxiliares
 // =====================================================
 
 void setup_lora();
+int  radio_start();
+int  radio_listen();
+void radio_service();
 void setup_wifi();
 void print_stats();
-void process_packet(uint8_t* buf, size_t len);
-void send_json(const String& json_line);
-String packet_to_json(const SensorDataMessage& msg);
+#if NO_HEAP_AFTER_BOOT
+static void heap_arm();
+static void print_heap();
+#endif
+void process_packet(const RxPacket& pkt);
+void handle_reading(const SensorReading& r, float rssi, float snr, node_addr_t via);
+void send_json(const char* json, size_t len, node_addr_t node, uint8_t prio);
+size_t packet_to_json(const SensorReading& r, node_addr_t via, float rssi, float snr, char* out, size_t cap);
 void print_hex(const uint8_t* data, size_t len);
+void link_poll();
+void fc_service();
+void setup_mqtt();
+#if ENABLE_DOWNLINK
+static void downlink_after_uplink(const RxPacket& pkt, uint32_t rx_end_us);
+static void downlink_expire(uint32_t now);
+#endif
+#if LOW_POWER_RX
+static void lp_sleep();
+#endif
 
 // =====================================================
 // Setup
@@ -66,12 +326,20 @@ void setup() {
 #if ENABLE_WIFI
   setup_wifi();
 #endif
+#if USE_MQTT
+  setup_mqtt();
+#endif
 
   setup_lora();
 
-  if (!lora_ready) {
-    Serial.println("LoRa init failed, switching to passive mode.");
+  if (!radio_health.is_up()) {
+    Serial.printf("LoRa init failed, nova tentativa em %lus.\n",
+                  (unsigned long)radio_health.backoff_ms() / 1000);
   }
+
+#if NO_HEAP_AFTER_BOOT
+  heap_arm();
+#endif
 }
 
 
@@ -80,43 +348,67 @@ void setup() {
 // =====================================================
 
 void loop() {
+#if NO_HEAP_AFTER_BOOT
+  heap_guard.tick();
+#endif
+  link_poll();
+  fc_service();
+
 #if TEST_MODE
   static unsigned long last = 0;
   if (millis() - last > GwCfg::kTestEveryMs) {
       last = millis();
 
-      // Pacote simulado
-      SensorDataMessage msg{};
-      msg.msg_type   = MSG_TYPE_SENSOR_DATA;
-      msg.client_id  = 1;
+      static uint8_t seq = 0;
+
+      // Pacote simulado (passa pelo mesmo decodificador dos pacotes reais)
+      SensorDataMessageV2 msg{};
+      msg.msg_type   = MSG_TYPE_SENSOR_DATA_V2;
+      msg.node_addr  = 1;
       msg.timestamp  = millis();
       msg.temperature= encode_temperature(25.4f);
       msg.humidity   = encode_humidity(58.3f);
       msg.distance_cm= 90;
       msg.battery    = 97;
+      msg.seq        = seq++;
       msg.checksum   = calculate_checksum((uint8_t*)&msg, sizeof(msg));
 
-      String json_line = packet_to_json(msg);
-      Serial.println(json_line); // gateway envia o JSON simulado
+      SensorReading r;
+      if (decode_sensor_frame((uint8_t*)&msg, sizeof(msg), r) == DECODE_OK) {
+        char json[IoCfg::kJsonMax];
+        size_t n = packet_to_json(r, NODE_ADDR_NONE, NAN, NAN, json, sizeof(json));
+        if (n > 0) send_json(json, n, r.node_addr, reading_priority(r)); // gateway envia o JSON simulado
+      }
   }
 #else
-  if (!lora_ready) {
-    delay(2000);
-    return;
-  }
+  radio_service();
 
-  uint8_t buf[GwCfg::kMaxPkt] = {0};
-  int len = radio.receive(buf, sizeof(buf));
+  // Um pacote por iteração: a IRQ de RX seguinte é atendida antes do próximo
+  uint8_t idx = rx_pool.next();
+  if (idx != RxPool::kNone) {
+    process_packet(rx_pool.at(idx));
+    rx_pool.release(idx);
+  }
 
-  if (len > 0) {
-    process_packet(buf, len);
+#if ENABLE_DOWNLINK
+  if (millis() - dl_last_expire >= 1000) {
+    dl_last_expire = millis();
+    downlink_expire(dl_last_expire);
   }
+#endif
 
   // Estatísticas periódicas
   if (millis() - last_stat_time > GwCfg::kStatsEveryMs) {
     print_stats();
     last_stat_time = millis();
   }
+
+#if LOW_POWER_RX
+  // Nada pendente: dorme até o próximo pacote, comando serial ou LP_MAX_SLEEP_MS
+  if (LowPowerCfg::kLightSleep && radio_health.is_up() && !rx_flag &&
+      rx_pool.in_use() == 0 && Serial.available() == 0)
+    lp_sleep();
+#endif
 #endif
 }
 
@@ -132,33 +424,275 @@ void setup_lora() {
   Serial.printf("  DIO1:%d  RST:%d  BUSY:%d\n",
       LinkCfg::kDio1, LinkCfg::kRst, LinkCfg::kBusy);
 
+  Serial.printf("  SPI: %s @ %lu Hz\n", radio_hal.dma() ? "DMA (SPI3)" : "SPIClass",
+                (unsigned long)radio_hal.clock_hz());
+
+  if (!radio_hal.dma())   // no modo DMA o HAL inicializa o próprio barramento
+    SPI.begin(LinkCfg::kSck, LinkCfg::kMiso, LinkCfg::kMosi, LinkCfg::kNss);
+  delay(50);
+
+  int state = radio_start();
+  if (state == RADIOLIB_ERR_NONE) {
+    Serial.println("✓ SX1262 iniciado com sucesso!");
+    radio_health.up(millis());
+  } else {
+    Serial.printf("✗ Falha na inicialização LoRa (erro %d)\n", state);
+    radio_health.down(state, millis());
+  }
+}
+
+// =====================================================
+// Rádio: RX por interrupção e monitor de saúde
+// =====================================================
+//
+// - DIO1 só levanta rx_flag; leitura e decodificação ficam no loop.
+// - Sonda: a cada RADIO_PROBE_MS lê o registrador OCP por SPI e compara com o valor
+//   lido após a inicialização (begin() grava 60 mA; um reset espúrio do chip volta
+//   ao padrão de fábrica e SPI morto lê 0x00/0xFF). Divergência confirmada => DOWN.
+// - Silêncio por RADIO_SILENCE_MS: sonda e reinicia o RX (standby + startReceive).
+// - Erros seguidos de readData/startReceive >= RADIO_ERR_MAX => DOWN.
+// - DOWN: radio_start() com backoff exponencial. Avisos de estado vão ao bridge
+//   como linhas de controle: @RADIO DOWN <erro> <motivo> | @RADIO UP <ms fora do ar>.
+// - LOW_POWER_RX: a escuta é em duty cycle (radio_listen). Qualquer comando SPI
+//   acorda o chip do sono e encerra o duty cycle, e cada pacote também o encerra:
+//   após leitura, sonda e estatísticas o RX é rearmado.
+
+void IRAM_ATTR on_radio_dio1() {
+  rx_done_us = micros();
+  rx_flag = true;
+}
+
+/**
+ * @brief Reseta e configura o SX1262 e entra em RX contínuo por interrupção.
+ * @return código RadioLib (RADIOLIB_ERR_NONE em caso de sucesso)
+ */
+int radio_start() {
+  radio.clearDio1Action();
   pinMode(LinkCfg::kRst, OUTPUT);
   digitalWrite(LinkCfg::kRst, LOW);
   delay(10);
   digitalWrite(LinkCfg::kRst, HIGH);
   delay(10);
 
-  SPI.begin(LinkCfg::kSck, LinkCfg::kMiso, LinkCfg::kMosi, LinkCfg::kNss);
-  delay(50);
-
   int state = radio.begin(
       LinkCfg::kFreqMHz,
       LinkCfg::kBwKHz,
       LinkCfg::kSf,
       LinkCfg::kCr,
       LinkCfg::kSyncWord,
-      14,
+      DownlinkCfg::kTxPowerDbm,
       LinkCfg::kPreamble
   );
+  if (state == RADIOLIB_ERR_NONE) {
+    radio_probe_ref = radio.getMod()->SPIreadRegister(RADIOLIB_SX126X_REG_OCP_CONFIGURATION);
+    if (radio_probe_ref == 0x00 || radio_probe_ref == 0xFF) state = RADIOLIB_ERR_CHIP_NOT_FOUND;
+  }
+  if (state != RADIOLIB_ERR_NONE) {
+    // Falha de SPI pode ser clock alto demais para a fiação: a próxima tentativa sai mais lenta
+    if (EspDmaHal::spi_fault(state) && radio_hal.step_down())
+      Serial.printf("[LoRa] SPI reduzido para %lu Hz\n", (unsigned long)radio_hal.clock_hz());
+    return state;
+  }
+
+  rx_flag = false;
+  radio.setDio1Action(on_radio_dio1);
+  state = radio_listen();
+  radio_last_probe = millis();
+  return state;
+}
+
+/**
+ * @brief Entra em RX: contínuo ou, com LOW_POWER_RX, duty cycle com detecção de
+ *        preâmbulo (períodos calculados pelo RadioLib a partir de LP_PREAMBLE).
+ */
+int radio_listen() {
+  if (LowPowerCfg::kEnabled)
+    return radio.startReceiveDutyCycleAuto(LowPowerCfg::kPreamble, LowPowerCfg::kMinSymbols);
+  return radio.startReceive();
+}
+
+static void radio_set_down(int code, const char* reason) {
+  radio.clearDio1Action();
+  radio_health.down(code, millis());
+  Serial.printf("@RADIO DOWN %d %s\n", code, reason);
+}
+
+// Lê o registrador de sonda; confirma uma divergência com uma segunda leitura.
+static bool radio_probe() {
+  uint8_t v = radio.getMod()->SPIreadRegister(RADIOLIB_SX126X_REG_OCP_CONFIGURATION);
+  if (v != radio_probe_ref)
+    v = radio.getMod()->SPIreadRegister(RADIOLIB_SX126X_REG_OCP_CONFIGURATION);
+  if (v == radio_probe_ref) {
+    radio_health.ok();
+    return true;
+  }
+  Serial.printf("[LoRa] Sonda falhou: OCP=0x%02X (esperado 0x%02X)\n", v, radio_probe_ref);
+  radio_set_down(RADIOLIB_ERR_SPI_CMD_FAILED, "probe");
+  return false;
+}
+
+// Lê o pacote direto no descritor (tamanho exato) e o entrega à decodificação.
+static void radio_rx() {
+  uint8_t idx = rx_pool.acquire();
+  if (idx == RxPool::kNone) {
+    radio_listen();   // pool esgotado: descarta o pacote e limpa a IRQ
+    return;
+  }
+  RxPacket& pkt = rx_pool.at(idx);
+  uint32_t t0 = micros();
+  uint32_t spi0 = radio_hal.busy_us();
+  uint32_t xfers0 = radio_hal.transactions();
+  size_t len = radio.getPacketLength();
+  if (len > sizeof(pkt.data)) len = sizeof(pkt.data);
+  int state = radio.readData(pkt.data, len);
+
+  if (state == RADIOLIB_ERR_NONE && len > 0) {
+    radio_health.rx_activity(millis());
+    pkt.len   = (uint16_t)len;
+    pkt.rx_ms = millis();
+    pkt.rssi  = radio.getRSSI();
+    pkt.snr   = radio.getSNR();
+    if (LowPowerCfg::kEnabled) radio_listen();
+    rx_readouts++;
+    rx_readout_us    += micros() - t0;
+    rx_readout_spi   += radio_hal.busy_us() - spi0;
+    rx_readout_xfers += radio_hal.transactions() - xfers0;
+    noise.add_airtime(radio.getTimeOnAir(len));
+    rx_pool.commit(idx);
+#if ENABLE_DOWNLINK
+    downlink_after_uplink(pkt, rx_done_us);
+#endif
+    return;
+  }
+  rx_pool.release(idx);
+  if (LowPowerCfg::kEnabled) radio_listen();
 
   if (state == RADIOLIB_ERR_NONE) {
-    Serial.println("✓ SX1262 iniciado com sucesso!");
-    lora_ready = true;
-  } else {
-    Serial.printf("✗ Falha na inicialização LoRa (erro %d)\n", state);
-    lora_ready = false;
+    radio_health.rx_activity(millis());
+    packets_invalid++;
+  } else if (state == RADIOLIB_ERR_CRC_MISMATCH) {
+    radio_health.rx_activity(millis());   // ruído/colisão: o rádio está vivo
+    packets_crc++;
+  } else if (radio_health.fault(state)) {
+    radio_set_down(state, "rx");
+  }
+}
+
+/**
+ * @brief Atende a IRQ de RX, roda a sonda/detecção de silêncio e reinicializa
+ *        o rádio com backoff quando ele está fora do ar.
+ */
+void radio_service() {
+  uint32_t now = millis();
+
+  if (!radio_health.is_up()) {
+    if (!radio_health.retry_due(now)) return;
+    int state = radio_start();
+    if (state == RADIOLIB_ERR_NONE) {
+      uint32_t lost = radio_health.current_outage_ms(millis());
+      radio_health.up(millis());
+      Serial.printf("@RADIO UP %lu\n", (unsigned long)lost);
+    } else {
+      radio_health.retry_failed(state, millis());
+      Serial.printf("[LoRa] Reinício falhou (erro %d), nova tentativa em %lus\n",
+                    state, (unsigned long)radio_health.backoff_ms() / 1000);
+    }
+    return;
+  }
+
+  if (rx_flag) {
+    rx_flag = false;
+    radio_rx();
+  }
+
+  // RSSI instantâneo com o rádio ocioso em RX (GetRssiInst não interrompe a
+  // detecção de preâmbulo). Jitter no período evita sincronizar com TX periódicos.
+  if (NoiseCfg::kSampleMs > 0 && radio_health.is_up() && !rx_flag &&
+      (int32_t)(now - noise_next_ms) >= 0) {
+    noise.add(radio.getRSSI(false));
+    noise_next_ms = now + NoiseCfg::kSampleMs / 2 + micros() % (NoiseCfg::kSampleMs | 1);
+  }
+
+  if (radio_health.is_up() && now - radio_last_probe >= HealthCfg::kProbeMs) {
+    radio_last_probe = now;
+    if (radio_probe() && LowPowerCfg::kEnabled) radio_listen();
+  }
+
+  if (radio_health.is_up() && radio_health.silent(now)) {
+    radio_health.silence_handled(now);
+    Serial.printf("[LoRa] Silêncio há %lus: sondando e reiniciando o RX\n",
+                  (unsigned long)radio_health.since_rx_ms(now) / 1000);
+    if (!radio_probe()) return;
+    int state = radio.standby();
+    if (state == RADIOLIB_ERR_NONE) state = radio_listen();
+    if (state == RADIOLIB_ERR_NONE) radio_health.ok();
+    else if (radio_health.fault(state)) radio_set_down(state, "silence");
+  }
+}
+
+#if LOW_POWER_RX
+// =====================================================
+// Baixo consumo: light sleep até o DIO1
+// =====================================================
+//
+// - O DIO1 vira fonte de wakeup por nível; durante o sono a interrupção do pino
+//   fica desligada (nível alto dispararia a ISR sem parar) e, ao acordar, volta
+//   à borda de subida. Se o DIO1 subiu durante o sono, rx_flag é levantado aqui.
+// - UART0 acorda o chip após alguns bytes (os primeiros se perdem; o bridge
+//   repete @HELLO/@PING). USB CDC nativo não sobrevive ao light sleep.
+// - millis()/micros() continuam contando durante o sono (esp_timer).
+
+static void lp_sleep() {
+  gpio_num_t dio1 = (gpio_num_t)LinkCfg::kDio1;
+  gpio_intr_disable(dio1);
+  gpio_wakeup_enable(dio1, GPIO_INTR_HIGH_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+  esp_sleep_enable_timer_wakeup(LowPowerCfg::kMaxSleepMs * 1000ULL);
+  if (!IoCfg::kUsbCdc) {
+    uart_set_wakeup_threshold(UART_NUM_0, 3);
+    esp_sleep_enable_uart_wakeup(UART_NUM_0);
   }
+  Serial.flush();
+
+  uint32_t t0 = micros();
+  esp_light_sleep_start();
+  lp_sleep_us += micros() - t0;
+  lp_sleeps++;
+
+  gpio_wakeup_disable(dio1);
+  gpio_set_intr_type(dio1, GPIO_INTR_POSEDGE);
+  gpio_intr_enable(dio1);
+  if (digitalRead(LinkCfg::kDio1) && !rx_flag) {
+    rx_done_us = micros();   // atraso de wakeup (~1 ms) entra na janela de downlink
+    rx_flag = true;
+    lp_wake_rx++;
+  }
+}
+
+// Consumo médio estimado na janela: rádio pelo duty cycle configurado + tempo de
+// ar recebido; MCU pela fração medida em light sleep.
+static void print_low_power(uint32_t now) {
+  uint32_t window = now - lp_window_start;
+  if (window == 0) return;
+  float asleep = (float)lp_sleep_us / (window * 1000.0f);
+  if (asleep > 1.0f) asleep = 1.0f;
+  float rx_air = noise.own_airtime(window);
+  float radio_on = LowPowerCfg::kRadioDuty + rx_air * (1.0f - LowPowerCfg::kRadioDuty);
+  float radio_ma = radio_on * LowPowerCfg::kRadioRxMa + (1.0f - radio_on) * LowPowerCfg::kRadioSleepMa;
+  float mcu_ma = (1.0f - asleep) * LowPowerCfg::kMcuActiveMa + asleep * LowPowerCfg::kMcuSleepMa;
+  float cont_ma = LowPowerCfg::kRadioRxMa + LowPowerCfg::kMcuActiveMa;
+  Serial.printf("  Baixo consumo: escuta %lu/%lu us (%.1f%%)  sono MCU %.1f%%  (%lu sonos, %lu por RX)\n",
+                (unsigned long)LowPowerCfg::kWakeUs, (unsigned long)LowPowerCfg::kSleepUs,
+                LowPowerCfg::kRadioDuty * 100, asleep * 100, lp_sleeps, lp_wake_rx);
+  Serial.printf("  Consumo estimado: %.2f mA (rádio %.2f + MCU %.2f) = %.1f mWh/h  vs RX contínuo %.1f mWh/h\n",
+                radio_ma + mcu_ma, radio_ma, mcu_ma, (radio_ma + mcu_ma) * LowPowerCfg::kSupplyV,
+                cont_ma * LowPowerCfg::kSupplyV);
+  lp_sleeps = 0;
+  lp_wake_rx = 0;
+  lp_sleep_us = 0;
+  lp_window_start = now;
 }
+#endif
 
 // =====================================================
 // Wi-Fi (opcional)
@@ -191,102 +725,746 @@ void setup_wifi() {
 // Processamento de pacotes
 // =====================================================
 
-void process_packet(uint8_t* buf, size_t len) {
-  Serial.println("\n[LoRa] Pacote recebido!");
+// Lote com a fila em flash do próprio remetente (não é repetição de outros nós).
+static bool is_backlog_batch(const RelayBatchHeader* h, const RelayRecord* recs) {
+  return h->count > 0 && recs[0].origin == h->sender && recs[0].hops == 0;
+}
 
-  // Mostrar RSSI/SNR
-  float rssi = radio.getRSSI();
-  float snr  = radio.getSNR();
-  Serial.printf("  RSSI: %.1f dBm | SNR: %.1f dB | Len: %d bytes\n", rssi, snr, len);
+void process_packet(const RxPacket& pkt) {
+  const uint8_t* buf = pkt.data;
+  size_t len = pkt.len;
+  float rssi = pkt.rssi;
+  float snr  = pkt.snr;
+
+  Serial.println("\n[LoRa] Pacote recebido!");
+  Serial.printf("  RSSI: %.1f dBm | SNR: %.1f dB | Len: %d bytes\n", rssi, snr, (int)len);
 
   // Mostrar bytes em HEX
   Serial.print("  Data HEX: ");
   print_hex(buf, len);
   Serial.println();
 
-  if (len < sizeof(SensorDataMessage)) {
-    packets_invalid++;
-    Serial.println("  ⚠ Pacote muito pequeno, ignorado.");
-    return;
+  SensorReading r;
+  DecodeStatus st;
+  const RelayBatchHeader* batch = nullptr;
+  const RelayRecord* records = nullptr;
+
+  if (len > 0 && buf[0] == MSG_TYPE_RELAY_BATCH)
+    st = decode_relay_batch(buf, len, batch, records);
+  else
+    st = decode_sensor_frame(buf, len, r);
+
+  switch (st) {
+    case DECODE_BAD_LENGTH:
+      packets_invalid++;
+      Serial.println("  ⚠ Tamanho incompatível com o tipo, ignorado.");
+      return;
+    case DECODE_BAD_CHECKSUM:
+      packets_checksum++;
+      Serial.printf("  ⚠ Checksum inválido (tipo 0x%02X).\n", buf[0]);
+      return;
+    case DECODE_UNKNOWN_TYPE:
+      packets_unknown++;
+      Serial.printf("  ⚠ Tipo desconhecido 0x%02X, ignorado.\n", buf[0]);
+      return;
+    case DECODE_OK:
+      break;
   }
 
-  SensorDataMessage msg;
-  memcpy(&msg, buf, sizeof(msg));
+  packets_ok++;
 
-  // Validar checksum
-  uint8_t expected = calculate_checksum((uint8_t*)&msg, sizeof(msg));
-  bool ok = verify_checksum((uint8_t*)&msg, sizeof(msg));
+  if (batch) {
+    relay_batches++;
+    Serial.printf("  ✓ Lote %s %u: %u registro(s)\n",
+                  is_backlog_batch(batch, records) ? "da fila em flash do nó" : "do repetidor",
+                  batch->sender, batch->count);
+    // RSSI/SNR pertencem ao enlace repetidor → gateway
+    ClientEntry& relay = clients.touch(batch->sender, millis());
+    relay.last_rssi = rssi;
+    relay.last_snr  = snr;
+    for (uint8_t i = 0; i < batch->count; i++) {
+      relay_record_to_reading(records[i], r);
+      handle_reading(r, NAN, NAN, batch->sender);   // via == origem: fila em flash
+    }
+    return;
+  }
+
+  if (!r.has_seq) packets_legacy++;
+  handle_reading(r, rssi, snr, NODE_ADDR_NONE);
+}
 
-  if (!ok) {
-    packets_checksum++;
-    Serial.printf("  ⚠ Checksum inválido. Recebido: 0x%02X, Esperado: 0x%02X\n",
-                  msg.checksum, expected);
+void handle_reading(const SensorReading& r, float rssi, float snr, node_addr_t via) {
+  ClientEntry& client = clients.touch(r.node_addr, millis());
+  bool backlog = via == r.node_addr;   // fila em flash do próprio nó (lote com hops 0)
+  bool fresh = !r.has_seq ||
+               (backlog ? ClientTable<GwCfg::kMaxClients>::account_backlog(client, r.seq)
+                        : ClientTable<GwCfg::kMaxClients>::account_seq(client, r.seq));
+  if (!fresh) {
+    readings_dup++;
+    Serial.printf("  ↺ Node %u seq %u duplicado, descartado.\n", r.node_addr, r.seq);
     return;
   }
+  client.packets++;
+  if (backlog) {
+    client.backlog++;
+  } else if (via != NODE_ADDR_NONE) {
+    client.relayed++;
+  } else {
+    client.last_rssi = rssi;
+    client.last_snr  = snr;
+  }
 
   // Exibir conteúdo decodificado
-  Serial.printf("  ✓ Client ID: %u\n", msg.client_id);
-  Serial.printf("  ✓ Temp: %.2f °C\n", decode_temperature(msg.temperature));
-  Serial.printf("  ✓ Humid: %.2f %%\n", decode_humidity(msg.humidity));
-  Serial.printf("  ✓ Dist: %u cm\n", msg.distance_cm);
-  Serial.printf("  ✓ Batt: %u %%\n", msg.battery);
-
-  String json_line = packet_to_json(msg);
-  send_json(json_line);
-  packets_ok++;
+  Serial.printf("  ✓ Node: %u%s\n", r.node_addr, r.has_seq ? "" : " (legado)");
+  if (r.has_seq) Serial.printf("  ✓ Seq: %u\n", r.seq);
+  if (backlog)
+    Serial.printf("  ✓ Fila em flash: guardada %us\n", r.age_s);
+  else if (via != NODE_ADDR_NONE)
+    Serial.printf("  ✓ Via: %u (%u salto(s), retido %us)\n", via, r.hops, r.age_s);
+  Serial.printf("  ✓ Temp: %.2f °C\n", decode_temperature(r.temperature));
+  Serial.printf("  ✓ Humid: %.2f %%\n", decode_humidity(r.humidity));
+  Serial.printf("  ✓ Dist: %u cm\n", r.distance_cm);
+  Serial.printf("  ✓ Batt: %u %%\n", r.battery);
+  if (r.summary) {
+    // Linhas curtas: Print::printf aloca no heap acima de 64 bytes
+    Serial.printf("  ✓ Resumo: %u amostras  umid σ %.2f %%\n",
+                  r.summary->samples, r.summary->humidity.stddev / 100.0f);
+    Serial.printf("  ✓ Resumo: dist %.1f..%.1f cm σ %.1f\n",
+                  r.summary->distance.min / 10.0f, r.summary->distance.max / 10.0f,
+                  r.summary->distance.stddev / 10.0f);
+  }
+
+  char json[IoCfg::kJsonMax];
+  size_t n = packet_to_json(r, via, rssi, snr, json, sizeof(json));
+  if (n > 0) send_json(json, n, r.node_addr, reading_priority(r));
 }
 
 // =====================================================
 // Conversão para JSON
 // =====================================================
 
-String packet_to_json(const SensorDataMessage& msg) {
+size_t packet_to_json(const SensorReading& r, node_addr_t via, float rssi, float snr, char* out, size_t cap) {
   char time_buf[32];
-  unsigned long ts_ms = msg.timestamp;
+  unsigned long ts_ms = r.timestamp;
   time_t sec = ts_ms / 1000;
   struct tm t;
   gmtime_r(&sec, &t);
   strftime(time_buf, sizeof(time_buf), "%Y-%m-%dT%H:%M:%S", &t);
 
-  bool presence = msg.distance_cm < 100;
+  // Resumo de janela: presença se houve qualquer amostra próxima no intervalo
+  bool presence = (r.summary ? r.summary->distance.min / 10 : r.distance_cm) < 100;
 
-  String json = "{";
-  json += "\"node_id\":\"" + String(msg.client_id) + "\",";
-  json += "\"timestamp\":\"" + String(time_buf) + "\",";
-  json += "\"sensors\":{";
-  json += "\"temperature_celsius\":" + String(decode_temperature(msg.temperature), 2) + ",";
-  json += "\"humidity_percent\":" + String(decode_humidity(msg.humidity), 2) + ",";
-  json += "\"luminosity_lux\":null,";
-  json += "\"presence_detected\":" + String(presence ? "true" : "false") + ",";
-  json += "\"power_on\":true";
-  json += "}}";
-  return json;
+  // Campos opcionais (seq, sinal do enlace direto, caminho via repetidor ou fila em flash).
+  // RSSI/SNR de leitura repetida seriam do repetidor, não do nó: omitidos.
+  char extra[96] = "";
+  int e = 0;
+  if (r.has_seq)
+    e += snprintf(extra + e, sizeof(extra) - e, "\"seq\":%u,", r.seq);
+  if (via == NODE_ADDR_NONE && !isnan(rssi))
+    e += snprintf(extra + e, sizeof(extra) - e, "\"rssi\":%.1f,\"snr\":%.1f,", rssi, snr);
+  if (via == r.node_addr)
+    e += snprintf(extra + e, sizeof(extra) - e, "\"backlog\":true,\"age_s\":%u,", r.age_s);
+  else if (via != NODE_ADDR_NONE)
+    e += snprintf(extra + e, sizeof(extra) - e, "\"relay\":\"%u\",\"hops\":%u,\"age_s\":%u,",
+                  via, r.hops, r.age_s);
+
+  // Estatísticas da janela (MSG_TYPE_SENSOR_SUMMARY); os campos de sempre levam a média
+  char stats[224] = "";
+  if (r.summary) {
+    const ChannelSummary& h = r.summary->humidity;
+    const ChannelSummary& d = r.summary->distance;
+    snprintf(stats, sizeof(stats),
+        ",\"samples\":%u,\"stats\":{"
+        "\"humidity_percent\":{\"min\":%.2f,\"max\":%.2f,\"mean\":%.2f,\"std\":%.2f},"
+        "\"distance_cm\":{\"min\":%.1f,\"max\":%.1f,\"mean\":%.1f,\"std\":%.1f}}",
+        r.summary->samples,
+        h.min / 100.0f, h.max / 100.0f, h.mean / 100.0f, h.stddev / 100.0f,
+        d.min / 10.0f, d.max / 10.0f, d.mean / 10.0f, d.stddev / 10.0f);
+  }
+
+  int len = snprintf(out, cap,
+      "{\"node_id\":\"%u\",\"timestamp\":\"%s\",%s\"sensors\":{"
+      "\"temperature_celsius\":%.2f,\"humidity_percent\":%.2f,\"luminosity_lux\":null,"
+      "\"presence_detected\":%s,\"power_on\":true}%s}",
+      r.node_addr, time_buf, extra,
+      decode_temperature(r.temperature), decode_humidity(r.humidity),
+      presence ? "true" : "false", stats);
+  return (len < 0 || (size_t)len >= cap) ? 0 : (size_t)len;
 }
 
 // =====================================================
-// Saída (Serial ou HTTP)
+// Saída (MQTT, HTTP ou Serial)
 // =====================================================
 
-void send_json(const String& json_line) {
+void send_json(const char* json, size_t len, node_addr_t node, uint8_t prio) {
+#if USE_MQTT
+  // Só enfileira: quem fala com o broker é a mqtt_task, fora do caminho de RX
+  xSemaphoreTake(mqtt_lock, portMAX_DELAY);
+  mqtt_queue.push(json, len, node, millis());
+  xSemaphoreGive(mqtt_lock);
+  return;
+#endif
 #if USE_HTTP
   if (NetCfg::kUseHttp && WiFi.status() == WL_CONNECTED) {
     HTTPClient http;
     String url = String("http://") + NetCfg::Host() + ":" + NetCfg::Port + NetCfg::Path();
     http.begin(url);
     http.addHeader("Content-Type", "application/json");
-    int code = http.POST(json_line);
+    int code = http.POST((uint8_t*)json, len);
     Serial.printf("[HTTP] POST %s (%d bytes) → code %d\n",
-                  url.c_str(), json_line.length(), code);
+                  url.c_str(), (int)len, code);
     http.end();
   } else
 #endif
   if (IoCfg::kUseSerial) {
+    if (fc_enabled) {   // sai por fc_service() conforme os créditos do bridge
+      fc_queue.push(json, len, node, prio, fc_policy, millis());
+      return;
+    }
     // Linha JSON pura — o bridge Python lê exatamente isso
     Serial.print(IoCfg::Prefix());
-    Serial.println(json_line);
+    Serial.write((const uint8_t*)json, len);
+    Serial.println();
   }
 }
 
+// =====================================================
+// MQTT (opcional)
+// =====================================================
+//
+// - Sessão persistente (clean session = false, client id fixo por gateway).
+// - MQTT_BATCH_MAX == 1: cada leitura vai para <prefixo>/<gw>/node/<id>.
+// - MQTT_BATCH_MAX  > 1: até N leituras viram um array JSON em <prefixo>/<gw>/batch,
+//   publicado quando o lote enche ou o mais antigo passa de MQTT_BATCH_FLUSH_MS.
+// - Tudo que fala com o broker (connect, espera do PUBACK, keepalive) roda na
+//   mqtt_task no core 0; o loop() só enfileira sob mqtt_lock e nunca espera a rede
+//   (no pior caso espera a cópia de um lote, alguns µs).
+// - Backpressure: com o broker lento/fora a fila enche e descarta o mais antigo.
+//   O registro é copiado antes de publicar e só sai da fila após o sucesso
+//   (pop_through ignora o que o push já descartou nesse meio).
+
+#if USE_MQTT
+static bool mqtt_ensure_connected() {
+  if (WiFi.status() != WL_CONNECTED) return false;
+  if (mqtt.connected()) return true;
+  if (mqtt_last_try != 0 && millis() - mqtt_last_try < MqttCfg::kReconnectMs) return false;
+  mqtt_last_try = millis();
+
+  char client_id[24];
+  snprintf(client_id, sizeof(client_id), "lora-gw-%u", GwCfg::kGatewayId);
+  mqtt.begin(MqttCfg::Host(), MqttCfg::kPort, mqtt_net);
+  mqtt.setCleanSession(false);
+  mqtt.setKeepAlive(MqttCfg::kKeepAliveS);
+  mqtt.setTimeout(MqttCfg::kTimeoutMs);
+
+  bool ok = strlen(MqttCfg::User()) > 0
+      ? mqtt.connect(client_id, MqttCfg::User(), MqttCfg::Pass())
+      : mqtt.connect(client_id);
+  Serial.printf("[MQTT] Conexão a %s:%u → %s\n", MqttCfg::Host(), MqttCfg::kPort,
+                ok ? "OK" : "falhou");
+  if (ok) mqtt_reconnects++;
+  return ok;
+}
+
+static bool mqtt_publish_one() {
+  static char payload[IoCfg::kJsonMax];
+  size_t len;
+  node_addr_t node;
+  uint32_t seq;
+  xSemaphoreTake(mqtt_lock, portMAX_DELAY);
+  const auto& slot = mqtt_queue.peek();
+  memcpy(payload, slot.json, slot.len);
+  len  = slot.len;
+  node = slot.node;
+  seq  = mqtt_queue.head_seq();
+  xSemaphoreGive(mqtt_lock);
+
+  char topic[64];
+  snprintf(topic, sizeof(topic), "%s/%u/node/%u", MqttCfg::Prefix(), GwCfg::kGatewayId, node);
+  if (!mqtt.publish(topic, payload, len, false, MqttCfg::kQos)) return false;
+  xSemaphoreTake(mqtt_lock, portMAX_DELAY);
+  mqtt_queue.pop_through(seq + 1);
+  xSemaphoreGive(mqtt_lock);
+  mqtt_published++;
+  return true;
+}
+
+static bool mqtt_publish_batch(size_t n) {
+  static char payload[MqttCfg::kBufferSize - 32];   // resto: cabeçalho e tópico
+  size_t len = 0;
+  uint32_t seq;
+  payload[len++] = '[';
+  xSemaphoreTake(mqtt_lock, portMAX_DELAY);
+  if (n > mqtt_queue.size()) n = mqtt_queue.size();
+  for (size_t i = 0; i < n; i++) {
+    const auto& slot = mqtt_queue.peek(i);
+    if (i > 0) payload[len++] = ',';
+    memcpy(payload + len, slot.json, slot.len);
+    len += slot.len;
+  }
+  seq = mqtt_queue.head_seq();
+  xSemaphoreGive(mqtt_lock);
+  payload[len++] = ']';
+
+  char topic[48];
+  snprintf(topic, sizeof(topic), "%s/%u/batch", MqttCfg::Prefix(), GwCfg::kGatewayId);
+  if (!mqtt.publish(topic, payload, len, false, MqttCfg::kQos)) return false;
+  xSemaphoreTake(mqtt_lock, portMAX_DELAY);
+  mqtt_queue.pop_through(seq + n);
+  xSemaphoreGive(mqtt_lock);
+  mqtt_published += n;
+  mqtt_batches++;
+  return true;
+}
+
+/**
+ * @brief Um ciclo da tarefa MQTT: conexão, keepalive e drenagem com orçamento.
+ */
+static void mqtt_cycle() {
+  mqtt_up = mqtt_ensure_connected();
+  if (!mqtt_up) return;
+  mqtt.loop();
+
+  for (uint8_t i = 0; i < MqttCfg::kBudget; i++) {
+    xSemaphoreTake(mqtt_lock, portMAX_DELAY);
+    size_t   queued = mqtt_queue.size();
+    uint32_t oldest = queued ? mqtt_queue.peek().enqueued_ms : 0;
+    xSemaphoreGive(mqtt_lock);
+    if (queued == 0) break;
+
+    bool ok;
+    if (MqttCfg::kBatchMax == 1) {
+      ok = mqtt_publish_one();
+    } else {
+      bool full  = queued >= MqttCfg::kBatchMax;
+      bool stale = millis() - oldest >= MqttCfg::kBatchFlushMs;
+      if (!full && !stale) break;
+      ok = mqtt_publish_batch(MqttCfg::kBatchMax);
+    }
+    if (!ok) {
+      mqtt_failures++;
+      break;   // tenta de novo no próximo ciclo; RX segue enfileirando
+    }
+  }
+  mqtt_up = mqtt.connected();
+}
+
+static void mqtt_task(void*) {
+  for (;;) {
+    mqtt_cycle();
+    vTaskDelay(pdMS_TO_TICKS(MqttCfg::kTaskPeriodMs));
+  }
+}
+
+/**
+ * @brief Cria a tarefa MQTT; a conexão ao broker acontece nela, não no setup().
+ */
+void setup_mqtt() {
+  mqtt_lock = xSemaphoreCreateMutexStatic(&mqtt_lock_buf);
+  xTaskCreatePinnedToCore(mqtt_task, "mqtt", MqttCfg::kTaskStack, nullptr, 1,
+                          &mqtt_task_handle, MqttCfg::kTaskCore);
+  Serial.printf("✓ MQTT: tarefa no core %d, broker %s:%u\n", MqttCfg::kTaskCore,
+                MqttCfg::Host(), MqttCfg::kPort);
+}
+#endif
+
+// =====================================================
+// Downlink (gateway -> nó)
+// =====================================================
+//
+// - O bridge enfileira com @DL <nó> <cmd> <prio> <ttl_s> [payload hex]; a fila é
+//   fixa (DL_NODES nós x DL_DEPTH comandos) e responde @DL OK|ERR na hora.
+// - Uplink direto do nó (v2 ou resumo) com comando pendente: o de maior
+//   prioridade sai DOWNLINK_RX_DELAY_MS após o fim do uplink (referência: IRQ
+//   de RX), na janela que o client abre logo depois de transmitir. O gateway
+//   fica surdo durante esse TX.
+// - Sem confirmação do nó: o comando sai uma vez e deixa a fila (@DL SENT). Se o
+//   uplink foi atendido tarde demais para a janela, o comando espera o próximo.
+// - Lote da fila em flash do nó (sender == origem, hops 0) também abre janela.
+// - DL_ACK_UPLINKS: sem comando pendente, responde DL_CMD_ACK com o checksum do
+//   uplink; para o nó, qualquer downlink na janela confirma a entrega.
+// - DL_CMD_TIME_SYNC é corrigido no envio para valer ao fim do quadro.
+
+#if ENABLE_DOWNLINK
+static const char* dl_result_name(DlResult r) {
+  switch (r) {
+    case DL_QUEUED:   return "queued";
+    case DL_REPLACED: return "replaced";
+    case DL_EVICTED:  return "evicted";
+    case DL_FULL:     return "full";
+    case DL_NO_SLOT:  return "no-slot";
+    case DL_TOO_LONG: return "too-long";
+  }
+  return "?";
+}
+
+static int hex_nibble(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static void downlink_command(const char* args) {
+  unsigned node = NODE_ADDR_NONE, prio = 0;
+  int cmd = 0;
+  unsigned long ttl_s = 0;
+  char hex[2 * DL_MAX_PAYLOAD + 2] = "";
+  int n = sscanf(args, "%u %i %u %lu %17s", &node, &cmd, &prio, &ttl_s, hex);
+  if (n < 4 || node >= NODE_ADDR_NONE || cmd < 1 || cmd > 255 || prio > 255) {
+    Serial.printf("@DL ERR %u syntax\n", node);
+    return;
+  }
+
+  uint8_t payload[DL_MAX_PAYLOAD];
+  size_t hex_len = strlen(hex);
+  if (hex_len % 2 != 0 || hex_len / 2 > DL_MAX_PAYLOAD) {
+    Serial.printf("@DL ERR %u payload\n", node);
+    return;
+  }
+  for (size_t i = 0; i < hex_len / 2; i++) {
+    int hi = hex_nibble(hex[2 * i]), lo = hex_nibble(hex[2 * i + 1]);
+    if (hi < 0 || lo < 0) {
+      Serial.printf("@DL ERR %u payload\n", node);
+      return;
+    }
+    payload[i] = (uint8_t)(hi << 4 | lo);
+  }
+
+  if (ttl_s > 0x7FFFFFFFUL / 1000) ttl_s = 0x7FFFFFFFUL / 1000;
+  uint32_t ttl_ms = ttl_s ? ttl_s * 1000UL : DownlinkCfg::kTtlMs;
+  DlResult r = dl_queue.push(node, (uint8_t)cmd, (uint8_t)prio, ttl_ms,
+                             payload, (uint8_t)(hex_len / 2), millis());
+  if (r == DL_QUEUED || r == DL_REPLACED || r == DL_EVICTED)
+    Serial.printf("@DL OK %u %s %u\n", node, dl_result_name(r), (unsigned)dl_queue.pending(node));
+  else
+    Serial.printf("@DL ERR %u %s\n", node, dl_result_name(r));
+}
+
+static void downlink_expire(uint32_t now) {
+  dl_queue.expire(now, [](node_addr_t node, const decltype(dl_queue)::Entry& e) {
+    Serial.printf("@DL EXPIRED %u %u\n", node, e.cmd);
+  });
+}
+
+static void downlink_after_uplink(const RxPacket& pkt, uint32_t rx_end_us) {
+  if (pkt.len < 3) return;
+  const RelayBatchHeader* batch;
+  const RelayRecord* records;
+  if (pkt.data[0] == MSG_TYPE_RELAY_BATCH) {
+    if (decode_relay_batch(pkt.data, pkt.len, batch, records) != DECODE_OK ||
+        !is_backlog_batch(batch, records)) return;
+  } else if (pkt.data[0] != MSG_TYPE_SENSOR_DATA_V2 && pkt.data[0] != MSG_TYPE_SENSOR_SUMMARY) {
+    return;
+  }
+  if (!verify_checksum(pkt.data, pkt.len)) return;
+  node_addr_t node;
+  memcpy(&node, pkt.data + 1, sizeof(node));   // node_addr ou sender: mesmo offset
+  if (dl_queue.pending(node) == 0 && !DownlinkCfg::kAckUplinks) return;
+
+  downlink_expire(millis());
+  const auto* e = dl_queue.head(node, millis());
+  if (!e && !DownlinkCfg::kAckUplinks) return;
+
+  uint32_t target = rx_end_us + DownlinkCfg::kRxDelayMs * 1000UL;
+  int32_t left = (int32_t)(target - micros());
+  if (left < 0) {
+    if (!e) { dl_acks_late++; return; }
+    dl_late++;
+    Serial.printf("@DL LATE %u %ld\n", node, (long)-left);
+    return;   // fica para o próximo uplink
+  }
+
+  uint8_t payload[DL_MAX_PAYLOAD];
+  uint8_t len = e ? e->len : 1;
+  if (e) memcpy(payload, e->payload, e->len);
+  else   payload[0] = pkt.data[pkt.len - 1];   // DL_CMD_ACK: checksum do uplink
+  uint8_t frame[downlink_size(DL_MAX_PAYLOAD)];
+  size_t n = downlink_size(len);
+  if (e && e->cmd == DL_CMD_TIME_SYNC && e->len == 6) {
+    // Época enviada pelo bridge + tempo na fila + tempo de ar = válida ao fim do quadro
+    uint32_t sec;
+    uint16_t ms;
+    memcpy(&sec, payload, 4);
+    memcpy(&ms, payload + 4, 2);
+    uint64_t t = (uint64_t)sec * 1000 + ms + (millis() - e->queued_ms) + left / 1000 +
+                 radio.getTimeOnAir(n) / 1000;
+    sec = (uint32_t)(t / 1000);
+    ms  = (uint16_t)(t % 1000);
+    memcpy(payload, &sec, 4);
+    memcpy(payload + 4, &ms, 2);
+  }
+  uint8_t cmd = e ? e->cmd : DL_CMD_ACK;
+  uint8_t seq = dl_queue.seq(node);   // o ACK não avança o seq (o nó não o deduplica)
+  encode_downlink(node, seq, cmd, payload, len, frame);
+
+  if (left > 3000) delay((left - 2000) / 1000);   // espera grossa cedendo a CPU
+  while ((int32_t)(target - micros()) > 0) {}
+  uint32_t lag = micros() - target;
+  int state = radio.transmit(frame, n);
+  rx_flag = false;            // TX_DONE também levanta o DIO1
+  int rx_state = radio_listen();
+
+  if (lag > dl_lag_max) dl_lag_max = lag;
+  if (state == RADIOLIB_ERR_NONE && !e) {
+    dl_acks++;
+  } else if (state == RADIOLIB_ERR_NONE) {
+    dl_queue.pop(node);
+    Serial.printf("@DL SENT %u %u %u %lu\n", node, seq, cmd, (unsigned long)lag);
+  } else {
+    dl_failed++;
+    Serial.printf("@DL FAIL %u %d\n", node, state);
+    if (radio_health.fault(state)) { radio_set_down(state, "dl-tx"); return; }
+  }
+  if (rx_state != RADIOLIB_ERR_NONE && radio_health.fault(rx_state)) radio_set_down(rx_state, "rx");
+}
+#endif
+
+// =====================================================
+// Controle do enlace serial (bridge <-> gateway)
+// =====================================================
+//
+// Linhas iniciadas por '@' são de controle e nunca são JSON:
+//   bridge  -> @HELLO            gateway -> @LINK base=.. max=.. cur=.. cdc=.. rates=..
+//   bridge  -> @BAUD <taxa>      gateway -> @BAUD OK <taxa> (e troca de taxa) | @BAUD ERR <taxa>
+//   bridge  -> @PING <token>     gateway -> @PONG <token>   (confirma e mantém a taxa)
+//   bridge  -> @BENCH <n>        gateway -> n registros de teste + @BENCH END <n> <us>
+//   bridge  -> @FC <janela> [buffer|aggregate|drop]
+//                                gateway -> @FC OK <janela> <política> <slots> <próximo seq> | @FC ERR
+//                                depois, cada registro: @REC <seq> <json>   (0 desliga: JSON puro)
+//   bridge  -> @ACK <seq>        confirma (cumulativo) os registros até seq
+//   bridge  -> @CREDIT <janela>  nova janela (0 = bridge parado; registros ficam retidos)
+//   bridge  -> @DL <nó> <cmd> <prio> <ttl_s> [hex]
+//                                gateway -> @DL OK <nó> <resultado> <pendentes> | @DL ERR <nó> <motivo>
+//                                depois:    @DL SENT <nó> <seq> <cmd> <atraso_us> | @DL LATE | @DL EXPIRED
+// Sem @PING por LINK_KEEPALIVE_MS (ou linhas corrompidas demais) o gateway volta
+// para SERIAL_BAUD e avisa com @BAUD FALLBACK; o bridge renegocia em seguida.
+// Controle de fluxo: no máximo <janela> registros em voo (enviados sem @ACK). Sem
+// @ACK/@CREDIT por FC_ACK_TIMEOUT_MS com registros em voo, o gateway avisa com
+// @FC TIMEOUT <seq> e reenvia desde seq (go-back-N; o bridge ignora repetidos).
+// Após FC_TIMEOUT_MAX timeouts seguidos (bridge antigo ou reiniciado sem --fc) ou
+// num @BAUD FALLBACK, o gateway desliga o FC, despeja os retidos como JSON puro e
+// avisa com @FC OFF <motivo>; o bridge com --fc renegocia com um novo @FC.
+// Com a fila cheia vale a política (FC_POLICY ou a pedida no @FC).
+
+static bool link_rate_supported(uint32_t baud) {
+  if (baud > IoCfg::kBaudMax) return false;
+  for (uint32_t r : IoCfg::kBaudRates)
+    if (r == baud) return true;
+  return baud == IoCfg::kSerialBaud;
+}
+
+static void link_set_baud(uint32_t baud) {
+  Serial.flush();
+#if !ARDUINO_USB_CDC_ON_BOOT
+  Serial.updateBaudRate(baud);
+#endif
+  link_baud = baud;
+}
+
+static void fc_disable(const char* reason);
+
+static void link_fallback(const char* reason) {
+  link_set_baud(IoCfg::kSerialBaud);
+  link_pending = false;
+  link_garbage = 0;
+  link_fallbacks++;
+  Serial.printf("@BAUD FALLBACK %lu %s\n", (unsigned long)link_baud, reason);
+  fc_disable("link-fallback");   // o bridge do outro lado pode nem ser o mesmo
+}
+
+static void link_bench(uint32_t n) {
+  char line[192];
+  uint32_t t0 = micros();
+  for (uint32_t i = 0; i < n; i++) {
+    int len = snprintf(line, sizeof(line),
+        "{\"bench\":true,\"node_id\":\"%lu\",\"timestamp\":\"1970-01-01T00:00:00\",\"seq\":%lu,"
+        "\"sensors\":{\"temperature_celsius\":25.40,\"humidity_percent\":58.30,"
+        "\"luminosity_lux\":null,\"presence_detected\":false,\"power_on\":true}}",
+        (unsigned long)(i % 1000), (unsigned long)i);
+    Serial.write((const uint8_t*)line, len);
+    Serial.write('\n');
+  }
+  Serial.printf("@BENCH END %lu %lu\n", (unsigned long)n, (unsigned long)(micros() - t0));
+}
+
+static void fc_write(const CreditQueue<FlowCfg::kSlots, IoCfg::kJsonMax>::Entry& e, bool framed) {
+  if (framed) Serial.printf("@REC %lu ", (unsigned long)e.seq);
+  else Serial.print(IoCfg::Prefix());
+  Serial.write((const uint8_t*)e.json, e.len);
+  Serial.println();
+}
+
+// Volta ao JSON puro: esvazia a fila sem esperar confirmação
+static void fc_flush_plain() {
+  fc_queue.rewind();
+  while (const auto* e = fc_queue.next(255)) fc_write(*e, false);
+  fc_queue.ack(fc_queue.next_seq() - 1);
+}
+
+static void fc_disable(const char* reason) {
+  if (!fc_enabled) return;
+  fc_enabled = false;
+  fc_window  = 0;
+  fc_timeout_run = 0;
+  fc_disables++;
+  fc_flush_plain();
+  Serial.printf("@FC OFF %s\n", reason);
+}
+
+static void fc_command(unsigned long window, const char* policy) {
+  FcPolicy p = fc_policy;
+  if (window > 255 || (policy[0] && !fc_policy_parse(policy, p))) {
+    Serial.println("@FC ERR");
+    return;
+  }
+  fc_policy  = p;
+  fc_window  = (uint8_t)window;
+  fc_enabled = window > 0;
+  fc_timeout_run = 0;
+  fc_queue.rewind();              // nova sessão: reenvia o que estava em voo
+  fc_last_ack = fc_last_tick = millis();
+  if (!fc_enabled) fc_flush_plain();
+  Serial.printf("@FC OK %u %s %u %lu\n", fc_window, fc_policy_name(fc_policy),
+                (unsigned)fc_queue.capacity(), (unsigned long)fc_queue.next_seq());
+}
+
+/**
+ * @brief Envia os registros que os créditos permitem; mede paradas e utilização.
+ */
+void fc_service() {
+  if (!fc_enabled) return;
+  uint32_t now = millis();
+  fc_util_acc   += (uint64_t)fc_queue.inflight() * (now - fc_last_tick);
+  fc_window_acc += (uint64_t)fc_window * (now - fc_last_tick);
+  fc_last_tick = now;
+
+  if (fc_queue.inflight() > 0 && now - fc_last_ack > FlowCfg::kAckTimeoutMs) {
+    fc_timeouts++;
+    if (FlowCfg::kTimeoutMax > 0 && ++fc_timeout_run >= FlowCfg::kTimeoutMax) {
+      fc_disable("ack-timeout");
+      return;
+    }
+    fc_queue.rewind();
+    fc_last_ack = now;
+    Serial.printf("@FC TIMEOUT %lu\n", (unsigned long)fc_queue.next_seq());
+  }
+
+  while (const auto* e = fc_queue.next(fc_window)) {
+    if (fc_queue.inflight() == 1) fc_last_ack = now;   // prazo do ACK conta do primeiro em voo
+    fc_write(*e, true);
+  }
+
+  bool stalled = fc_queue.pending() > 0;   // há registros e nenhum crédito
+  if (stalled && !fc_stalled) {
+    fc_stalls++;
+    fc_stall_start = now;
+  } else if (!stalled && fc_stalled) {
+    uint32_t d = now - fc_stall_start;
+    fc_stall_ms += d;
+    if (d > fc_stall_max) fc_stall_max = d;
+  }
+  fc_stalled = stalled;
+}
+
+static void link_handle(const char* line) {
+  if (strcmp(line, "@HELLO") == 0) {
+    Serial.printf("@LINK base=%lu max=%lu cur=%lu cdc=%d rates=",
+                  (unsigned long)IoCfg::kSerialBaud, (unsigned long)IoCfg::kBaudMax,
+                  (unsigned long)link_baud, IoCfg::kUsbCdc ? 1 : 0);
+    bool first = true;
+    for (uint32_t r : IoCfg::kBaudRates) {
+      if (r > IoCfg::kBaudMax) continue;
+      Serial.printf(first ? "%lu" : ",%lu", (unsigned long)r);
+      first = false;
+    }
+    Serial.println();
+    return;
+  }
+
+  unsigned long arg = 0;
+  char token[24];
+  char policy[12] = "";
+  if (sscanf(line, "@FC %lu %11s", &arg, policy) >= 1) {
+    fc_command(arg, policy);
+    return;
+  }
+  if (sscanf(line, "@ACK %lu", &arg) == 1) {
+    fc_queue.ack(arg);
+    fc_last_ack = millis();
+    fc_timeout_run = 0;
+    return;
+  }
+  if (sscanf(line, "@CREDIT %lu", &arg) == 1) {
+    fc_window = arg > 255 ? 255 : (uint8_t)arg;
+    fc_last_ack = millis();
+    fc_timeout_run = 0;
+    return;
+  }
+  if (sscanf(line, "@BAUD %lu", &arg) == 1) {
+    if (!link_rate_supported(arg)) {
+      Serial.printf("@BAUD ERR %lu\n", arg);
+      return;
+    }
+    Serial.printf("@BAUD OK %lu\n", arg);
+    link_set_baud(arg);
+    link_pending  = arg != IoCfg::kSerialBaud;
+    link_deadline = millis() + IoCfg::kLinkConfirmMs;
+    link_last_ping = millis();
+    return;
+  }
+  if (sscanf(line, "@PING %23s", token) == 1) {
+    link_pending = false;
+    link_garbage = 0;
+    link_last_ping = millis();
+    Serial.printf("@PONG %s\n", token);
+    return;
+  }
+  if (sscanf(line, "@BENCH %lu", &arg) == 1) {
+    link_bench(arg);
+    return;
+  }
+#if ENABLE_DOWNLINK
+  if (strncmp(line, "@DL ", 4) == 0) {
+    downlink_command(line + 4);
+    return;
+  }
+#endif
+  link_garbage++;
+}
+
+/**
+ * @brief Lê comandos do bridge sem bloquear e aplica os prazos do enlace.
+ */
+void link_poll() {
+  static char line[96];
+  static size_t len = 0;
+  static bool bad = false;
+
+  while (Serial.available() > 0) {
+    int c = Serial.read();
+    if (c < 0) break;
+    if (c == '\r') continue;
+    if (c == '\n') {
+      line[len] = '\0';
+      if (bad || (len > 0 && line[0] != '@')) link_garbage++;
+      else if (len > 0) link_handle(line);
+      len = 0;
+      bad = false;
+      continue;
+    }
+    if (c < 0x20 || c > 0x7E || len + 1 >= sizeof(line)) { bad = true; continue; }
+    line[len++] = (char)c;
+  }
+
+  if (link_baud == IoCfg::kSerialBaud) { link_garbage = 0; return; }
+
+  uint32_t now = millis();
+  if (link_pending && (int32_t)(now - link_deadline) > 0)           link_fallback("confirm-timeout");
+  else if (!link_pending && now - link_last_ping > IoCfg::kLinkKeepaliveMs) link_fallback("keepalive-timeout");
+  else if (link_garbage >= IoCfg::kLinkGarbageMax)                  link_fallback("framing-errors");
+}
+
 // =====================================================
 // Utilitários e estatísticas
 // =====================================================
@@ -298,12 +1476,162 @@ void print_hex(const uint8_t* data, size_t len) {
   }
 }
 
+// Relatório da janela de ruído (humano + linha @NOISE para o bridge) e reinício.
+static void print_noise(uint32_t now) {
+  uint32_t window = now - noise_window_start;
+  if (noise.samples() == 0) {
+    Serial.println("  Ruído: sem amostras");
+  } else {
+    int   floor_dbm = noise.percentile(NoiseCfg::kFloorPct);
+    int   p50 = noise.percentile(50);
+    int   p90 = noise.percentile(90);
+    float busy = noise.occupancy(floor_dbm, NoiseCfg::kBusyMarginDb);
+    float own  = noise.own_airtime(window);
+    float ext  = busy > own ? busy - own : 0.0f;
+    Serial.printf("  Ruído %.1f MHz: piso %d dBm (p%u)  p50 %d  p90 %d  máx %d  (%lu amostras)\n",
+                  LinkCfg::kFreqMHz, floor_dbm, NoiseCfg::kFloorPct, p50, p90, noise.max_dbm(),
+                  noise.samples());
+    Serial.printf("  Ocupação: %.1f%% (própria %.1f%%, externa ~%.1f%%)\n",
+                  busy * 100, own * 100, ext * 100);
+
+    // Histograma compacto em faixas de 4 dB (só faixas com amostras)
+    Serial.print("  Ruído hist:");
+    for (size_t b = 0; b < noise.bins(); b += 4) {
+      uint32_t c = 0;
+      for (size_t i = b; i < b + 4 && i < noise.bins(); i++) c += noise.count(i);
+      if (c) Serial.printf(" %d:%lu", noise.min_dbm() + (int)b, c);
+    }
+    Serial.println();
+    Serial.printf("@NOISE freq=%.1f floor=%d p50=%d p90=%d max=%d busy=%.4f own=%.4f n=%lu window_s=%lu\n",
+                  LinkCfg::kFreqMHz, floor_dbm, p50, p90, noise.max_dbm(), busy, own,
+                  noise.samples(), window / 1000);
+  }
+  noise.reset();
+  noise_window_start = now;
+}
+
 void print_stats() {
+#if NO_HEAP_AFTER_BOOT
+  heap_guard.exempt_enter();   // fora do caminho de pacotes: printf longo aloca
+#endif
   Serial.printf("\n--- Gateway Stats ---\n");
   Serial.printf("  Packets OK:       %lu\n", packets_ok);
   Serial.printf("  Invalid length:   %lu\n", packets_invalid);
   Serial.printf("  Bad checksum:     %lu\n", packets_checksum);
-  Serial.printf("  RSSI last: %.1f dBm  SNR last: %.1f dB\n",
-                radio.getRSSI(), radio.getSNR());
+  Serial.printf("  Unknown type:     %lu\n", packets_unknown);
+  Serial.printf("  Legacy frames:    %lu\n", packets_legacy);
+  Serial.printf("  Relay batches:    %lu\n", relay_batches);
+  Serial.printf("  Duplicates:       %lu\n", readings_dup);
+  Serial.printf("  CRC errors:       %lu\n", packets_crc);
+  Serial.printf("  RX pool: %u/%u (pico %u, esgotado %lu)\n",
+                (unsigned)rx_pool.in_use(), (unsigned)rx_pool.capacity(),
+                (unsigned)rx_pool.high_water(), rx_pool.exhausted());
+  uint32_t now = millis();
+  Serial.printf("  Rádio: %s  quedas %lu  recuperações %lu  fora do ar %lus (maior %lus, atual %lus)\n",
+                radio_health.is_up() ? "UP" : "DOWN",
+                radio_health.outages(), radio_health.recoveries(),
+                radio_health.downtime_ms(now) / 1000, radio_health.longest_ms() / 1000,
+                radio_health.current_outage_ms(now) / 1000);
+  Serial.printf("  Rádio: init falhos %lu  erros %lu (último %d)  silêncios %lu  sem RX há %lus\n",
+                radio_health.failed_inits(), radio_health.faults(), radio_health.last_error(),
+                radio_health.silences(), radio_health.since_rx_ms(now) / 1000);
+  Serial.printf("  SPI: %s %lu Hz  transações %lu  bytes %lu  erros %lu\n",
+                radio_hal.dma() ? "DMA" : "SPIClass", (unsigned long)radio_hal.clock_hz(),
+                radio_hal.transactions(), radio_hal.bytes(), radio_hal.errors());
+  if (rx_readouts > 0)
+    Serial.printf("  Leitura pós-RX: %lu us (SPI %lu us, %lu transações) média de %lu pacotes\n",
+                  rx_readout_us / rx_readouts, rx_readout_spi / rx_readouts,
+                  rx_readout_xfers / rx_readouts, rx_readouts);
+#if ENABLE_DOWNLINK
+  Serial.printf("  Downlink: pendentes %u/%u (%u nós)  enfileirados %lu  enviados %lu  atrasados %lu  "
+                "expirados %lu  deslocados %lu  recusados %lu  falhas %lu  maior atraso %lu us\n",
+                (unsigned)dl_queue.size(), (unsigned)dl_queue.capacity(), (unsigned)dl_queue.nodes(),
+                dl_queue.queued(), dl_queue.sent(), dl_late, dl_queue.expired(), dl_queue.evicted(),
+                dl_queue.rejected(), dl_failed, dl_lag_max);
+  if (DownlinkCfg::kAckUplinks)
+    Serial.printf("  ACK de uplink: enviados %lu  atrasados %lu\n", dl_acks, dl_acks_late);
+#endif
+#if LOW_POWER_RX
+  print_low_power(now);
+#endif
+  print_noise(now);
+  Serial.printf("  Serial: %lu baud (fallbacks %lu)\n", (unsigned long)link_baud, link_fallbacks);
+  if (fc_enabled || fc_queue.sent() > 0) {
+    uint32_t stall_ms = fc_stall_ms + (fc_stalled ? now - fc_stall_start : 0);
+    float util = fc_window_acc ? (float)fc_util_acc / fc_window_acc : 0.0f;
+    Serial.printf("  Fluxo: %s janela %u  em voo %u  pendentes %u/%u (pico %u)  política %s\n",
+                  fc_enabled ? "ativo" : "desligado", fc_window, (unsigned)fc_queue.inflight(),
+                  (unsigned)fc_queue.pending(), (unsigned)fc_queue.capacity(),
+                  (unsigned)fc_queue.high_water(), fc_policy_name(fc_policy));
+    Serial.printf("  Fluxo: enviados %lu  confirmados %lu  reenviados %lu  timeouts %lu  "
+                  "descartados %lu  agregados %lu  desligamentos %lu\n",
+                  fc_queue.sent(), fc_queue.acked(), fc_queue.retransmits(), fc_timeouts,
+                  fc_queue.dropped(), fc_queue.merged(), fc_disables);
+    Serial.printf("  Fluxo: paradas %lu  parado %lu ms (maior %lu ms)  utilização da janela %.0f%%\n",
+                  fc_stalls, stall_ms, fc_stall_max, util * 100);
+    Serial.printf("@FC STATS sent=%lu acked=%lu retx=%lu timeouts=%lu dropped=%lu merged=%lu "
+                  "stalls=%lu stall_ms=%lu util=%.3f\n",
+                  fc_queue.sent(), fc_queue.acked(), fc_queue.retransmits(), fc_timeouts,
+                  fc_queue.dropped(), fc_queue.merged(), fc_stalls, stall_ms, util);
+  }
+#if USE_MQTT
+  Serial.printf("  MQTT: %s  pub %lu  lotes %lu  falhas %lu  reconexões %lu\n",
+                mqtt_up ? "conectado" : "desconectado",
+                mqtt_published, mqtt_batches, mqtt_failures, mqtt_reconnects);
+  Serial.printf("  MQTT fila: %u/%u (pico %u, descartados %lu)\n",
+                (unsigned)mqtt_queue.size(), (unsigned)mqtt_queue.capacity(),
+                (unsigned)mqtt_queue.high_water(), mqtt_queue.dropped());
+#endif
+  Serial.printf("  Clients: %u/%u (evictions %lu)\n",
+                (unsigned)clients.size(), (unsigned)clients.capacity(), clients.evictions());
+  size_t listed = 0;
+  for (size_t i = 0; i < clients.capacity() && listed < GwCfg::kStatsClients; ++i) {
+    const ClientEntry& c = clients.at(i);
+    if (!c.used) continue;
+    Serial.printf("    node %5u  pkts %lu  relayed %lu  backlog %lu  lost %lu  dup %lu  rssi %.1f  age %lus\n",
+                  c.addr, c.packets, c.relayed, c.backlog, c.lost, c.duplicates, c.last_rssi,
+                  (millis() - c.last_seen_ms) / 1000);
+    listed++;
+  }
+  if (radio_health.is_up()) {
+    Serial.printf("  RSSI last: %.1f dBm  SNR last: %.1f dB\n",
+                  radio.getRSSI(), radio.getSNR());
+    if (LowPowerCfg::kEnabled) radio_listen();
+  }
+#if NO_HEAP_AFTER_BOOT
+  print_heap();
+  heap_guard.exempt_leave();
+#endif
   Serial.println("----------------------");
 }
+
+#if NO_HEAP_AFTER_BOOT
+static void heap_arm() {
+  // Aquece o que o newlib aloca na primeira conversão de float (dtoa/_reent)
+  char warm[24];
+  snprintf(warm, sizeof(warm), "%.2f", 1.5f);
+  heap_guard.arm(heap_task(), HeapCfg::kWarmupLoops, HeapCfg::kTrap);
+  Serial.printf("Heap vigiado após o boot (%s, aquecimento %lu loops)\n",
+                HeapCfg::kTrap ? "trap" : "contagem", (unsigned long)HeapCfg::kWarmupLoops);
+}
+
+static void print_heap() {
+  Serial.printf("  Heap: livre %lu  mínimo %lu  maior bloco %lu\n",
+                (unsigned long)ESP.getFreeHeap(), (unsigned long)ESP.getMinFreeHeap(),
+                (unsigned long)ESP.getMaxAllocHeap());
+  Serial.printf("  Heap no loop(): %lu alocações (%lu bytes)  aquecimento %lu  isentas %lu  "
+                "pontos %u/%u\n",
+                heap_guard.allocs(), heap_guard.bytes(), heap_guard.warmup(), heap_guard.exempt(),
+                (unsigned)heap_guard.sites(), (unsigned)heap_guard.capacity());
+  Serial.printf("@HEAP allocs=%lu bytes=%lu warmup=%lu exempt=%lu overflow=%lu loops=%lu "
+                "free=%lu min_free=%lu largest=%lu\n",
+                heap_guard.allocs(), heap_guard.bytes(), heap_guard.warmup(), heap_guard.exempt(),
+                heap_guard.overflow(), heap_guard.loops(), (unsigned long)ESP.getFreeHeap(),
+                (unsigned long)ESP.getMinFreeHeap(), (unsigned long)ESP.getMaxAllocHeap());
+  for (size_t i = 0; i < heap_guard.sites(); ++i) {
+    const auto& st = heap_guard.site(i);
+    Serial.printf("@HEAP SITE 0x%08lx n=%lu bytes=%lu max=%lu\n",
+                  (unsigned long)st.pc, st.count, st.bytes, st.max);
+  }
+}
+#endif
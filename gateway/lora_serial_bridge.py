@@ -1,6 +1,10 @@
 import json
 import time
+import struct
 import sys
+from collections import deque
+from typing import Callable, Dict, List, Optional, Tuple
+
 import serial
 import requests
 
@@ -10,34 +14,529 @@ import requests
 SERIAL_PORT = "/dev/ttyUSB0"   # Linux: /dev/ttyUSBx ou /dev/ttyACMx | Windows: COMx
 BAUD = 115200
 SERVER_URL = "http://127.0.0.1:8000/data"   # Endpoint do server.py
+SERVER_FRAMES_URL = SERVER_URL + "/frames"   # ingestão binária (quadros v2 crus)
+
+# Saída binária enquadrada (fake_gateway.py --format binary)
+SYNC = b"\xA5\x5A"
+FRAME_MAX_PAYLOAD = 64      # maior payload aceito num registro binário
+FRAME_BATCH_MAX = 100       # quadros por POST em /data/frames
+FRAME_FLUSH_S = 0.2         # tempo máximo que um quadro espera pelo lote
+
+# Negociação de taxa (ver "Controle do enlace serial" no firmware do gateway)
+BASE_BAUD = 115200          # taxa em que todo enlace começa (SERIAL_BAUD do gateway)
+MAX_BAUD = 2000000          # teto pedido pelo bridge (--max-baud)
+KEEPALIVE_S = 5.0           # intervalo de @PING (gateway desiste após LINK_KEEPALIVE_MS)
+GATEWAY_KEEPALIVE_S = 15.0  # LINK_KEEPALIVE_MS do gateway
+ERR_WINDOW = 50             # linhas consideradas na taxa de erro
+ERR_MAX = 5                 # linhas corrompidas na janela antes de reduzir a taxa
+
+# Controle de fluxo por créditos (--fc)
+FC_WINDOW = 8               # registros em voo concedidos ao gateway
+FC_RETRY_S = 2.0            # espera entre tentativas de POST com o servidor fora
+FC_REPORT_S = 60.0          # intervalo do relatório [FC]
 
 # =====================================================
 # FUNÇÕES AUXILIARES
 # =====================================================
 
-def post_to_server(msg: dict):
+def post_to_server(msg: dict, verbose: bool = True) -> bool:
     """Envia o JSON recebido do gateway para o servidor via HTTP POST."""
     try:
         r = requests.post(SERVER_URL, json=msg, timeout=5)
         r.raise_for_status()
-        print(f"[OK] Enviado para o servidor ({r.status_code})")
+        if verbose:
+            print(f"[OK] Enviado para o servidor ({r.status_code})")
+        return True
+    except requests.RequestException as e:
+        print(f"[ERRO HTTP] {e}")
+        return False
+
+
+def post_frames(frames: List[bytes], verbose: bool = True) -> bool:
+    """Envia quadros v2 crus em lote para /data/frames (um POST, uma transação)."""
+    try:
+        r = requests.post(SERVER_FRAMES_URL, data=b"".join(frames), timeout=5,
+                          headers={"Content-Type": "application/octet-stream"})
+        r.raise_for_status()
+        if verbose:
+            print(f"[OK] {len(frames)} quadro(s) enviados ({r.status_code})")
+        return True
     except requests.RequestException as e:
         print(f"[ERRO HTTP] {e}")
-        
-def run_from_stdin():
-    print("[Bridge] Lendo do STDIN (pipe). Enviando para:", SERVER_URL)
-    for line in sys.stdin.buffer:
-        line = line.strip()
+        return False
+
+# =====================================================
+# SAÍDA BINÁRIA ENQUADRADA
+# =====================================================
+# Registro binário: A5 5A | len (1 B) | payload (len B) | XOR de len e payload.
+# Só é reconhecido no início de um registro (após '\n' ou após outro quadro), então
+# linhas de texto e JSON continuam convivendo no mesmo fluxo. O payload é o quadro
+# LoRa v2 de 16 bytes, repassado sem conversão ao servidor.
+
+class StreamParser:
+    """Separa o fluxo do gateway em linhas de texto e quadros binários."""
+
+    def __init__(self, max_line: int = 4096):
+        self.buf = bytearray()
+        self.max_line = max_line
+
+    def feed(self, data: bytes):
+        """Devolve eventos ("line", bytes) | ("frame", payload) | ("bad_frame", None)."""
+        self.buf += data
+        out = []
+        buf = self.buf
+        pos = 0
+        while pos < len(buf):
+            if buf[pos] == SYNC[0] and (pos + 1 >= len(buf) or buf[pos + 1] == SYNC[1]):
+                if pos + 3 > len(buf):
+                    break                                   # cabeçalho incompleto
+                n = buf[pos + 2]
+                if n == 0 or n > FRAME_MAX_PAYLOAD:
+                    out.append(("bad_frame", None))
+                    pos += 2                                # comprimento absurdo: ressincroniza
+                    continue
+                end = pos + 3 + n + 1
+                if end > len(buf):
+                    break                                   # quadro incompleto
+                check = n
+                for b in buf[pos + 3:end - 1]:
+                    check ^= b
+                if check == buf[end - 1]:
+                    out.append(("frame", bytes(buf[pos + 3:end - 1])))
+                else:
+                    out.append(("bad_frame", None))
+                pos = end
+                continue
+            nl = buf.find(b"\n", pos)
+            if nl < 0:
+                if len(buf) - pos > self.max_line:          # lixo sem fim de linha
+                    out.append(("line", bytes(buf[pos:])))
+                    pos = len(buf)
+                break
+            out.append(("line", bytes(buf[pos:nl]).strip()))
+            pos = nl + 1
+        del buf[:pos]
+        return out
+
+
+class BridgeStats:
+    """Contadores do bridge, com relatório periódico de taxas (--stats)."""
+
+    FIELDS = ("bytes", "json", "frames", "bad_frames", "malformed", "debug",
+              "posted", "post_errors")
+
+    def __init__(self):
+        self.c = dict.fromkeys(self.FIELDS, 0)
+        self.last = dict(self.c)
+        self.t0 = self.t_last = time.monotonic()
+
+    def add(self, key: str, n: int = 1):
+        self.c[key] += n
+
+    def report(self, final: bool = False):
+        now = time.monotonic()
+        dt = max((now - self.t0) if final else (now - self.t_last), 1e-9)
+        base = dict.fromkeys(self.FIELDS, 0) if final else self.last
+        d = {k: self.c[k] - base[k] for k in self.FIELDS}
+        print(f"[Stats]{' total' if final else ''} {(d['json'] + d['frames']) / dt:.0f} leituras/s "
+              f"({d['bytes'] / dt / 1024:.1f} KB/s) | json {self.c['json']} quadros {self.c['frames']} "
+              f"| corrompidos: json {self.c['malformed']} quadros {self.c['bad_frames']} "
+              f"| debug {self.c['debug']} | enviados {self.c['posted']} erros {self.c['post_errors']}",
+              flush=True)
+        self.last = dict(self.c)
+        self.t_last = now
+
+
+def run_from_stdin(dry_run: bool = False, stats_every: float = 0.0):
+    """Lê a saída do gateway (ou de fake_gateway.py) por pipe.
+
+    --dry-run não envia nada ao servidor: mede só a vazão de parsing do bridge.
+    --stats N imprime taxas a cada N segundos e suprime o log por linha.
+    """
+    verbose = stats_every <= 0
+    print("[Bridge] Lendo do STDIN (pipe). Enviando para:",
+          "nenhum (dry-run)" if dry_run else SERVER_URL, flush=True)
+    parser = StreamParser()
+    stats = BridgeStats()
+    frames: List[bytes] = []
+    frames_since = 0.0
+    next_stats = time.monotonic() + stats_every
+    src = sys.stdin.buffer
+
+    def flush_frames():
+        if frames and not dry_run:
+            ok = post_frames(frames, verbose)
+            stats.add("posted" if ok else "post_errors", len(frames))
+        frames.clear()
+
+    try:
+        while True:
+            chunk = src.read1(65536)
+            if not chunk:
+                break
+            stats.add("bytes", len(chunk))
+            for kind, data in parser.feed(chunk):
+                if kind == "frame":
+                    stats.add("frames")
+                    if not frames:
+                        frames_since = time.monotonic()
+                    frames.append(data)
+                    continue
+                if kind == "bad_frame":
+                    stats.add("bad_frames")
+                    continue
+                line = data
+                if not line or line.startswith(b"@"):
+                    continue
+                try:
+                    payload = json.loads(line.decode("utf-8"))
+                except (UnicodeDecodeError, json.JSONDecodeError):
+                    if line.startswith(b"{") or is_garbled(line):
+                        stats.add("malformed")
+                        if verbose:
+                            print("[ERRO] Linha corrompida:", line[:80])
+                    else:
+                        stats.add("debug")
+                        if verbose:
+                            print("[DBG]", line.decode(errors="ignore"))
+                    continue
+                stats.add("json")
+                if not dry_run:
+                    ok = post_to_server(payload, verbose)
+                    stats.add("posted" if ok else "post_errors")
+                    if verbose:
+                        print("[Bridge] Linha JSON encaminhada.")
+            now = time.monotonic()
+            if frames and (len(frames) >= FRAME_BATCH_MAX or now - frames_since >= FRAME_FLUSH_S):
+                flush_frames()
+            if stats_every > 0 and now >= next_stats:
+                stats.report()
+                next_stats = now + stats_every
+    except KeyboardInterrupt:
+        pass
+    flush_frames()
+    stats.report(final=True)
+
+# =====================================================
+# NEGOCIAÇÃO DE TAXA
+# =====================================================
+
+def send_ctrl(ser: serial.Serial, cmd: str):
+    ser.write((cmd + "\n").encode("ascii"))
+    ser.flush()
+
+
+def read_ctrl(ser: serial.Serial, prefix: str, timeout: float,
+              on_line: Optional[Callable[[bytes], None]] = None) -> Optional[str]:
+    """Lê até achar uma linha de controle com o prefixo; as demais vão para on_line."""
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        line = ser.readline().strip()
         if not line:
             continue
+        if line.startswith(prefix.encode()):
+            return line.decode("ascii", errors="replace")
+        if on_line is not None:
+            on_line(line)
+    return None
+
+
+def ping_ok(ser: serial.Serial, count: int = 3, timeout: float = 0.5) -> bool:
+    for i in range(count):
+        token = f"{int(time.monotonic() * 1000) % 100000}-{i}"
+        send_ctrl(ser, f"@PING {token}")
+        reply = read_ctrl(ser, "@PONG", timeout)
+        if reply != f"@PONG {token}":
+            return False
+    return True
+
+
+def parse_link(reply: str) -> Dict[str, str]:
+    return dict(kv.split("=", 1) for kv in reply.split()[1:] if "=" in kv)
+
+
+def negotiate(ser: serial.Serial, max_baud: int = MAX_BAUD,
+              on_line: Optional[Callable[[bytes], None]] = None) -> Tuple[int, List[int]]:
+    """Sobe o enlace para a maior taxa que passar no teste de eco.
+
+    Devolve (taxa final, taxas anunciadas pelo gateway em ordem decrescente).
+    """
+    ser.baudrate = BASE_BAUD
+    reply = None
+    for _ in range(3):
+        send_ctrl(ser, "@HELLO")
+        reply = read_ctrl(ser, "@LINK", 1.5, on_line)
+        if reply:
+            break
+    if not reply:
+        print(f"[Link] Gateway sem negociação (firmware antigo?) — mantendo {BASE_BAUD}")
+        return BASE_BAUD, []
+
+    info = parse_link(reply)
+    rates = sorted((int(r) for r in info.get("rates", "").split(",") if r), reverse=True)
+    if info.get("cdc") == "1":
+        print("[Link] Gateway em USB CDC nativo — taxa serial não se aplica")
+        return BASE_BAUD, []
+
+    for rate in [r for r in rates if BASE_BAUD < r <= max_baud]:
+        send_ctrl(ser, f"@BAUD {rate}")
+        ack = read_ctrl(ser, "@BAUD", 1.5, on_line)
+        if ack != f"@BAUD OK {rate}":
+            continue
+        ser.baudrate = rate
+        time.sleep(0.05)
+        ser.reset_input_buffer()
+        if ping_ok(ser):
+            print(f"[Link] Enlace em {rate} baud")
+            return rate, rates
+        # Gateway volta sozinho para a taxa base após LINK_CONFIRM_MS
+        print(f"[Link] {rate} baud falhou no teste de eco, tentando taxa menor")
+        ser.baudrate = BASE_BAUD
+        read_ctrl(ser, "@BAUD FALLBACK", 3.0, on_line)
+
+    print(f"[Link] Enlace em {BASE_BAUD} baud")
+    return BASE_BAUD, rates
+
+
+class LinkMonitor:
+    """Mantém o enlace negociado: envia keepalive e detecta erros de enquadramento."""
+
+    def __init__(self, ser: serial.Serial, max_baud: int, on_line: Callable[[bytes], None]):
+        self.ser = ser
+        self.max_baud = max_baud
+        self.on_line = on_line
+        self.baud = BASE_BAUD
+        self.rates: List[int] = []
+        self.window = deque(maxlen=ERR_WINDOW)
+        self.last_ping = time.monotonic()
+        self.downgrades = 0
+
+    def start(self):
+        self.baud, self.rates = negotiate(self.ser, self.max_baud, self.on_line)
+        self.window.clear()
+        self.last_ping = time.monotonic()
+
+    def record(self, garbled: bool):
+        self.window.append(garbled)
+        if self.baud != BASE_BAUD and sum(self.window) >= ERR_MAX:
+            self.downgrade()
+
+    def tick(self):
+        if self.baud == BASE_BAUD:
+            return
+        if time.monotonic() - self.last_ping >= KEEPALIVE_S:
+            send_ctrl(self.ser, f"@PING ka{int(time.monotonic())}")
+            self.last_ping = time.monotonic()
+
+    def downgrade(self):
+        """Erros demais: volta à taxa base, espera o gateway desistir e renegocia abaixo."""
+        lower = [r for r in self.rates if r < self.baud]
+        self.max_baud = max(lower) if lower else BASE_BAUD
+        self.downgrades += 1
+        print(f"[Link] Erros de enquadramento em {self.baud} baud — renegociando até {self.max_baud}")
+        self.ser.baudrate = BASE_BAUD
+        read_ctrl(self.ser, "@BAUD FALLBACK", GATEWAY_KEEPALIVE_S + 2.0, self.on_line)
+        self.start()
+
+
+# =====================================================
+# DOWNLINK
+# =====================================================
+
+DL_CMDS = {"interval": 0x01, "time": 0x02, "power": 0x03}
+
+
+def parse_downlink(spec: str) -> str:
+    """Converte NÓ:CMD[:VALOR[:PRIO[:TTL_S]]] no comando @DL do gateway.
+
+    CMD: interval (VALOR em ms), time (época atual; o gateway desconta a espera
+    na fila), power (VALOR em dBm) ou um código numérico com VALOR em hex cru.
+    """
+    parts = spec.split(":")
+    if len(parts) < 2:
+        raise ValueError(f"downlink inválido: {spec!r}")
+    node = int(parts[0], 0)
+    name = parts[1].lower()
+    value = parts[2] if len(parts) > 2 else ""
+    prio = int(parts[3], 0) if len(parts) > 3 else 0
+    ttl_s = int(parts[4], 0) if len(parts) > 4 else 0
+
+    if name == "interval":
+        payload = struct.pack("<I", int(value, 0))
+    elif name == "time":
+        now = time.time()
+        payload = struct.pack("<IH", int(now), int(now * 1000) % 1000)
+    elif name == "power":
+        payload = struct.pack("<b", int(value, 0))
+    else:
+        payload = bytes.fromhex(value)
+    cmd = DL_CMDS.get(name) or int(name, 0)
+    return f"@DL {node} {cmd} {prio} {ttl_s} {payload.hex().upper()}".rstrip()
+
+
+def send_downlinks(ser: serial.Serial, specs: List[str],
+                   on_line: Optional[Callable[[bytes], None]] = None):
+    """Enfileira os downlinks no gateway; a entrega ocorre no próximo uplink de cada nó."""
+    for spec in specs:
         try:
-            payload = json.loads(line.decode("utf-8", errors="ignore"))
-            post_to_server(payload)
-            print("[Bridge] Linha JSON encaminhada.")
-        except json.JSONDecodeError:
-            print("[DBG] ignorado (não é JSON):", line[:80])
-            
-def run_from_serial(port: str, baud: int = 115200):
+            cmd = parse_downlink(spec)
+        except ValueError as e:
+            print(f"[ERRO] {e}")
+            continue
+        send_ctrl(ser, cmd)
+        # SENT/LATE/EXPIRED de outros comandos podem chegar antes da resposta
+        reply = read_ctrl(ser, "@DL ", 1.5, on_line)
+        while reply and not reply.startswith(("@DL OK", "@DL ERR")):
+            print("[Link]", reply)
+            reply = read_ctrl(ser, "@DL ", 1.5, on_line)
+        print(f"[Downlink] {cmd} -> {reply or 'sem resposta'}")
+
+
+# =====================================================
+# CONTROLE DE FLUXO
+# =====================================================
+
+class FlowControl:
+    """Lado do bridge do controle de fluxo: concede créditos e confirma entregas.
+
+    Só aceita o próximo seq esperado; fora de ordem é descartado e o gateway
+    reenvia após FC_ACK_TIMEOUT_MS (go-back-N). Cada registro é confirmado com
+    @ACK depois do POST. Se o POST falhar, o bridge zera os créditos (@CREDIT 0)
+    e tenta de novo a cada FC_RETRY_S; o gateway retém os registros e aplica a
+    política de descarte dele se a fila encher.
+    """
+
+    def __init__(self, ser: serial.Serial, window: int = FC_WINDOW, policy: str = "",
+                 post: Callable[[dict], bool] = post_to_server):
+        self.ser = ser
+        self.window = window
+        self.policy = policy
+        self.post = post
+        self.expected: Optional[int] = None
+        self.backlog: deque = deque()        # (seq, payload) recebidos e ainda não entregues
+        self.last_acked = 0
+        self.stalled = False
+        self.stall_t0 = 0.0
+        self.retry_at = 0.0
+        self.c = dict.fromkeys(("records", "dups", "gaps", "malformed", "posted",
+                                "post_errors", "stalls"), 0)
+        self.stall_s = 0.0
+        self.util_sum = 0.0
+        self.t_report = time.monotonic()
+
+    def start(self, on_line: Optional[Callable[[bytes], None]] = None) -> bool:
+        send_ctrl(self.ser, f"@FC {self.window} {self.policy}".rstrip())
+        reply = read_ctrl(self.ser, "@FC ", 1.5, on_line)
+        while reply and not reply.startswith(("@FC OK", "@FC ERR")):
+            print("[Link]", reply)
+            reply = read_ctrl(self.ser, "@FC ", 1.5, on_line)
+        if not reply or not reply.startswith("@FC OK"):
+            print(f"[FC] Gateway sem controle de fluxo ({reply or 'sem resposta'}) — JSON direto")
+            return False
+        parts = reply.split()
+        self.expected = int(parts[5])
+        self.last_acked = self.expected - 1
+        print(f"[FC] Ativo: janela {parts[2]}, política {parts[3]}, fila do gateway {parts[4]}, "
+              f"próximo seq {self.expected}")
+        return True
+
+    def restart(self, on_line: Optional[Callable[[bytes], None]] = None) -> bool:
+        """Gateway desligou o FC (@FC OFF) e já despejou os retidos como JSON puro."""
+        self.backlog.clear()
+        if self.stalled:
+            self.stalled = False
+            self.stall_s += time.monotonic() - self.stall_t0
+        self.expected = None
+        print("[FC] Gateway desligou o controle de fluxo — renegociando")
+        return self.start(on_line)
+
+    def on_record(self, line: bytes):
+        """Trata uma linha @REC <seq> <json>."""
+        try:
+            _, seq_txt, body = line.split(b" ", 2)
+            seq = int(seq_txt)
+        except ValueError:
+            self.c["malformed"] += 1
+            return
+        if self.expected is None:
+            self.expected = seq
+        if seq < self.expected:
+            self.c["dups"] += 1                  # reenvio de algo já recebido
+            if seq <= self.last_acked:
+                send_ctrl(self.ser, f"@ACK {self.last_acked}")
+            return
+        if seq > self.expected:
+            self.c["gaps"] += 1                  # perdeu um registro: espera o reenvio
+            return
+        try:
+            payload = json.loads(body.decode("utf-8"))
+        except (UnicodeDecodeError, json.JSONDecodeError):
+            self.c["malformed"] += 1             # corrompido: não confirma, vem de novo
+            return
+        self.c["records"] += 1
+        self.expected += 1
+        self.backlog.append((seq, payload))
+        self.util_sum += min(len(self.backlog) / self.window, 1.0)
+        self.pump()
+
+    def pump(self):
+        now = time.monotonic()
+        if self.stalled and now < self.retry_at:
+            return
+        acked = None
+        while self.backlog:
+            seq, payload = self.backlog[0]
+            if not self.post(payload):
+                self.c["post_errors"] += 1
+                self.retry_at = now + FC_RETRY_S
+                if not self.stalled:
+                    self.stalled = True
+                    self.stall_t0 = now
+                    self.c["stalls"] += 1
+                    print(f"[FC] Servidor indisponível — créditos zerados ({len(self.backlog)} retidos)")
+                send_ctrl(self.ser, "@CREDIT 0")   # também renova o prazo do ACK no gateway
+                break
+            self.backlog.popleft()
+            self.c["posted"] += 1
+            acked = seq
+        if acked is not None:
+            self.last_acked = acked
+            send_ctrl(self.ser, f"@ACK {acked}")
+        if self.stalled and not self.backlog:
+            self.stalled = False
+            self.stall_s += time.monotonic() - self.stall_t0
+            send_ctrl(self.ser, f"@CREDIT {self.window}")
+            print(f"[FC] Servidor de volta — janela {self.window} restaurada")
+
+    def tick(self):
+        if self.stalled:
+            self.pump()
+        if time.monotonic() - self.t_report >= FC_REPORT_S:
+            self.report()
+
+    def report(self):
+        stall_s = self.stall_s + (time.monotonic() - self.stall_t0 if self.stalled else 0.0)
+        util = self.util_sum / self.c["records"] if self.c["records"] else 0.0
+        c = self.c
+        print(f"[FC] registros {c['records']} entregues {c['posted']} retidos {len(self.backlog)} "
+              f"| repetidos {c['dups']} lacunas {c['gaps']} corrompidos {c['malformed']} "
+              f"| paradas {c['stalls']} ({stall_s:.1f}s) erros HTTP {c['post_errors']} "
+              f"| ocupação média da janela {util * 100:.0f}%", flush=True)
+        self.t_report = time.monotonic()
+
+
+def is_garbled(line: bytes) -> bool:
+    """Linha com bytes de controle ou UTF-8 inválido indica taxa acima do que o enlace suporta."""
+    try:
+        text = line.decode("utf-8")
+    except UnicodeDecodeError:
+        return True
+    return any(ord(c) < 0x20 and c != "\t" for c in text)
+
+
+def run_from_serial(port: str, baud: int = 115200, negotiate_link: bool = True,
+                    max_baud: int = MAX_BAUD, downlinks: Optional[List[str]] = None,
+                    fc_window: int = 0, fc_policy: str = ""):
     print(f"[Bridge] Lendo Serial {port} @ {baud}")
     print("[Bridge] Enviando dados para:", SERVER_URL)
     print("-------------------------------------------")
@@ -48,24 +547,69 @@ def run_from_serial(port: str, baud: int = 115200):
         print("[DICA] Use --stdin para ler via pipe.")
         return
 
+    fc: Optional[FlowControl] = None
+    fc_off = False
+
+    def handle_line(line: bytes) -> bool:
+        """Processa uma linha do gateway; devolve True se ela parecia corrompida."""
+        nonlocal fc_off
+        if line.startswith(b"@REC ") and fc is not None:
+            fc.on_record(line)
+            return False
+        if line.startswith(b"@FC OFF"):
+            fc_off = True
+        if line.startswith(b"@"):
+            print("[Link]", line.decode(errors="ignore"))
+            return False
+        try:
+            payload = json.loads(line.decode("utf-8", errors="ignore"))
+            post_to_server(payload)
+            print("[Bridge] Linha JSON encaminhada.")
+            return False
+        except json.JSONDecodeError:
+            txt = line.decode(errors="ignore")
+            if not txt.startswith("{"):
+                print("[DBG]", txt)
+                return is_garbled(line)
+            print("[ERRO] JSON malformado:", txt[:120])
+            return True
+
+    link = LinkMonitor(ser, max_baud, handle_line)
+    if negotiate_link and baud == BASE_BAUD:
+        link.start()
+    if downlinks:
+        send_downlinks(ser, downlinks, handle_line)
+    if fc_window > 0:
+        candidate = FlowControl(ser, fc_window, fc_policy)
+        if candidate.start(handle_line):
+            fc = candidate
+    else:
+        # O gateway pode ter ficado com o FC de uma sessão anterior (bridge
+        # reiniciado sem --fc): @FC 0 faz ele despejar os retidos como JSON puro.
+        send_ctrl(ser, "@FC 0")
+        reply = read_ctrl(ser, "@FC ", 1.5, handle_line)
+        while reply and not reply.startswith(("@FC OK", "@FC ERR")):
+            print("[Link]", reply)
+            reply = read_ctrl(ser, "@FC ", 1.5, handle_line)
+
     try:
         while True:
+            link.tick()
+            if fc_off:
+                fc_off = False
+                if fc is not None and not fc.restart(handle_line):
+                    fc = None
+            if fc is not None:
+                fc.tick()
             line = ser.readline().strip()
             if not line:
                 continue
-            try:
-                payload = json.loads(line.decode("utf-8", errors="ignore"))
-                post_to_server(payload)
-                print("[Bridge] Linha JSON encaminhada.")
-            except json.JSONDecodeError:
-                txt = line.decode(errors="ignore")
-                if not txt.startswith("{"):
-                    print("[DBG]", txt)
-                else:
-                    print("[ERRO] JSON malformado:", txt[:120])
+            link.record(handle_line(line))
     except KeyboardInterrupt:
         pass
     finally:
+        if fc is not None:
+            fc.report()
         try: ser.close()
         except: pass
 
@@ -116,9 +660,19 @@ def main():
 if __name__ == "__main__":
     # Uso:
     #   python lora_serial_bridge.py --stdin
+    #   python lora_serial_bridge.py --stdin --dry-run --stats 5     (teste de vazão)
     #   python lora_serial_bridge.py --port /dev/ttyACM0 --baud 115200
+    #   python lora_serial_bridge.py --port /dev/ttyUSB0 --max-baud 921600
+    #   python lora_serial_bridge.py --port /dev/ttyUSB0 --no-negotiate
+    #   python lora_serial_bridge.py --port /dev/ttyUSB0 --dl 3:interval:60000 --dl 3:time::5
+    #   python lora_serial_bridge.py --port /dev/ttyUSB0 --fc 8:drop    (créditos + política do gateway)
     if "--stdin" in sys.argv:
-        run_from_stdin()
+        stats_every = 0.0
+        if "--stats" in sys.argv:
+            i = sys.argv.index("--stats")
+            if i + 1 < len(sys.argv):
+                stats_every = float(sys.argv[i+1])
+        run_from_stdin("--dry-run" in sys.argv, stats_every)
     else:
         port = "/dev/ttyUSB0"
         if "--port" in sys.argv:
@@ -130,4 +684,17 @@ if __name__ == "__main__":
             i = sys.argv.index("--baud")
             if i + 1 < len(sys.argv):
                 baud = int(sys.argv[i+1])
-        run_from_serial(port, baud)
+        max_baud = MAX_BAUD
+        if "--max-baud" in sys.argv:
+            i = sys.argv.index("--max-baud")
+            if i + 1 < len(sys.argv):
+                max_baud = int(sys.argv[i+1])
+        downlinks = [sys.argv[i+1] for i, a in enumerate(sys.argv[:-1]) if a == "--dl"]
+        fc_window, fc_policy = 0, ""
+        if "--fc" in sys.argv:
+            i = sys.argv.index("--fc")
+            if i + 1 < len(sys.argv):
+                w, _, fc_policy = sys.argv[i+1].partition(":")
+                fc_window = int(w)
+        run_from_serial(port, baud, "--no-negotiate" not in sys.argv, max_baud, downlinks,
+                        fc_window, fc_policy)
@@ -0,0 +1,97 @@
+import json
+import sys
+import time
+
+import serial
+
+from lora_serial_bridge import BASE_BAUD, MAX_BAUD, negotiate, send_ctrl, is_garbled
+
+# =====================================================
+# TESTE DE VAZÃO DO ENLACE SERIAL GATEWAY -> BRIDGE
+# =====================================================
+# Negocia a taxa como o bridge faz, pede ao gateway rajadas de registros de teste
+# (@BENCH n) e mede registros/s e bytes/s efetivamente recebidos no host.
+#
+# Uso:
+#   python serial_throughput.py --port /dev/ttyUSB0 [--max-baud 2000000]
+#                               [--records 5000] [--rounds 5] [--no-negotiate]
+
+
+def run_round(ser: serial.Serial, records: int) -> dict:
+    ser.reset_input_buffer()
+    send_ctrl(ser, f"@BENCH {records}")
+    ok = garbled = nbytes = 0
+    gw_us = None
+    t0 = None
+    deadline = time.monotonic() + 10.0 + records / 200.0
+    while time.monotonic() < deadline:
+        line = ser.readline()
+        if not line:
+            continue
+        if t0 is None:
+            t0 = time.monotonic()
+        nbytes += len(line)
+        line = line.strip()
+        if line.startswith(b"@BENCH END"):
+            gw_us = int(line.split()[3])
+            break
+        try:
+            if json.loads(line.decode("utf-8")).get("bench"):
+                ok += 1
+                continue
+        except (UnicodeDecodeError, json.JSONDecodeError, AttributeError):
+            pass
+        if is_garbled(line) or line.startswith(b"{"):
+            garbled += 1
+    elapsed = time.monotonic() - t0 if t0 else 0.0
+    return {
+        "received": ok,
+        "lost": records - ok,
+        "garbled": garbled,
+        "seconds": elapsed,
+        "records_s": ok / elapsed if elapsed else 0.0,
+        "bytes_s": nbytes / elapsed if elapsed else 0.0,
+        "gateway_s": gw_us / 1e6 if gw_us is not None else None,
+    }
+
+
+def main():
+    args = sys.argv[1:]
+
+    def opt(name, default):
+        if name in args:
+            i = args.index(name)
+            if i + 1 < len(args):
+                return type(default)(args[i + 1])
+        return default
+
+    port = opt("--port", "/dev/ttyUSB0")
+    max_baud = opt("--max-baud", MAX_BAUD)
+    records = opt("--records", 5000)
+    rounds = opt("--rounds", 5)
+
+    ser = serial.Serial(port, BASE_BAUD, timeout=0.5)
+    baud = BASE_BAUD
+    if "--no-negotiate" not in args:
+        baud, _ = negotiate(ser, max_baud)
+    print(f"[Bench] {port} @ {baud} baud, {rounds} rodada(s) de {records} registros")
+
+    totals = {"received": 0, "lost": 0, "garbled": 0, "seconds": 0.0}
+    for r in range(1, rounds + 1):
+        res = run_round(ser, records)
+        for k in totals:
+            totals[k] += res[k]
+        gw = f"{res['gateway_s']:.2f}s" if res["gateway_s"] is not None else "?"
+        print(f"  #{r}: {res['received']}/{records} ok, {res['garbled']} corrompidos, "
+              f"{res['records_s']:.0f} reg/s, {res['bytes_s'] / 1024:.1f} KB/s (gateway {gw})")
+        if baud != BASE_BAUD:
+            send_ctrl(ser, "@PING bench")   # mantém o enlace negociado
+
+    rate = totals["received"] / totals["seconds"] if totals["seconds"] else 0.0
+    print(f"[Bench] Sustentado: {rate:.0f} reg/s, perdidos {totals['lost']}, "
+          f"corrompidos {totals['garbled']}")
+    ser.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,307 @@
+"""Open-loop load generator for server.py with virtual nodes and latency percentiles.
+
+Requests are scheduled at fixed times derived from the target rate, independently of
+how fast the server answers. Latency is measured from each request's *scheduled* time,
+so when the server falls behind, the queueing delay shows up in the percentiles instead
+of silently lowering the offered load (no coordinated omission).
+
+Ingest paths:
+  json    one reading per POST /data (what the gateway bridge does)
+  batch   a JSON array of --batch readings per POST /data
+  binary  --batch 16-byte v2 sensor frames per POST /data/frames
+
+Usage:
+    python load_generator.py --nodes 200 --rate 500 --duration 60 --mode batch --batch 50
+    python load_generator.py --rate 2000 --mode binary --batch 100 --json-report out.json
+"""
+import argparse
+import http.client
+import json
+import math
+import queue
+import random
+import struct
+import threading
+import time
+from datetime import datetime, timezone
+from typing import Dict, List, Optional, Tuple
+from urllib.parse import urlparse
+
+FRAME_V2 = struct.Struct('<BHIhHHBB')          # SensorDataMessageV2 without the checksum
+MSG_TYPE_SENSOR_DATA_V2 = 0x04
+
+
+class Histogram:
+    """HDR-style log-linear histogram of microsecond values.
+
+    Values below `sub_buckets` are exact; above that, each power-of-two range is split
+    into sub_buckets/2 linear buckets, so the relative error stays below 2/sub_buckets
+    (< 1% with the default 256) up to `max_us`, in constant memory. Histograms from
+    different threads merge by addition.
+    """
+    def __init__(self, max_us: int = 3_600_000_000, sub_buckets: int = 256):
+        self.sub_bits = int(math.log2(sub_buckets))
+        self.sub_buckets = 1 << self.sub_bits
+        self.max_us = max_us
+        magnitudes = max(1, max_us.bit_length() - self.sub_bits + 1)
+        self.counts = [0] * (magnitudes * self.sub_buckets)
+        self.total = 0
+        self.sum = 0
+        self.max = 0
+
+    def _index(self, v: int) -> int:
+        if v < self.sub_buckets:
+            return v
+        shift = v.bit_length() - self.sub_bits
+        return shift * self.sub_buckets + (v >> shift)
+
+    def _value(self, idx: int) -> int:
+        shift, sub = divmod(idx, self.sub_buckets)
+        # Upper edge of the bucket, so percentiles never under-report.
+        return ((sub + 1) << shift) - 1 if shift else sub
+
+    def record(self, us: float) -> None:
+        v = min(max(int(us), 0), self.max_us)
+        self.counts[self._index(v)] += 1
+        self.total += 1
+        self.sum += v
+        self.max = max(self.max, v)
+
+    def merge(self, other: 'Histogram') -> None:
+        for i, c in enumerate(other.counts):
+            if c:
+                self.counts[i] += c
+        self.total += other.total
+        self.sum += other.sum
+        self.max = max(self.max, other.max)
+
+    def percentile(self, p: float) -> int:
+        if not self.total:
+            return 0
+        target = max(1, math.ceil(p / 100.0 * self.total))
+        seen = 0
+        for i, c in enumerate(self.counts):
+            seen += c
+            if seen >= target:
+                return min(self._value(i), self.max)
+        return self.max
+
+    def mean(self) -> float:
+        return self.sum / self.total if self.total else 0.0
+
+
+class VirtualNode:
+    """A sensor node with slowly drifting readings and an 8-bit frame counter."""
+    def __init__(self, index: int, rnd: random.Random):
+        self.addr = index + 1
+        self.node_id = f'lg-{index:05d}'
+        self.seq = rnd.randrange(256)
+        self.temp = rnd.uniform(20.0, 30.0)
+        self.hum = rnd.uniform(35.0, 60.0)
+        self.rnd = rnd
+
+    def step(self) -> None:
+        self.seq = (self.seq + 1) & 0xFF
+        self.temp = min(max(self.temp + self.rnd.gauss(0, 0.05), -40.0), 85.0)
+        self.hum = min(max(self.hum + self.rnd.gauss(0, 0.1), 0.0), 100.0)
+
+    def reading(self) -> Dict:
+        self.step()
+        return {
+            'node_id': self.node_id,
+            'timestamp': datetime.now(timezone.utc).isoformat().replace('+00:00', 'Z'),
+            'seq': self.seq,
+            'sensors': {
+                'temperature_celsius': round(self.temp, 2),
+                'humidity_percent': round(self.hum, 2),
+                'luminosity_lux': round(self.rnd.uniform(5.0, 50.0), 2),
+                'presence_detected': self.rnd.random() < 0.05,
+                'power_on': True,
+            },
+        }
+
+    def frame(self) -> bytes:
+        self.step()
+        body = FRAME_V2.pack(MSG_TYPE_SENSOR_DATA_V2, self.addr, int(time.monotonic() * 1000) & 0xFFFFFFFF,
+                             int(self.temp * 100), int(self.hum * 100), self.rnd.randrange(20, 300),
+                             self.rnd.randrange(60, 101), self.seq)
+        check = 0
+        for b in body:
+            check ^= b
+        return body + bytes([check])
+
+
+class Result:
+    def __init__(self):
+        self.hist = Histogram()
+        self.ok = 0
+        self.records = 0
+        self.errors: Dict[str, int] = {}
+
+    def error(self, kind: str) -> None:
+        self.errors[kind] = self.errors.get(kind, 0) + 1
+
+
+def build_request(mode: str, nodes: List[VirtualNode], cursor: int, batch: int) -> Tuple[str, bytes, str, int]:
+    picked = [nodes[(cursor + i) % len(nodes)] for i in range(batch)]
+    if mode == 'binary':
+        return '/data/frames', b''.join(n.frame() for n in picked), 'application/octet-stream', batch
+    if mode == 'batch':
+        return '/data', json.dumps([n.reading() for n in picked]).encode(), 'application/json', batch
+    return '/data', json.dumps(picked[0].reading()).encode(), 'application/json', 1
+
+
+def worker(url, jobs: 'queue.Queue', result: Result, timeout: float, stop: threading.Event) -> None:
+    conn: Optional[http.client.HTTPConnection] = None
+    while True:
+        job = jobs.get()
+        if job is None:
+            break
+        scheduled, path, body, ctype, records, measure = job
+        if stop.is_set():
+            continue
+        try:
+            if conn is None:
+                conn = http.client.HTTPConnection(url.hostname, url.port or 80, timeout=timeout)
+            conn.request('POST', path, body, {'Content-Type': ctype})
+            resp = conn.getresponse()
+            resp.read()
+            error = None if 200 <= resp.status < 300 else f'http_{resp.status}'
+        except TimeoutError:
+            error = 'timeout'
+            conn = None
+        except (ConnectionError, http.client.HTTPException, OSError) as exc:
+            error = type(exc).__name__
+            if conn is not None:
+                conn.close()
+            conn = None
+        if not measure:
+            continue                                   # warmup request
+        if error is None:
+            result.ok += 1
+            result.records += records
+        else:
+            result.error(error)
+        # Measured from the scheduled send time, so queueing counts.
+        result.hist.record((time.perf_counter() - scheduled) * 1e6)
+
+
+def fmt_ms(us: int) -> str:
+    return f'{us / 1000.0:.2f}'
+
+
+def main() -> None:
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument('--url', default='http://localhost:8000')
+    p.add_argument('--nodes', type=int, default=100, help='virtual nodes')
+    p.add_argument('--rate', type=float, default=100.0, help='target readings per second (aggregate)')
+    p.add_argument('--duration', type=float, default=30.0, help='seconds of measured load')
+    p.add_argument('--warmup', type=float, default=2.0, help='seconds of load before measuring')
+    p.add_argument('--mode', choices=('json', 'batch', 'binary'), default='json')
+    p.add_argument('--batch', type=int, default=20, help='readings per request in batch/binary mode')
+    p.add_argument('--connections', type=int, default=32, help='max requests in flight')
+    p.add_argument('--timeout', type=float, default=10.0)
+    p.add_argument('--seed', type=int, default=1)
+    p.add_argument('--json-report', help='also write the summary to this file')
+    args = p.parse_args()
+
+    url = urlparse(args.url)
+    batch = 1 if args.mode == 'json' else max(1, args.batch)
+    req_rate = args.rate / batch
+    rnd = random.Random(args.seed)
+    nodes = [VirtualNode(i, rnd) for i in range(args.nodes)]
+
+    jobs: 'queue.Queue' = queue.Queue()
+    stop = threading.Event()
+    measured = Result()
+    results = [Result() for _ in range(args.connections)]
+    threads = []
+    for r in results:
+        t = threading.Thread(target=worker, args=(url, jobs, r, args.timeout, stop), daemon=True)
+        t.start()
+        threads.append(t)
+
+    print(f'{args.mode} load: {args.rate:g} readings/s from {args.nodes} node(s) '
+          f'({req_rate:.1f} req/s x {batch}), {args.connections} connection(s), '
+          f'{args.warmup:g}s warmup + {args.duration:g}s')
+
+    t0 = time.perf_counter()
+    t_measure = t0 + args.warmup
+    t_end = t_measure + args.duration
+    sent = cursor = 0
+    max_lag = 0.0
+    next_report = t_measure + 5.0
+    while True:
+        scheduled = t0 + sent / req_rate
+        if scheduled >= t_end:
+            break
+        now = time.perf_counter()
+        if scheduled > now:
+            time.sleep(scheduled - now)
+        else:
+            max_lag = max(max_lag, now - scheduled)
+        path, body, ctype, records = build_request(args.mode, nodes, cursor, batch)
+        cursor += batch
+        jobs.put((scheduled, path, body, ctype, records, scheduled >= t_measure))
+        sent += 1
+        if time.perf_counter() >= next_report:
+            done = sum(r.ok + sum(r.errors.values()) for r in results)
+            print(f'  t={time.perf_counter() - t_measure:5.1f}s queued={jobs.qsize()} done={done}')
+            next_report += 5.0
+
+    # Requests still queued at the end are part of the measured load: wait for them.
+    for _ in threads:
+        jobs.put(None)
+    drain_deadline = time.perf_counter() + args.timeout + 5.0
+    for t in threads:
+        t.join(max(0.0, drain_deadline - time.perf_counter()))
+    stop.set()
+    elapsed = max(time.perf_counter() - t_measure, 1e-9)
+
+    for r in results:
+        measured.hist.merge(r.hist)
+        measured.ok += r.ok
+        measured.records += r.records
+        for k, v in r.errors.items():
+            measured.errors[k] = measured.errors.get(k, 0) + v
+
+    h = measured.hist
+    offered = int(args.duration * req_rate)
+    summary = {
+        'mode': args.mode,
+        'nodes': args.nodes,
+        'batch': batch,
+        'target_readings_s': args.rate,
+        'achieved_readings_s': measured.records / elapsed,
+        'achieved_requests_s': measured.ok / elapsed,
+        'requests_offered': offered,
+        'requests_ok': measured.ok,
+        'requests_unfinished': max(0, offered - measured.ok - sum(measured.errors.values())),
+        'errors': measured.errors,
+        'max_scheduler_lag_ms': max_lag * 1000.0,
+        'latency_ms': {
+            'mean': h.mean() / 1000.0,
+            'p50': h.percentile(50) / 1000.0,
+            'p95': h.percentile(95) / 1000.0,
+            'p99': h.percentile(99) / 1000.0,
+            'p999': h.percentile(99.9) / 1000.0,
+            'max': h.max / 1000.0,
+        },
+    }
+
+    print(f'achieved {summary["achieved_readings_s"]:.1f} readings/s '
+          f'({summary["achieved_requests_s"]:.1f} req/s) of {args.rate:g} target')
+    print(f'requests ok {measured.ok}/{offered}, unfinished {summary["requests_unfinished"]}, '
+          f'errors {sum(measured.errors.values())} {measured.errors or ""}')
+    print(f'latency ms  p50 {fmt_ms(h.percentile(50))}  p95 {fmt_ms(h.percentile(95))}  '
+          f'p99 {fmt_ms(h.percentile(99))}  p999 {fmt_ms(h.percentile(99.9))}  max {fmt_ms(h.max)}  '
+          f'(mean {h.mean() / 1000.0:.2f})')
+    if max_lag > 0.05:
+        print(f'warning: generator fell {max_lag * 1000:.0f} ms behind schedule; results understate the load')
+    if args.json_report:
+        with open(args.json_report, 'w') as f:
+            json.dump(summary, f, indent=2)
+
+
+if __name__ == '__main__':
+    main()
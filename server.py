@@ -1,22 +1,168 @@
-from http.server import SimpleHTTPRequestHandler
-from socketserver import TCPServer
+from http.server import SimpleHTTPRequestHandler, ThreadingHTTPServer
+from array import array
+from collections import deque
+from contextlib import contextmanager
+from datetime import datetime, timezone
+from urllib.parse import urlparse, parse_qs
+import argparse
 import json
+import queue
+import struct
+import sys
 import sqlite3
+import threading
 from pathlib import Path
-from typing import Any, Dict, List
+from typing import Any, Deque, Dict, Iterator, List, Optional, Tuple
 import os
 import time
 
+from columnar_store import ColumnarStore
+from shard_store import ShardedStore
+
+MAX_ROWS_PER_REQUEST = 100000
+MAX_SERIES_POINTS = 5000
+SERIES_METRICS = (
+    'temperature_celsius', 'humidity_percent', 'luminosity_lux', 'presence_detected', 'power_on',
+)
+
+
+def parse_timestamp(value: Any) -> Optional[float]:
+    """ISO-8601 string (with or without zone, 'Z' allowed) or epoch seconds -> epoch seconds. Naive means UTC."""
+    if value is None:
+        return None
+    if isinstance(value, (int, float)):
+        return float(value)
+    text = str(value).strip()
+    try:
+        return float(text)
+    except ValueError:
+        pass
+    try:
+        dt = datetime.fromisoformat(text.replace('Z', '+00:00'))
+    except ValueError:
+        return None
+    if dt.tzinfo is None:
+        dt = dt.replace(tzinfo=timezone.utc)
+    return dt.timestamp()
+
+
+FRAME_V2 = struct.Struct('<BHIhHHBBB')     # firmware protocol.h SensorDataMessageV2
+MSG_TYPE_SENSOR_DATA_V2 = 0x04
+
+
+def decode_frames(raw: bytes, received: datetime) -> Tuple[List[Dict[str, Any]], int]:
+    """Decodes concatenated v2 sensor frames into /data payloads, mirroring the gateway's JSON."""
+    stamp = received.strftime('%Y-%m-%dT%H:%M:%S.%f')[:-3] + 'Z'
+    payloads: List[Dict[str, Any]] = []
+    rejected = 1 if len(raw) % FRAME_V2.size else 0        # truncated trailing frame
+    for off in range(0, len(raw) - FRAME_V2.size + 1, FRAME_V2.size):
+        frame = raw[off:off + FRAME_V2.size]
+        check = 0
+        for b in frame[:-1]:
+            check ^= b
+        (msg_type, node_addr, _uptime_ms, temp, hum, distance_cm,
+         _battery, seq, checksum) = FRAME_V2.unpack(frame)
+        if msg_type != MSG_TYPE_SENSOR_DATA_V2 or check != checksum:
+            rejected += 1
+            continue
+        payloads.append({
+            'node_id': str(node_addr),
+            'timestamp': stamp,
+            'seq': seq,
+            'sensors': {
+                'temperature_celsius': temp / 100.0,
+                'humidity_percent': hum / 100.0,
+                'luminosity_lux': None,
+                'presence_detected': distance_cm < 100,
+                'power_on': True,
+            },
+        })
+    return payloads, rejected
+
+
+def lttb(ts: array, vs: array, threshold: int) -> Tuple[array, array]:
+    """Largest-Triangle-Three-Buckets downsampling. Keeps first and last points; output has <= threshold points."""
+    n = len(ts)
+    if threshold >= n or threshold < 3:
+        return ts, vs
+    out_t, out_v = array('d', [ts[0]]), array('d', [vs[0]])
+    every = (n - 2) / (threshold - 2)
+    a = 0
+    for i in range(threshold - 2):
+        # Average of the next bucket is the third triangle vertex.
+        nxt_start = int((i + 1) * every) + 1
+        nxt_end = min(int((i + 2) * every) + 1, n)
+        span = nxt_end - nxt_start
+        avg_t = sum(ts[nxt_start:nxt_end]) / span
+        avg_v = sum(vs[nxt_start:nxt_end]) / span
+
+        start = int(i * every) + 1
+        end = int((i + 1) * every) + 1
+        at, av = ts[a], vs[a]
+        best, best_area = start, -1.0
+        for j in range(start, end):
+            area = abs((at - avg_t) * (vs[j] - av) - (at - ts[j]) * (avg_v - av))
+            if area > best_area:
+                best, best_area = j, area
+        out_t.append(ts[best])
+        out_v.append(vs[best])
+        a = best
+    out_t.append(ts[n - 1])
+    out_v.append(vs[n - 1])
+    return out_t, out_v
+
+
+# Named PRAGMA sets for DBController (server --sqlite-profile). All of them keep WAL so pooled
+# readers never wait for the writer; they differ in what a crash can cost and in memory use.
+# page_size only applies when the database file is created.
+SQLITE_PROFILES: Dict[str, Dict[str, Any]] = {
+    # fsync of the WAL on every commit: an acknowledged reading survives a power cut.
+    'durable': {'synchronous': 'FULL', 'cache_kib': 8192, 'mmap_bytes': 0, 'page_size': 4096,
+                'temp_store': 'FILE', 'wal_autocheckpoint': 1000},
+    # fsync only at checkpoints: a power cut may drop the last commits but never corrupts.
+    'balanced': {'synchronous': 'NORMAL', 'cache_kib': 16384, 'mmap_bytes': 256 * 1024 * 1024,
+                 'page_size': 4096, 'temp_store': 'MEMORY', 'wal_autocheckpoint': 1000},
+    # No fsync: survives a server crash, not an OS crash or power cut. Replays and test rigs.
+    'throughput': {'synchronous': 'OFF', 'cache_kib': 65536, 'mmap_bytes': 1024 * 1024 * 1024,
+                   'page_size': 8192, 'temp_store': 'MEMORY', 'wal_autocheckpoint': 10000},
+}
+
+
 class DBController:
-    """Controller that encapsulates database operations with resiliency for SQLite locks."""
-    def __init__(self, db_path: Path, timeout: float = 30.0, retries: int = 5):
+    """Controller that encapsulates database operations with resiliency for SQLite locks.
+
+    Writes go through one long-lived writer connection, serialized by a lock. Reads use a
+    separate pool of read-only connections (mode=ro, query_only) with their own page cache,
+    mmap window and statement cache; in WAL mode each query reads a consistent snapshot
+    without waiting for the writer. read_pool_size=0 restores a fresh connection per read.
+    The tuning PRAGMAs come from a SQLITE_PROFILES entry; cache_kib/mmap_bytes override it.
+    """
+    def __init__(self, db_path: Path, timeout: float = 30.0, retries: int = 5,
+                 read_pool_size: int = 4, cache_kib: Optional[int] = None,
+                 mmap_bytes: Optional[int] = None, cached_statements: int = 64,
+                 profile: str = 'balanced'):
+        if profile not in SQLITE_PROFILES:
+            raise ValueError(f'unknown SQLite profile {profile!r}')
         self.db_path = db_path
         self.timeout = timeout
         self.retries = retries
+        self.read_pool_size = read_pool_size
+        self.profile = profile
+        self.tuning = dict(SQLITE_PROFILES[profile])
+        self.cache_kib = self.tuning['cache_kib'] if cache_kib is None else cache_kib
+        self.mmap_bytes = self.tuning['mmap_bytes'] if mmap_bytes is None else mmap_bytes
+        self.page_size = self.tuning['page_size']     # effective value after initialize()
+        self.cached_statements = cached_statements
+        self._writer: Optional[sqlite3.Connection] = None
+        self._write_lock = threading.Lock()
+        self._readers: 'queue.LifoQueue[sqlite3.Connection]' = queue.LifoQueue()
+        self._readers_open = 0
+        self._pool_lock = threading.Lock()
 
     def initialize(self) -> None:
         with sqlite3.connect(self.db_path, timeout=self.timeout) as conn:
             cur = conn.cursor()
+            cur.execute(f'PRAGMA page_size = {int(self.tuning["page_size"])};')   # no-op on an existing file
             cur.execute('''
                 CREATE TABLE IF NOT EXISTS sensor_data (
                     id INTEGER PRIMARY KEY AUTOINCREMENT,
@@ -29,25 +175,101 @@ class DBController:
                     power_on BOOLEAN
                 )
             ''')
+            cur.execute('''
+                CREATE INDEX IF NOT EXISTS idx_sensor_node_time
+                ON sensor_data (node_id, timestamp)
+            ''')
             cur.execute('PRAGMA journal_mode = WAL;')
-            cur.execute('PRAGMA synchronous = NORMAL;')
+            self._tune(conn)
             conn.commit()
+            self.page_size = cur.execute('PRAGMA page_size;').fetchone()[0]
+
+    def _tune(self, conn: sqlite3.Connection) -> None:
+        """Per-connection PRAGMAs of the profile (journal_mode and page_size live in the file)."""
+        t = self.tuning
+        conn.execute(f'PRAGMA synchronous = {t["synchronous"]};')
+        conn.execute(f'PRAGMA cache_size = -{int(self.cache_kib)};')
+        conn.execute(f'PRAGMA mmap_size = {int(self.mmap_bytes)};')
+        conn.execute(f'PRAGMA temp_store = {t["temp_store"]};')
+        conn.execute(f'PRAGMA wal_autocheckpoint = {int(t["wal_autocheckpoint"])};')
 
     def _connect(self):
         return sqlite3.connect(self.db_path, timeout=self.timeout)
 
-    def save(self, payload: Dict[str, Any]) -> None:
+    def _writer_conn(self) -> sqlite3.Connection:
+        if self._writer is None:
+            self._writer = sqlite3.connect(self.db_path, timeout=self.timeout, check_same_thread=False,
+                                           cached_statements=self.cached_statements)
+            self._tune(self._writer)
+        return self._writer
+
+    def _open_reader(self) -> sqlite3.Connection:
+        uri = Path(self.db_path).resolve().as_uri() + '?mode=ro'
+        conn = sqlite3.connect(uri, uri=True, timeout=self.timeout, check_same_thread=False,
+                               cached_statements=self.cached_statements)
+        conn.execute(f'PRAGMA cache_size = -{int(self.cache_kib)};')
+        conn.execute(f'PRAGMA mmap_size = {int(self.mmap_bytes)};')
+        conn.execute(f'PRAGMA temp_store = {self.tuning["temp_store"]};')
+        conn.execute('PRAGMA query_only = ON;')
+        return conn
+
+    @contextmanager
+    def _reader(self) -> Iterator[sqlite3.Connection]:
+        """Borrow a pooled read-only connection; grows lazily up to read_pool_size, then waits."""
+        if self.read_pool_size <= 0:
+            conn = self._connect()
+            try:
+                yield conn
+            finally:
+                conn.close()
+            return
+        try:
+            conn = self._readers.get_nowait()
+        except queue.Empty:
+            with self._pool_lock:
+                grow = self._readers_open < self.read_pool_size
+                if grow:
+                    self._readers_open += 1
+            if grow:
+                try:
+                    conn = self._open_reader()
+                except sqlite3.Error:
+                    with self._pool_lock:
+                        self._readers_open -= 1
+                    raise
+            else:
+                conn = self._readers.get()
+        try:
+            yield conn
+        finally:
+            self._readers.put(conn)
+
+    def close(self) -> None:
+        with self._write_lock:
+            if self._writer is not None:
+                self._writer.close()
+                self._writer = None
+        while True:
+            try:
+                self._readers.get_nowait().close()
+            except queue.Empty:
+                break
+        with self._pool_lock:
+            self._readers_open = 0
+
+    INSERT_SQL = '''
+        INSERT INTO sensor_data (
+            node_id, timestamp, temperature_celsius, humidity_percent,
+            luminosity_lux, presence_detected, power_on
+        ) VALUES (?, ?, ?, ?, ?, ?, ?)
+    '''
+
+    @staticmethod
+    def _row_params(payload: Dict[str, Any]) -> Optional[Tuple[Any, ...]]:
         sensors = payload.get('sensors')
         if sensors is None:
-            sqlite3.OperationalError('No sensor data provided')
-            return
-        sql = '''
-            INSERT INTO sensor_data (
-                node_id, timestamp, temperature_celsius, humidity_percent,
-                luminosity_lux, presence_detected, power_on
-            ) VALUES (?, ?, ?, ?, ?, ?, ?)
-        '''
-        params = (
+            return None
+        return (
             payload.get('node_id'),
             payload.get('timestamp'),
             sensors.get('temperature_celsius'),
@@ -57,12 +279,25 @@ class DBController:
             1 if sensors.get('power_on') else 0
         )
 
+    def save(self, payload: Dict[str, Any]) -> None:
+        self.save_many([payload])
+
+    def save_many(self, payloads: List[Dict[str, Any]]) -> None:
+        """Stores readings in one transaction; entries without sensor data are skipped."""
+        rows = [p for p in (self._row_params(x) for x in payloads) if p is not None]
+        if not rows:
+            return
+
         for attempt in range(1, self.retries + 1):
             try:
-                with self._connect() as conn:
-                    cur = conn.cursor()
-                    cur.execute(sql, params)
-                    conn.commit()
+                with self._write_lock:
+                    conn = self._writer_conn()
+                    try:
+                        conn.executemany(self.INSERT_SQL, rows)
+                        conn.commit()
+                    except sqlite3.Error:
+                        conn.rollback()
+                        raise
                 return
             except sqlite3.OperationalError as e:
                 msg = str(e).lower()
@@ -75,31 +310,44 @@ class DBController:
 
         raise sqlite3.OperationalError(f'database is locked after {self.retries} retries')
 
-    def fetch_recent(self, limit: int = 100) -> List[Dict[str, Any]]:
-        sql = '''
-            SELECT node_id, timestamp, temperature_celsius, humidity_percent,
-                   luminosity_lux, presence_detected, power_on
-            FROM sensor_data
-            ORDER BY timestamp DESC
-            LIMIT ?
-        '''
+    def fetch_recent(self, limit: int = 100, after_id: Optional[int] = None) -> List[Dict[str, Any]]:
+        """Newest rows by id first. With after_id, the next `limit` rows after that id in id order
+        (oldest first), so a client paging a backlog by the last id it holds misses nothing."""
+        if after_id is None:
+            sql = '''
+                SELECT id, node_id, timestamp, temperature_celsius, humidity_percent,
+                       luminosity_lux, presence_detected, power_on
+                FROM sensor_data
+                ORDER BY id DESC
+                LIMIT ?
+            '''
+            params: Tuple[Any, ...] = (limit,)
+        else:
+            sql = '''
+                SELECT id, node_id, timestamp, temperature_celsius, humidity_percent,
+                       luminosity_lux, presence_detected, power_on
+                FROM sensor_data
+                WHERE id > ?
+                ORDER BY id ASC
+                LIMIT ?
+            '''
+            params = (after_id, limit)
         for attempt in range(1, self.retries + 1):
             try:
-                with self._connect() as conn:
-                    cur = conn.cursor()
-                    cur.execute(sql, (limit,))
-                    rows = cur.fetchall()
+                with self._reader() as conn:
+                    rows = conn.execute(sql, params).fetchall()
                 out: List[Dict[str, Any]] = []
                 for r in rows:
                     out.append({
-                        'node_id': r[0],
-                        'timestamp': r[1],
+                        'id': r[0],
+                        'node_id': r[1],
+                        'timestamp': r[2],
                         'sensors': {
-                            'temperature_celsius': r[2],
-                            'humidity_percent': r[3],
-                            'luminosity_lux': r[4],
-                            'presence_detected': bool(r[5]),
-                            'power_on': bool(r[6])
+                            'temperature_celsius': r[3],
+                            'humidity_percent': r[4],
+                            'luminosity_lux': r[5],
+                            'presence_detected': bool(r[6]),
+                            'power_on': bool(r[7])
                         }
                     })
                 return out
@@ -114,12 +362,444 @@ class DBController:
 
         raise sqlite3.OperationalError('database is locked after retries')
 
+    def fetch_series(self, node_id: str, metric: str, t_from: Optional[float] = None,
+                     t_to: Optional[float] = None) -> Tuple[array, array]:
+        """Raw (epoch seconds, value) columns of one metric for one node, time ordered, NULLs skipped."""
+        if metric not in SERIES_METRICS:
+            raise ValueError(f'unknown metric {metric!r}')
+        # Coarse string range on the (node_id, timestamp) index, exact filter after parsing.
+        where, params = ['node_id = ?', f'{metric} IS NOT NULL'], [node_id]
+        if t_from is not None:
+            where.append('timestamp >= ?')
+            params.append(datetime.fromtimestamp(t_from - 1, timezone.utc).strftime('%Y-%m-%dT%H:%M:%S'))
+        if t_to is not None:
+            where.append('timestamp <= ?')
+            params.append(datetime.fromtimestamp(t_to + 1, timezone.utc).strftime('%Y-%m-%dT%H:%M:%S~'))
+        sql = f'SELECT timestamp, {metric} FROM sensor_data WHERE {" AND ".join(where)} ORDER BY timestamp'
+
+        for attempt in range(1, self.retries + 1):
+            try:
+                ts, vs = array('d'), array('d')
+                with self._reader() as conn:
+                    for stamp, value in conn.execute(sql, params):
+                        t = parse_timestamp(stamp)
+                        if t is None or (t_from is not None and t < t_from) or (t_to is not None and t > t_to):
+                            continue
+                        ts.append(t)
+                        vs.append(float(value))
+                break
+            except sqlite3.OperationalError as e:
+                if 'locked' in str(e).lower():
+                    time.sleep(0.02 * (2 ** (attempt - 1)))
+                    continue
+                raise
+        else:
+            raise sqlite3.OperationalError('database is locked after retries')
+
+        # Mixed timestamp formats can sort differently as text than as time.
+        if any(ts[i] > ts[i + 1] for i in range(len(ts) - 1)):
+            order = sorted(range(len(ts)), key=ts.__getitem__)
+            ts, vs = array('d', (ts[i] for i in order)), array('d', (vs[i] for i in order))
+        return ts, vs
+
+
+class LiveStream:
+    """In-memory fan-out of ingest events (readings and anomalies) for Server-Sent Events clients.
+
+    Publishing is O(1): events go into a bounded ring and waiting subscribers are woken up.
+    A subscriber that falls behind by more than the ring size simply skips the lost events.
+    """
+    def __init__(self, capacity: int = 1024):
+        self._events: Deque[Tuple[int, str, Dict[str, Any]]] = deque(maxlen=capacity)
+        self._next_id = 1
+        self._cond = threading.Condition()
+
+    def publish(self, kind: str, data: Dict[str, Any]) -> int:
+        with self._cond:
+            event_id = self._next_id
+            self._next_id += 1
+            self._events.append((event_id, kind, data))
+            self._cond.notify_all()
+        return event_id
+
+    def last_id(self) -> int:
+        with self._cond:
+            return self._next_id - 1
+
+    def wait_since(self, last_id: int, timeout: float) -> List[Tuple[int, str, Dict[str, Any]]]:
+        with self._cond:
+            if self._next_id - 1 <= last_id:
+                self._cond.wait(timeout)
+            return [e for e in self._events if e[0] > last_id]
+
+
+class _NodeState:
+    """Per-node streaming state kept by AnomalyDetector (constant size per node)."""
+    __slots__ = ('group', 'last_seen', 'last_seen_wall', 'interval', 'silent',
+                 'last_value', 'repeats', 'varied', 'stuck', 'outlier')
+
+    def __init__(self, group: str, now: float, wall: float):
+        self.group = group
+        self.last_seen = now
+        self.last_seen_wall = wall
+        self.interval: Optional[float] = None
+        self.silent = False
+        self.last_value: Dict[str, float] = {}
+        self.repeats: Dict[str, int] = {}
+        self.varied: Dict[str, bool] = {}
+        self.stuck: Dict[str, bool] = {}
+        self.outlier: Dict[str, bool] = {}
+
+
+class _PeerMedian:
+    """Streaming estimate of the peer-group median and spread of one metric.
+
+    Uses a sign-driven (frugal) median update plus an EWMA of the absolute deviation,
+    so each reading costs O(1) regardless of how many nodes are in the group.
+    """
+    __slots__ = ('median', 'spread', 'samples')
+
+    def __init__(self):
+        self.median: Optional[float] = None
+        self.spread = 0.0
+        self.samples = 0
+
+    def update(self, value: float, rate: float) -> None:
+        self.samples += 1
+        if self.median is None:
+            self.median = value
+            return
+        dev = value - self.median
+        step = rate * max(self.spread, abs(dev) * 0.1, 1e-3)
+        if dev > 0:
+            self.median += min(step, dev)
+        elif dev < 0:
+            self.median -= min(step, -dev)
+        self.spread += rate * (abs(dev) - self.spread)
+
+
+class AnomalyDetector:
+    """Ingest-path stage that flags silent nodes, stuck values and outliers vs peers.
+
+    All state lives in memory and is updated in O(1) per reading; SQLite is never queried.
+    Silence is detected by a periodic sweep (see run_sweeper) against each node's expected
+    next arrival, derived from an EWMA of its inter-arrival time.
+    """
+    METRICS = ('temperature_celsius', 'humidity_percent', 'luminosity_lux')
+
+    def __init__(self, stream: Optional[LiveStream] = None, alpha: float = 0.1,
+                 silence_factor: float = 3.0, min_silence_s: float = 30.0,
+                 stuck_repeats: int = 6, outlier_k: float = 4.0, min_peers: int = 3,
+                 peer_groups: Optional[Dict[str, str]] = None, history: int = 500):
+        self.stream = stream
+        self.alpha = alpha
+        self.silence_factor = silence_factor
+        self.min_silence_s = min_silence_s
+        self.stuck_repeats = stuck_repeats
+        self.outlier_k = outlier_k
+        self.min_peers = min_peers
+        self.peer_groups = peer_groups or {}
+        self._nodes: Dict[str, _NodeState] = {}
+        self._group_size: Dict[str, int] = {}
+        self._peers: Dict[Tuple[str, str], _PeerMedian] = {}
+        self._events: Deque[Dict[str, Any]] = deque(maxlen=history)
+        self._next_event = 1
+        self._lock = threading.Lock()
+
+    def _emit(self, kind: str, node_id: str, wall: float, **details: Any) -> None:
+        event = {
+            'id': self._next_event,
+            'type': kind,
+            'node_id': node_id,
+            'time': time.strftime('%Y-%m-%dT%H:%M:%SZ', time.gmtime(wall)),
+            'details': details,
+        }
+        self._next_event += 1
+        self._events.append(event)
+        if self.stream is not None:
+            self.stream.publish('anomaly', event)
+
+    def observe(self, payload: Dict[str, Any], now: Optional[float] = None) -> None:
+        node_id = str(payload.get('node_id'))
+        sensors = payload.get('sensors') or {}
+        now = time.monotonic() if now is None else now
+        wall = time.time()
+
+        with self._lock:
+            st = self._nodes.get(node_id)
+            if st is None:
+                group = self.peer_groups.get(node_id, 'default')
+                st = _NodeState(group, now, wall)
+                self._nodes[node_id] = st
+                self._group_size[group] = self._group_size.get(group, 0) + 1
+            else:
+                gap = now - st.last_seen
+                st.interval = gap if st.interval is None else st.interval + self.alpha * (gap - st.interval)
+                st.last_seen = now
+                st.last_seen_wall = wall
+                if st.silent:
+                    st.silent = False
+                    self._emit('node_recovered', node_id, wall, gap_s=round(gap, 1))
+
+            for metric in self.METRICS:
+                value = sensors.get(metric)
+                if not isinstance(value, (int, float)) or isinstance(value, bool):
+                    continue
+                value = float(value)
+                self._check_stuck(st, node_id, metric, value, wall)
+                self._check_peers(st, node_id, metric, value, wall)
+
+    def _check_stuck(self, st: _NodeState, node_id: str, metric: str, value: float, wall: float) -> None:
+        last = st.last_value.get(metric)
+        if last == value:
+            st.repeats[metric] = st.repeats.get(metric, 1) + 1
+        else:
+            if last is not None:
+                st.varied[metric] = True
+            st.repeats[metric] = 1
+            st.stuck[metric] = False
+        st.last_value[metric] = value
+        # A metric the node has never varied is a fixed value (e.g. temperature 0 on nodes
+        # without that sensor), not a frozen one: only a value that stops changing is stuck.
+        if not st.varied.get(metric):
+            return
+        if st.repeats[metric] >= self.stuck_repeats and not st.stuck.get(metric):
+            st.stuck[metric] = True
+            self._emit('stuck_value', node_id, wall, metric=metric, value=value,
+                       repeats=st.repeats[metric])
+
+    def _check_peers(self, st: _NodeState, node_id: str, metric: str, value: float, wall: float) -> None:
+        peers = self._peers.get((st.group, metric))
+        if peers is None:
+            peers = self._peers[(st.group, metric)] = _PeerMedian()
+        enough = (self._group_size.get(st.group, 0) >= self.min_peers
+                  and peers.samples >= 2 * self.min_peers)
+        if enough and peers.median is not None:
+            limit = self.outlier_k * max(peers.spread, 0.05 * abs(peers.median), 0.1)
+            is_outlier = abs(value - peers.median) > limit
+            if is_outlier and not st.outlier.get(metric):
+                self._emit('outlier_vs_peers', node_id, wall, metric=metric, value=value,
+                           peer_median=round(peers.median, 3), peer_spread=round(peers.spread, 3),
+                           group=st.group)
+            st.outlier[metric] = is_outlier
+        # Outliers are still fed in, with a damped rate, so a real shift in the group is followed.
+        peers.update(value, 0.02 if st.outlier.get(metric) else 0.1)
+
+    def sweep(self, now: Optional[float] = None) -> None:
+        """Flags nodes whose expected next arrival is overdue. Cost is O(nodes) per sweep."""
+        now = time.monotonic() if now is None else now
+        wall = time.time()
+        with self._lock:
+            for node_id, st in self._nodes.items():
+                if st.silent or st.interval is None:
+                    continue
+                overdue = now - st.last_seen
+                if overdue > max(self.min_silence_s, self.silence_factor * st.interval):
+                    st.silent = True
+                    self._emit('node_silent', node_id, wall, silent_for_s=round(overdue, 1),
+                               expected_interval_s=round(st.interval, 1))
+
+    def run_sweeper(self, period: float = 1.0) -> threading.Thread:
+        def loop() -> None:
+            while True:
+                time.sleep(period)
+                self.sweep()
+        t = threading.Thread(target=loop, name='anomaly-sweeper', daemon=True)
+        t.start()
+        return t
+
+    def events(self, since: int = 0, limit: int = 100) -> List[Dict[str, Any]]:
+        with self._lock:
+            out = [e for e in self._events if e['id'] > since]
+        return out[-limit:]
+
+
+class _NodeSummary:
+    """Per-node fleet-health state kept by NodeRegistry (constant size per node)."""
+    __slots__ = ('node_id', 'first_seen', 'last_seen', 'timestamp', 'sensors', 'messages',
+                 'interval', 'last_seq', 'seq_received', 'seq_lost', 'duplicates',
+                 'rssi', 'snr', 'rssi_avg', 'relay', 'hops', 'backlog', 'missing')
+
+    def __init__(self, node_id: str, wall: float):
+        self.node_id = node_id
+        self.first_seen = wall
+        self.last_seen = wall
+        self.timestamp: Optional[str] = None
+        self.sensors: Dict[str, Any] = {}
+        self.messages = 0
+        self.interval: Optional[float] = None
+        self.last_seq: Optional[int] = None
+        self.seq_received = 0
+        self.seq_lost = 0
+        self.duplicates = 0
+        self.rssi: Optional[float] = None
+        self.snr: Optional[float] = None
+        self.rssi_avg: Optional[float] = None
+        self.relay: Optional[str] = None
+        self.hops: Optional[int] = None
+        self.backlog = 0
+        self.missing = 0          # bit s set: seq s was counted in seq_lost (last half-cycle only)
+
+
+class NodeRegistry:
+    """Latest state and link health of every node, updated in O(1) per reading.
+
+    Serves /nodes at O(nodes) cost without touching storage. Loss is estimated from the
+    8-bit frame sequence number when the gateway forwards it ("seq"); readings without
+    one (legacy frames, sensor_client.py) report loss as null.
+    """
+    SEQ_MODULO = 256
+
+    def __init__(self, alpha: float = 0.2):
+        self.alpha = alpha
+        self._nodes: Dict[str, _NodeSummary] = {}
+        self._lock = threading.Lock()
+
+    def observe(self, payload: Dict[str, Any], wall: Optional[float] = None) -> None:
+        wall = time.time() if wall is None else wall
+        node_id = str(payload.get('node_id'))
+        with self._lock:
+            n = self._nodes.get(node_id)
+            if n is None:
+                n = self._nodes[node_id] = _NodeSummary(node_id, wall)
+            if payload.get('backlog'):
+                # Replayed from the node's flash queue: old data, not its latest state.
+                n.backlog += 1
+                self._account_backlog(n, payload.get('seq'))
+                return
+            if n.messages:
+                gap = max(wall - n.last_seen, 0.0)
+                n.interval = gap if n.interval is None else n.interval + self.alpha * (gap - n.interval)
+            n.last_seen = wall
+            n.messages += 1
+            n.timestamp = payload.get('timestamp')
+            n.sensors = dict(payload.get('sensors') or {})
+            self._account_seq(n, payload.get('seq'))
+
+            rssi, snr = payload.get('rssi'), payload.get('snr')
+            if isinstance(rssi, (int, float)):
+                n.rssi = float(rssi)
+                n.rssi_avg = n.rssi if n.rssi_avg is None else n.rssi_avg + self.alpha * (n.rssi - n.rssi_avg)
+            if isinstance(snr, (int, float)):
+                n.snr = float(snr)
+            n.relay = payload.get('relay')
+            n.hops = payload.get('hops')
+
+    def seed(self, payload: Dict[str, Any], wall: Optional[float] = None) -> None:
+        """Restores a node's last known values from storage after a restart.
+
+        Stored timestamps come from the node clock (often uptime, i.e. 1970), so they say
+        nothing about arrival: the node is marked seen at `wall` (startup) and interval,
+        message count and sequence state are left for live readings to establish.
+        """
+        wall = time.time() if wall is None else wall
+        if payload.get('backlog'):
+            return
+        node_id = str(payload.get('node_id'))
+        with self._lock:
+            n = self._nodes.get(node_id)
+            if n is None:
+                n = self._nodes[node_id] = _NodeSummary(node_id, wall)
+            n.timestamp = payload.get('timestamp')
+            n.sensors = dict(payload.get('sensors') or {})
+            for key in ('rssi', 'snr'):
+                value = payload.get(key)
+                if isinstance(value, (int, float)):
+                    setattr(n, key, float(value))
+            if n.rssi is not None:
+                n.rssi_avg = n.rssi
+            n.relay = payload.get('relay')
+            n.hops = payload.get('hops')
+
+    def _account_seq(self, n: _NodeSummary, seq: Any) -> None:
+        if not isinstance(seq, int):
+            return
+        seq %= self.SEQ_MODULO
+        if n.last_seq is None:
+            n.last_seq = seq
+            n.seq_received = 1
+            return
+        gap = (seq - n.last_seq) % self.SEQ_MODULO
+        if gap == 0:
+            n.duplicates += 1
+            return
+        if gap < self.SEQ_MODULO // 2:
+            half = self.SEQ_MODULO // 2
+            # Seqs falling out of the half-cycle window can no longer be told apart
+            # from the next lap; the ones just skipped are now counted as lost.
+            n.missing &= ~self._span(n.last_seq + 1 - half, gap)
+            n.missing |= self._span(n.last_seq + 1, gap - 1)
+            n.seq_received += 1
+            n.seq_lost += gap - 1
+            n.last_seq = seq
+        elif not self._fill(n, seq):
+            n.duplicates += 1         # late copy of a reading already counted
+
+    def _account_backlog(self, n: _NodeSummary, seq: Any) -> None:
+        # A stored reading was never delivered live, so it can fill a gap already counted
+        # as lost (the gateway drops copies of readings it did receive).
+        if isinstance(seq, int) and n.last_seq is not None:
+            self._fill(n, seq % self.SEQ_MODULO)
+
+    def _fill(self, n: _NodeSummary, seq: int) -> bool:
+        """Moves seq from lost to received if it is one of the counted gaps."""
+        bit = 1 << seq
+        if not n.missing & bit:
+            return False
+        n.missing &= ~bit
+        n.seq_lost -= 1
+        n.seq_received += 1
+        return True
+
+    @classmethod
+    def _span(cls, start: int, count: int) -> int:
+        """Bit mask of count consecutive seqs from start, wrapping at SEQ_MODULO."""
+        m = cls.SEQ_MODULO
+        mask = ((1 << count) - 1) << (start % m)
+        return (mask | (mask >> m)) & ((1 << m) - 1)
+
+    def snapshot(self, now: Optional[float] = None) -> List[Dict[str, Any]]:
+        now = time.time() if now is None else now
+        with self._lock:
+            nodes = list(self._nodes.values())
+            out = []
+            for n in nodes:
+                age = now - n.last_seen
+                # A node that went quiet should not keep reporting its old rate.
+                interval = max(n.interval, age) if n.interval else None
+                expected = n.seq_received + n.seq_lost
+                out.append({
+                    'node_id': n.node_id,
+                    'first_seen': n.first_seen,
+                    'last_seen': n.last_seen,
+                    'age_s': round(age, 1),
+                    'timestamp': n.timestamp,
+                    'sensors': n.sensors,
+                    'messages': n.messages,
+                    'rate_per_min': round(60.0 / interval, 3) if interval else None,
+                    'loss': round(n.seq_lost / expected, 4) if n.last_seq is not None and expected else None,
+                    'lost': n.seq_lost if n.last_seq is not None else None,
+                    'duplicates': n.duplicates,
+                    'rssi': n.rssi,
+                    'rssi_avg': round(n.rssi_avg, 1) if n.rssi_avg is not None else None,
+                    'snr': n.snr,
+                    'relay': n.relay,
+                    'hops': n.hops,
+                    'backlog': n.backlog,
+                })
+        out.sort(key=lambda d: d['node_id'])
+        return out
+
 
 class RequestHandler(SimpleHTTPRequestHandler):
-    db_controller: DBController = None
+    db_controller: DBController = None     # or a ShardedStore/ColumnarStore, same interface
+    anomaly_detector: AnomalyDetector = None
+    live_stream: LiveStream = None
+    node_registry: NodeRegistry = None
 
     def do_POST(self) -> None:
-        if self.path != '/data':
+        url = urlparse(self.path)
+        if url.path not in ('/data', '/data/frames'):
             self.send_response(404)
             self.end_headers()
             return
@@ -127,9 +807,18 @@ class RequestHandler(SimpleHTTPRequestHandler):
         try:
             length = int(self.headers.get('Content-Length', 0))
             raw = self.rfile.read(length)
+            if url.path == '/data/frames':
+                return self.ingest_frames(raw)
             payload = json.loads(raw)
-            print(payload)
-            self.db_controller.save(payload)
+            if isinstance(payload, list):
+                # Batch: one transaction for the whole array.
+                self.db_controller.save_many(payload)
+                for item in payload:
+                    self.ingest(item)
+            else:
+                print(payload)
+                self.db_controller.save(payload)
+                self.ingest(payload)
             self.send_response(202)
             self.end_headers()
             self.wfile.write(b'Data accepted and stored.')
@@ -138,18 +827,145 @@ class RequestHandler(SimpleHTTPRequestHandler):
             self.end_headers()
             self.wfile.write(f'Error: {exc}'.encode())
 
+    def ingest_frames(self, raw: bytes) -> None:
+        """Binary ingest: concatenated 16-byte SensorDataMessageV2 frames, as sent over LoRa.
+
+        Frames carry node uptime rather than wall time, so readings are stamped with the
+        receive time. Bad frames are counted and skipped; the rest are stored as one batch.
+        """
+        payloads, rejected = decode_frames(raw, datetime.now(timezone.utc))
+        self.db_controller.save_many(payloads)
+        for item in payloads:
+            self.ingest(item)
+        self.send_json({'accepted': len(payloads), 'rejected': rejected}, status=202)
+
+    def ingest(self, payload: Dict[str, Any]) -> None:
+        """Post-storage ingest stages: node summary, anomaly detection and live fan-out."""
+        if self.node_registry is not None:
+            self.node_registry.observe(payload)
+        if self.anomaly_detector is not None:
+            self.anomaly_detector.observe(payload)
+        if self.live_stream is not None:
+            self.live_stream.publish('reading', payload)
+
+    def send_json(self, obj: Any, status: int = 200) -> None:
+        self.send_response(status)
+        self.send_header('Content-Type', 'application/json')
+        self.end_headers()
+        self.wfile.write(json.dumps(obj).encode())
+
+    def serve_series(self, query: Dict[str, List[str]]) -> None:
+        """Downsampled history of one metric: /series?node=&metric=&from=&to=&points=N[&format=binary].
+
+        JSON is columnar ({"t": [...], "v": [...]}, t in epoch seconds). The binary form is
+        little-endian: uint32 count, uint32 raw_points, float64 t[count], float32 v[count]. Either way the
+        response holds at most MAX_SERIES_POINTS points, whatever the time range.
+        """
+        try:
+            node = query['node'][0]
+            metric = query.get('metric', ['temperature_celsius'])[0]
+            t_from = parse_timestamp(query['from'][0]) if 'from' in query else None
+            t_to = parse_timestamp(query['to'][0]) if 'to' in query else None
+            for name, parsed in (('from', t_from), ('to', t_to)):
+                if name in query and parsed is None:
+                    raise ValueError(f'unparseable {name!r} timestamp: {query[name][0]!r}')
+            points = max(3, min(int(query.get('points', ['500'])[0]), MAX_SERIES_POINTS))
+            ts, vs = self.db_controller.fetch_series(node, metric, t_from, t_to)
+        except (KeyError, ValueError) as exc:
+            self.send_response(400)
+            self.end_headers()
+            self.wfile.write(f'Error: {exc}'.encode())
+            return
+        except Exception as exc:
+            self.send_response(500)
+            self.end_headers()
+            self.wfile.write(f'Error: {exc}'.encode())
+            return
+
+        raw_points = len(ts)
+        ts, vs = lttb(ts, vs, points)
+        if query.get('format', ['json'])[0] == 'binary':
+            vf = array('f', vs)
+            if sys.byteorder == 'big':
+                ts.byteswap()
+                vf.byteswap()
+            body = struct.pack('<II', len(ts), raw_points) + ts.tobytes() + vf.tobytes()
+            self.send_response(200)
+            self.send_header('Content-Type', 'application/octet-stream')
+            self.send_header('Content-Length', str(len(body)))
+            self.send_header('X-Raw-Points', str(raw_points))
+            self.end_headers()
+            self.wfile.write(body)
+            return
+        self.send_json({
+            'node': node,
+            'metric': metric,
+            'raw_points': raw_points,
+            't': [round(t, 3) for t in ts],
+            'v': [round(v, 3) for v in vs],
+        })
+
+    def serve_stream(self) -> None:
+        """Server-Sent Events feed of new readings and anomaly events."""
+        self.send_response(200)
+        self.send_header('Content-Type', 'text/event-stream')
+        self.send_header('Cache-Control', 'no-cache')
+        self.send_header('Connection', 'keep-alive')
+        self.end_headers()
+        last_id = self.live_stream.last_id()
+        try:
+            while True:
+                batch = self.live_stream.wait_since(last_id, timeout=15.0)
+                if not batch:
+                    self.wfile.write(b': keep-alive\n\n')
+                for event_id, kind, data in batch:
+                    self.wfile.write(f'id: {event_id}\nevent: {kind}\ndata: {json.dumps(data)}\n\n'.encode())
+                    last_id = event_id
+                self.wfile.flush()
+        except (BrokenPipeError, ConnectionResetError):
+            pass
+
     def do_GET(self) -> None:
-        if self.path == '/':
+        url = urlparse(self.path)
+        query = parse_qs(url.query)
+
+        if url.path == '/events':
+            try:
+                since = int(query.get('since', ['0'])[0])
+                limit = int(query.get('limit', ['100'])[0])
+                self.send_json(self.anomaly_detector.events(since, limit))
+            except ValueError as exc:
+                self.send_response(400)
+                self.end_headers()
+                self.wfile.write(f'Error: {exc}'.encode())
+            return
+
+        if url.path == '/stream':
+            return self.serve_stream()
+
+        if url.path == '/series':
+            return self.serve_series(query)
+
+        if url.path == '/nodes':
+            return self.send_json(self.node_registry.snapshot())
+
+        if url.path == '/':
             self.path = 'public/index.html'
             return SimpleHTTPRequestHandler.do_GET(self)
 
-        if self.path == '/data':
+        if url.path == '/data':
             try:
-                rows = self.db_controller.fetch_recent()
+                limit = max(1, min(int(query.get('limit', ['100'])[0]), MAX_ROWS_PER_REQUEST))
+                after_id = int(query['after_id'][0]) if 'after_id' in query else None
+                rows = self.db_controller.fetch_recent(limit, after_id)
                 self.send_response(200)
                 self.send_header('Content-Type', 'application/json')
                 self.end_headers()
                 self.wfile.write(json.dumps(rows).encode())
+            except ValueError as exc:
+                self.send_response(400)
+                self.end_headers()
+                self.wfile.write(f'Error: {exc}'.encode())
             except Exception as exc:
                 self.send_response(500)
                 self.end_headers()
@@ -166,17 +982,55 @@ if __name__ == '__main__':
     BIND_ADDR = '0.0.0.0'
     PORT = 8000
 
-    db_controller = DBController(DB_PATH, timeout=30.0, retries=6)
+    parser = argparse.ArgumentParser(description='Telemetry ingest server and dashboard.')
+    parser.add_argument('--port', type=int, default=PORT)
+    parser.add_argument('--storage', choices=('sqlite', 'sharded', 'columnar'), default='sqlite',
+                        help='sqlite (telemetry.db), sharded (one SQLite file per day/week) '
+                             'or append-only columnar segments')
+    parser.add_argument('--data-dir', type=Path, default=BASE_FOLDER / 'columnar',
+                        help='segment directory for --storage columnar')
+    parser.add_argument('--sqlite-profile', choices=tuple(SQLITE_PROFILES), default='balanced',
+                        help='SQLite tuning for --storage sqlite/sharded: durable (fsync per commit), '
+                             'balanced or throughput (no fsync); see tools/bench_sqlite_profiles.py')
+    parser.add_argument('--shard-dir', type=Path, default=BASE_FOLDER / 'shards',
+                        help='shard directory for --storage sharded')
+    parser.add_argument('--shard-period', choices=('day', 'week'), default='day')
+    parser.add_argument('--retention-days', type=float, default=0,
+                        help='--storage sharded: unlink shards older than this (0 keeps everything)')
+    args = parser.parse_args()
+    PORT = args.port
+
+    if args.storage == 'columnar':
+        db_controller = ColumnarStore(args.data_dir)
+    elif args.storage == 'sharded':
+        db_controller = ShardedStore(args.shard_dir, args.shard_period, args.retention_days,
+                                     tuning=SQLITE_PROFILES[args.sqlite_profile])
+    else:
+        db_controller = DBController(DB_PATH, timeout=30.0, retries=6, profile=args.sqlite_profile)
     db_controller.initialize()
+    if args.storage == 'sqlite':
+        print(f'SQLite profile {db_controller.profile}: synchronous={db_controller.tuning["synchronous"]} '
+              f'page_size={db_controller.page_size}')
+
+    live_stream = LiveStream()
+    anomaly_detector = AnomalyDetector(stream=live_stream)
+    anomaly_detector.run_sweeper()
 
     RequestHandler.db_controller = db_controller
+    RequestHandler.anomaly_detector = anomaly_detector
+    RequestHandler.live_stream = live_stream
 
-    os.chdir(BASE_FOLDER)
+    # Seed from recent history so /nodes is populated right after a restart.
+    node_registry = NodeRegistry()
+    started = time.time()
+    for row in reversed(db_controller.fetch_recent(1000)):
+        node_registry.seed(row, wall=started)
+    RequestHandler.node_registry = node_registry
 
-    # if great race for connections is expected, use ThreadingHTTPServer:
-    # server = ThreadingHTTPServer((BIND_ADDR, PORT), RequestHandler)
+    os.chdir(BASE_FOLDER)
 
-    with TCPServer((BIND_ADDR, PORT), RequestHandler) as srv:
+    # Threaded so that /stream subscribers do not block ingest.
+    with ThreadingHTTPServer((BIND_ADDR, PORT), RequestHandler) as srv:
         print(f"Server running at http://{BIND_ADDR}:{PORT}")
         print(f"Open the dashboard at http://localhost:{PORT}/")
         try:
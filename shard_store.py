@@ -0,0 +1,402 @@
+"""Time-partitioned SQLite storage: one database file per day or per ISO week, for server.py.
+
+Layout under the shard directory:
+
+    <root>/telemetry-20261018.db     per-day shard, readings that reached the server that UTC day
+    <root>/telemetry-w20261012.db    per-week shard, named after its Monday (UTC)
+    <root>/next_id                   row id counter, saved when retention drops shards
+
+Every shard has the sensor_data table of the single-file engine plus received_at, the
+server's arrival time (epoch seconds). Readings are routed by arrival, not by their own
+timestamp: nodes without a wall clock report uptime, which the gateway renders as a 1970
+date. Row ids are global and assigned by the store (max id across shards + 1 at startup),
+so ids follow arrival order and fetch_recent's after_id polling works across shards.
+
+A reading's time for fetch_series is its timestamp when that is a wall-clock time (2000 or
+later), else its arrival. Readings arrive after they are taken, so a time range only needs
+the shards from its start to max_lag_s past its end (backlogged readings stored in flash by
+the nodes arrive late); the (node_id, received_at) index bounds the scan the same way.
+
+Queries open one connection, ATTACH read-only only the shards whose span (or id range, for
+after_id polls) intersects the request, and UNION ALL the per-shard selects; shards are
+attached in groups when a range spans more of them than SQLite's attach limit.
+
+Retention is by whole shards: a shard whose arrival span ends before the cutoff is closed
+and its files unlinked, which costs the same however much history is kept.
+
+It implements the DBController calls server.py makes (initialize, save, save_many,
+fetch_recent, fetch_series), so it can be selected with `python server.py --storage sharded`.
+"""
+import re
+import sqlite3
+import threading
+import time
+from array import array
+from collections import OrderedDict
+from datetime import datetime, timezone
+from pathlib import Path
+from typing import Any, Dict, List, Optional, Tuple
+
+SERIES_METRICS = (
+    'temperature_celsius', 'humidity_percent', 'luminosity_lux', 'presence_detected', 'power_on',
+)
+COLUMNS = 'id, node_id, timestamp, temperature_celsius, humidity_percent, luminosity_lux, presence_detected, power_on'
+PERIODS = {'day': 86400, 'week': 7 * 86400}
+SHARD_RE = re.compile(r'^telemetry-(w?)(\d{8})\.db$')
+MAX_ATTACHED = 10              # SQLite's default SQLITE_MAX_ATTACHED
+NEXT_ID_FILE = 'next_id'       # id counter saved when shards are dropped
+MIN_WALL_CLOCK = 946684800.0   # 2000-01-01: earlier timestamps are device uptime
+CLOCK_SLACK_S = 60.0           # reading stamped by a clock slightly ahead of the server's
+
+
+def _epoch(value: Any) -> Optional[float]:
+    """ISO-8601 (naive means UTC, 'Z' allowed) or epoch seconds -> epoch seconds."""
+    if value is None:
+        return None
+    if isinstance(value, (int, float)):
+        return float(value)
+    text = str(value).strip()
+    try:
+        return float(text)
+    except ValueError:
+        pass
+    try:
+        dt = datetime.fromisoformat(text.replace('Z', '+00:00'))
+    except ValueError:
+        return None
+    if dt.tzinfo is None:
+        dt = dt.replace(tzinfo=timezone.utc)
+    return dt.timestamp()
+
+
+def _stamp(t: float) -> str:
+    return datetime.fromtimestamp(t, timezone.utc).strftime('%Y-%m-%dT%H:%M:%S')
+
+
+class Shard:
+    """One shard file: its time span [start, end) and the highest row id stored in it."""
+    def __init__(self, path: Path, start: float, end: float):
+        self.path = path
+        self.start = start
+        self.end = end
+        self.max_id = 0
+
+    def files(self) -> List[Path]:
+        return [self.path] + [Path(str(self.path) + s) for s in ('-wal', '-shm')]
+
+
+class ShardedStore:
+    """Drop-in storage engine for server.py with one SQLite file per day or week.
+
+    tuning is a server.SQLITE_PROFILES entry, applied to every shard connection. retention_days=0
+    keeps everything; otherwise expired shards are unlinked at startup and, at most once a
+    minute, on ingest (or explicitly with drop_before()).
+    """
+    def __init__(self, root: Path, period: str = 'day', retention_days: float = 0,
+                 tuning: Optional[Dict[str, Any]] = None, timeout: float = 30.0, open_writers: int = 4,
+                 max_lag_s: float = 86400.0):
+        if period not in PERIODS:
+            raise ValueError(f'unknown shard period {period!r}')
+        self.root = Path(root)
+        self.period = period
+        self.span = PERIODS[period]
+        self.retention_days = retention_days
+        self.tuning = tuning or {'synchronous': 'NORMAL', 'cache_kib': 16384, 'page_size': 4096,
+                                 'temp_store': 'MEMORY', 'wal_autocheckpoint': 1000}
+        self.timeout = timeout
+        self.open_writers = open_writers
+        self.max_lag_s = max_lag_s
+        self._shards: Dict[float, Shard] = {}          # by start
+        self._writers: 'OrderedDict[float, sqlite3.Connection]' = OrderedDict()
+        self._next_id = 1
+        self._lock = threading.Lock()
+        self._next_retention = 0.0
+        self.dropped_shards = 0
+
+    # ---------------- Shard files ----------------
+
+    def _shard_start(self, t: float) -> float:
+        day = int(t // 86400) * 86400
+        if self.period == 'week':
+            # 1970-01-01 was a Thursday; weeks start on Monday
+            day -= ((day // 86400 + 3) % 7) * 86400
+        return float(day)
+
+    def _shard_name(self, start: float) -> str:
+        prefix = 'w' if self.period == 'week' else ''
+        return f'telemetry-{prefix}{datetime.fromtimestamp(start, timezone.utc):%Y%m%d}.db'
+
+    def _create(self, start: float) -> Shard:
+        shard = Shard(self.root / self._shard_name(start), start, start + self.span)
+        with sqlite3.connect(shard.path, timeout=self.timeout) as conn:
+            conn.execute(f'PRAGMA page_size = {int(self.tuning["page_size"])};')
+            conn.execute('''
+                CREATE TABLE IF NOT EXISTS sensor_data (
+                    id INTEGER PRIMARY KEY,
+                    node_id TEXT NOT NULL,
+                    timestamp TEXT NOT NULL,
+                    temperature_celsius REAL,
+                    humidity_percent REAL,
+                    luminosity_lux REAL,
+                    presence_detected BOOLEAN,
+                    power_on BOOLEAN,
+                    received_at REAL NOT NULL
+                )
+            ''')
+            conn.execute('CREATE INDEX IF NOT EXISTS idx_sensor_node_arrival ON sensor_data (node_id, received_at)')
+            conn.execute('PRAGMA journal_mode = WAL;')
+        conn.close()
+        self._shards[start] = shard
+        return shard
+
+    def _writer(self, shard: Shard) -> sqlite3.Connection:
+        conn = self._writers.get(shard.start)
+        if conn is not None:
+            self._writers.move_to_end(shard.start)
+            return conn
+        conn = sqlite3.connect(shard.path, timeout=self.timeout, check_same_thread=False)
+        t = self.tuning
+        conn.execute(f'PRAGMA synchronous = {t["synchronous"]};')
+        conn.execute(f'PRAGMA cache_size = -{int(t["cache_kib"])};')
+        conn.execute(f'PRAGMA temp_store = {t["temp_store"]};')
+        conn.execute(f'PRAGMA wal_autocheckpoint = {int(t["wal_autocheckpoint"])};')
+        self._writers[shard.start] = conn
+        # Ingest goes to the current shard; old ones only see the odd late reading.
+        while len(self._writers) > self.open_writers:
+            self._writers.popitem(last=False)[1].close()
+        return conn
+
+    def initialize(self) -> None:
+        self.root.mkdir(parents=True, exist_ok=True)
+        with self._lock:
+            for path in sorted(self.root.iterdir()):
+                m = SHARD_RE.match(path.name)
+                if not m:
+                    continue
+                start = datetime.strptime(m.group(2), '%Y%m%d').replace(tzinfo=timezone.utc).timestamp()
+                shard = Shard(path, start, start + self.span)
+                with sqlite3.connect(f'{path.resolve().as_uri()}?mode=ro', uri=True) as conn:
+                    shard.max_id = conn.execute('SELECT MAX(id) FROM sensor_data').fetchone()[0] or 0
+                conn.close()
+                # Shards of the other period are not served, but their ids stay taken.
+                self._next_id = max(self._next_id, shard.max_id + 1)
+                if (m.group(1) == 'w') == (self.period == 'week'):
+                    self._shards[start] = shard
+            try:
+                self._next_id = max(self._next_id, int((self.root / NEXT_ID_FILE).read_text()))
+            except (FileNotFoundError, ValueError):
+                pass
+            self._expire(time.time())
+
+    def close(self) -> None:
+        with self._lock:
+            for conn in self._writers.values():
+                conn.close()
+            self._writers.clear()
+
+    # ---------------- Retention ----------------
+
+    def _expire(self, now: float) -> int:
+        if self.retention_days <= 0:
+            return 0
+        return self._drop_before(now - self.retention_days * 86400)
+
+    def _drop_before(self, cutoff: float) -> int:
+        dropped = 0
+        for start in [s for s, sh in self._shards.items() if sh.end <= cutoff]:
+            shard = self._shards.pop(start)
+            conn = self._writers.pop(start, None)
+            if conn is not None:
+                conn.close()
+            # Open readers keep their file handle until the query ends (POSIX unlink).
+            for f in shard.files():
+                f.unlink(missing_ok=True)
+            dropped += 1
+        if dropped:
+            # The newest shards may not hold the highest id any more (late readings): keep
+            # the counter so a restart never hands out an id a poller has already seen.
+            tmp = self.root / (NEXT_ID_FILE + '.tmp')
+            tmp.write_text(f'{self._next_id}\n')
+            tmp.replace(self.root / NEXT_ID_FILE)
+        self.dropped_shards += dropped
+        self._next_retention = time.time() + 60
+        return dropped
+
+    def drop_before(self, cutoff: float) -> int:
+        """Unlinks every shard that ends at or before cutoff (epoch seconds); returns how many."""
+        with self._lock:
+            return self._drop_before(cutoff)
+
+    # ---------------- Writes ----------------
+
+    @staticmethod
+    def _row_params(payload: Dict[str, Any], row_id: int, received_at: float) -> Tuple[Any, ...]:
+        sensors = payload['sensors']
+        return (
+            row_id,
+            payload.get('node_id'),
+            payload.get('timestamp'),
+            sensors.get('temperature_celsius'),
+            sensors.get('humidity_percent'),
+            sensors.get('luminosity_lux'),
+            1 if sensors.get('presence_detected') else 0,
+            1 if sensors.get('power_on') else 0,
+            received_at
+        )
+
+    def save(self, payload: Dict[str, Any]) -> None:
+        self.save_many([payload])
+
+    def save_many(self, payloads: List[Dict[str, Any]], received_at: Optional[float] = None) -> None:
+        """Stores readings with one transaction; entries without sensor data are skipped.
+
+        received_at (epoch seconds) defaults to now; replays and benchmarks pass the original arrival.
+        """
+        now = time.time()
+        arrival = now if received_at is None else received_at
+        batch = [p for p in payloads if p.get('sensors') is not None]
+        if not batch:
+            return
+
+        with self._lock:
+            if now >= self._next_retention:
+                self._expire(now)
+            start = self._shard_start(arrival)
+            rows = []
+            for p in batch:
+                rows.append(self._row_params(p, self._next_id, arrival))
+                self._next_id += 1
+            shard = self._shards.get(start) or self._create(start)
+            conn = self._writer(shard)
+            try:
+                conn.executemany(f'INSERT INTO sensor_data ({COLUMNS}, received_at) '
+                                 f'VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)', rows)
+                conn.commit()
+            except sqlite3.Error:
+                conn.rollback()
+                raise
+            shard.max_id = max(shard.max_id, rows[-1][0])
+
+    # ---------------- Reads ----------------
+
+    def _select(self, shards: List[Shard], branch: str, params: List[Any], tail: str,
+                tail_params: List[Any]) -> List[Tuple[Any, ...]]:
+        """UNION ALL of `branch` (with {db} for the schema name) over shards, attached in groups."""
+        out: List[Tuple[Any, ...]] = []
+        for g in range(0, len(shards), MAX_ATTACHED):
+            group = shards[g:g + MAX_ATTACHED]
+            if len(group) == 1:
+                # One shard: query it directly, no attach round trip
+                try:
+                    conn = sqlite3.connect(f'{group[0].path.resolve().as_uri()}?mode=ro', uri=True,
+                                           timeout=self.timeout)
+                except sqlite3.OperationalError:
+                    continue
+                try:
+                    sql = f'SELECT * FROM ({branch.format(db="main")})' + tail
+                    out.extend(conn.execute(sql, params + tail_params).fetchall())
+                finally:
+                    conn.close()
+                continue
+            conn = sqlite3.connect(':memory:', uri=True, timeout=self.timeout)
+            try:
+                attached = []
+                for i, shard in enumerate(group):
+                    try:
+                        conn.execute(f'ATTACH DATABASE ? AS s{i}', (f'{shard.path.resolve().as_uri()}?mode=ro',))
+                    except sqlite3.OperationalError:
+                        continue        # dropped by retention after the shard list was taken
+                    attached.append(f's{i}')
+                if not attached:
+                    continue
+                sql = ' UNION ALL '.join(f'SELECT * FROM ({branch.format(db=db)})' for db in attached) + tail
+                out.extend(conn.execute(sql, params * len(attached) + tail_params).fetchall())
+            finally:
+                conn.close()
+        return out
+
+    @staticmethod
+    def _row(r: Tuple[Any, ...]) -> Dict[str, Any]:
+        return {
+            'id': r[0],
+            'node_id': r[1],
+            'timestamp': r[2],
+            'sensors': {
+                'temperature_celsius': r[3],
+                'humidity_percent': r[4],
+                'luminosity_lux': r[5],
+                'presence_detected': bool(r[6]),
+                'power_on': bool(r[7])
+            }
+        }
+
+    def fetch_recent(self, limit: int = 100, after_id: Optional[int] = None) -> List[Dict[str, Any]]:
+        """Newest rows first. With after_id, the next `limit` rows after that id, oldest first
+        (same contract as DBController.fetch_recent)."""
+        with self._lock:
+            shards = sorted(self._shards.values(), key=lambda s: s.start, reverse=True)
+        if after_id is not None:
+            # Only shards that took rows since after_id (normally just the current one)
+            hits = [s for s in reversed(shards) if s.max_id > after_id]
+            rows = self._select(hits, f'SELECT {COLUMNS} FROM {{db}}.sensor_data WHERE id > ? '
+                                      f'ORDER BY id LIMIT ?', [after_id, limit],
+                                ' ORDER BY id LIMIT ?', [limit])
+            # Each attach group is sorted and limited on its own
+            rows.sort(key=lambda r: r[0])
+            return [self._row(r) for r in rows[:limit]]
+        # Shards partition arrival (and ids follow it): walk back from the newest until the limit is filled
+        out: List[Dict[str, Any]] = []
+        for shard in shards:
+            rows = self._select([shard], f'SELECT {COLUMNS} FROM {{db}}.sensor_data ORDER BY id DESC LIMIT ?',
+                                [limit - len(out)], '', [])
+            out.extend(self._row(r) for r in rows)
+            if len(out) >= limit:
+                break
+        return out
+
+    def fetch_series(self, node_id: str, metric: str, t_from: Optional[float] = None,
+                     t_to: Optional[float] = None) -> Tuple[array, array]:
+        """Raw (epoch seconds, value) columns of one metric for one node, time ordered, NULLs skipped."""
+        if metric not in SERIES_METRICS:
+            raise ValueError(f'unknown metric {metric!r}')
+        lo = -float('inf') if t_from is None else t_from
+        hi = float('inf') if t_to is None else t_to + self.max_lag_s
+        with self._lock:
+            shards = sorted((s for s in self._shards.values() if s.end > lo - CLOCK_SLACK_S and s.start <= hi),
+                            key=lambda s: s.start)
+        # Coarse arrival range on the (node_id, received_at) index, exact filter on the reading's time.
+        where, params = ['node_id = ?', f'{metric} IS NOT NULL'], [node_id]
+        if t_from is not None:
+            where.append('received_at >= ?')
+            params.append(t_from - CLOCK_SLACK_S)
+        if t_to is not None:
+            where.append('received_at <= ?')
+            params.append(hi)
+        branch = (f'SELECT timestamp, received_at, {metric} FROM {{db}}.sensor_data '
+                  f'WHERE {" AND ".join(where)} ORDER BY received_at')
+
+        ts, vs = array('d'), array('d')
+        for stamp, arrival, value in self._select(shards, branch, params, '', []):
+            t = _epoch(stamp)
+            if t is None or t < MIN_WALL_CLOCK:
+                t = arrival
+            if (t_from is not None and t < t_from) or (t_to is not None and t > t_to):
+                continue
+            ts.append(t)
+            vs.append(float(value))
+        # Backlogged readings arrive after newer ones.
+        if any(ts[i] > ts[i + 1] for i in range(len(ts) - 1)):
+            order = sorted(range(len(ts)), key=ts.__getitem__)
+            ts, vs = array('d', (ts[i] for i in order)), array('d', (vs[i] for i in order))
+        return ts, vs
+
+    def stats(self) -> Dict[str, Any]:
+        with self._lock:
+            shards = sorted(self._shards.values(), key=lambda s: s.start)
+            return {
+                'period': self.period,
+                'shards': len(shards),
+                'oldest': _stamp(shards[0].start) if shards else None,
+                'next_id': self._next_id,
+                'dropped_shards': self.dropped_shards,
+            }
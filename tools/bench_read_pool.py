@@ -0,0 +1,151 @@
+"""Dashboard query latency under concurrent ingest: per-call connections vs the read pool.
+
+Preloads a database, then for each mode runs one writer thread calling DBController.save()
+at a fixed rate while reader threads issue the dashboard's queries back to back:
+  poll    fetch_recent(100, after_id=...)    the incremental /data request
+  series  fetch_series(node, metric, 1 h)    the /series chart request
+Reports p50/p95/p99/max latency per query and the write rate actually achieved.
+
+Usage:
+    python tools/bench_read_pool.py --preload 500000 --writes 200 --readers 4 --seconds 10
+"""
+import argparse
+import random
+import shutil
+import sys
+import threading
+import time
+from pathlib import Path
+from typing import Dict, List
+
+sys.path.insert(0, str(Path(__file__).resolve().parent.parent))
+
+from server import DBController  # noqa: E402
+
+NODES = 20
+
+
+def payload(i: int, t: float) -> dict:
+    return {
+        'node_id': f'node-{i % NODES}',
+        'timestamp': time.strftime('%Y-%m-%dT%H:%M:%S', time.gmtime(t)),
+        'sensors': {
+            'temperature_celsius': round(20 + 10 * random.random(), 2),
+            'humidity_percent': round(40 + 20 * random.random(), 2),
+            'luminosity_lux': round(300 * random.random(), 2),
+            'presence_detected': random.random() < 0.2,
+            'power_on': True,
+        },
+    }
+
+
+def preload(path: Path, rows: int) -> None:
+    db = DBController(path)
+    db.initialize()
+    now = time.time()
+    sql = '''
+        INSERT INTO sensor_data (
+            node_id, timestamp, temperature_celsius, humidity_percent,
+            luminosity_lux, presence_detected, power_on
+        ) VALUES (?, ?, ?, ?, ?, ?, ?)
+    '''
+    with db._connect() as conn:
+        batch = []
+        for i in range(rows):
+            p = payload(i, now - (rows - i) * 10.0 / NODES)
+            s = p['sensors']
+            batch.append((p['node_id'], p['timestamp'], s['temperature_celsius'], s['humidity_percent'],
+                          s['luminosity_lux'], int(s['presence_detected']), int(s['power_on'])))
+            if len(batch) == 10000:
+                conn.executemany(sql, batch)
+                batch.clear()
+        conn.executemany(sql, batch)
+        conn.commit()
+
+
+def pct(sorted_ms: List[float], p: float) -> float:
+    return sorted_ms[min(len(sorted_ms) - 1, int(p / 100 * len(sorted_ms)))] if sorted_ms else 0.0
+
+
+def run(path: Path, pool_size: int, writes_per_s: float, readers: int, seconds: float) -> Dict[str, object]:
+    db = DBController(path, read_pool_size=pool_size)
+    stop = threading.Event()
+    lat: Dict[str, List[float]] = {'poll': [], 'series': []}
+    lock = threading.Lock()
+    written = [0]
+    errors = [0]
+
+    def writer() -> None:
+        i, t0 = 0, time.perf_counter()
+        while not stop.is_set():
+            due = t0 + i / writes_per_s
+            delay = due - time.perf_counter()
+            if delay > 0:
+                time.sleep(delay)
+            try:
+                db.save(payload(i, time.time()))
+                written[0] += 1
+            except Exception:
+                errors[0] += 1
+            i += 1
+
+    def reader(k: int) -> None:
+        rnd = random.Random(k)
+        with db._reader() as conn:
+            last = conn.execute('SELECT MAX(id) FROM sensor_data').fetchone()[0] or 0
+        while not stop.is_set():
+            kind = 'poll' if rnd.random() < 0.8 else 'series'
+            t0 = time.perf_counter()
+            try:
+                if kind == 'poll':
+                    rows = db.fetch_recent(100, after_id=max(0, last - 100))
+                    if rows:
+                        last = rows[-1]['id']
+                else:
+                    db.fetch_series(f'node-{rnd.randrange(NODES)}', 'temperature_celsius', time.time() - 3600)
+            except Exception:
+                errors[0] += 1
+                continue
+            ms = (time.perf_counter() - t0) * 1000.0
+            with lock:
+                lat[kind].append(ms)
+
+    threads = [threading.Thread(target=writer)] + [threading.Thread(target=reader, args=(k,)) for k in range(readers)]
+    for t in threads:
+        t.start()
+    time.sleep(seconds)
+    stop.set()
+    for t in threads:
+        t.join()
+    db.close()
+    return {'lat': {k: sorted(v) for k, v in lat.items()}, 'writes': written[0] / seconds, 'errors': errors[0]}
+
+
+def main() -> None:
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument('--db', type=Path, default=Path('/tmp/bench_read_pool/telemetry.db'))
+    p.add_argument('--preload', type=int, default=500_000)
+    p.add_argument('--writes', type=float, default=200.0, help='target save() calls per second')
+    p.add_argument('--readers', type=int, default=4)
+    p.add_argument('--pool', type=int, default=4, help='read pool size for the pooled run')
+    p.add_argument('--seconds', type=float, default=10.0)
+    args = p.parse_args()
+
+    shutil.rmtree(args.db.parent, ignore_errors=True)
+    args.db.parent.mkdir(parents=True)
+    print(f'preloading {args.preload:,} rows...')
+    preload(args.db, args.preload)
+
+    print(f'{args.readers} reader(s), writer at {args.writes:g}/s, {args.seconds:g}s per mode')
+    print(f'{"mode":10} {"query":7} {"count":>7} {"p50 ms":>8} {"p95 ms":>8} {"p99 ms":>8} {"max ms":>8} '
+          f'{"writes/s":>9} {"errors":>7}')
+    for mode, pool in (('per-call', 0), ('pooled', args.pool)):
+        res = run(args.db, pool, args.writes, args.readers, args.seconds)
+        for kind, ms in res['lat'].items():
+            print(f'{mode:10} {kind:7} {len(ms):7} {pct(ms, 50):8.2f} {pct(ms, 95):8.2f} {pct(ms, 99):8.2f} '
+                  f'{(ms[-1] if ms else 0):8.2f} {res["writes"]:9.1f} {res["errors"]:7}')
+    shutil.rmtree(args.db.parent, ignore_errors=True)
+
+
+if __name__ == '__main__':
+    main()
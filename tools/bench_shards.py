@@ -0,0 +1,166 @@
+"""Query and retention latency as history grows: one telemetry.db vs per-day shard files.
+
+Grows the same synthetic history in both engines one day at a time, and at each checkpoint
+in --days (with the end of the loaded history as "now") times:
+  series 1h   fetch_series(node, metric, last hour)       the /series chart request
+  series 24h  fetch_series(node, metric, last 24 hours)
+  poll        fetch_recent(100, after_id=...)              the incremental /data request
+  recent      fetch_recent(100)                            a dashboard (re)load
+  drop day    retention of the oldest day: DELETE ... WHERE timestamp < cutoff on the single
+              file, unlinking the oldest shard on the sharded store
+Query figures are medians over --repeat calls. The single file grows with every checkpoint;
+the sharded store only ever touches the shards a request intersects, so its columns should
+stay flat while the single-file ones climb.
+
+Like real nodes without a wall clock, --uptime-share of the nodes stamp readings with their
+uptime (a 1970 date after the gateway's conversion). The sharded store routes by arrival,
+so those readings still land in the current shard, age out with retention and chart by
+arrival time; each checkpoint checks that. Query timings use the wall-clock nodes, which
+the single file can also serve.
+
+Usage:
+    python tools/bench_shards.py --days 7,30,90 --rows-per-day 28800 --nodes 20
+"""
+import argparse
+import random
+import shutil
+import statistics
+import sys
+import time
+from itertools import groupby
+from pathlib import Path
+from typing import Callable, List, Tuple
+
+sys.path.insert(0, str(Path(__file__).resolve().parent.parent))
+
+from server import DBController  # noqa: E402
+from shard_store import ShardedStore  # noqa: E402
+
+BATCH = 10000
+
+
+def day_payloads(day_start: float, rows: int, nodes: int, uptime_nodes: int,
+                 rnd: random.Random) -> List[Tuple[float, dict]]:
+    """(arrival, payload) pairs; the first uptime_nodes nodes report uptime since day_start."""
+    period = 86400.0 * nodes / rows
+    out = []
+    for i in range(rows):
+        t = day_start + (i // nodes) * period
+        stamp = t - day_start if i % nodes < uptime_nodes else t
+        out.append((t, {
+            'node_id': f'node-{i % nodes}',
+            'timestamp': time.strftime('%Y-%m-%dT%H:%M:%S', time.gmtime(stamp)),
+            'sensors': {
+                'temperature_celsius': round(20 + 10 * rnd.random(), 2),
+                'humidity_percent': round(40 + 20 * rnd.random(), 2),
+                'luminosity_lux': round(300 * rnd.random(), 2),
+                'presence_detected': rnd.random() < 0.2,
+                'power_on': True,
+            },
+        }))
+    return out
+
+
+def load_single(db: DBController, readings: List[Tuple[float, dict]]) -> None:
+    conn = db._writer_conn()
+    rows = [db._row_params(p) for _, p in readings]
+    for i in range(0, len(rows), BATCH):
+        conn.executemany(db.INSERT_SQL, rows[i:i + BATCH])
+        conn.commit()
+
+
+def load_sharded(store: ShardedStore, readings: List[Tuple[float, dict]]) -> None:
+    # One save_many per arrival instant, as the server sees them
+    for _, group in groupby(readings, key=lambda r: r[0]):
+        group = list(group)
+        store.save_many([p for _, p in group], received_at=group[0][0])
+
+
+def median_ms(fn: Callable[[], object], repeat: int) -> float:
+    samples = []
+    for _ in range(repeat):
+        t0 = time.perf_counter()
+        fn()
+        samples.append((time.perf_counter() - t0) * 1000.0)
+    return statistics.median(samples)
+
+
+def drop_single(db: DBController, cutoff: float) -> None:
+    stamp = time.strftime('%Y-%m-%dT%H:%M:%S', time.gmtime(cutoff))
+    with db._write_lock:
+        conn = db._writer_conn()
+        conn.execute('DELETE FROM sensor_data WHERE timestamp < ?', (stamp,))
+        conn.commit()
+
+
+def main() -> None:
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument('--days', default='7,30,90', help='history sizes (days) to measure at, ascending')
+    p.add_argument('--rows-per-day', type=int, default=28800, help='readings per day over all nodes')
+    p.add_argument('--nodes', type=int, default=20)
+    p.add_argument('--uptime-share', type=float, default=0.25,
+                   help='fraction of nodes stamping readings with uptime instead of wall-clock time')
+    p.add_argument('--repeat', type=int, default=15, help='calls per query measurement')
+    p.add_argument('--dir', type=Path, default=Path('/tmp/bench_shards'))
+    p.add_argument('--keep', action='store_true', help='keep the data files afterwards')
+    args = p.parse_args()
+
+    checkpoints = sorted(int(d) for d in args.days.split(','))
+    uptime_nodes = min(args.nodes - 1, int(args.nodes * args.uptime_share))
+    shutil.rmtree(args.dir, ignore_errors=True)
+    args.dir.mkdir(parents=True)
+    single = DBController(args.dir / 'telemetry.db')
+    single.initialize()
+    sharded = ShardedStore(args.dir / 'shards', 'day')
+    sharded.initialize()
+    engines = (('single', single, load_single), ('sharded', sharded, load_sharded))
+
+    # History runs forward from `first` day by day; "now" is the end of the loaded history,
+    # so row ids grow with time as they do on a live server.
+    rnd = random.Random(1)
+    first = int(time.time() // 86400) * 86400.0 - checkpoints[-1] * 86400
+    end = first
+    print(f'{args.rows_per_day:,} rows/day, {args.nodes} nodes; medians of {args.repeat} calls')
+    print(f'{"days":>5} {"rows":>11} {"engine":8} {"series 1h":>10} {"series 24h":>11} {"poll":>7} '
+          f'{"recent":>8} {"drop day":>9}   (ms)')
+    for target in checkpoints:
+        while (end - first) / 86400 < target:
+            batch = day_payloads(end, args.rows_per_day, args.nodes, uptime_nodes, rnd)
+            for _, engine, load in engines:
+                load(engine, batch)
+            end += 86400
+
+        now = end - 1
+        total = target * args.rows_per_day
+        for name, engine, _ in engines:
+            last_id = engine.fetch_recent(1)[0]['id']
+            node = lambda: f'node-{rnd.randrange(uptime_nodes, args.nodes)}'  # noqa: E731
+            s1 = median_ms(lambda: engine.fetch_series(node(), 'temperature_celsius', now - 3600, now), args.repeat)
+            s24 = median_ms(lambda: engine.fetch_series(node(), 'temperature_celsius', now - 86400, now), args.repeat)
+            poll = median_ms(lambda: engine.fetch_recent(100, after_id=last_id - 100), args.repeat)
+            recent = median_ms(lambda: engine.fetch_recent(100), args.repeat)
+            t0 = time.perf_counter()
+            if name == 'single':
+                drop_single(engine, first + 86400)
+            else:
+                engine.drop_before(first + 86400)
+            drop = (time.perf_counter() - t0) * 1000.0
+            print(f'{target:5} {total:11,} {name:8} {s1:10.2f} {s24:11.2f} {poll:7.2f} {recent:8.2f} {drop:9.2f}')
+        if uptime_nodes:
+            ts, _ = sharded.fetch_series('node-0', 'temperature_celsius', now - 86400, now)
+            oldest = sharded.stats()['oldest']
+            print(f'      uptime-clock node-0 on the sharded store: {len(ts)} points in the last 24 h, '
+                  f'oldest shard {oldest}')
+            if not ts:
+                raise SystemExit('readings stamped with uptime were not served by arrival time')
+        # Both engines just lost their oldest day
+        first += 86400
+
+    single.close()
+    sharded.close()
+    if not args.keep:
+        shutil.rmtree(args.dir, ignore_errors=True)
+
+
+if __name__ == '__main__':
+    main()
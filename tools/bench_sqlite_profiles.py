@@ -0,0 +1,287 @@
+"""SQLite tuning profiles under a replayed ingest + dashboard query mix.
+
+For each profile in server.SQLITE_PROFILES (durable, balanced, throughput), builds a copy of
+the database with that profile's page size, then runs the server's traffic for a fixed time:
+  ingest  writer thread(s) replaying recent rows of the database with fresh timestamps, as the
+          bridge posts them: mostly one reading per save() (POST /data), some save_many()
+          batches (POST /frames)
+  poll    fetch_recent(100, after_id=...)        the incremental /data request
+  recent  fetch_recent(100)                      a dashboard (re)load
+  series  fetch_series(node, metric, 1 h | 24 h) the /series chart request
+Reports ingest rows/s and commits/s, fsyncs/s and query latency percentiles per query kind.
+
+fsyncs are derived from SQLite's sync points in WAL mode rather than traced: with
+synchronous=FULL every commit syncs the WAL; FULL and NORMAL sync the WAL and the database
+once per checkpoint; OFF never syncs. Checkpoints are counted from the wal-index after every
+commit, so the figure tracks what the run actually did.
+
+With --db the replay runs against copies of an existing telemetry.db (the original is only
+read); without it a synthetic history of --seed-rows readings is generated.
+
+Usage:
+    python tools/bench_sqlite_profiles.py --db telemetry.db --seconds 20
+    python tools/bench_sqlite_profiles.py --seed-rows 500000 --rate 500 --readers 4
+"""
+import argparse
+import random
+import shutil
+import sqlite3
+import struct
+import sys
+import threading
+import time
+from contextlib import closing
+from pathlib import Path
+from typing import Any, Dict, List
+
+sys.path.insert(0, str(Path(__file__).resolve().parent.parent))
+sys.path.insert(0, str(Path(__file__).resolve().parent))
+
+from server import DBController, SQLITE_PROFILES, parse_timestamp  # noqa: E402
+from bench_storage import synthetic  # noqa: E402
+from bench_read_pool import pct  # noqa: E402
+
+REPLAY_ROWS = 20000
+QUERY_MIX = (('poll', 0.70), ('recent', 0.10), ('series', 0.20))
+
+
+class CheckpointProbe:
+    """Counts checkpoints that copied frames into the database, seen after each commit.
+
+    Reads the wal-index (-shm): nBackfill grows when a checkpoint backfills frames and drops
+    back when the WAL restarts; the WAL header's checkpoint sequence number covers restarts
+    that happen between two observations. Readers that keep the WAL pinned stop restarts
+    but not backfills, so the WAL header alone would undercount under a query load.
+    """
+    def __init__(self, db_path: Path):
+        self.shm = str(db_path) + '-shm'
+        self.wal = str(db_path) + '-wal'
+        self.count = 0
+        self._lock = threading.Lock()
+        self._last = self._read()
+
+    def _read(self):
+        try:
+            with open(self.shm, 'rb') as f:
+                index = f.read(100)
+            with open(self.wal, 'rb') as f:
+                head = f.read(16)
+        except FileNotFoundError:
+            return (0, 0)
+        backfill = struct.unpack('<I', index[96:100])[0] if len(index) == 100 else 0
+        seq = struct.unpack('>I', head[12:16])[0] if len(head) == 16 else 0
+        return (seq, backfill)
+
+    def observe(self) -> None:
+        with self._lock:
+            seq, backfill = cur = self._read()
+            last_seq, last_backfill = self._last
+            if seq != last_seq:
+                self.count += (seq - last_seq) & 0xFFFFFFFF
+            elif backfill > last_backfill:
+                self.count += 1
+            self._last = cur
+
+
+def fsyncs(synchronous: str, commits: int, checkpoints: int) -> int:
+    if synchronous == 'OFF':
+        return 0
+    per_commit = 1 if synchronous in ('FULL', 'EXTRA') else 0
+    return commits * per_commit + checkpoints * 2
+
+
+def prepare(src: Path, dst: Path, profile: str, seed_rows: int, nodes: int) -> DBController:
+    """Fresh database for one profile: a copy of src rebuilt to the profile's page size, or synthetic rows."""
+    for suffix in ('', '-wal', '-shm'):
+        Path(str(dst) + suffix).unlink(missing_ok=True)
+    page_size = SQLITE_PROFILES[profile]['page_size']
+    if src is not None:
+        with closing(sqlite3.connect(f'{src.resolve().as_uri()}?mode=ro', uri=True)) as s, \
+                closing(sqlite3.connect(dst)) as d:
+            s.backup(d)
+            if d.execute('PRAGMA page_size;').fetchone()[0] != page_size:
+                d.execute('PRAGMA journal_mode = DELETE;')
+                d.execute(f'PRAGMA page_size = {page_size};')
+                d.execute('VACUUM;')
+        db = DBController(dst, profile=profile)
+        db.initialize()
+        return db
+
+    db = DBController(dst, profile=profile)
+    db.initialize()
+    period = 10.0
+    start = time.time() - seed_rows // nodes * period
+    rows = (db._row_params(p) for p in synthetic(seed_rows, nodes, start, period))
+    conn = db._writer_conn()
+    batch: List[Any] = []
+    for r in rows:
+        batch.append(r)
+        if len(batch) == 10000:
+            conn.executemany(db.INSERT_SQL, batch)
+            conn.commit()
+            batch.clear()
+    if batch:
+        conn.executemany(db.INSERT_SQL, batch)
+        conn.commit()
+    return db
+
+
+def replay_source(db: DBController) -> List[Dict[str, Any]]:
+    """Most recent rows of the database, oldest first: the ingest stream to replay."""
+    rows = list(reversed(db.fetch_recent(REPLAY_ROWS)))
+    if not rows:
+        raise SystemExit('database has no readings to replay')
+    return rows
+
+
+def run(db: DBController, replay: List[Dict[str, Any]], seconds: float, rate: float, writers: int,
+        readers: int, batch_max: int, batch_share: float) -> Dict[str, Any]:
+    nodes = sorted({r['node_id'] for r in replay})
+    newest = max(parse_timestamp(r['timestamp']) or 0.0 for r in replay)
+    stop = threading.Event()
+    lock = threading.Lock()
+    lat: Dict[str, List[float]] = {kind: [] for kind, _ in QUERY_MIX}
+    counts = {'rows': 0, 'commits': 0, 'errors': 0}
+
+    def writer(k: int) -> None:
+        rnd = random.Random(100 + k)
+        i, t0 = k, time.perf_counter()
+        while not stop.is_set():
+            n = rnd.randint(2, batch_max) if batch_max > 1 and rnd.random() < batch_share else 1
+            if rate > 0:
+                delay = t0 + counts['rows'] / rate - time.perf_counter()
+                if delay > 0:
+                    time.sleep(min(delay, 0.1))
+                    continue
+            stamp = time.strftime('%Y-%m-%dT%H:%M:%S', time.gmtime())
+            batch = []
+            for _ in range(n):
+                src = replay[i % len(replay)]
+                batch.append({'node_id': src['node_id'], 'timestamp': stamp, 'sensors': src['sensors']})
+                i += writers
+            try:
+                if n == 1:
+                    db.save(batch[0])
+                else:
+                    db.save_many(batch)
+            except sqlite3.Error:
+                with lock:
+                    counts['errors'] += 1
+                continue
+            probe.observe()
+            with lock:
+                counts['rows'] += n
+                counts['commits'] += 1
+
+    def reader(k: int) -> None:
+        rnd = random.Random(k)
+        with db._reader() as conn:
+            last = conn.execute('SELECT MAX(id) FROM sensor_data').fetchone()[0] or 0
+        while not stop.is_set():
+            x, kind = rnd.random(), QUERY_MIX[-1][0]
+            for name, share in QUERY_MIX:
+                if x < share:
+                    kind = name
+                    break
+                x -= share
+            t0 = time.perf_counter()
+            try:
+                if kind == 'poll':
+                    rows = db.fetch_recent(100, after_id=max(0, last - 100))
+                    if rows:
+                        last = rows[-1]['id']
+                elif kind == 'recent':
+                    db.fetch_recent(100)
+                else:
+                    span = 3600.0 if rnd.random() < 0.8 else 86400.0
+                    end = max(newest, time.time()) if rnd.random() < 0.5 else newest
+                    db.fetch_series(rnd.choice(nodes), 'temperature_celsius', end - span, end)
+            except sqlite3.Error:
+                with lock:
+                    counts['errors'] += 1
+                continue
+            ms = (time.perf_counter() - t0) * 1000.0
+            with lock:
+                lat[kind].append(ms)
+
+    probe = CheckpointProbe(db.db_path)
+    threads = ([threading.Thread(target=writer, args=(k,)) for k in range(writers)] +
+               [threading.Thread(target=reader, args=(k,)) for k in range(readers)])
+    t0 = time.perf_counter()
+    for t in threads:
+        t.start()
+    time.sleep(seconds)
+    stop.set()
+    for t in threads:
+        t.join()
+    elapsed = time.perf_counter() - t0
+    checkpoints = probe.count
+    db.close()
+    return {
+        'elapsed': elapsed,
+        'rows': counts['rows'],
+        'commits': counts['commits'],
+        'errors': counts['errors'],
+        'checkpoints': checkpoints,
+        'fsyncs': fsyncs(db.tuning['synchronous'], counts['commits'], checkpoints),
+        'lat': {k: sorted(v) for k, v in lat.items()},
+    }
+
+
+def main() -> None:
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument('--db', type=Path, help='existing telemetry.db to replay against (read only)')
+    p.add_argument('--seed-rows', type=int, default=300_000, help='synthetic history when --db is not given')
+    p.add_argument('--nodes', type=int, default=20, help='nodes in the synthetic history')
+    p.add_argument('--profiles', default=','.join(SQLITE_PROFILES))
+    p.add_argument('--seconds', type=float, default=10.0, help='run time per profile')
+    p.add_argument('--rate', type=float, default=0.0, help='target ingest rows/s (0 = as fast as possible)')
+    p.add_argument('--writers', type=int, default=1, help='concurrent ingest threads (server request threads)')
+    p.add_argument('--readers', type=int, default=4)
+    p.add_argument('--batch-max', type=int, default=16, help='largest save_many() batch')
+    p.add_argument('--batch-share', type=float, default=0.2, help='fraction of commits that are batches')
+    p.add_argument('--dir', type=Path, default=Path('/tmp/bench_sqlite_profiles'))
+    p.add_argument('--keep', action='store_true', help='keep the per-profile databases afterwards')
+    args = p.parse_args()
+
+    profiles = args.profiles.split(',')
+    for name in profiles:
+        if name not in SQLITE_PROFILES:
+            raise SystemExit(f'unknown profile {name} (have {", ".join(SQLITE_PROFILES)})')
+    if args.db is not None and not args.db.exists():
+        raise SystemExit(f'{args.db} not found')
+    shutil.rmtree(args.dir, ignore_errors=True)
+    args.dir.mkdir(parents=True)
+
+    source = f'{args.db}' if args.db else f'{args.seed_rows:,} synthetic rows, {args.nodes} nodes'
+    pace = f'{args.rate:g} rows/s' if args.rate > 0 else 'unpaced'
+    print(f'{source}; {args.writers} writer(s) {pace}, {args.readers} reader(s), {args.seconds:g}s per profile')
+
+    results = {}
+    for name in profiles:
+        db = prepare(args.db, args.dir / f'{name}.db', name, args.seed_rows, args.nodes)
+        replay = replay_source(db)
+        results[name] = (db, run(db, replay, args.seconds, args.rate, args.writers, args.readers,
+                                 args.batch_max, args.batch_share))
+
+    print(f'\n{"profile":11} {"sync":6} {"page":>5} {"cache MiB":>9} {"mmap MiB":>8} {"rows/s":>9} '
+          f'{"commits/s":>9} {"fsync/s":>8} {"ckpts":>6} {"errors":>6}')
+    for name, (db, r) in results.items():
+        t = db.tuning
+        print(f'{name:11} {t["synchronous"]:6} {db.page_size:5} {db.cache_kib / 1024:9.0f} '
+              f'{db.mmap_bytes / 2**20:8.0f} {r["rows"] / r["elapsed"]:9,.0f} {r["commits"] / r["elapsed"]:9,.0f} '
+              f'{r["fsyncs"] / r["elapsed"]:8.1f} {r["checkpoints"]:6} {r["errors"]:6}')
+
+    print(f'\n{"profile":11} {"query":7} {"count":>7} {"p50 ms":>8} {"p95 ms":>8} {"p99 ms":>8} {"max ms":>8}')
+    for name, (_, r) in results.items():
+        for kind, ms in r['lat'].items():
+            print(f'{name:11} {kind:7} {len(ms):7} {pct(ms, 50):8.2f} {pct(ms, 95):8.2f} {pct(ms, 99):8.2f} '
+                  f'{(ms[-1] if ms else 0):8.2f}')
+
+    if not args.keep:
+        shutil.rmtree(args.dir, ignore_errors=True)
+    print('\n(fsync/s is derived from commits and checkpoints; on tmpfs syncs cost nothing)')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,154 @@
+"""Ingest and scan benchmark: SQLite DBController vs the columnar segment store.
+
+Loads the same synthetic readings into both engines, then times the queries the server
+serves: a one-metric range scan (/series) and the newest rows (/data). Bulk loading uses
+each engine's best path (executemany in one transaction per batch for SQLite, save_many
+for the columnar store), so it compares storage layouts. The save() column times one row
+per call, which is what POST /data does.
+
+Measured on one core, warm page cache, 20 nodes (a 100M-row run takes about an hour and
+needs ~14 GB of scratch disk):
+
+    rows  engine    bulk rows/s  save() rows/s  B/row  scan 10% s  recent 100 ms
+      1M  sqlite         79,493         19,332  109.9       0.040            0.6
+      1M  columnar       78,741         71,948   36.1       0.010            1.3
+    100M  sqlite        100,457         36,087  106.1       2.366            4.7
+    100M  columnar      143,629        132,761   31.0       0.434            0.9
+
+Usage:
+    python tools/bench_storage.py --rows 1000000 --nodes 20 [--dir /tmp/bench] [--engines sqlite,columnar]
+"""
+import argparse
+import os
+import random
+import shutil
+import sys
+import time
+from pathlib import Path
+
+sys.path.insert(0, str(Path(__file__).resolve().parent.parent))
+
+from columnar_store import ColumnarStore  # noqa: E402
+from server import DBController  # noqa: E402
+
+BATCH = 10000
+
+
+def synthetic(rows: int, nodes: int, start: float, period_s: float):
+    rnd = random.Random(1)
+    for i in range(rows):
+        node = i % nodes
+        t = start + (i // nodes) * period_s
+        yield {
+            'node_id': f'node-{node}',
+            'timestamp': time.strftime('%Y-%m-%dT%H:%M:%S', time.gmtime(t)),
+            'sensors': {
+                'temperature_celsius': round(20 + 10 * rnd.random(), 2),
+                'humidity_percent': round(40 + 20 * rnd.random(), 2),
+                'luminosity_lux': round(300 * rnd.random(), 2),
+                'presence_detected': rnd.random() < 0.2,
+                'power_on': True,
+            },
+        }
+
+
+def dir_size(path: Path) -> int:
+    if path.is_file():
+        return path.stat().st_size
+    return sum(p.stat().st_size for p in path.rglob('*') if p.is_file())
+
+
+def load_sqlite(db: DBController, payloads) -> None:
+    sql = '''
+        INSERT INTO sensor_data (
+            node_id, timestamp, temperature_celsius, humidity_percent,
+            luminosity_lux, presence_detected, power_on
+        ) VALUES (?, ?, ?, ?, ?, ?, ?)
+    '''
+    batch = []
+    with db._connect() as conn:
+        for p in payloads:
+            s = p['sensors']
+            batch.append((p['node_id'], p['timestamp'], s['temperature_celsius'], s['humidity_percent'],
+                          s['luminosity_lux'], int(s['presence_detected']), int(s['power_on'])))
+            if len(batch) >= BATCH:
+                conn.executemany(sql, batch)
+                conn.commit()
+                batch.clear()
+        if batch:
+            conn.executemany(sql, batch)
+            conn.commit()
+
+
+def load_columnar(store: ColumnarStore, payloads) -> None:
+    batch = []
+    for p in payloads:
+        batch.append(p)
+        if len(batch) >= BATCH:
+            store.save_many(batch)
+            batch.clear()
+    if batch:
+        store.save_many(batch)
+
+
+def timed(fn, *args):
+    t0 = time.perf_counter()
+    result = fn(*args)
+    return time.perf_counter() - t0, result
+
+
+def main() -> None:
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument('--rows', type=int, default=1_000_000)
+    p.add_argument('--nodes', type=int, default=20)
+    p.add_argument('--period', type=float, default=10.0, help='seconds between readings of a node')
+    p.add_argument('--dir', type=Path, default=Path('/tmp/bench_storage'))
+    p.add_argument('--engines', default='sqlite,columnar')
+    p.add_argument('--api-rows', type=int, default=5000, help='rows timed through save() one at a time')
+    p.add_argument('--keep', action='store_true', help='keep the data files afterwards')
+    args = p.parse_args()
+
+    shutil.rmtree(args.dir, ignore_errors=True)
+    args.dir.mkdir(parents=True)
+    start = time.time() - args.rows // args.nodes * args.period
+    span = args.rows // args.nodes * args.period
+    # Scan the middle 10% of the history of one node.
+    scan_from, scan_to = start + span * 0.45, start + span * 0.55
+
+    print(f'{args.rows:,} rows, {args.nodes} nodes, one reading per {args.period:g}s per node')
+    print(f'{"engine":10} {"bulk rows/s":>12} {"save() rows/s":>14} {"size MB":>9} {"B/row":>7} {"scan 10% s":>11} '
+          f'{"scan pts":>9} {"scan pts/s":>12} {"recent 100 ms":>14}')
+    for engine in args.engines.split(','):
+        if engine == 'sqlite':
+            path = args.dir / 'telemetry.db'
+            db = DBController(path)
+            db.initialize()
+            load_time, _ = timed(load_sqlite, db, synthetic(args.rows, args.nodes, start, args.period))
+        elif engine == 'columnar':
+            path = args.dir / 'columnar'
+            db = ColumnarStore(path)
+            db.initialize()
+            load_time, _ = timed(load_columnar, db, synthetic(args.rows, args.nodes, start, args.period))
+        else:
+            raise SystemExit(f'unknown engine {engine}')
+
+        api = list(synthetic(args.api_rows, args.nodes, start + span + args.period, args.period))
+        api_time, _ = timed(lambda: [db.save(x) for x in api])
+
+        size = dir_size(path) + (dir_size(Path(str(path) + '-wal')) if Path(str(path) + '-wal').exists() else 0)
+        scan_time, (ts, _) = timed(db.fetch_series, 'node-0', 'temperature_celsius', scan_from, scan_to)
+        recent_time, _ = timed(db.fetch_recent, 100)
+        print(f'{engine:10} {args.rows / load_time:12,.0f} {len(api) / api_time:14,.0f} {size / 1e6:9.1f} {size / args.rows:7.1f} '
+              f'{scan_time:11.3f} {len(ts):9,} {len(ts) / scan_time if scan_time else 0:12,.0f} '
+              f'{recent_time * 1000:14.1f}')
+        if engine == 'columnar':
+            db.close()
+
+    if not args.keep:
+        shutil.rmtree(args.dir, ignore_errors=True)
+    if os.name == 'posix':
+        print('(page cache is warm; drop caches between runs for cold-read numbers)')
+
+
+if __name__ == '__main__':
+    main()
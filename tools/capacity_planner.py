@@ -0,0 +1,371 @@
+"""Gateway capacity planner built from the firmware's own link configuration.
+
+Reads the #define defaults the client firmware compiles with (config.h: LinkCfg,
+NodeCfg, TxPolicy, SamplerCfg) plus the frame sizes asserted in protocol.h, so the
+numbers follow the tree instead of hand-copied constants. -D NAME=VALUE overrides a
+define the same way a PlatformIO build flag would.
+
+For N nodes reporting every interval it reports:
+  - time on air of the frame the node actually sends (v2, legacy or summary)
+  - channel utilisation (offered load) and expected PDR, analytically (pure ALOHA)
+    and by Monte Carlo over periodic transmitters with clock drift and loop jitter
+  - per-node duty cycle against the regional limit for LORA_FREQUENCY_MHZ
+  - the largest node count per gateway that still meets --target-pdr
+Monte Carlo trials and sweep points run in parallel across cores.
+
+Usage:
+    python tools/capacity_planner.py show
+    python tools/capacity_planner.py plan --nodes 200 [--interval 60] [-D LORA_SPREADING_FACTOR=10]
+    python tools/capacity_planner.py sweep --nodes 50:1000:50 --intervals 10,60,300
+"""
+import argparse
+import math
+import os
+import random
+import re
+import sys
+from concurrent.futures import ProcessPoolExecutor
+from pathlib import Path
+from typing import Dict, List, Optional, Sequence, Tuple
+
+from lora_sim import Radio, _print_table, time_on_air_ms
+
+ROOT = Path(__file__).resolve().parent.parent
+CLIENT_INCLUDE = ROOT / 'firmware' / 'client' / 'include'
+
+# Per-node transmit limits by band: (name, low MHz, high MHz, duty fraction, max dwell ms)
+REGIONS = [
+    ('EU433', 433.05, 434.79, 0.10, None),
+    ('EU868', 863.0, 870.0, 0.01, None),
+    ('US915', 902.0, 928.0, None, 400.0),
+]
+
+# Time between radio.transmit() returning and the next one starting that is not
+# TX_INTERVAL_MS: sensor reads, loop delays, serial logging.
+LOOP_OVERHEAD_MS = 150.0
+
+_DEFINE = re.compile(r'^\s*#\s*define\s+([A-Za-z_]\w*)\b(?!\()\s*(.*)$')
+_SIZEOF = re.compile(r'static_assert\(\s*sizeof\((\w+)\)\s*==\s*(\d+)')
+
+
+# =====================================================
+# Firmware configuration
+# =====================================================
+
+def _c_to_py(expr: str) -> str:
+    expr = expr.split('//')[0].strip()
+    expr = re.sub(r'(\d+(?:\.\d+)?)(?:[uU]?[lL]{0,2}|[fF])\b', r'\1', expr)
+    expr = expr.replace('&&', ' and ').replace('||', ' or ')
+    expr = re.sub(r'!(?!=)', ' not ', expr)
+    # (cond ? a : b), innermost first
+    ternary = re.compile(r'\(([^()?]+)\?([^():]+):([^()]+)\)')
+    while ternary.search(expr):
+        expr = ternary.sub(r'((\2) if (\1) else (\3))', expr)
+    return re.sub(r'\btrue\b', 'True', re.sub(r'\bfalse\b', 'False', expr))
+
+
+def read_defines(paths: Sequence[Path], overrides: Dict[str, str]) -> Dict[str, object]:
+    """First #define of each object-like macro (the #ifndef default), overrides applied."""
+    raw: Dict[str, str] = {}
+    for path in paths:
+        for line in path.read_text(encoding='utf-8').splitlines():
+            m = _DEFINE.match(line)
+            if m and m.group(1) not in raw:
+                raw[m.group(1)] = m.group(2)
+    raw.update(overrides)
+
+    values: Dict[str, object] = {}
+
+    def resolve(name: str, depth: int = 0) -> object:
+        if name in values:
+            return values[name]
+        if depth > 32 or name not in raw:
+            raise KeyError(name)
+        expr = _c_to_py(raw[name])
+        env = {}
+        for ident in set(re.findall(r'[A-Za-z_]\w*', expr)) - {'and', 'or', 'not', 'if', 'else', 'True', 'False'}:
+            env[ident] = resolve(ident, depth + 1)
+        values[name] = eval(expr, {'__builtins__': {}}, env) if expr else True
+        return values[name]
+
+    for name in raw:
+        try:
+            resolve(name)
+        except Exception:       # function-like bodies, printf macros, struct lists
+            pass
+    return values
+
+
+def read_frame_sizes(protocol_h: Path) -> Dict[str, int]:
+    return {m.group(1): int(m.group(2)) for m in _SIZEOF.finditer(protocol_h.read_text(encoding='utf-8'))}
+
+
+class LinkPlan:
+    """What a client built from a given config puts on the air."""
+
+    def __init__(self, include_dir: Path = CLIENT_INCLUDE, overrides: Optional[Dict[str, str]] = None):
+        self.cfg = read_defines([include_dir / 'config.h', include_dir / 'protocol.h'], overrides or {})
+        self.sizes = read_frame_sizes(include_dir / 'protocol.h')
+        c = self.cfg
+        self.radio = Radio(int(c['LORA_SPREADING_FACTOR']), float(c['LORA_BANDWIDTH_KHZ']),
+                           int(c['LORA_CODING_RATE']), int(c['LORA_PREAMBLE_LEN']))
+        self.freq_mhz = float(c['LORA_FREQUENCY_MHZ'])
+        self.interval_ms = float(c['TX_INTERVAL_MS'])
+        self.adaptive = bool(c['ENABLE_ADAPTIVE_TX'])
+        self.retries = int(c['MAX_TX_RETRIES'])
+        if c.get('ENABLE_SAMPLER') and not c.get('ENABLE_DEEP_SLEEP'):
+            self.frame, self.frame_len = 'SensorSummaryMessage', self.sizes['SensorSummaryMessage']
+        elif c.get('USE_LEGACY_FRAME'):
+            self.frame, self.frame_len = 'SensorDataMessage', self.sizes['SensorDataMessage']
+        else:
+            self.frame, self.frame_len = 'SensorDataMessageV2', self.sizes['SensorDataMessageV2']
+
+    @property
+    def toa_ms(self) -> float:
+        return time_on_air_ms(self.frame_len, self.radio)
+
+    def period_ms(self, interval_ms: Optional[float] = None) -> float:
+        """Loop period: the firmware delays TX_INTERVAL_MS after each transmit() returns."""
+        return (interval_ms if interval_ms is not None else self.interval_ms) + self.toa_ms + LOOP_OVERHEAD_MS
+
+    def relay_batch_len(self, records: int) -> int:
+        return 4 + records * self.sizes['RelayRecord'] + 1
+
+    def region(self) -> Tuple[str, Optional[float], Optional[float]]:
+        for name, lo, hi, duty, dwell in REGIONS:
+            if lo <= self.freq_mhz <= hi:
+                return name, duty, dwell
+        return 'unknown', None, None
+
+
+# =====================================================
+# Collision models
+# =====================================================
+
+def offered_load(nodes: int, toa_ms: float, period_ms: float) -> float:
+    return nodes * toa_ms / period_ms
+
+
+def analytic_pdr(nodes: int, toa_ms: float, period_ms: float) -> float:
+    """Pure ALOHA against the other N-1 nodes' load (a lone node never collides)."""
+    return math.exp(-2.0 * offered_load(max(nodes - 1, 0), toa_ms, period_ms))
+
+
+def analytic_max_nodes(target_pdr: float, toa_ms: float, period_ms: float) -> int:
+    """Largest N with analytic_pdr(N) >= target."""
+    return 1 + int(-math.log(target_pdr) / 2.0 * period_ms / toa_ms)
+
+
+def monte_carlo(nodes: int, toa_ms: float, period_ms: float, duration_s: float,
+                jitter_ms: float, drift_ppm: float, seed: int) -> Tuple[int, int, float]:
+    """One trial. Returns (sent, delivered, busy fraction of the channel).
+
+    Each node starts at a random phase and keeps its own period (crystal error up to
+    +/-drift_ppm) with a uniform +/-jitter_ms per cycle. A packet is lost if it overlaps
+    any other; no capture effect, so this is the pessimistic single-channel case.
+    """
+    rnd = random.Random(seed)
+    horizon = duration_s * 1000.0
+    starts: List[float] = []
+    for _ in range(nodes):
+        period = period_ms * (1.0 + rnd.uniform(-drift_ppm, drift_ppm) * 1e-6)
+        t = rnd.uniform(0.0, period)
+        while t < horizon:
+            starts.append(t)
+            t += period + rnd.uniform(-jitter_ms, jitter_ms)
+    starts.sort()
+
+    delivered = 0
+    busy = 0.0
+    prev_end = -math.inf        # latest end among earlier packets
+    for i, s in enumerate(starts):
+        e = s + toa_ms
+        clash = s < prev_end or (i + 1 < len(starts) and starts[i + 1] < e)
+        if not clash:
+            delivered += 1
+        busy += e - max(s, prev_end) if e > prev_end else 0.0
+        prev_end = max(prev_end, e)
+    return len(starts), delivered, min(busy / horizon, 1.0) if horizon > 0 else 0.0
+
+
+def _trial(args: Tuple) -> Tuple[int, int, float]:
+    return monte_carlo(*args)
+
+
+def simulate(pool: ProcessPoolExecutor, points: Sequence[Tuple[int, float]], toa_ms: float,
+             opts: argparse.Namespace) -> Dict[Tuple[int, float], Dict[str, float]]:
+    """Runs opts.trials trials for every (nodes, period_ms) point, spread over the pool."""
+    jobs = [(n, toa_ms, p, opts.duration, opts.jitter, opts.drift_ppm, opts.seed + 7919 * k + n)
+            for n, p in points for k in range(opts.trials)]
+    results = list(pool.map(_trial, jobs, chunksize=max(1, len(jobs) // (4 * (opts.workers or os.cpu_count() or 1)))))
+    out: Dict[Tuple[int, float], Dict[str, float]] = {}
+    for i, (n, p) in enumerate(points):
+        chunk = results[i * opts.trials:(i + 1) * opts.trials]
+        sent = sum(r[0] for r in chunk)
+        ok = sum(r[1] for r in chunk)
+        pdrs = [r[1] / r[0] for r in chunk if r[0]]
+        mean = ok / sent if sent else 1.0
+        sd = math.sqrt(sum((x - mean) ** 2 for x in pdrs) / (len(pdrs) - 1)) if len(pdrs) > 1 else 0.0
+        out[(n, p)] = {
+            'pdr': mean,
+            'pdr_ci95': 1.96 * sd / math.sqrt(len(pdrs)) if pdrs else 0.0,
+            'busy': sum(r[2] for r in chunk) / len(chunk),
+            'packets': sent,
+        }
+    return out
+
+
+def mc_max_nodes(pool: ProcessPoolExecutor, toa_ms: float, period_ms: float, target: float,
+                 opts: argparse.Namespace) -> int:
+    """Largest N meeting target PDR: one parallel grid around the analytic answer, then bisection."""
+    guess = max(analytic_max_nodes(target, toa_ms, period_ms), 1)
+    grid = sorted({max(1, int(guess * f)) for f in (0.25, 0.5, 0.75, 1.0, 1.25, 1.5, 2.0, 3.0)})
+    res = simulate(pool, [(n, period_ms) for n in grid], toa_ms, opts)
+    passing = [n for n in grid if res[(n, period_ms)]['pdr'] >= target]
+    if not passing:
+        lo, hi = 0, grid[0]
+    else:
+        lo = max(passing)
+        above = [n for n in grid if n > lo]
+        if not above:
+            return lo
+        hi = min(above)
+    while hi - lo > max(1, lo // 50):
+        mid = (lo + hi) // 2
+        if simulate(pool, [(mid, period_ms)], toa_ms, opts)[(mid, period_ms)]['pdr'] >= target:
+            lo = mid
+        else:
+            hi = mid
+    return lo
+
+
+# =====================================================
+# Commands
+# =====================================================
+
+def _duty_report(plan: LinkPlan, period_ms: float) -> Tuple[str, str]:
+    region, duty, dwell = plan.region()
+    node_duty = plan.toa_ms / period_ms
+    checks = []
+    if duty is not None:
+        ok = node_duty <= duty
+        min_interval = plan.toa_ms / duty - plan.toa_ms - LOOP_OVERHEAD_MS
+        checks.append(f"{'OK' if ok else 'VIOLATES'} {duty * 100:g}% limit"
+                      + ('' if ok else f' (needs TX_INTERVAL_MS >= {math.ceil(min_interval)})'))
+    if dwell is not None:
+        checks.append(f"{'OK' if plan.toa_ms <= dwell else 'VIOLATES'} {dwell:g} ms dwell")
+    return f'{node_duty * 100:.3f}%', f"{region}: {', '.join(checks) if checks else 'no limit known'}"
+
+
+def cmd_show(plan: LinkPlan, opts: argparse.Namespace) -> None:
+    c = plan.cfg
+    r = plan.radio
+    print(f'config: {opts.include}')
+    print(f'  LORA_FREQUENCY_MHZ={plan.freq_mhz:g}  SF{r.sf}  BW {r.bw_khz:g} kHz  CR 4/{r.cr}  '
+          f'preamble {r.preamble}')
+    print(f'  TX_INTERVAL_MS={plan.interval_ms:g}  ENABLE_DEEP_SLEEP={c.get("ENABLE_DEEP_SLEEP")}  '
+          f'ENABLE_SAMPLER={c.get("ENABLE_SAMPLER")}  USE_LEGACY_FRAME={c.get("USE_LEGACY_FRAME")}')
+    print(f'  ENABLE_ADAPTIVE_TX={plan.adaptive}  MAX_TX_RETRIES={plan.retries}  '
+          f'ENABLE_RELAY={c.get("ENABLE_RELAY")}  RELAY_BATCH_MAX={c.get("RELAY_BATCH_MAX")}')
+    print(f'  node sends {plan.frame} ({plan.frame_len} bytes)')
+    rows = [['frame', 'bytes', 'toa_ms']]
+    for name in ('SensorDataMessage', 'SensorDataMessageV2', 'SensorSummaryMessage'):
+        if name in plan.sizes:
+            rows.append([name, str(plan.sizes[name]), f'{time_on_air_ms(plan.sizes[name], r):.1f}'])
+    for n in (1, int(c.get('RELAY_BATCH_MAX', 8)), int(c.get('RELAY_MAX_RECORDS', 14))):
+        rows.append([f'RelayBatch x{n}', str(plan.relay_batch_len(n)),
+                     f'{time_on_air_ms(plan.relay_batch_len(n), r):.1f}'])
+    _print_table(rows)
+
+
+def cmd_plan(plan: LinkPlan, opts: argparse.Namespace) -> None:
+    period = plan.period_ms(opts.interval * 1000.0 if opts.interval else None)
+    toa = plan.toa_ms
+    load = offered_load(opts.nodes, toa, period)
+    duty, compliance = _duty_report(plan, period)
+    print(f'{opts.nodes} node(s) sending {plan.frame} ({plan.frame_len} B, ToA {toa:.1f} ms) '
+          f'every {period / 1000:.2f} s, SF{plan.radio.sf}/{plan.radio.bw_khz:g} kHz')
+    if plan.adaptive:
+        print('  ENABLE_ADAPTIVE_TX=true: the interval is the worst case (every reading sent)')
+    with ProcessPoolExecutor(max_workers=opts.workers) as pool:
+        mc = simulate(pool, [(opts.nodes, period)], toa, opts)[(opts.nodes, period)]
+        mc_max = mc_max_nodes(pool, toa, period, opts.target_pdr, opts)
+    rows = [
+        ['', 'analytic', 'monte carlo'],
+        ['channel utilisation', f'{load * 100:.2f}%', f"{mc['busy'] * 100:.2f}% busy"],
+        ['PDR', f'{analytic_pdr(opts.nodes, toa, period):.4f}', f"{mc['pdr']:.4f} +/- {mc['pdr_ci95']:.4f}"],
+        [f'max nodes @ PDR {opts.target_pdr:g}', str(analytic_max_nodes(opts.target_pdr, toa, period)), str(mc_max)],
+    ]
+    _print_table(rows)
+    print(f"node duty cycle {duty}  {compliance}")
+    print(f"({opts.trials} trial(s) x {opts.duration:g} s, {mc['packets']} packets, "
+          f'jitter +/-{opts.jitter:g} ms, drift +/-{opts.drift_ppm:g} ppm)')
+
+
+def _parse_range(spec: str) -> List[int]:
+    if ':' in spec:
+        a, b, *step = (int(x) for x in spec.split(':'))
+        return list(range(a, b + 1, step[0] if step else 1))
+    return [int(x) for x in spec.split(',')]
+
+
+def cmd_sweep(plan: LinkPlan, opts: argparse.Namespace) -> None:
+    nodes = _parse_range(opts.nodes)
+    intervals = [float(x) for x in opts.intervals.split(',')] if opts.intervals else [plan.interval_ms / 1000.0]
+    toa = plan.toa_ms
+    points = [(n, plan.period_ms(i * 1000.0)) for i in intervals for n in nodes]
+    with ProcessPoolExecutor(max_workers=opts.workers) as pool:
+        res = simulate(pool, points, toa, opts)
+    print(f'{plan.frame} ({plan.frame_len} B, ToA {toa:.1f} ms), SF{plan.radio.sf}/{plan.radio.bw_khz:g} kHz, '
+          f'{opts.trials} trial(s) x {opts.duration:g} s per point')
+    rows = [['interval_s', 'nodes', 'util', 'pdr_aloha', 'pdr_mc', 'ci95', 'node_duty', 'max_nodes']]
+    for i, interval in enumerate(intervals):
+        period = plan.period_ms(interval * 1000.0)
+        nmax = analytic_max_nodes(opts.target_pdr, toa, period)
+        duty, _ = _duty_report(plan, period)
+        for n in nodes:
+            r = res[(n, period)]
+            load = offered_load(n, toa, period)
+            rows.append([f'{interval:g}', str(n), f'{load * 100:.2f}%', f'{analytic_pdr(n, toa, period):.4f}',
+                         f"{r['pdr']:.4f}", f"{r['pdr_ci95']:.4f}", duty, str(nmax)])
+    _print_table(rows)
+    print(f'max_nodes: analytic, PDR >= {opts.target_pdr:g}; compliance: {_duty_report(plan, plan.period_ms(intervals[0] * 1000.0))[1]}')
+
+
+def build_parser() -> argparse.ArgumentParser:
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument('--include', type=Path, default=CLIENT_INCLUDE, help='firmware include dir with config.h/protocol.h')
+    p.add_argument('-D', dest='defines', action='append', default=[], metavar='NAME=VALUE',
+                   help='override a config.h define (repeatable)')
+    p.add_argument('--target-pdr', type=float, default=0.9, help='PDR used for max nodes per gateway')
+    p.add_argument('--trials', type=int, default=8, help='Monte Carlo trials per point')
+    p.add_argument('--duration', type=float, default=3600.0, help='simulated seconds per trial')
+    p.add_argument('--jitter', type=float, default=50.0, help='per-cycle loop jitter, +/- ms')
+    p.add_argument('--drift-ppm', type=float, default=20.0, help='crystal error per node, +/- ppm')
+    p.add_argument('--seed', type=int, default=1)
+    p.add_argument('--workers', type=int, default=None, help='worker processes (default: all cores)')
+    sub = p.add_subparsers(dest='cmd', required=True)
+
+    s = sub.add_parser('show', help='parsed link configuration and time on air per frame')
+    s.set_defaults(func=cmd_show)
+
+    pl = sub.add_parser('plan', help='PDR, utilisation, duty cycle and capacity for one deployment')
+    pl.add_argument('--nodes', type=int, required=True)
+    pl.add_argument('--interval', type=float, default=None, help='seconds between readings (default TX_INTERVAL_MS)')
+    pl.set_defaults(func=cmd_plan)
+
+    sw = sub.add_parser('sweep', help='node count x interval grid, evaluated in parallel')
+    sw.add_argument('--nodes', required=True, help='list "10,50,100" or range "50:1000:50"')
+    sw.add_argument('--intervals', default='', help='seconds, comma separated (default TX_INTERVAL_MS)')
+    sw.set_defaults(func=cmd_sweep)
+    return p
+
+
+if __name__ == '__main__':
+    args = build_parser().parse_args()
+    overrides = dict(d.split('=', 1) if '=' in d else (d, 'true') for d in args.defines)
+    try:
+        link = LinkPlan(args.include, overrides)
+    except (OSError, KeyError) as exc:
+        sys.exit(f'cannot read firmware config from {args.include}: {exc}')
+    args.func(link, args)
@@ -0,0 +1,112 @@
+"""Cursor paging check for /data: every storage engine must hand a backlog over in full.
+
+The dashboard keeps the highest id it holds and asks for fetch_recent(batch, after_id=...)
+until a page comes back short. For each engine this loads an initial set of rows, takes
+the newest ones the way the dashboard's first load does, then ingests a backlog several
+batches long (spread over shards / columnar segments) and pages through it. It fails if
+any id is missing, repeated or out of order.
+
+Usage:
+    python tools/check_paging.py [--batch 50] [--backlog 175] [--engines sqlite,sharded,columnar]
+"""
+import argparse
+import shutil
+import sys
+import tempfile
+import time
+from pathlib import Path
+from typing import List
+
+sys.path.insert(0, str(Path(__file__).resolve().parent.parent))
+
+from bench_storage import synthetic  # noqa: E402
+from columnar_store import ColumnarStore  # noqa: E402
+from server import DBController  # noqa: E402
+from shard_store import ShardedStore  # noqa: E402
+
+
+def open_engine(name: str, root: Path, segment_rows: int):
+    if name == 'sqlite':
+        engine = DBController(root / 'telemetry.db')
+    elif name == 'sharded':
+        engine = ShardedStore(root / 'shards', 'day')
+    else:
+        engine = ColumnarStore(root / 'columnar', segment_rows=segment_rows, block_rows=8)
+    engine.initialize()
+    return engine
+
+
+def ingest(engine, payloads: List[dict], arrival: float) -> None:
+    if isinstance(engine, ShardedStore):
+        engine.save_many(payloads, received_at=arrival)
+    else:
+        for p in payloads:
+            engine.save(p)
+
+
+def check(name: str, root: Path, args) -> List[str]:
+    engine = open_engine(name, root, args.batch // 3)
+    day = 86400.0
+    start = int(time.time() // day) * day - 3 * day
+    rows = list(synthetic(args.initial + args.backlog, 7, start, 60.0))
+    ingest(engine, rows[:args.initial], start)
+
+    first = engine.fetch_recent(args.initial // 2)
+    last_id = max(r['id'] for r in first)
+    # The backlog arrives over three days, so it spans several shards
+    backlog = rows[args.initial:]
+    third = len(backlog) // 3 + 1
+    for k in range(3):
+        ingest(engine, backlog[k * third:(k + 1) * third], start + k * day + 1)
+    expected = list(range(last_id + 1, last_id + 1 + len(backlog)))
+
+    got: List[int] = []
+    pages = 0
+    while True:
+        page = engine.fetch_recent(args.batch, after_id=last_id)
+        pages += 1
+        ids = [r['id'] for r in page]
+        if ids != sorted(ids):
+            return [f'{name}: page {pages} not in ascending id order: {ids[:5]}...']
+        got.extend(ids)
+        if page:
+            last_id = ids[-1]
+        if len(page) < args.batch:
+            break
+    if hasattr(engine, 'close'):
+        engine.close()
+
+    problems = []
+    missing = sorted(set(expected) - set(got))
+    if missing:
+        problems.append(f'{name}: {len(missing)} id(s) never paged, first {missing[:5]}')
+    if len(got) != len(set(got)):
+        problems.append(f'{name}: ids repeated across pages')
+    print(f'{name:9} {len(backlog)} backlog rows in {pages} page(s) of {args.batch}: '
+          f'{"ok" if not problems else "FAILED"}')
+    return problems
+
+
+def main() -> None:
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument('--batch', type=int, default=50, help='page size (the dashboard uses 5000)')
+    p.add_argument('--initial', type=int, default=40, help='rows stored before the first load')
+    p.add_argument('--backlog', type=int, default=175, help='rows that arrive after it (> batch)')
+    p.add_argument('--engines', default='sqlite,sharded,columnar')
+    args = p.parse_args()
+    if args.backlog <= args.batch:
+        raise SystemExit('--backlog must be larger than --batch to exercise paging')
+
+    problems: List[str] = []
+    for name in args.engines.split(','):
+        root = Path(tempfile.mkdtemp(prefix=f'paging-{name}-'))
+        try:
+            problems += check(name, root, args)
+        finally:
+            shutil.rmtree(root, ignore_errors=True)
+    if problems:
+        raise SystemExit('\n'.join(problems))
+
+
+if __name__ == '__main__':
+    main()
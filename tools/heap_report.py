@@ -0,0 +1,128 @@
+"""Heap allocation report for the gateway's no-heap-after-boot build.
+
+The seeed_xiao_esp32s3_noheap environment wraps malloc/calloc/realloc, the
+heap_caps_* allocators and new, and counts every allocation made by the loop()
+task once setup() has finished. Each stats dump ends with '@HEAP' lines on the
+serial port:
+
+    @HEAP allocs=12 bytes=1536 warmup=3 exempt=40 overflow=0 loops=91234 ...
+    @HEAP SITE 0x42001a2b n=12 bytes=1536 max=128
+
+Counters are cumulative, so only the last dump in the log is reported. Call
+sites are resolved against the firmware ELF with addr2line (function, file:line
+and inlining chain); without --elf the raw addresses are listed.
+
+Usage:
+    pio device monitor -e seeed_xiao_esp32s3_noheap | tee gw.log
+    python tools/heap_report.py gw.log --elf .pio/build/seeed_xiao_esp32s3_noheap/firmware.elf
+    python tools/heap_report.py - < gw.log
+"""
+import argparse
+import re
+import shutil
+import subprocess
+import sys
+from typing import Dict, List, Optional, Tuple
+
+ADDR2LINE = 'xtensa-esp32s3-elf-addr2line'
+
+SUMMARY_RE = re.compile(r'@HEAP\s+(?P<fields>(?:\w+=\d+\s*)+)$')
+SITE_RE = re.compile(r'@HEAP SITE 0x(?P<pc>[0-9a-fA-F]+)\s+n=(?P<n>\d+)\s+bytes=(?P<bytes>\d+)\s+max=(?P<max>\d+)')
+TRAP_RE = re.compile(r'@HEAP TRAP 0x(?P<pc>[0-9a-fA-F]+)\s+n=(?P<n>\d+)')
+
+
+def parse_log(lines) -> Tuple[Optional[Dict[str, int]], List[Dict[str, int]], List[Tuple[int, int]]]:
+    """Returns (last summary, its sites, traps seen anywhere in the log)."""
+    summary: Optional[Dict[str, int]] = None
+    sites: List[Dict[str, int]] = []
+    traps: List[Tuple[int, int]] = []
+    for raw in lines:
+        line = raw.strip()
+        if '@HEAP' not in line:
+            continue
+        line = line[line.index('@HEAP'):]
+        m = SITE_RE.match(line)
+        if m:
+            sites.append({'pc': int(m['pc'], 16), 'n': int(m['n']),
+                          'bytes': int(m['bytes']), 'max': int(m['max'])})
+            continue
+        m = TRAP_RE.match(line)
+        if m:
+            traps.append((int(m['pc'], 16), int(m['n'])))
+            continue
+        m = SUMMARY_RE.match(line)
+        if m:
+            # New dump: the sites that follow belong to it
+            summary = {k: int(v) for k, v in (f.split('=') for f in m['fields'].split())}
+            sites = []
+    return summary, sites, traps
+
+
+def symbolize(pcs: List[int], elf: Optional[str], tool: str) -> Dict[int, str]:
+    if not elf or not pcs:
+        return {}
+    exe = shutil.which(tool)
+    if not exe:
+        print(f'warning: {tool} not found; listing raw addresses', file=sys.stderr)
+        return {}
+    # One call per address: -i prints a variable number of lines per address
+    out: Dict[int, str] = {}
+    for pc in pcs:
+        res = subprocess.run([exe, '-pfiaC', '-e', elf, f'0x{pc:08x}'],
+                             capture_output=True, text=True, check=False)
+        text = res.stdout.strip()
+        if res.returncode != 0 or not text:
+            continue
+        # "0x42001a2b: send_json(...) at src/main.cpp:123\n (inlined by) ..."
+        out[pc] = '\n'.join(l.split(': ', 1)[-1] if i == 0 else l.strip()
+                            for i, l in enumerate(text.splitlines()))
+    return out
+
+
+def main() -> None:
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument('log', help="serial log file ('-' for stdin)")
+    p.add_argument('--elf', help='firmware.elf of the noheap build, for call-site symbols')
+    p.add_argument('--addr2line', default=ADDR2LINE, help=f'addr2line binary (default: {ADDR2LINE})')
+    p.add_argument('--top', type=int, default=0, help='show only the N busiest call sites')
+    args = p.parse_args()
+
+    if args.log == '-':
+        summary, sites, traps = parse_log(sys.stdin)
+    else:
+        with open(args.log, encoding='utf-8', errors='replace') as f:
+            summary, sites, traps = parse_log(f)
+
+    if summary is None and not traps:
+        sys.exit('no @HEAP lines found (is the firmware built with the *_noheap environment?)')
+
+    sites.sort(key=lambda s: (s['n'], s['bytes']), reverse=True)
+    if args.top:
+        sites = sites[:args.top]
+    names = symbolize(sorted({s['pc'] for s in sites} | {pc for pc, _ in traps}),
+                      args.elf, args.addr2line)
+
+    if summary is not None:
+        print(f"loop() allocations: {summary.get('allocs', 0)} ({summary.get('bytes', 0)} bytes) "
+              f"over {summary.get('loops', 0)} loops")
+        print(f"  ignored: warmup {summary.get('warmup', 0)}  exempt {summary.get('exempt', 0)}  "
+              f"untracked sites {summary.get('overflow', 0)}")
+        if 'free' in summary:
+            print(f"  heap: free {summary['free']}  min free {summary['min_free']}  "
+                  f"largest block {summary['largest']}")
+        if not sites:
+            print('no allocations on the packet path')
+    for s in sites:
+        print(f"\n0x{s['pc']:08x}  count {s['n']}  bytes {s['bytes']}  largest {s['max']}")
+        if s['pc'] in names:
+            for l in names[s['pc']].splitlines():
+                print(f'    {l}')
+    for pc, n in traps:
+        print(f'\nTRAP at 0x{pc:08x} ({n} bytes)')
+        if pc in names:
+            for l in names[pc].splitlines():
+                print(f'    {l}')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,307 @@
+"""Network-level LoRa airtime simulator for the environment monitor.
+
+Models time-on-air with the Semtech SX126x formula and compares deployment
+scenarios at the channel level. Defaults mirror the firmware's config.h
+(SF9, 125 kHz, CR 4/7, 8-symbol preamble, 16-byte SensorDataMessageV2).
+
+Usage:
+    python tools/lora_sim.py toa --sf 9 --len 16
+    python tools/lora_sim.py relay --nodes 20 --interval 60 --sf-far 12 --sf-near 7 --batch 8
+    python tools/lora_sim.py lowpower --nodes 20 --interval 60 --preambles 8,16,32,64,128
+"""
+import argparse
+import math
+import random
+from dataclasses import dataclass
+from typing import Dict, List, Tuple
+
+SENSOR_FRAME_LEN = 16           # SensorDataMessageV2
+RELAY_HEADER_LEN = 4            # RelayBatchHeader
+RELAY_RECORD_LEN = 17           # RelayRecord
+RELAY_MAX_RECORDS = 14
+
+
+@dataclass(frozen=True)
+class Radio:
+    sf: int = 9
+    bw_khz: float = 125.0
+    cr: int = 7                 # RadioLib convention: 5..8 => 4/5..4/8
+    preamble: int = 8
+    explicit_header: bool = True
+    crc: bool = True
+
+    def with_sf(self, sf: int) -> 'Radio':
+        return Radio(sf, self.bw_khz, self.cr, self.preamble, self.explicit_header, self.crc)
+
+
+def symbol_time_ms(radio: Radio) -> float:
+    return (2 ** radio.sf) / radio.bw_khz
+
+
+def time_on_air_ms(payload_len: int, radio: Radio) -> float:
+    """Time on air of one LoRa packet, in milliseconds."""
+    t_sym = symbol_time_ms(radio)
+    ldro = 1 if t_sym > 16.0 else 0
+    h = 0 if radio.explicit_header else 1
+    crc = 1 if radio.crc else 0
+    num = 8 * payload_len - 4 * radio.sf + 28 + 16 * crc - 20 * h
+    den = 4 * (radio.sf - 2 * ldro)
+    payload_symbols = 8 + max(math.ceil(num / den) * radio.cr, 0)
+    return (radio.preamble + 4.25) * t_sym + payload_symbols * t_sym
+
+
+def relay_batch_len(records: int) -> int:
+    return RELAY_HEADER_LEN + records * RELAY_RECORD_LEN + 1
+
+
+def aloha_success(load_erlang: float) -> float:
+    """Unslotted ALOHA success probability for a given offered channel load (airtime/s)."""
+    return math.exp(-2.0 * load_erlang)
+
+
+def relay_scenario(nodes: int, interval_s: float, radio: Radio, sf_far: int,
+                   sf_near: int, batch: int) -> Dict[str, Dict[str, float]]:
+    """Compares far nodes talking directly to the gateway against one relay.
+
+    Direct: every far node transmits a sensor frame at sf_far.
+    Relayed: far nodes transmit at sf_near to a nearby relay, which forwards
+    readings in batches of `batch` records at the gateway link SF (radio.sf).
+    All traffic is assumed to share one channel.
+    """
+    readings_per_s = nodes / interval_s
+
+    direct_toa = time_on_air_ms(SENSOR_FRAME_LEN, radio.with_sf(sf_far))
+    direct_load = readings_per_s * direct_toa / 1000.0
+
+    near_toa = time_on_air_ms(SENSOR_FRAME_LEN, radio.with_sf(sf_near))
+    batch_toa = time_on_air_ms(relay_batch_len(batch), radio)
+    batches_per_s = readings_per_s / batch
+    relay_load = readings_per_s * near_toa / 1000.0 + batches_per_s * batch_toa / 1000.0
+
+    hop = aloha_success(relay_load)
+    return {
+        'direct': {
+            'frame_toa_ms': direct_toa,
+            'node_airtime_s_per_h': direct_toa * 3600.0 / interval_s / 1000.0,
+            'channel_airtime_s_per_h': direct_load * 3600.0,
+            'channel_load': direct_load,
+            'pdr': aloha_success(direct_load),
+        },
+        'relayed': {
+            'frame_toa_ms': near_toa,
+            'batch_toa_ms': batch_toa,
+            'node_airtime_s_per_h': near_toa * 3600.0 / interval_s / 1000.0,
+            'relay_airtime_s_per_h': batches_per_s * batch_toa * 3600.0 / 1000.0,
+            'channel_airtime_s_per_h': relay_load * 3600.0,
+            'channel_load': relay_load,
+            'pdr': hop * hop,
+        },
+    }
+
+
+def duty_cycle_periods_us(preamble: int, min_symbols: int, radio: Radio) -> Tuple[int, int]:
+    """(listen, sleep) periods in us as chosen by RadioLib's startReceiveDutyCycleAuto.
+
+    Returns (0, 0) when the preamble is too short to sleep at all; RadioLib
+    then falls back to continuous RX.
+    """
+    symbol_us = int(1000 * (1 << radio.sf) / radio.bw_khz)
+    if 2 * min_symbols > preamble:
+        return 0, 0
+    sleep_us = symbol_us * (preamble - 2 * min_symbols)
+    if sleep_us < 1000:
+        return 0, 0
+    wake_us = max((symbol_us * (preamble + 1) - (sleep_us - 1000)) // 2,
+                  symbol_us * (min_symbols + 1))
+    return wake_us, sleep_us
+
+
+def detection_probability(preamble: int, min_symbols: int, radio: Radio, startup_us: float,
+                          trials: int, rng: random.Random) -> float:
+    """Fraction of preambles that overlap a listen window by at least min_symbols.
+
+    The preamble starts at a uniformly random phase of the listen/sleep cycle;
+    the first startup_us of each listen window are deaf (wake-up and PLL lock).
+    """
+    wake_us, sleep_us = duty_cycle_periods_us(preamble, min_symbols, radio)
+    if wake_us == 0:
+        return 1.0
+    t_sym = symbol_time_ms(radio) * 1000.0
+    period = wake_us + sleep_us
+    length = preamble * t_sym
+    need = min_symbols * t_sym
+    hits = 0
+    for _ in range(trials):
+        start = rng.uniform(0.0, period)
+        k = math.floor((start - wake_us) / period)
+        while k * period <= start + length:
+            lo = max(k * period + startup_us, start)
+            hi = min(k * period + wake_us, start + length)
+            if hi - lo >= need:
+                hits += 1
+                break
+            k += 1
+    return hits / trials
+
+
+def lowpower_scenario(nodes: int, interval_s: float, radio: Radio, preamble: int,
+                      args: argparse.Namespace, rng: random.Random) -> Dict[str, float]:
+    """Gateway energy, added latency and delivery for one client preamble length.
+
+    Continuous mode: radio always in RX and MCU always awake. Duty-cycled mode:
+    radio listens for wake_us every wake_us + sleep_us (plus full RX during
+    received packets) and the MCU light-sleeps except for per-packet handling
+    and periodic housekeeping wakes.
+    """
+    r = Radio(radio.sf, radio.bw_khz, radio.cr, preamble)
+    toa = time_on_air_ms(args.len, r)
+    wake_us, sleep_us = duty_cycle_periods_us(preamble, args.min_symbols, r)
+    continuous = wake_us == 0 or preamble == radio.preamble
+    pkts_per_s = nodes / interval_s
+    rx_frac = min(pkts_per_s * toa / 1000.0, 1.0)
+
+    if continuous:
+        duty = 1.0
+        radio_ma = args.rx_ma
+        mcu_ma = args.mcu_ma
+        detect = 1.0
+    else:
+        duty = wake_us / (wake_us + sleep_us)
+        on = duty + rx_frac * (1.0 - duty)
+        radio_ma = on * args.rx_ma + (1.0 - on) * args.radio_sleep_ma
+        awake = min((pkts_per_s * args.handle_ms + 1000.0 / args.max_sleep_ms * args.tick_ms) / 1000.0, 1.0)
+        mcu_ma = awake * args.mcu_ma + (1.0 - awake) * args.mcu_sleep_ma
+        detect = detection_probability(preamble, args.min_symbols, r, args.startup_us,
+                                       args.trials, rng)
+
+    load = pkts_per_s * toa / 1000.0
+    gw_ma = radio_ma + mcu_ma
+    return {
+        'continuous': continuous,
+        'wake_ms': wake_us / 1000.0,
+        'sleep_ms': sleep_us / 1000.0,
+        'duty': duty,
+        'toa_ms': toa,
+        'latency_ms': (preamble - radio.preamble) * symbol_time_ms(r),
+        'detect': detect,
+        'pdr': detect * aloha_success(load),
+        'gw_ma': gw_ma,
+        'gw_mwh_per_h': gw_ma * args.volts,
+        'days': args.battery_mah / gw_ma / 24.0,
+        'node_mj': args.volts * args.tx_ma * toa / 1000.0,
+    }
+
+
+def _print_table(rows: List[List[str]]) -> None:
+    widths = [max(len(r[i]) for r in rows) for i in range(len(rows[0]))]
+    for r in rows:
+        print('  '.join(c.ljust(w) for c, w in zip(r, widths)))
+
+
+def cmd_toa(args: argparse.Namespace) -> None:
+    radio = Radio(args.sf, args.bw, args.cr, args.preamble)
+    rows = [['frame', 'bytes', 'toa_ms']]
+    frames = [('SensorDataMessageV2', SENSOR_FRAME_LEN)]
+    frames += [(f'RelayBatch x{n}', relay_batch_len(n)) for n in (1, 4, 8, RELAY_MAX_RECORDS)]
+    if args.len:
+        frames.append(('custom', args.len))
+    for name, length in frames:
+        rows.append([name, str(length), f'{time_on_air_ms(length, radio):.1f}'])
+    _print_table(rows)
+
+
+def cmd_relay(args: argparse.Namespace) -> None:
+    radio = Radio(args.sf, args.bw, args.cr, args.preamble)
+    res = relay_scenario(args.nodes, args.interval, radio, args.sf_far, args.sf_near, args.batch)
+    d, r = res['direct'], res['relayed']
+    print(f'{args.nodes} far node(s) every {args.interval:g}s; relay batch {args.batch} '
+          f'(SF{args.sf_near} to relay, SF{args.sf} relay->gateway, direct SF{args.sf_far})')
+    rows = [
+        ['', 'direct', 'relayed'],
+        ['frame ToA (ms)', f"{d['frame_toa_ms']:.1f}", f"{r['frame_toa_ms']:.1f}"],
+        ['per-node airtime (s/h)', f"{d['node_airtime_s_per_h']:.2f}", f"{r['node_airtime_s_per_h']:.2f}"],
+        ['relay airtime (s/h)', '-', f"{r['relay_airtime_s_per_h']:.2f}"],
+        ['channel airtime (s/h)', f"{d['channel_airtime_s_per_h']:.1f}", f"{r['channel_airtime_s_per_h']:.1f}"],
+        ['channel load (Erl)', f"{d['channel_load']:.4f}", f"{r['channel_load']:.4f}"],
+        ['end-to-end PDR (ALOHA)', f"{d['pdr']:.4f}", f"{r['pdr']:.4f}"],
+    ]
+    _print_table(rows)
+    saving = 1.0 - r['channel_airtime_s_per_h'] / d['channel_airtime_s_per_h']
+    print(f'Channel airtime saving with relay: {saving * 100:.1f}%')
+
+
+def cmd_lowpower(args: argparse.Namespace) -> None:
+    radio = Radio(args.sf, args.bw, args.cr, args.preamble)
+    rng = random.Random(args.seed)
+    preambles = sorted({int(p) for p in args.preambles.split(',')} | {args.preamble})
+    print(f'{args.nodes} node(s) every {args.interval:g}s, {args.len}-byte frame, SF{args.sf}/{args.bw:g} kHz; '
+          f'duty-cycled RX with {args.min_symbols} min symbols, {args.battery_mah:g} mAh battery')
+    rows = [['preamble', 'mode', 'listen/sleep ms', 'radio on', 'toa ms', '+latency ms',
+             'detect', 'pdr', 'gw mA', 'gw mWh/h', 'days', 'node mJ/tx']]
+    for p in preambles:
+        res = lowpower_scenario(args.nodes, args.interval, radio, p, args, rng)
+        rows.append([
+            str(p),
+            'continuous' if res['continuous'] else 'duty-cycle',
+            '-' if res['continuous'] else f"{res['wake_ms']:.1f}/{res['sleep_ms']:.1f}",
+            f"{res['duty'] * 100:.1f}%",
+            f"{res['toa_ms']:.1f}",
+            f"{res['latency_ms']:.1f}",
+            f"{res['detect']:.4f}",
+            f"{res['pdr']:.4f}",
+            f"{res['gw_ma']:.2f}",
+            f"{res['gw_mwh_per_h']:.1f}",
+            f"{res['days']:.1f}",
+            f"{res['node_mj']:.1f}",
+        ])
+    _print_table(rows)
+    print('latency is the extra preamble airtime before the packet ends; detect is the Monte Carlo '
+          'fraction of preambles caught by a listen window.')
+
+
+def build_parser() -> argparse.ArgumentParser:
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument('--sf', type=int, default=9, help='gateway link spreading factor (LORA_SF)')
+    p.add_argument('--bw', type=float, default=125.0, help='bandwidth in kHz')
+    p.add_argument('--cr', type=int, default=7, help='coding rate denominator (5..8)')
+    p.add_argument('--preamble', type=int, default=8, help='preamble length in symbols')
+    sub = p.add_subparsers(dest='cmd', required=True)
+
+    t = sub.add_parser('toa', help='time on air per frame type')
+    t.add_argument('--len', type=int, default=0, help='extra payload length to evaluate')
+    t.set_defaults(func=cmd_toa)
+
+    r = sub.add_parser('relay', help='airtime of direct far nodes vs a batching relay')
+    r.add_argument('--nodes', type=int, default=20)
+    r.add_argument('--interval', type=float, default=60.0, help='seconds between readings per node')
+    r.add_argument('--sf-far', type=int, default=12, help='SF far nodes need to reach the gateway')
+    r.add_argument('--sf-near', type=int, default=7, help='SF far nodes use to reach the relay')
+    r.add_argument('--batch', type=int, default=8, choices=range(1, RELAY_MAX_RECORDS + 1), metavar='1..14')
+    r.set_defaults(func=cmd_relay)
+
+    lp = sub.add_parser('lowpower', help='gateway energy vs latency/loss with duty-cycled RX (LOW_POWER_RX)')
+    lp.add_argument('--nodes', type=int, default=20)
+    lp.add_argument('--interval', type=float, default=60.0, help='seconds between uplinks per node')
+    lp.add_argument('--len', type=int, default=SENSOR_FRAME_LEN, help='uplink frame length in bytes')
+    lp.add_argument('--preambles', default='16,32,64,128', help='client preamble lengths to compare (LP_PREAMBLE)')
+    lp.add_argument('--min-symbols', type=int, default=8, help='LP_MIN_SYMBOLS')
+    lp.add_argument('--max-sleep-ms', type=float, default=1000.0, help='LP_MAX_SLEEP_MS housekeeping period')
+    lp.add_argument('--tick-ms', type=float, default=2.0, help='MCU awake time per housekeeping wake')
+    lp.add_argument('--handle-ms', type=float, default=15.0, help='MCU awake time per received packet')
+    lp.add_argument('--rx-ma', type=float, default=4.6, help='SX1262 RX current')
+    lp.add_argument('--radio-sleep-ma', type=float, default=0.0012, help='SX1262 warm sleep current')
+    lp.add_argument('--mcu-ma', type=float, default=40.0, help='ESP32-S3 active current')
+    lp.add_argument('--mcu-sleep-ma', type=float, default=0.24, help='ESP32-S3 light sleep current')
+    lp.add_argument('--tx-ma', type=float, default=90.0, help='client TX current (for node energy per uplink)')
+    lp.add_argument('--volts', type=float, default=3.3)
+    lp.add_argument('--battery-mah', type=float, default=3000.0)
+    lp.add_argument('--startup-us', type=float, default=1000.0, help='deaf time at the start of each listen window')
+    lp.add_argument('--trials', type=int, default=20000, help='Monte Carlo trials per preamble')
+    lp.add_argument('--seed', type=int, default=1)
+    lp.set_defaults(func=cmd_lowpower)
+    return p
+
+
+if __name__ == '__main__':
+    args = build_parser().parse_args()
+    args.func(args)
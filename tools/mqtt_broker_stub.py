@@ -0,0 +1,202 @@
+"""Minimal MQTT 3.1.1 broker stand-in for testing the gateway's MQTT output.
+
+Speaks just enough of the protocol for the gateway (CONNECT with persistent
+sessions, PUBLISH QoS 0/1, PINGREQ, DISCONNECT) plus SUBSCRIBE so other tools can
+watch the traffic. Received publishes are logged with per-topic counters, and the
+--ack-delay-ms / --drop-acks options exercise the gateway's backpressure path.
+
+Usage:
+    python tools/mqtt_broker_stub.py --port 1883 [--ack-delay-ms 200] [--drop-acks 0.1]
+"""
+import argparse
+import json
+import random
+import socket
+import struct
+import threading
+import time
+from collections import Counter
+from typing import Dict, List, Optional, Tuple
+
+CONNECT, CONNACK, PUBLISH, PUBACK = 1, 2, 3, 4
+SUBSCRIBE, SUBACK, PINGREQ, PINGRESP, DISCONNECT = 8, 9, 12, 13, 14
+
+
+def encode_length(n: int) -> bytes:
+    out = bytearray()
+    while True:
+        b = n % 128
+        n //= 128
+        out.append(b | (0x80 if n else 0))
+        if not n:
+            return bytes(out)
+
+
+def read_exact(sock: socket.socket, n: int) -> bytes:
+    buf = bytearray()
+    while len(buf) < n:
+        chunk = sock.recv(n - len(buf))
+        if not chunk:
+            raise ConnectionError('peer closed')
+        buf.extend(chunk)
+    return bytes(buf)
+
+
+def read_packet(sock: socket.socket) -> Tuple[int, int, bytes]:
+    first = read_exact(sock, 1)[0]
+    mult, length = 1, 0
+    while True:
+        b = read_exact(sock, 1)[0]
+        length += (b & 0x7F) * mult
+        if not b & 0x80:
+            break
+        mult *= 128
+    return first >> 4, first & 0x0F, read_exact(sock, length)
+
+
+def read_str(body: bytes, pos: int) -> Tuple[str, int]:
+    (n,) = struct.unpack_from('!H', body, pos)
+    return body[pos + 2:pos + 2 + n].decode('utf-8', errors='replace'), pos + 2 + n
+
+
+def topic_matches(pattern: str, topic: str) -> bool:
+    p, t = pattern.split('/'), topic.split('/')
+    for i, part in enumerate(p):
+        if part == '#':
+            return True
+        if i >= len(t) or (part != '+' and part != t[i]):
+            return False
+    return len(p) == len(t)
+
+
+class Broker:
+    def __init__(self, ack_delay_s: float, drop_acks: float, quiet: bool):
+        self.ack_delay_s = ack_delay_s
+        self.drop_acks = drop_acks
+        self.quiet = quiet
+        self.sessions: Dict[str, bool] = {}
+        self.subscribers: List[Tuple[str, socket.socket]] = []
+        self.topics: Counter = Counter()
+        self.records = 0
+        self.lock = threading.Lock()
+
+    def handle(self, sock: socket.socket, addr) -> None:
+        client_id: Optional[str] = None
+        try:
+            while True:
+                ptype, flags, body = read_packet(sock)
+                if ptype == CONNECT:
+                    client_id, clean = self._connect(body)
+                    with self.lock:
+                        present = (not clean) and client_id in self.sessions
+                        self.sessions[client_id] = True
+                    sock.sendall(bytes([CONNACK << 4, 2, 1 if present else 0, 0]))
+                    print(f'[broker] CONNECT {client_id} from {addr[0]} clean={clean} session_present={present}')
+                elif ptype == PUBLISH:
+                    self._publish(sock, flags, body)
+                elif ptype == SUBSCRIBE:
+                    self._subscribe(sock, body)
+                elif ptype == PINGREQ:
+                    sock.sendall(bytes([PINGRESP << 4, 0]))
+                elif ptype == DISCONNECT:
+                    break
+        except (ConnectionError, OSError):
+            pass
+        finally:
+            with self.lock:
+                self.subscribers = [s for s in self.subscribers if s[1] is not sock]
+            sock.close()
+            print(f'[broker] {client_id or addr[0]} disconnected')
+
+    @staticmethod
+    def _connect(body: bytes) -> Tuple[str, bool]:
+        _, pos = read_str(body, 0)              # protocol name
+        flags = body[pos + 1]
+        client_id, _ = read_str(body, pos + 4)  # level, flags, keepalive
+        return client_id, bool(flags & 0x02)
+
+    def _publish(self, sock: socket.socket, flags: int, body: bytes) -> None:
+        qos = (flags >> 1) & 0x03
+        topic, pos = read_str(body, 0)
+        packet_id = None
+        if qos > 0:
+            (packet_id,) = struct.unpack_from('!H', body, pos)
+            pos += 2
+        payload = body[pos:]
+
+        n = 1
+        try:
+            doc = json.loads(payload)
+            n = len(doc) if isinstance(doc, list) else 1
+        except ValueError:
+            pass
+        with self.lock:
+            self.topics[topic] += 1
+            self.records += n
+            subs = [s for p, s in self.subscribers if topic_matches(p, topic)]
+        if not self.quiet:
+            print(f'[broker] PUBLISH qos={qos} {topic} ({len(payload)} B, {n} record(s))')
+
+        for s in subs:
+            try:
+                s.sendall(bytes([PUBLISH << 4]) + encode_length(2 + len(topic) + len(payload))
+                          + struct.pack('!H', len(topic)) + topic.encode() + payload)
+            except OSError:
+                pass
+
+        if qos == 1:
+            if self.ack_delay_s:
+                time.sleep(self.ack_delay_s)
+            if random.random() >= self.drop_acks:
+                sock.sendall(bytes([PUBACK << 4, 2]) + struct.pack('!H', packet_id))
+
+    def _subscribe(self, sock: socket.socket, body: bytes) -> None:
+        (packet_id,) = struct.unpack_from('!H', body, 0)
+        pos, granted = 2, []
+        while pos < len(body):
+            pattern, pos = read_str(body, pos)
+            pos += 1
+            granted.append(0)
+            with self.lock:
+                self.subscribers.append((pattern, sock))
+        sock.sendall(bytes([SUBACK << 4]) + encode_length(2 + len(granted))
+                     + struct.pack('!H', packet_id) + bytes(granted))
+
+    def report(self, period: float) -> None:
+        last = 0
+        while True:
+            time.sleep(period)
+            with self.lock:
+                total, topics = self.records, len(self.topics)
+            print(f'[broker] {total} record(s) on {topics} topic(s), {(total - last) / period:.1f} rec/s')
+            last = total
+
+
+def main() -> None:
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument('--bind', default='0.0.0.0')
+    p.add_argument('--port', type=int, default=1883)
+    p.add_argument('--ack-delay-ms', type=float, default=0.0, help='delay before each PUBACK')
+    p.add_argument('--drop-acks', type=float, default=0.0, help='fraction of PUBACKs never sent')
+    p.add_argument('--report-every', type=float, default=10.0, help='seconds between rate reports')
+    p.add_argument('--quiet', action='store_true', help='do not log every publish')
+    args = p.parse_args()
+
+    broker = Broker(args.ack_delay_ms / 1000.0, args.drop_acks, args.quiet)
+    threading.Thread(target=broker.report, args=(args.report_every,), daemon=True).start()
+
+    srv = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    srv.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    srv.bind((args.bind, args.port))
+    srv.listen(16)
+    print(f'[broker] listening on {args.bind}:{args.port}')
+    try:
+        while True:
+            sock, addr = srv.accept()
+            threading.Thread(target=broker.handle, args=(sock, addr), daemon=True).start()
+    except KeyboardInterrupt:
+        print('\n[broker] stopping')
+
+
+if __name__ == '__main__':
+    main()